@@ -8,6 +8,9 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <cstring>
+#include <vector>
+
 #include <be_io_recordstore.h>
 #include <be_memory_autoarrayiterator.h>
 
@@ -220,6 +223,47 @@ getDescription(
 	return (rsCPtr->getRecordStore()->getDescription());
 }
 
+/**
+ * @brief
+ * Copy record data into an R raw vector.
+ *
+ * @param data
+ * Record data.
+ *
+ * @return
+ * RawVector with the contents of data.
+ */
+static Rcpp::RawVector
+toRawVector(
+    const BE::Memory::uint8Array &data)
+{
+	Rcpp::RawVector rv(data.size());
+	std::copy(data.cbegin(), data.cend(), rv.begin());
+	return (rv);
+}
+
+/**
+ * @brief
+ * Convert an R character to a key.
+ *
+ * @param keys
+ * R characters of keys.
+ * @param i
+ * Index of the key to convert.
+ *
+ * @return
+ * The key at index i of keys.
+ */
+static std::string
+keyAt(
+    const Rcpp::CharacterVector &keys,
+    R_xlen_t i)
+{
+	if (Rcpp::CharacterVector::is_na(keys[i]))
+		Rf_error("Key %ld is NA", static_cast<long>(i + 1));
+	return (Rcpp::as<std::string>(keys[i]));
+}
+
 /**
  * @brief
  * Read a single record from a RecordStore.
@@ -241,10 +285,7 @@ read(
 	Rcpp::XPtr<RecordStoreContainer> rsCPtr(containerFromR);
 
 	try {
-		const auto data = rsCPtr->getRecordStore()->read(key);
-		Rcpp::RawVector rv(data.size());
-		std::copy(data.cbegin(), data.cend(), rv.begin());
-		return (rv);
+		return (toRawVector(rsCPtr->getRecordStore()->read(key)));
 	} catch (BE::Error::Exception &e) {
 		Rf_error(e.what());
 	}
@@ -389,3 +430,314 @@ readAll(
 		return (readAllKeys(rs));
 }
 
+/**
+ * @brief
+ * Read several records from a RecordStore in one call.
+ *
+ * @param recordStore
+ * R pointer to RecordStoreContainer.
+ * @param keys
+ * R characters of keys of records in recordStore.
+ * @param ignoreMissing
+ * Whether keys that are not in recordStore produce NULL instead of an error.
+ *
+ * @return
+ * R list of R raws of the records associated with keys, named by key, in
+ * the order of keys.
+ */
+// [[Rcpp::export]]
+Rcpp::List
+readKeys(
+    SEXP recordStore,
+    const Rcpp::CharacterVector keys,
+    const bool ignoreMissing = false)
+{
+	const Rcpp::XPtr<RecordStoreContainer> rsCPtr(recordStore);
+	const std::shared_ptr<BE::IO::RecordStore> rs =
+	    rsCPtr->getRecordStore();
+
+	/* Sized once; elements for missing keys are left NULL */
+	Rcpp::List data(keys.size());
+	for (R_xlen_t i = 0; i < keys.size(); i++) {
+		try {
+			data[i] = toRawVector(rs->read(keyAt(keys, i)));
+		} catch (BE::Error::ObjectDoesNotExist &e) {
+			if (!ignoreMissing)
+				Rf_error(e.what());
+		} catch (BE::Error::Exception &e) {
+			Rf_error(e.what());
+		}
+	}
+
+	data.names() = keys;
+	return (data);
+}
+
+/**
+ * @brief
+ * Read a range of records from a RecordStore in one call.
+ *
+ * @param recordStore
+ * R pointer to RecordStoreContainer.
+ * @param first
+ * Position of the first record to read, starting at 1, in the order
+ * returned by readAll().
+ * @param last
+ * Position of the last record to read.  Positions past the end of
+ * recordStore are ignored.
+ * @param readData
+ * Whether or not to read data as well as keys.
+ *
+ * @return
+ * R list of an R list of R characters of keys and an R list of R raws of
+ * records associated with said keys when readData is true, or an R list
+ * of R characters of keys othewise.
+ */
+// [[Rcpp::export]]
+Rcpp::List
+readRange(
+    SEXP recordStore,
+    const int first,
+    const int last,
+    const bool readData = true)
+{
+	const Rcpp::XPtr<RecordStoreContainer> rsCPtr(recordStore);
+	const std::shared_ptr<BE::IO::RecordStore> rs =
+	    rsCPtr->getRecordStore();
+
+	if ((first < 1) || (last < first))
+		Rf_error("Invalid range (%d-%d)", first, last);
+	const uint64_t count = rs->getCount();
+	const uint64_t end = std::min<uint64_t>(last, count);
+	const uint64_t numElements = (static_cast<uint64_t>(first) > count ?
+	    0 : end - first + 1);
+
+	std::vector<std::string> keys;
+	keys.reserve(numElements);
+	Rcpp::List data(readData ? numElements : 0);
+
+	int cursor = BE::IO::RecordStore::BE_RECSTORE_SEQ_START;
+	try {
+		/* Sequence past the records before first without reading */
+		for (int i = 1; (i < first) && (numElements > 0); i++) {
+			rs->sequenceKey(cursor);
+			cursor = BE::IO::RecordStore::BE_RECSTORE_SEQ_NEXT;
+		}
+
+		for (uint64_t i = 0; i < numElements; i++) {
+			if (readData) {
+				const auto record = rs->sequence(cursor);
+				keys.emplace_back(record.key);
+				data[i] = toRawVector(record.data);
+			} else {
+				keys.emplace_back(rs->sequenceKey(cursor));
+			}
+			cursor = BE::IO::RecordStore::BE_RECSTORE_SEQ_NEXT;
+		}
+	} catch (BE::Error::Exception &e) {
+		Rf_error(e.what());
+	}
+
+	if (!readData)
+		return (Rcpp::List::create(Rcpp::Named("key") = keys));
+
+	Rcpp::List rv;
+	rv["key"] = keys;
+	data.names() = keys;
+	rv["data"] = data;
+	return (rv);
+}
+
+/** Location and encoding of one numeric field of a score record. */
+struct ScoreField
+{
+	/** Offset of the field within the record, in bytes. */
+	uint64_t offset;
+	/** Size of the field, in bytes. */
+	unsigned int size;
+	/** Whether an integer field is two's complement. */
+	bool isSigned;
+	/** Whether the field is an IEEE 754 floating point value. */
+	bool isFloat;
+};
+
+/**
+ * @brief
+ * Describe a field of a score record.
+ *
+ * @param type
+ * One of int8, uint8, int16, uint16, int32, uint32, int64, uint64, float,
+ * or double.
+ * @param offset
+ * Offset of the field within the record, in bytes.
+ *
+ * @return
+ * Description of the field.
+ */
+static ScoreField
+scoreField(
+    const std::string &type,
+    const uint64_t offset)
+{
+	static const struct {
+		const char *name;
+		unsigned int size;
+		bool isSigned;
+		bool isFloat;
+	} types[] = {
+	    {"int8", 1, true, false}, {"uint8", 1, false, false},
+	    {"int16", 2, true, false}, {"uint16", 2, false, false},
+	    {"int32", 4, true, false}, {"uint32", 4, false, false},
+	    {"int64", 8, true, false}, {"uint64", 8, false, false},
+	    {"float", 4, true, true}, {"double", 8, true, true}};
+
+	for (const auto &t : types)
+		if (type == t.name)
+			return (ScoreField{offset, t.size, t.isSigned,
+			    t.isFloat});
+	Rf_error("Unknown column type \"%s\"", type.c_str());
+}
+
+/**
+ * @brief
+ * Decode one field of a score record.
+ *
+ * @param record
+ * Start of the record.
+ * @param field
+ * Field to decode, which must lie within the record.
+ * @param bigEndian
+ * Whether the record is big-endian rather than little-endian.
+ *
+ * @return
+ * Value of the field.
+ */
+static double
+decodeScoreField(
+    const uint8_t *record,
+    const ScoreField &field,
+    const bool bigEndian)
+{
+	uint64_t bits = 0;
+	for (unsigned int i = 0; i < field.size; i++)
+		bits |= static_cast<uint64_t>(record[field.offset + i]) <<
+		    (8 * (bigEndian ? (field.size - 1 - i) : i));
+
+	if (field.isFloat) {
+		if (field.size == sizeof(float)) {
+			const uint32_t bits32 = static_cast<uint32_t>(bits);
+			float value;
+			std::memcpy(&value, &bits32, sizeof(value));
+			return (value);
+		}
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return (value);
+	}
+
+	if (!field.isSigned)
+		return (static_cast<double>(bits));
+	/* Sign-extend */
+	if ((field.size < sizeof(bits)) &&
+	    ((bits >> ((8 * field.size) - 1)) & 1))
+		bits |= ~UINT64_C(0) << (8 * field.size);
+	return (static_cast<double>(static_cast<int64_t>(bits)));
+}
+
+/**
+ * @brief
+ * Read fixed-layout binary score records into a data.frame.
+ *
+ * @param recordStore
+ * R pointer to RecordStoreContainer.
+ * @param keys
+ * R characters of keys of score records in recordStore.
+ * @param columnNames
+ * Names of the numeric columns to create, one per field.
+ * @param columnTypes
+ * Type of each field: int8, uint8, int16, uint16, int32, uint32, int64,
+ * uint64, float, or double.
+ * @param offsets
+ * Offset in bytes of each field within a record.  When empty, fields
+ * are packed one after another from the start of the record.
+ * @param bigEndian
+ * Whether fields are big-endian rather than little-endian.
+ *
+ * @return
+ * data.frame with a "key" column of keys and one numeric column per field,
+ * one row per key.
+ */
+// [[Rcpp::export]]
+Rcpp::List
+readScores(
+    SEXP recordStore,
+    const Rcpp::CharacterVector keys,
+    const Rcpp::CharacterVector columnNames,
+    const Rcpp::CharacterVector columnTypes,
+    const Rcpp::IntegerVector offsets = Rcpp::IntegerVector::create(),
+    const bool bigEndian = false)
+{
+	const Rcpp::XPtr<RecordStoreContainer> rsCPtr(recordStore);
+	const std::shared_ptr<BE::IO::RecordStore> rs =
+	    rsCPtr->getRecordStore();
+
+	const R_xlen_t numColumns = columnNames.size();
+	if (columnTypes.size() != numColumns)
+		Rf_error("columnNames and columnTypes differ in length");
+	if ((offsets.size() != 0) && (offsets.size() != numColumns))
+		Rf_error("offsets and columnNames differ in length");
+
+	std::vector<ScoreField> fields;
+	uint64_t recordSize = 0, offset = 0;
+	for (R_xlen_t i = 0; i < numColumns; i++) {
+		if (offsets.size() != 0) {
+			if ((offsets[i] == NA_INTEGER) || (offsets[i] < 0))
+				Rf_error("Invalid offset for column %ld",
+				    static_cast<long>(i + 1));
+			offset = offsets[i];
+		}
+		fields.push_back(scoreField(Rcpp::as<std::string>(
+		    columnTypes[i]), offset));
+		offset += fields.back().size;
+		recordSize = std::max(recordSize, offset);
+	}
+
+	/* Decode straight into the columns, without R raw vectors */
+	const R_xlen_t numRows = keys.size();
+	std::vector<Rcpp::NumericVector> columns;
+	columns.reserve(numColumns);
+	for (R_xlen_t i = 0; i < numColumns; i++)
+		columns.emplace_back(numRows);
+
+	for (R_xlen_t row = 0; row < numRows; row++) {
+		BE::Memory::uint8Array record;
+		try {
+			record = rs->read(keyAt(keys, row));
+		} catch (BE::Error::Exception &e) {
+			Rf_error(e.what());
+		}
+		if (record.size() < recordSize)
+			Rf_error("Record for %s is %lu bytes, but fields "
+			    "require %lu", keyAt(keys, row).c_str(),
+			    static_cast<unsigned long>(record.size()),
+			    static_cast<unsigned long>(recordSize));
+
+		for (R_xlen_t i = 0; i < numColumns; i++)
+			columns[i][row] = decodeScoreField(record, fields[i],
+			    bigEndian);
+	}
+
+	Rcpp::List df(numColumns + 1);
+	Rcpp::CharacterVector names(numColumns + 1);
+	df[0] = keys;
+	names[0] = "key";
+	for (R_xlen_t i = 0; i < numColumns; i++) {
+		df[i + 1] = columns[i];
+		names[i + 1] = columnNames[i];
+	}
+	df.attr("names") = names;
+	df.attr("row.names") = Rcpp::IntegerVector::create(NA_INTEGER,
+	    -static_cast<int>(numRows));
+	df.attr("class") = "data.frame";
+	return (df);
+}
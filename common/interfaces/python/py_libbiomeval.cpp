@@ -12,6 +12,7 @@
 #include "py_libbiomeval.h"
 
 namespace PBE = PythonBiometricEvaluation;
+using namespace BE::Framework::Enumeration;
 
 /** Public methods of the BiometricEvaluation module. */
 static PyMethodDef biomeval_methods[] =
@@ -27,6 +28,10 @@ initBiometricEvaluation()
 	RSType.tp_new = PyType_GenericNew;
 	if (PyType_Ready(&RSType) < 0)
 		return;
+	if (PyType_Ready(&RecordBufferType) < 0)
+		return;
+	if (PyType_Ready(&RSBatchIterType) < 0)
+		return;
 	
 	module = Py_InitModule3(PBE::MODULE_NAME.c_str(), biomeval_methods,
 	    "NIST Image Group Biometric Evaluation");
@@ -18,13 +18,36 @@
 
 #include "py_recordstore.h"
 
+#include <exception>
 #include <memory>
+#include <new>
+#include <vector>
 #include <be_io_recordstore.h>
-#include <be_io_recordstoreiterator.h>
 
 namespace BE = BiometricEvaluation;
 namespace PBE = PythonBiometricEvaluation;
 namespace PRS = PythonBiometricEvaluation::RecordStore;
+using namespace BE::Framework::Enumeration;
+
+/**
+ * @brief
+ * Check whether the RecordStore is being used by another thread that
+ * released the GIL.
+ *
+ * @return
+ * true, with a Python exception set, if the RecordStore is in use.
+ */
+static bool
+RSObject_isBusy(
+    RSObject *self)
+{
+	if (!self->busy)
+		return (false);
+
+	PyErr_SetString(PyExc_RuntimeError, (PRS::OBJECT_NAME + " is in "
+	    "use by another thread").c_str());
+	return (true);
+}
 
 /*
  * Iterators.
@@ -45,6 +68,8 @@ RSObject_iternext(
 {
 	BE::IO::RecordStore::Record record;
 	RSObject *rsSelf = (RSObject *)self;
+	if (RSObject_isBusy(rsSelf))
+		return (nullptr);
 
 	/* Set the cursor before sequencing in case an exception is thrown */
 	bool firstTime =
@@ -69,6 +94,265 @@ RSObject_iternext(
 	    record.data.size()));
 }
 
+/*
+ * Zero-copy access.
+ */
+
+static void
+RecordBuffer_dealloc(
+    PyObject *self)
+{
+	((RecordBufferObject*)self)->data.~AutoArray();
+	self->ob_type->tp_free(self);
+}
+
+static int
+RecordBuffer_getbuffer(
+    PyObject *self,
+    Py_buffer *view,
+    int flags)
+{
+	BE::Memory::uint8Array &data = ((RecordBufferObject*)self)->data;
+	return (PyBuffer_FillInfo(view, self, data, data.size(), 1, flags));
+}
+
+static Py_ssize_t
+RecordBuffer_getreadbuffer(
+    PyObject *self,
+    Py_ssize_t segment,
+    void **ptr)
+{
+	if (segment != 0) {
+		PyErr_SetString(PyExc_SystemError, "Accessing non-existent "
+		    "segment");
+		return (-1);
+	}
+
+	BE::Memory::uint8Array &data = ((RecordBufferObject*)self)->data;
+	*ptr = data;
+	return (data.size());
+}
+
+static Py_ssize_t
+RecordBuffer_getsegcount(
+    PyObject *self,
+    Py_ssize_t *lenp)
+{
+	if (lenp != nullptr)
+		*lenp = ((RecordBufferObject*)self)->data.size();
+	return (1);
+}
+
+/** Buffer protocols supported by RecordBuffer. */
+static PyBufferProcs RecordBuffer_as_buffer =
+{
+	RecordBuffer_getreadbuffer,			/* bf_getreadbuffer */
+	0,						/* bf_getwritebuffer */
+	RecordBuffer_getsegcount,			/* bf_getsegcount */
+	(charbufferproc)RecordBuffer_getreadbuffer,	/* bf_getcharbuffer */
+	RecordBuffer_getbuffer,				/* bf_getbuffer */
+	0						/* bf_releasebuffer */
+};
+
+PyObject*
+RecordBuffer_asMemoryView(
+    BE::Memory::uint8Array &&data)
+{
+	RecordBufferObject *buffer = PyObject_New(RecordBufferObject,
+	    &RecordBufferType);
+	if (buffer == nullptr)
+		return (nullptr);
+	new (&buffer->data) BE::Memory::uint8Array(std::move(data));
+
+	/* The memoryview holds the only remaining reference to buffer */
+	PyObject *view = PyMemoryView_FromObject((PyObject*)buffer);
+	Py_DECREF(buffer);
+	return (view);
+}
+
+PyObject*
+RSObject_readBuffer(
+    RSObject *self,
+    PyObject *args,
+    PyObject *kwds)
+{
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
+	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(), nullptr};
+	char *pyKey = nullptr;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s",
+	    const_cast<char**>(kwlist), &pyKey))
+	    	return (PBE::parameterException());
+
+	std::string key;
+	try {
+		key = PBE::parseString(pyKey);
+	} catch (BE::Error::Exception &e) {
+		return (PBE::convertException(e));
+	}
+
+	const std::shared_ptr<BE::IO::RecordStore> rs = self->rs;
+	BE::Memory::uint8Array value;
+	std::exception_ptr error;
+	self->busy = true;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		value = rs->read(key);
+	} catch (BE::Error::Exception) {
+		error = std::current_exception();
+	}
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+
+	if (error) {
+		try {
+			std::rethrow_exception(error);
+		} catch (BE::Error::Exception &e) {
+			return (PBE::convertException(e));
+		}
+	}
+
+	return (RecordBuffer_asMemoryView(std::move(value)));
+}
+
+/**
+ * @brief
+ * Read the next records in sequence with the GIL released.
+ *
+ * @param self
+ * RecordStore to sequence.
+ * @param count
+ * Maximum number of records to read.  Fewer are read once
+ * PRS::MAX_BATCH_BYTES have been read.
+ * @param fromStart
+ * Whether to sequence from the first record.
+ *
+ * @return
+ * New reference to a list of (key, memoryview) tuples, which is empty
+ * at the end of the sequence, or nullptr with the Python exception set.
+ */
+static PyObject*
+RSObject_sequenceBatch(
+    RSObject *self,
+    Py_ssize_t count,
+    bool fromStart)
+{
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
+	const std::shared_ptr<BE::IO::RecordStore> rs = self->rs;
+	std::vector<BE::IO::RecordStore::Record> records;
+	std::exception_ptr error;
+	self->busy = true;
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		records.reserve(count);
+		int cursor = (fromStart ?
+		    BE::IO::RecordStore::BE_RECSTORE_SEQ_START :
+		    BE::IO::RecordStore::BE_RECSTORE_SEQ_NEXT);
+		uint64_t bytes = 0;
+		while ((records.size() < static_cast<size_t>(count)) &&
+		    (bytes < PRS::MAX_BATCH_BYTES)) {
+			records.push_back(rs->sequence(cursor));
+			cursor = BE::IO::RecordStore::BE_RECSTORE_SEQ_NEXT;
+			bytes += records.back().data.size();
+		}
+	} catch (BE::Error::ObjectDoesNotExist) {
+		/* End of sequence */
+	} catch (BE::Error::Exception) {
+		error = std::current_exception();
+	} catch (std::bad_alloc) {
+		error = std::make_exception_ptr(BE::Error::MemoryError());
+	}
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+
+	if (error) {
+		try {
+			std::rethrow_exception(error);
+		} catch (BE::Error::Exception &e) {
+			return (PBE::convertException(e));
+		}
+	}
+
+	PyObject *list = PyList_New(records.size());
+	if (list == nullptr)
+		return (nullptr);
+	for (size_t i = 0; i < records.size(); i++) {
+		PyObject *view = RecordBuffer_asMemoryView(
+		    std::move(records[i].data));
+		if (view == nullptr) {
+			Py_DECREF(list);
+			return (nullptr);
+		}
+		PyObject *tuple = Py_BuildValue("(s#N)",
+		    records[i].key.c_str(), records[i].key.size(), view);
+		if (tuple == nullptr) {
+			Py_DECREF(list);
+			return (nullptr);
+		}
+		PyList_SET_ITEM(list, i, tuple);
+	}
+
+	return (list);
+}
+
+PyObject*
+RSObject_batches(
+    RSObject *self,
+    PyObject *args,
+    PyObject *kwds)
+{
+	static const char *kwlist[] = {PRS::PARAM_BATCH_SIZE.c_str(),
+	    nullptr};
+	Py_ssize_t batchSize = PRS::DEFAULT_BATCH_SIZE;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n",
+	    const_cast<char**>(kwlist), &batchSize))
+		return (PBE::parameterException());
+	if (batchSize < 1)
+		return (PBE::parameterException(PRS::PARAM_BATCH_SIZE));
+
+	RSBatchIterObject *iter = PyObject_New(RSBatchIterObject,
+	    &RSBatchIterType);
+	if (iter == nullptr)
+		return (nullptr);
+	Py_INCREF(self);
+	iter->rsObject = self;
+	iter->batchSize = batchSize;
+	iter->started = false;
+
+	return ((PyObject*)iter);
+}
+
+static void
+RSBatchIter_dealloc(
+    PyObject *self)
+{
+	Py_XDECREF(((RSBatchIterObject*)self)->rsObject);
+	PyObject_Del(self);
+}
+
+static PyObject*
+RSBatchIter_iternext(
+    PyObject *self)
+{
+	RSBatchIterObject *iter = (RSBatchIterObject*)self;
+
+	PyObject *batch = RSObject_sequenceBatch(iter->rsObject,
+	    iter->batchSize, !iter->started);
+	if (batch == nullptr)
+		return (nullptr);
+	iter->started = true;
+
+	/* An empty batch ends iteration */
+	if (PyList_GET_SIZE(batch) == 0) {
+		Py_DECREF(batch);
+		return (nullptr);
+	}
+	return (batch);
+}
+
 /*
  * CRUD.
  */
@@ -79,6 +363,9 @@ RSObject_read(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(), nullptr};
 	char *pyKey = nullptr;
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s",
@@ -108,6 +395,9 @@ RSObject_insert(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(),
 	    PRS::PARAM_VALUE.c_str(), nullptr};
 	char *pyKey = nullptr;
@@ -148,6 +438,9 @@ RSObject_replace(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(),
 	    PRS::PARAM_VALUE.c_str(), nullptr};
 	char *pyKey = nullptr;
@@ -188,6 +481,9 @@ RSObject_remove(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(), nullptr};
 	char *pyKey = nullptr;
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s",
@@ -223,6 +519,9 @@ RSObject_length(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(), nullptr};
 	char *pyKey = nullptr;
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s",
@@ -253,6 +552,9 @@ RSObject_changeDescription(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_DESCRIPTION.c_str(), nullptr};
 	char *pyDesc = nullptr;
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "z",
@@ -279,6 +581,9 @@ PyObject*
 RSObject_sync(
     RSObject *self)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	try {
 		self->rs->sync();
 		return (Py_BuildValue(""));
@@ -293,6 +598,9 @@ RSObject_flush(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(), nullptr};
 	char *pyKey = nullptr;
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s",
@@ -325,6 +633,9 @@ RSObject_containsKey(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	static const char *kwlist[] = {PRS::PARAM_KEY.c_str(), nullptr};
 	char *pyKey = nullptr;
 	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s",
@@ -348,6 +659,9 @@ PyObject*
 RSObject_description(
     RSObject *self)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	try {
 		return (Py_BuildValue("z", self->rs->getDescription().c_str()));
 	} catch (BE::Error::Exception &e) {
@@ -359,6 +673,9 @@ PyObject*
 RSObject_count(
     RSObject *self)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	try {
 		return (Py_BuildValue("K", self->rs->getCount()));
 	} catch (BE::Error::Exception &e) {
@@ -370,6 +687,9 @@ PyObject*
 RSObject_spaceUsed(
     RSObject *self)
 {
+	if (RSObject_isBusy(self))
+		return (nullptr);
+
 	try {
 		return (Py_BuildValue("K", self->rs->getSpaceUsed()));
 	} catch (BE::Error::Exception &e) {
@@ -402,6 +722,7 @@ RSObject_new(
 		return (PBE::convertException(BE::Error::MemoryError()));
 
 	self->cursor = BE::IO::RecordStore::BE_RECSTORE_SEQ_START;
+	self->busy = false;
 
 	return ((PyObject *)self);
 }
@@ -412,6 +733,9 @@ RSObject_init(
     PyObject *args,
     PyObject *kwds)
 {
+	if (RSObject_isBusy(self))
+		return (-1);
+
 	static const char *kwlist[] = {PRS::PARAM_PATHNAME.c_str(),
 	    PRS::PARAM_MODE.c_str(), PRS::PARAM_RSTYPE.c_str(),
 	    PRS::PARAM_DESCRIPTION.c_str(), nullptr};
@@ -526,3 +850,67 @@ removeRecordStore(
 
 	return (Py_BuildValue(""));
 }
+
+/*
+ * Type definitions.
+ */
+
+PyTypeObject RecordBufferType =
+{
+	PyObject_HEAD_INIT(NULL)
+	0,						/* ob_size */
+	PRS::BUFFER_DOTTED_NAME.c_str(),		/* tp_name */
+	sizeof(RecordBufferObject),			/* tp_basicsize */
+	0,						/* tp_itemsize */
+	RecordBuffer_dealloc,				/* tp_dealloc */
+	0,						/* tp_print */
+	0,						/* tp_getattr */
+	0,						/* tp_setattr */
+	0,						/* tp_compare */
+	0,						/* tp_repr */
+	0,						/* tp_as_number */
+	0,						/* tp_as_sequence */
+	0,						/* tp_as_mapping */
+	0,						/* tp_hash */
+	0,						/* tp_call */
+	0,						/* tp_str */
+	0,						/* tp_getattro */
+	0,						/* tp_setattro */
+	&RecordBuffer_as_buffer,			/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER,	/* tp_flags */
+	"Data of a record, exposed through the buffer protocol",
+							/* tp_doc */
+};
+
+PyTypeObject RSBatchIterType =
+{
+	PyObject_HEAD_INIT(NULL)
+	0,						/* ob_size */
+	PRS::BATCH_ITERATOR_DOTTED_NAME.c_str(),	/* tp_name */
+	sizeof(RSBatchIterObject),			/* tp_basicsize */
+	0,						/* tp_itemsize */
+	RSBatchIter_dealloc,				/* tp_dealloc */
+	0,						/* tp_print */
+	0,						/* tp_getattr */
+	0,						/* tp_setattr */
+	0,						/* tp_compare */
+	0,						/* tp_repr */
+	0,						/* tp_as_number */
+	0,						/* tp_as_sequence */
+	0,						/* tp_as_mapping */
+	0,						/* tp_hash */
+	0,						/* tp_call */
+	0,						/* tp_str */
+	0,						/* tp_getattro */
+	0,						/* tp_setattro */
+	0,						/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_ITER,	/* tp_flags */
+	"Iterator returning lists of records from a RecordStore",
+							/* tp_doc */
+	0,						/* tp_traverse */
+	0,						/* tp_clear */
+	0,						/* tp_richcompare */
+	0,						/* tp_weaklistoffset */
+	PyObject_SelfIter,				/* tp_iter */
+	RSBatchIter_iternext,				/* tp_iternext */
+};
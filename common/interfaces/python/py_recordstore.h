@@ -58,6 +58,24 @@ namespace PythonBiometricEvaluation
 		static const std::string PARAM_RSTYPE_VALUE_DEFAULT = "Default";
 		/** Parameter used for passing descriptions of RecordStores. */
 		static const std::string PARAM_DESCRIPTION = "description";
+		/** Parameter used for passing the number of records per batch. */
+		static const std::string PARAM_BATCH_SIZE = "batch_size";
+		/** Records per batch when PARAM_BATCH_SIZE is omitted. */
+		static const Py_ssize_t DEFAULT_BATCH_SIZE = 256;
+		/** Bytes after which a batch ends early, bounding its memory. */
+		static const uint64_t MAX_BATCH_BYTES = 1024 * 1024;
+
+		/** Name of the object that holds record data. */
+		static const std::string BUFFER_OBJECT_NAME = "RecordBuffer";
+		/** Fully-qualified name of the record data object. */
+		static const std::string BUFFER_DOTTED_NAME = PBE::MODULE_NAME +
+		    "." + BUFFER_OBJECT_NAME;
+		/** Name of the batched iterator object. */
+		static const std::string BATCH_ITERATOR_OBJECT_NAME =
+		    "RecordStoreBatchIterator";
+		/** Fully-qualified name of the batched iterator object. */
+		static const std::string BATCH_ITERATOR_DOTTED_NAME =
+		    PBE::MODULE_NAME + "." + BATCH_ITERATOR_OBJECT_NAME;
 	}
 }
 namespace PRS = PythonBiometricEvaluation::RecordStore;
@@ -68,8 +86,72 @@ typedef struct {
 	PyObject_HEAD /* No semicolon. Really. */
 	std::shared_ptr<BE::IO::RecordStore> rs;
 	int cursor;
+	/** Set while rs is in use with the GIL released. */
+	bool busy;
 } RSObject;
 
+/**
+ * Read-only Python buffer over the data of one record, owned by the
+ * object so that memoryviews of it need no copy.
+ */
+typedef struct {
+	PyObject_HEAD
+	BE::Memory::uint8Array data;
+} RecordBufferObject;
+
+/** Iterator returning lists of records from a RecordStore. */
+typedef struct {
+	PyObject_HEAD
+	/** RecordStore being iterated (owned reference). */
+	RSObject *rsObject;
+	/** Maximum number of records returned by each iteration. */
+	Py_ssize_t batchSize;
+	/** Whether sequencing has started. */
+	bool started;
+} RSBatchIterObject;
+
+/** Python definition of the RecordBuffer type. */
+extern PyTypeObject RecordBufferType;
+
+/** Python definition of the batched iterator type. */
+extern PyTypeObject RSBatchIterType;
+
+/*
+ * Zero-copy access.
+ */
+
+/**
+ * @brief
+ * Wrap record data in a memoryview without copying it.
+ *
+ * @param data
+ * Record data, moved into the new object.
+ *
+ * @return
+ * New reference to a read-only memoryview, or nullptr with the Python
+ * exception set.
+ */
+PyObject*
+RecordBuffer_asMemoryView(
+    BE::Memory::uint8Array &&data);
+
+/** Read a value from the RecordStore as a memoryview. */
+PyObject*
+RSObject_readBuffer(
+    RSObject *self,
+    PyObject *args,
+    PyObject *kwds);
+
+/**
+ * Obtain an iterator returning lists of (key, memoryview) tuples,
+ * read with the GIL released.
+ */
+PyObject*
+RSObject_batches(
+    RSObject *self,
+    PyObject *args,
+    PyObject *kwds);
+
 /*
  * Iterators.
  */
@@ -215,6 +297,10 @@ static PyMethodDef RSObject_methods[] =
 	/* CRUD */
 	{"read", (PyCFunction)RSObject_read, METH_VARARGS | METH_KEYWORDS,
 	    "Returns the value for the specified key"},
+	{"read_buffer", (PyCFunction)RSObject_readBuffer,
+	    METH_VARARGS | METH_KEYWORDS,
+	    "Returns the value for the specified key as a read-only\n"
+	    "memoryview, without copying it"},
 	{"insert", (PyCFunction)RSObject_insert, METH_VARARGS | METH_KEYWORDS,
 	    "Insert a record into the RecordStore"},
 	{"remove", (PyCFunction)RSObject_remove, METH_VARARGS | METH_KEYWORDS,
@@ -247,6 +333,14 @@ static PyMethodDef RSObject_methods[] =
 	{"length", (PyCFunction)RSObject_length, METH_VARARGS | METH_KEYWORDS,
 	    "Obtain the length of a record"},
 
+	/* Iteration */
+	{"batches", (PyCFunction)RSObject_batches,
+	    METH_VARARGS | METH_KEYWORDS,
+	    "Iterate through the RecordStore, returning lists of up to\n"
+	    "batch_size (key, memoryview) tuples, fewer when records are\n"
+	    "large.  Records are read without holding the GIL.  Shares the\n"
+	    "sequence cursor of the RecordStore."},
+
 	{"delete", (PyCFunction)removeRecordStore, METH_VARARGS | 
 	    METH_KEYWORDS | METH_STATIC, "Delete all persistant data "
 	    "associated with a RecordStore."},
@@ -0,0 +1,132 @@
+#!/usr/bin/env python
+# This software was developed at the National Institute of Standards and
+# Technology (NIST) by employees of the Federal Government in the course
+# of their official duties. Pursuant to title 17 Section 105 of the
+# United States Code, this software is not subject to copyright protection
+# and is in the public domain. NIST assumes no responsibility whatsoever for
+# its use by other parties, and makes no guarantees, expressed or implied,
+# about its quality, reliability, or any other characteristic.
+
+#
+# Compare the throughput of the ways to read a RecordStore from Python,
+# and how much a concurrent Python thread progresses while each runs
+# (which is higher when the GIL is released during I/O).
+#
+
+from __future__ import print_function
+
+import optparse
+import os
+import sys
+import threading
+import time
+
+sys.path.insert(0, '../')
+import BiometricEvaluation as BE
+
+def create(path, count, size, rstype):
+	rs = BE.RecordStore(path = path, rstype = rstype,
+	    description = "Python binding benchmark")
+	record = os.urandom(size)
+	for i in range(count):
+		rs.insert("key" + str(i), record)
+	rs.sync()
+	return rs
+
+def iterate(rs, keys):
+	n = 0
+	for kv in rs:
+		n += len(kv.values()[0])
+	return n
+
+def read(rs, keys):
+	n = 0
+	for key in keys:
+		n += len(rs.read(key))
+	return n
+
+def read_buffer(rs, keys):
+	n = 0
+	for key in keys:
+		n += len(rs.read_buffer(key))
+	return n
+
+def batches(rs, keys):
+	n = 0
+	for batch in rs.batches():
+		for key, view in batch:
+			n += len(view)
+	return n
+
+class Spinner(threading.Thread):
+	"""Count as quickly as possible until stopped."""
+	def __init__(self):
+		threading.Thread.__init__(self)
+		self.count = 0
+		self.running = True
+
+	def run(self):
+		while self.running:
+			self.count += 1
+
+def trial(method, rs, keys, concurrent):
+	spinner = Spinner()
+	if concurrent:
+		spinner.start()
+	start = time.time()
+	n = method(rs, keys)
+	elapsed = max(time.time() - start, 1e-9)
+	if concurrent:
+		spinner.running = False
+		spinner.join()
+	return (n, elapsed, spinner.count / elapsed)
+
+def main():
+	parser = optparse.OptionParser()
+	parser.add_option("-n", dest = "count", type = "int", default = 20000,
+	    help = "number of records (default: %default)")
+	parser.add_option("-s", dest = "size", type = "int", default = 65536,
+	    help = "record size in bytes (default: %default)")
+	parser.add_option("-p", dest = "path", default = "rs_benchmark",
+	    help = "RecordStore to create (default: %default)")
+	parser.add_option("-r", dest = "repeat", type = "int", default = 3,
+	    help = "trials per method, best is reported (default: %default)")
+	(options, args) = parser.parse_args()
+
+	rs = create(options.path, options.count, options.size,
+	    BE.RecordStore_Default)
+	try:
+		keys = [kv.keys()[0] for kv in rs]
+		print("{0:>12} {1:>12} {2:>10} {3:>14} {4:>16}".format(
+		    "method", "records/s", "MiB/s", "records/s (T)",
+		    "other thread/s"))
+		for name, method in (("iterate", iterate), ("read", read),
+		    ("read_buffer", read_buffer), ("batches", batches)):
+			best = None
+			best_concurrent = None
+			for i in range(options.repeat):
+				for concurrent in (False, True):
+					n, elapsed, spins = trial(method, rs,
+					    keys, concurrent)
+					if n != options.count * options.size:
+						sys.exit(name + " read " +
+						    str(n) + " bytes")
+					if concurrent:
+						if (best_concurrent is None or
+						    elapsed <
+						    best_concurrent[0]):
+							best_concurrent = (
+							    elapsed, spins)
+					elif best is None or elapsed < best:
+						best = elapsed
+			print("{0:>12} {1:>12.0f} {2:>10.1f} {3:>14.0f} "
+			    "{4:>16.0f}".format(name, options.count / best,
+			    n / best / 1048576, options.count /
+			    best_concurrent[0], best_concurrent[1]))
+		print("(T): with another Python thread running")
+	finally:
+		rs = None
+		BE.RecordStore.delete(options.path)
+
+if __name__ == '__main__':
+	main()
@@ -85,6 +85,27 @@ class NewRecordStoreTest(unittest.TestCase):
 			lastVal += 1
 		self.assertEqual(lastVal, 9)
 	
+	def test_buffers(self):
+		for i in range(1,10):
+			self.rs.insert("key" + str(i), str(i) * i)
+
+		# Read without copying
+		view = self.rs.read_buffer("key5")
+		self.assertTrue(isinstance(view, memoryview))
+		self.assertTrue(view.readonly)
+		self.assertEqual(view.tobytes(), "55555")
+		self.assertRaises(Exception, self.rs.read_buffer, "badkey")
+
+		# Batches contain every record, in sequence order
+		expected = [(kv.keys()[0], kv.values()[0]) for kv in self.rs]
+		for batch_size in (1, 4, 9, 100):
+			records = []
+			for batch in self.rs.batches(batch_size = batch_size):
+				self.assertTrue(0 < len(batch) <= batch_size)
+				records += [(k, v.tobytes()) for k, v in batch]
+			self.assertEqual(records, expected)
+		self.assertRaises(Exception, self.rs.batches, batch_size = 0)
+
 	def zero_length(self):
 		key = "key"
 
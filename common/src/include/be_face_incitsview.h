@@ -197,6 +197,29 @@ namespace BiometricEvaluation
 			    const Memory::uint8Array &buffer,
 			    const uint32_t viewNumber);
 
+			/**
+			 * @brief
+			 * Construct an INCITS face view from a record
+			 * contained in a buffer, taking ownership of
+			 * the buffer so that images are shared with it
+			 * instead of copied.
+			 * @details
+			 * See documentation in child classes of INCITS for
+			 * information on constructing INCITS-derived face
+			 * views.
+			 * @param[in] buffer
+			 * The buffer containing the complete face image data
+			 * record.
+			 * @param[in] viewNumber
+			 *	The eye number to use.
+			 *
+			 * @throw Error::DataError
+			 *	Invalid record format.
+			 */
+			INCITSView(
+			    Memory::uint8Array &&buffer,
+			    const uint32_t viewNumber);
+
 			/**
 			 * @brief
 			 * Obtain a reference to the face image record
@@ -247,7 +270,9 @@ namespace BiometricEvaluation
 			    Memory::IndexedBuffer &buf);
 
 		private:
-			BiometricEvaluation::Memory::uint8Array _fid;
+			/** The entire record, shared with Images */
+			std::shared_ptr<BiometricEvaluation::Memory::uint8Array>
+			    _fid;
 
 			BiometricEvaluation::Feature::MPEGFacePointSet
 			    _featurePointSet;
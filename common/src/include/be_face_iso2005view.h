@@ -83,6 +83,30 @@ namespace BiometricEvaluation
 			    const Memory::uint8Array &buffer,
 			    const uint32_t viewNumber);
 
+			/**
+			 * @brief
+			 * Construct an ISO 2005 face view from a record
+			 * contained in a buffer, taking ownership of
+			 * the buffer so that images are shared with it
+			 * instead of copied.
+			 * @details
+			 * The entire face image data record is passed into
+			 * this method, with the specific instance of the
+			 * facial image that is to be extraced from the record.
+			 *
+			 * @param[in] buffer
+			 * The buffer containing the complete face image
+			 * data record.
+			 * @param[in] viewNumber
+			 * The facial information instance to read.
+			 *
+			 * @throw Error::DataError
+			 * Invalid record format.
+			 */
+			ISO2005View(
+			    Memory::uint8Array &&buffer,
+			    const uint32_t viewNumber);
+
 		protected:
 
 			static const uint32_t BASE_SPEC_VERSION = 0x30313000;
@@ -397,6 +397,34 @@ namespace BiometricEvaluation
 		operator!=(
 		    const ROI &lhs,
 		    const ROI &rhs);
+
+		/**
+		 * @brief
+		 * The portion of an image to decode, and the resolution at
+		 * which to decode it.
+		 */
+		struct DecodeRequest {
+			/**
+			 * Create a DecodeRequest object.
+			 *
+			 * @param[in] roi
+			 *	Region of the full-resolution image to decode.
+			 *	Only the bounding box is used.  A ROI with an
+			 *	empty size requests the entire image.
+			 * @param[in] scaleDenominator
+			 *	Decode at 1/scaleDenominator of the full
+			 *	resolution.  One of 1, 2, 4, or 8.
+			 */
+			DecodeRequest(
+			    const ROI &roi = ROI(),
+			    const uint8_t scaleDenominator = 1);
+
+			/** Region of the full-resolution image to decode */
+			ROI roi;
+			/** Reciprocal of the scale at which to decode */
+			uint8_t scaleDenominator;
+		};
+		using DecodeRequest = struct DecodeRequest;
 	}
 }
 
@@ -0,0 +1,195 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IMAGE_BATCHDECODER_H__
+#define __BE_IMAGE_BATCHDECODER_H__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <be_image_image.h>
+#include <be_io_recordstore.h>
+
+namespace BiometricEvaluation
+{
+	namespace Image
+	{
+		/**
+		 * @brief
+		 * One image decoded by a BatchDecoder.
+		 */
+		struct DecodedImage
+		{
+			/** Position of the image in the batch */
+			uint64_t index{0};
+			/** RecordStore key of the image, if any */
+			std::string key;
+			/** Opened image, or nullptr if decoding failed */
+			std::shared_ptr<Image> image;
+			/** Decoded pixels, rows packed without padding */
+			Memory::uint8Array pixels;
+			/** Reason decoding failed, empty on success */
+			std::string error;
+		};
+
+		/**
+		 * @brief
+		 * Decode batches of encoded images on a pool of threads.
+		 *
+		 * @details
+		 * The format of each image is detected as with
+		 * Image::openImage(), and each image is decoded by a single
+		 * worker thread (with Image::setDecodeThreadCount(1)), so
+		 * images are decoded concurrently with one another instead
+		 * of each decode being split among threads.  Decoded images
+		 * are delivered to a callback, on the thread that called
+		 * decode(), in the order they were submitted.  Pixel
+		 * buffers are recycled once the callback returns.
+		 *
+		 * Images that cannot be decoded are delivered with an
+		 * error instead of ending the batch.
+		 *
+		 * Each decode creates its own codec state, as a serial
+		 * decode does; no codec contexts are kept per thread.
+		 */
+		class BatchDecoder
+		{
+		public:
+			/**
+			 * @brief
+			 * Function called with each decoded image.
+			 *
+			 * @details
+			 * DecodedImage::pixels is reused for a later
+			 * image after the callback returns; move from it to
+			 * keep the pixels.  Exceptions thrown from the
+			 * callback stop the batch and are rethrown by
+			 * decode().
+			 */
+			using Callback = std::function<void(DecodedImage&)>;
+
+			/**
+			 * @brief
+			 * Constructor.
+			 *
+			 * @param threadCount
+			 *	Number of worker threads, or 0 for one per
+			 *	processor.
+			 * @param format
+			 *	Format of decoded pixels (Gray8 or RGB24).
+			 *
+			 * @throw Error::ParameterError
+			 *	format is not Gray8 or RGB24.
+			 */
+			BatchDecoder(
+			    uint32_t threadCount = 0,
+			    PixelFormat format = PixelFormat::Gray8);
+
+			/**
+			 * @brief
+			 * Decode encoded images.
+			 *
+			 * @param images
+			 *	Encoded images, which must not be modified
+			 *	until decode() returns.  Each is copied
+			 *	before it is decoded, so DecodedImage::image
+			 *	remains valid after images is destroyed.
+			 * @param callback
+			 *	Function called with each decoded image, in
+			 *	the order of images.
+			 *
+			 * @throw Error::Exception
+			 *	Exception thrown by callback.
+			 */
+			void
+			decode(
+			    const std::vector<Memory::uint8Array> &images,
+			    const Callback &callback)
+			    const;
+
+			/**
+			 * @brief
+			 * Decode images stored in a RecordStore.
+			 *
+			 * @param recordStore
+			 *	RecordStore containing images.  Records are
+			 *	read by one thread at a time.
+			 * @param keys
+			 *	Keys of the images to decode.
+			 * @param callback
+			 *	Function called with each decoded image, in
+			 *	the order of keys.  Keys that cannot be read
+			 *	are delivered with an error.
+			 *
+			 * @throw Error::Exception
+			 *	Exception thrown by callback.
+			 */
+			void
+			decode(
+			    const std::shared_ptr<IO::RecordStore> &recordStore,
+			    const std::vector<std::string> &keys,
+			    const Callback &callback)
+			    const;
+
+			/**
+			 * @return
+			 *	Number of worker threads.
+			 */
+			uint32_t
+			getThreadCount()
+			    const;
+
+			/**
+			 * @return
+			 *	Format of decoded pixels.
+			 */
+			PixelFormat
+			getPixelFormat()
+			    const;
+
+		private:
+			/** Function to open the image at an index in a batch */
+			using Opener = std::function<std::shared_ptr<Image>(
+			    uint64_t index)>;
+
+			/**
+			 * @brief
+			 * Decode a batch of images with the worker threads.
+			 *
+			 * @param count
+			 *	Number of images in the batch.
+			 * @param open
+			 *	Function to open each image, called
+			 *	concurrently by worker threads.
+			 * @param keys
+			 *	Key of each image, or empty.
+			 * @param callback
+			 *	Function called with each decoded image.
+			 */
+			void
+			decodeBatch(
+			    uint64_t count,
+			    const Opener &open,
+			    const std::vector<std::string> &keys,
+			    const Callback &callback)
+			    const;
+
+			/** Number of worker threads */
+			uint32_t _threadCount;
+			/** Format of decoded pixels */
+			PixelFormat _format;
+		};
+	}
+}
+
+#endif /* __BE_IMAGE_BATCHDECODER_H__ */
@@ -48,6 +48,10 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    const uint64_t size);
 
+			BMP(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
 			BMP(
 			    const Memory::uint8Array &data);
 
@@ -61,6 +65,13 @@ namespace BiometricEvaluation
 			getRawGrayscaleData(
 			    uint8_t depth)
 			    const;
+
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
 	
 			/**
 			 * Whether or not data is a BMP image.
@@ -183,6 +194,8 @@ namespace BiometricEvaluation
 			 *	ColorTable read from the data and mapped into
 			 *	RGBA values.
 			 *
+			 * @throw Error::StrategyError
+			 *	buf is too small to hold count elements.
 			 */
 			void
 			getColorTable(
@@ -20,6 +20,12 @@
 
 namespace BiometricEvaluation
 {
+	namespace IO
+	{
+		/* Forward declaration */
+		class RecordStore;
+	}
+
 	/**
 	 * @brief
 	 * Classes and methods for manipulating images.
@@ -29,6 +35,40 @@ namespace BiometricEvaluation
 		/* Forward declaration */
 		class Raw;
 
+		/**
+		 * @brief
+		 * Bytes of encoded data read by Image::probe() before
+		 * reading an entire record or file.
+		 */
+		const uint64_t DefaultProbeSize = 64 * 1024;
+
+		/**
+		 * @brief
+		 * Properties of an encoded image, read from its header.
+		 *
+		 * @details
+		 * Returned by Image::probe(), which does not keep or decode
+		 * the image data.  Members are the values the accessors of
+		 * an Image opened from the same data would return.
+		 */
+		struct Metadata
+		{
+			/** Compression algorithm of the encoded data */
+			const CompressionAlgorithm compressionAlgorithm;
+			/** Size of the encoded data, in bytes */
+			const uint64_t size;
+			/** Width and height, in pixels */
+			const Size dimensions;
+			/** Resolution, as recorded in the header */
+			const Resolution resolution;
+			/** Number of bits per pixel */
+			const uint32_t colorDepth;
+			/** Number of bits per color component */
+			const uint16_t bitDepth;
+			/** Whether the image has an alpha channel */
+			const bool hasAlphaChannel;
+		};
+
 		/**
 		 * @brief
 		 * Represent attributes common to all images.
@@ -104,6 +144,65 @@ namespace BiometricEvaluation
 			    const uint64_t size,
 			    const CompressionAlgorithm compression);
 
+			/**
+		 	 * @brief
+			 * Parent constructor for all Image classes, sharing
+			 * ownership of the image data instead of copying it.
+			 *
+			 * @param[in] data
+			 *	The image data, which must not be modified
+			 *	for the lifetime of this object.
+			 * @param[in] size
+			 *	The size of the image data, in bytes.
+			 * @param[in] dimensions
+			 *	The width and height of the image in pixels.
+			 * @param[in] colorDepth
+			 *	The image color depth, in bits-per-pixel.
+			 * @param[in] bitDepth
+			 *	The number of bits per color component.
+			 * @param[in] resolution
+			 *	The resolution of the image
+			 * @param[in] compression
+			 *	The CompressionAlgorithm of data.
+			 * @param[in] hasAlphaChannel
+			 *	Presence of an alpha channel.
+			 *
+			 * @throw Error::StrategyError
+			 *	Error while creating Image.
+			 */
+			Image(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size,
+			    const Size dimensions,
+			    const uint32_t colorDepth,
+			    const uint16_t bitDepth,
+			    const Resolution resolution,
+			    const CompressionAlgorithm compression,
+			    const bool hasAlphaChannel);
+
+			/**
+		 	 * @brief
+			 * Parent constructor for all Image classes, sharing
+			 * ownership of the image data instead of copying it.
+			 *
+			 * @param[in] data
+			 *	The image data, which must not be modified
+			 *	for the lifetime of this object.
+			 * @param[in] size
+			 *	The size of the image data, in bytes.
+			 * @param[in] compression
+			 *	The CompressionAlgorithm of data.
+			 *
+			 * @throw Error::DataError
+			 *	Error manipulating data.
+			 * @throw Error::StrategyError
+			 *	Error while creating Image.
+			 */
+			Image(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size,
+			    const CompressionAlgorithm compression);
+
 			/**
 			 * @brief
 			 * Accessor for the CompressionAlgorithm of the image.
@@ -218,6 +317,132 @@ namespace BiometricEvaluation
 			    uint8_t depth)
 			    const = 0;
 
+			/**
+			 * @brief
+			 * Decompress the image into a caller-owned buffer.
+			 *
+			 * @param[out] buffer
+			 *	Buffer to hold the decompressed image.  Must
+			 *	be at least stride * getDimensions().ySize
+			 *	bytes.  Row r of the image begins at
+			 *	buffer + (r * stride).
+			 * @param[in] stride
+			 *	Distance between the start of adjacent rows
+			 *	in buffer, in bytes.  Must be at least
+			 *	getDecodedRowSize(format).
+			 * @param[in] format
+			 *	Layout of decompressed pixels.  Gray8 and
+			 *	RGB24 are supported.
+			 *
+			 * @throw Error::DataError
+			 *	Error decompressing image data.
+			 * @throw Error::NotImplemented
+			 *	format is not supported.
+			 * @throw Error::ParameterError
+			 *	buffer is nullptr or stride is too small.
+			 *
+			 * @note
+			 * Unlike getRawData(), this method does not allocate
+			 * storage for the decompressed image, so buffer may
+			 * be reused between images.  Alpha channels are
+			 * ignored, 16-bit samples are reduced to 8 bits,
+			 * and color is converted to gray with the ITU-R
+			 * BT.601 luma factors, as in getRawGrayscaleData().
+			 * Padding between rows is not modified.
+			 */
+			virtual void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
+			/**
+			 * @brief
+			 * Decompress a region of the image, optionally at
+			 * reduced resolution, into a caller-owned buffer.
+			 *
+			 * @param[out] buffer
+			 *	Buffer to hold the decompressed region.  Must
+			 *	be at least stride *
+			 *	getDecodedDimensions(request).ySize bytes.
+			 * @param[in] stride
+			 *	Distance between the start of adjacent rows
+			 *	in buffer, in bytes.  Must be at least
+			 *	getDecodedDimensions(request).xSize times
+			 *	the size of a pixel in format.
+			 * @param[in] format
+			 *	Layout of decompressed pixels.  Gray8 and
+			 *	RGB24 are supported.
+			 * @param[in] request
+			 *	Region and scale to decode.
+			 *
+			 * @throw Error::DataError
+			 *	Error decompressing image data.
+			 * @throw Error::NotImplemented
+			 *	format is not supported.
+			 * @throw Error::ParameterError
+			 *	buffer is nullptr, stride is too small, or
+			 *	request is invalid for this image.
+			 *
+			 * @note
+			 * When scaled, each pixel approximates the mean of
+			 * the block of full-resolution pixels it covers.
+			 * Codecs that decode at reduced resolution natively
+			 * use their own filters, so results may differ
+			 * slightly between codecs.  Codecs that cannot
+			 * decode partial images decode the entire image
+			 * first.
+			 */
+			virtual void
+			decodeRegionInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format,
+			    const DecodeRequest &request)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the dimensions of the pixels written by
+			 * decodeRegionInto().
+			 *
+			 * @param[in] request
+			 *	Region and scale to decode.
+			 *
+			 * @return
+			 *	Dimensions of the decoded region.  The region
+			 *	covers the pixels from
+			 *	floor(offset / scaleDenominator) to
+			 *	ceil((offset + size) / scaleDenominator).
+			 *
+			 * @throw Error::ParameterError
+			 *	request is invalid for this image.
+			 */
+			Size
+			getDecodedDimensions(
+			    const DecodeRequest &request)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the number of bytes in one row of pixels
+			 * written by decodeInto().
+			 *
+			 * @param[in] format
+			 *	Layout of decompressed pixels.
+			 *
+			 * @return
+			 *	Minimum stride for decodeInto() in format.
+			 *
+			 * @throw Error::NotImplemented
+			 *	format is not supported by decodeInto().
+			 */
+			uint64_t
+			getDecodedRowSize(
+			    PixelFormat format)
+			    const;
+
 			/**
 		 	 * @brief
 			 * Accessor for the dimensions of the image in pixels.
@@ -266,6 +491,37 @@ namespace BiometricEvaluation
 				return (this->_hasAlphaChannel);
 			}
 
+			/**
+			 * @brief
+			 * Limit the number of threads used to decode this
+			 * image.
+			 *
+			 * @param count
+			 *	Maximum number of threads a single decode may
+			 *	use, or 0 (the default) for one per processor.
+			 *
+			 * @note
+			 * Set this to 1 when many images are already being
+			 * decoded concurrently.  Codecs that cannot decode
+			 * with multiple threads ignore this value.
+			 */
+			void
+			setDecodeThreadCount(
+			    uint32_t count);
+
+			/**
+			 * @brief
+			 * Obtain the number of threads a single decode of this
+			 * image may use.
+			 *
+			 * @return
+			 *	Thread limit set by setDecodeThreadCount(), or
+			 *	the number of processors when none was set.
+			 */
+			uint32_t
+			getDecodeThreadCount()
+			    const;
+
 			virtual ~Image();
 			
 			/*
@@ -339,6 +595,169 @@ namespace BiometricEvaluation
 			static std::shared_ptr<Image>
 			openImage(
 			    const Memory::uint8Array &data);
+
+			/**
+			 * @brief
+			 * Determine the image type of a buffer of image data
+			 * and create an Image object that takes ownership
+			 * of the buffer.
+			 *
+			 * @details
+			 * This is the preferred way to open a record read
+			 * from a RecordStore, as the image data is never
+			 * copied.
+			 *
+ 			 * @param[in] data
+			 *	The image data, which is moved from.
+			 *
+			 * @return
+			 *	Image representation of the input data buffer.
+ 			 *
+			 * @throw Error::DataError
+			 *	Error manipulating data.
+			 * @throw Error::StrategyError
+			 *	Error while creating Image.
+			 */
+			static std::shared_ptr<Image>
+			openImage(
+			    Memory::uint8Array &&data);
+
+			/**
+			 * @brief
+			 * Determine the image type of a buffer of image data
+			 * and create an Image object that shares ownership
+			 * of the buffer.
+			 *
+			 * @details
+			 * data may point into a larger buffer, such as a
+			 * biometric record or a memory-mapped file, by
+			 * using the aliasing constructor of std::shared_ptr,
+			 * so that the larger buffer lives as long as the
+			 * Image.
+			 *
+ 			 * @param[in] data
+			 *	The image data, which must not be modified
+			 *	for the lifetime of the returned Image.
+			 * @param[in] size
+			 *	The size of the image data, in bytes.
+			 *
+			 * @return
+			 *	Image representation of the input data buffer.
+ 			 *
+			 * @throw Error::DataError
+			 *	Error manipulating data.
+			 * @throw Error::StrategyError
+			 *	Error while creating Image.
+			 */
+			static std::shared_ptr<Image>
+			openImage(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
+			/**
+			 * @brief
+			 * Create an Image object from a buffer of image data
+			 * whose compression algorithm is already known.
+			 *
+			 * @details
+			 * The format of data is not detected, so callers that
+			 * know the format (e.g., from a record header) avoid
+			 * the cost of getCompressionAlgorithm().
+			 *
+ 			 * @param[in] data
+			 *	The image data.
+			 * @param[in] compression
+			 *	The CompressionAlgorithm of data.
+			 *
+			 * @return
+			 *	Image representation of the input data buffer.
+ 			 *
+			 * @throw Error::DataError
+			 *	Error manipulating data.
+			 * @throw Error::ParameterError
+			 *	compression cannot be opened by openImage().
+			 * @throw Error::StrategyError
+			 *	Error while creating Image, including when
+			 *	data is not compressed with compression.
+			 */
+			static std::shared_ptr<Image>
+			openImage(
+			    const Memory::uint8Array &data,
+			    const CompressionAlgorithm compression);
+
+			/**
+			 * @brief
+			 * Create an Image object that takes ownership of a
+			 * buffer of image data whose compression algorithm
+			 * is already known.
+			 *
+ 			 * @param[in] data
+			 *	The image data, which is moved from.
+			 * @param[in] compression
+			 *	The CompressionAlgorithm of data.
+			 *
+			 * @return
+			 *	Image representation of the input data buffer.
+ 			 *
+			 * @throw Error::DataError
+			 *	Error manipulating data.
+			 * @throw Error::ParameterError
+			 *	compression cannot be opened by openImage().
+			 * @throw Error::StrategyError
+			 *	Error while creating Image, including when
+			 *	data is not compressed with compression.
+			 */
+			static std::shared_ptr<Image>
+			openImage(
+			    Memory::uint8Array &&data,
+			    const CompressionAlgorithm compression);
+
+			/**
+			 * @brief
+			 * Create an Image object that shares ownership of a
+			 * buffer of image data whose compression algorithm
+			 * is already known.
+			 *
+ 			 * @param[in] data
+			 *	The image data, which must not be modified
+			 *	for the lifetime of the returned Image.
+			 * @param[in] size
+			 *	The size of the image data, in bytes.
+			 * @param[in] compression
+			 *	The CompressionAlgorithm of data.
+			 *
+			 * @return
+			 *	Image representation of the input data buffer.
+ 			 *
+			 * @throw Error::DataError
+			 *	Error manipulating data.
+			 * @throw Error::ParameterError
+			 *	compression cannot be opened by openImage().
+			 * @throw Error::StrategyError
+			 *	Error while creating Image, including when
+			 *	data is not compressed with compression.
+			 */
+			static std::shared_ptr<Image>
+			openImage(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size,
+			    const CompressionAlgorithm compression);
+
+			/**
+			 * @brief
+			 * Take ownership of a buffer so that it may be
+			 * shared by Image objects without being copied.
+			 *
+			 * @param[in] data
+			 *	Buffer, which is moved from.
+			 *
+			 * @return
+			 *	Pointer to the first element of the buffer,
+			 *	which owns the buffer.
+			 */
+			static std::shared_ptr<const uint8_t>
+			shareData(
+			    Memory::uint8Array &&data);
 			    
 			/**
 			 * @brief
@@ -379,6 +798,13 @@ namespace BiometricEvaluation
 			 *	CompressionAlgorithm::None is returned if
 			 *	no compression algorithm known to the
 			 *	Biometric Evaluation Framework is found.
+			 *
+			 * @note
+			 * Formats are recognized by the signature in their
+			 * first bytes.  Only JPEG data (to the first start
+			 * of frame marker, to distinguish lossy from lossless
+			 * compression) and NetPBM data beginning with
+			 * comments are read further.
 			 */
 			static CompressionAlgorithm
 			getCompressionAlgorithm(
@@ -430,6 +856,156 @@ namespace BiometricEvaluation
 			getCompressionAlgorithm(
 			    const std::string &path);
 
+			/**
+			 * @brief
+			 * Read the properties of a buffer of image data
+			 * without opening an Image.
+			 *
+			 * @details
+			 * The format is detected as with openImage(), and
+			 * only its header is parsed.  data is not copied
+			 * or kept, and no pixels are decoded.
+			 *
+			 * @param[in] data
+			 *	The image data.
+			 * @param[in] size
+			 *	The size of the image data, in bytes.
+			 *
+			 * @return
+			 *	Properties of the image.
+			 *
+			 * @throw Error::DataError
+			 *	Error parsing the header.
+			 * @throw Error::StrategyError
+			 *	The compression algorithm could not be
+			 *	determined, or the header could not be
+			 *	parsed.
+			 */
+			static Metadata
+			probe(
+			    const uint8_t *data,
+			    const uint64_t size);
+
+			/**
+			 * @brief
+			 * Read the properties of a buffer of image data
+			 * without opening an Image.
+			 *
+			 * @param[in] data
+			 *	The image data.
+			 *
+			 * @return
+			 *	Properties of the image.
+			 *
+			 * @throw Error::DataError
+			 *	Error parsing the header.
+			 * @throw Error::StrategyError
+			 *	The compression algorithm could not be
+			 *	determined, or the header could not be
+			 *	parsed.
+			 */
+			static Metadata
+			probe(
+			    const Memory::uint8Array &data);
+
+			/**
+			 * @brief
+			 * Read the properties of an image file from its
+			 * first bytes.
+			 *
+			 * @details
+			 * Only the first prefixSize bytes are read, unless
+			 * the header extends beyond them or the format
+			 * may place its header anywhere in the file
+			 * (TIFF), in which case the entire file is read.
+			 * Reads are positional, so the file offset of fd
+			 * is not changed.
+			 *
+			 * @param[in] fd
+			 *	Open file descriptor of a regular file.
+			 * @param[in] prefixSize
+			 *	Number of bytes to read first.
+			 *
+			 * @return
+			 *	Properties of the image.
+			 *
+			 * @throw Error::DataError
+			 *	Error parsing the header.
+			 * @throw Error::StrategyError
+			 *	fd could not be read, the compression
+			 *	algorithm could not be determined, or the
+			 *	header could not be parsed.
+			 */
+			static Metadata
+			probe(
+			    int fd,
+			    uint64_t prefixSize = DefaultProbeSize);
+
+			/**
+			 * @brief
+			 * Read the properties of an image file from its
+			 * first bytes.
+			 *
+			 * @param[in] path
+			 *	Path to image data.
+			 * @param[in] prefixSize
+			 *	Number of bytes to read first, as in
+			 *	probe(int, uint64_t).
+			 *
+			 * @return
+			 *	Properties of the image.
+			 *
+			 * @throw Error::DataError
+			 *	Error parsing the header.
+			 * @throw Error::ObjectDoesNotExist
+			 *	No file at specified path.
+			 * @throw Error::StrategyError
+			 *	path could not be read, the compression
+			 *	algorithm could not be determined, or the
+			 *	header could not be parsed.
+			 */
+			static Metadata
+			probe(
+			    const std::string &path,
+			    uint64_t prefixSize = DefaultProbeSize);
+
+			/**
+			 * @brief
+			 * Read the properties of an image stored in a
+			 * RecordStore from the first bytes of its record.
+			 *
+			 * @details
+			 * The first prefixSize bytes are read with
+			 * IO::RecordStore::readPrefix(), and the entire
+			 * record is read only when needed, as in
+			 * probe(int, uint64_t).
+			 *
+			 * @param[in] recordStore
+			 *	RecordStore containing the image.
+			 * @param[in] key
+			 *	Key of the image.
+			 * @param[in] prefixSize
+			 *	Number of bytes to read first.
+			 *
+			 * @return
+			 *	Properties of the image.
+			 *
+			 * @throw Error::DataError
+			 *	Error parsing the header.
+			 * @throw Error::ObjectDoesNotExist
+			 *	key does not exist.
+			 * @throw Error::StrategyError
+			 *	The record could not be read, the
+			 *	compression algorithm could not be
+			 *	determined, or the header could not be
+			 *	parsed.
+			 */
+			static Metadata
+			probe(
+			    const IO::RecordStore &recordStore,
+			    const std::string &key,
+			    uint64_t prefixSize = DefaultProbeSize);
+
 			/**
 			 * @brief
 			 * Obtain Image::Raw version of an Image::Image.
@@ -505,6 +1081,259 @@ namespace BiometricEvaluation
 			getDataSize()
 			    const;
 
+			/**
+			 * @brief
+			 * Copy a buffer into storage that may be shared by
+			 * Image objects.
+			 *
+			 * @param[in] data
+			 *	Buffer to copy.
+			 * @param[in] size
+			 *	Size of data, in bytes.
+			 *
+			 * @return
+			 *	Pointer to the first byte of the copy.
+			 */
+			static std::shared_ptr<const uint8_t>
+			copyData(
+			    const uint8_t *data,
+			    const uint64_t size);
+
+			/**
+			 * @brief
+			 * Check the arguments to decodeInto().
+			 *
+			 * @param[in] buffer
+			 *	Buffer passed to decodeInto().
+			 * @param[in] stride
+			 *	Stride passed to decodeInto().
+			 * @param[in] format
+			 *	Format passed to decodeInto().
+			 *
+			 * @throw Error::NotImplemented
+			 *	format is not supported.
+			 * @throw Error::ParameterError
+			 *	buffer is nullptr or stride is too small.
+			 */
+			void
+			checkDecodeArguments(
+			    const uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
+			/**
+			 * @brief
+			 * Check the arguments to decodeRegionInto().
+			 *
+			 * @param[in] buffer
+			 *	Buffer passed to decodeRegionInto().
+			 * @param[in] stride
+			 *	Stride passed to decodeRegionInto().
+			 * @param[in] format
+			 *	Format passed to decodeRegionInto().
+			 * @param[in] request
+			 *	Request passed to decodeRegionInto().
+			 * @param[out] horzOffset
+			 *	Horizontal offset of the region in the
+			 *	scaled image.
+			 * @param[out] vertOffset
+			 *	Vertical offset of the region in the scaled
+			 *	image.
+			 * @param[out] dimensions
+			 *	Dimensions of the decoded region.
+			 *
+			 * @throw Error::NotImplemented
+			 *	format is not supported.
+			 * @throw Error::ParameterError
+			 *	buffer is nullptr, stride is too small, or
+			 *	request is invalid for this image.
+			 */
+			void
+			checkDecodeArguments(
+			    const uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format,
+			    const DecodeRequest &request,
+			    uint32_t &horzOffset,
+			    uint32_t &vertOffset,
+			    Size &dimensions)
+			    const;
+
+			/**
+			 * @param[in] format
+			 *	A decodeInto() pixel format.
+			 *
+			 * @return
+			 *	Number of bytes per pixel in format.
+			 *
+			 * @throw Error::NotImplemented
+			 *	format is not supported by decodeInto().
+			 */
+			static uint8_t
+			getDecodedPixelSize(
+			    PixelFormat format);
+
+			/**
+			 * @brief
+			 * Reduce a band of full-resolution rows to one row
+			 * of scaled pixels.
+			 *
+			 * @param[in] band
+			 *	First pixel of the band.
+			 * @param[in] bandStride
+			 *	Distance between rows of band, in bytes.
+			 * @param[in] bandRows
+			 *	Number of rows in band, at most
+			 *	scaleDenominator.
+			 * @param[in] bandWidth
+			 *	Number of pixels in each row of band.
+			 * @param[in] scaleDenominator
+			 *	Number of full-resolution pixels in each
+			 *	direction that make up a scaled pixel.
+			 * @param[in] format
+			 *	Format of band and out.
+			 * @param[out] out
+			 *	Destination of the scaled row.
+			 * @param[in] outWidth
+			 *	Number of pixels to write to out.
+			 */
+			static void
+			reduceBand(
+			    const uint8_t *band,
+			    uint64_t bandStride,
+			    uint32_t bandRows,
+			    uint32_t bandWidth,
+			    uint8_t scaleDenominator,
+			    PixelFormat format,
+			    uint8_t *out,
+			    uint32_t outWidth);
+
+			/**
+			 * @brief
+			 * Crop and scale a decoded image into a
+			 * decodeRegionInto() buffer.
+			 *
+			 * @param[in] image
+			 *	The full-resolution decoded image.
+			 * @param[in] imageStride
+			 *	Distance between rows of image, in bytes.
+			 * @param[in] imageDimensions
+			 *	Dimensions of image.
+			 * @param[in] format
+			 *	Format of image and buffer.
+			 * @param[in] scaleDenominator
+			 *	Reciprocal of the scale.
+			 * @param[in] horzOffset
+			 *	Horizontal offset of the region in the
+			 *	scaled image.
+			 * @param[in] vertOffset
+			 *	Vertical offset of the region in the scaled
+			 *	image.
+			 * @param[in] dimensions
+			 *	Dimensions of the scaled region.
+			 * @param[out] buffer
+			 *	Destination of the scaled region.
+			 * @param[in] stride
+			 *	Distance between rows of buffer, in bytes.
+			 */
+			static void
+			reduceRegion(
+			    const uint8_t *image,
+			    uint64_t imageStride,
+			    const Size &imageDimensions,
+			    PixelFormat format,
+			    uint8_t scaleDenominator,
+			    uint32_t horzOffset,
+			    uint32_t vertOffset,
+			    const Size &dimensions,
+			    uint8_t *buffer,
+			    uint64_t stride);
+
+			/**
+			 * @brief
+			 * Convert decompressed image data, in the layout
+			 * returned by getRawData(), to a decodeInto()
+			 * pixel format.
+			 *
+			 * @param[in] rawData
+			 *	Decompressed image data.
+			 * @param[in] rawDataSize
+			 *	Size of rawData, in bytes.
+			 * @param[out] buffer
+			 *	Buffer passed to decodeInto().
+			 * @param[in] stride
+			 *	Stride passed to decodeInto().
+			 * @param[in] format
+			 *	Format passed to decodeInto().
+			 *
+			 * @throw Error::DataError
+			 *	rawData is too small for the image.
+			 */
+			void
+			convertRawData(
+			    const uint8_t *rawData,
+			    uint64_t rawDataSize,
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
+			/**
+			 * @brief
+			 * Convert a color to gray.
+			 *
+			 * @param[in] red
+			 *	Red component.
+			 * @param[in] green
+			 *	Green component.
+			 * @param[in] blue
+			 *	Blue component.
+			 *
+			 * @return
+			 *	Y' component of Y'CbCr, using the factors
+			 *	from ITU-R BT.601.
+			 */
+			static uint8_t
+			grayValue(
+			    uint8_t red,
+			    uint8_t green,
+			    uint8_t blue)
+			{
+				return (static_cast<uint8_t>((red * 0.299f) +
+				    (green * 0.587f) + (blue * 0.114f)));
+			}
+
+			/**
+			 * @brief
+			 * Convert one row of interleaved samples to a
+			 * decodeInto() pixel format.
+			 *
+			 * @param[in] in
+			 *	Row of samples.  Images with one or two
+			 *	components are gray (plus alpha); those with
+			 *	three or four are RGB (plus alpha).
+			 * @param[in] width
+			 *	Number of pixels in the row.
+			 * @param[in] components
+			 *	Number of components per pixel in in.
+			 * @param[in] bytesPerComponent
+			 *	1 for 8-bit samples, 2 for native-endian
+			 *	16-bit samples.
+			 * @param[out] out
+			 *	Destination of the converted row.
+			 * @param[in] format
+			 *	Gray8 or RGB24.
+			 */
+			static void
+			convertRow(
+			    const uint8_t *in,
+			    uint32_t width,
+			    uint8_t components,
+			    uint8_t bytesPerComponent,
+			    uint8_t *out,
+			    PixelFormat format);
+
 			/**
 			 * @brief
 			 * Mutator for the presence of an alpha channel.
@@ -535,11 +1364,17 @@ namespace BiometricEvaluation
 			/** Resolution */
 			Resolution _resolution;
 
-			/** Encoded image data */
-			Memory::AutoArray<uint8_t> _data;
+			/** Encoded image data, possibly shared */
+			std::shared_ptr<const uint8_t> _data;
+
+			/** Size of _data, in bytes */
+			uint64_t _dataSize;
 
 			/** Compression algorithm of _data */
 			CompressionAlgorithm _compressionAlgorithm;
+
+			/** Most threads a decode may use (0: one per CPU) */
+			uint32_t _decodeThreadCount;
 		};
 	}
 }
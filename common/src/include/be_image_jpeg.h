@@ -53,6 +53,10 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    const uint64_t size);
 
+			JPEG(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
 			JPEG(
 			    const Memory::uint8Array &data);
 
@@ -62,6 +66,21 @@ namespace BiometricEvaluation
 			getRawGrayscaleData(
 			    uint8_t depth) const;
 
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
+			void
+			decodeRegionInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format,
+			    const DecodeRequest &request)
+			    const;
+
 			Memory::uint8Array
 			getRawData()
 			    const;
@@ -82,6 +101,27 @@ namespace BiometricEvaluation
 			isJPEG(
 			    const uint8_t *data,
 			    uint64_t size);
+
+			/**
+			 * @brief
+			 * Determine whether data is a lossy or lossless
+			 * JPEG image from its first start of frame marker.
+			 *
+			 * @param[in] data
+			 *	The buffer to check.
+			 * @param[in] size
+			 *	The size of data.
+			 *
+			 * @return
+			 *	CompressionAlgorithm::JPEGB for lossy JPEG,
+			 *	CompressionAlgorithm::JPEGL for lossless JPEG,
+			 *	or CompressionAlgorithm::None when data is
+			 *	not a JPEG image.
+			 */
+			static CompressionAlgorithm
+			getJPEGCompressionAlgorithm(
+			    const uint8_t *data,
+			    uint64_t size);
 			
 			static int
 			getc_skip_marker_segment(
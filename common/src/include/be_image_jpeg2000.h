@@ -45,6 +45,28 @@ namespace BiometricEvaluation
 			    const uint64_t size,
 			    const int8_t codecFormat = 2);
 
+			/**
+			 * @brief
+			 * Create a new JPEG2000 object that shares the
+			 * image data instead of copying it.
+			 *
+			 * @param[in] data
+			 *	The image data.
+			 * @param[in] size
+			 *	The size of the image data, in bytes.
+			 * @param[in] codec
+			 *	The OPJ_CODEC_FORMAT used to encode data.
+			 *
+			 * @throw Error::DataError
+			 *	Error manipulating data.
+			 * @throw Error::StrategyError
+			 *	Error while creating Image.
+			 */
+			JPEG2000(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size,
+			    const int8_t codecFormat = 2);
+
 			JPEG2000(
 			    const Memory::uint8Array &data);
 
@@ -57,6 +79,21 @@ namespace BiometricEvaluation
 			Memory::uint8Array
 			getRawGrayscaleData(
 			    uint8_t depth) const;
+
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
+			void
+			decodeRegionInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format,
+			    const DecodeRequest &request)
+			    const;
 	
 			/**
 			 * Whether or not data is a JPEG-2000 image.
@@ -75,6 +112,48 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    uint64_t size);
 
+			/**
+			 * @brief
+			 * Encode pixels as a JP2 image.
+			 *
+			 * @param[in] rawData
+			 *	Pixels in the format returned by getRawData():
+			 *	row-major with no padding between rows,
+			 *	components interleaved, and 16-bit components
+			 *	in native byte order.
+			 * @param[in] dimensions
+			 *	Dimensions of the image in rawData.
+			 * @param[in] colorDepth
+			 *	Number of bits per pixel.  Gray, gray with
+			 *	alpha, RGB, and RGBA pixels are supported.
+			 * @param[in] bitDepth
+			 *	Number of bits per component, 8 or 16.
+			 * @param[in] resolution
+			 *	Resolution recorded in the capture resolution
+			 *	box, or Resolution::Units::NA to omit it.
+			 * @param[in] compressionRatio
+			 *	Target compression ratio for lossy (9/7
+			 *	wavelet) encoding, or 0 for lossless (5/3
+			 *	wavelet) encoding.
+			 *
+			 * @return
+			 *	JP2-encoded image.
+			 *
+			 * @throw Error::ParameterError
+			 *	rawData is nullptr, or unsupported colorDepth,
+			 *	bitDepth, or compressionRatio.
+			 * @throw Error::StrategyError
+			 *	libopenjp2 could not encode the image.
+			 */
+			static Memory::uint8Array
+			encode(
+			    const uint8_t *rawData,
+			    const Size &dimensions,
+			    uint32_t colorDepth,
+			    uint16_t bitDepth,
+			    const Resolution &resolution,
+			    float compressionRatio = 0);
+
 		private:
 			/** JPEG2000 codec to use (from libopenjpeg) */
 			const int8_t _codecFormat;
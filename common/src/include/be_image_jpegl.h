@@ -28,6 +28,10 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    const uint64_t size);
 
+			JPEGL(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
 			JPEGL(
 			    const Memory::uint8Array &data);
 
@@ -37,6 +41,13 @@ namespace BiometricEvaluation
 			getRawGrayscaleData(
 			    uint8_t depth) const;
 
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
 			Memory::uint8Array
 			getRawData()
 			    const;
@@ -45,6 +45,10 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    const uint64_t size);
 
+			NetPBM(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
 			NetPBM(
 			    const Memory::uint8Array &data);
 
@@ -76,6 +80,13 @@ namespace BiometricEvaluation
 			Memory::uint8Array
 			getRawGrayscaleData(
 			    uint8_t depth) const;
+
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
 	
 			/**
 			 * Whether or not data is a netpbm image.
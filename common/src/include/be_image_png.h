@@ -28,6 +28,10 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    const uint64_t size);
 
+			PNG(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
 			PNG(
 			    const Memory::uint8Array &data);
 
@@ -41,6 +45,21 @@ namespace BiometricEvaluation
 			getRawGrayscaleData(
 			    uint8_t depth) const;
 
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
+			void
+			decodeRegionInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format,
+			    const DecodeRequest &request)
+			    const;
+
 			/**
 			 * Whether or not data is a PNG image.
 			 *
@@ -57,6 +76,47 @@ namespace BiometricEvaluation
 			isPNG(
 			    const uint8_t *data,
 			    uint64_t size);
+
+			/**
+			 * @brief
+			 * Encode pixels as PNG.
+			 *
+			 * @param[in] rawData
+			 *	Pixels in the format returned by getRawData():
+			 *	row-major with no padding between rows,
+			 *	components interleaved, and 16-bit components
+			 *	in native byte order.
+			 * @param[in] dimensions
+			 *	Dimensions of the image in rawData.
+			 * @param[in] colorDepth
+			 *	Number of bits per pixel.  Gray, gray with
+			 *	alpha, RGB, and RGBA pixels are supported.
+			 * @param[in] bitDepth
+			 *	Number of bits per component, 8 or 16.
+			 * @param[in] resolution
+			 *	Resolution recorded in the encoded image, or
+			 *	Resolution::Units::NA if unknown.
+			 * @param[in] compressionLevel
+			 *	zlib compression level, 0 (fastest) through 9
+			 *	(smallest), or -1 for the libpng default.
+			 *
+			 * @return
+			 *	PNG-encoded image.
+			 *
+			 * @throw Error::ParameterError
+			 *	rawData is nullptr, or unsupported colorDepth,
+			 *	bitDepth, or compressionLevel.
+			 * @throw Error::StrategyError
+			 *	libpng could not encode the image.
+			 */
+			static Memory::uint8Array
+			encode(
+			    const uint8_t *rawData,
+			    const Size &dimensions,
+			    uint32_t colorDepth,
+			    uint16_t bitDepth,
+			    const Resolution &resolution,
+			    int8_t compressionLevel = -1);
 		};
 	}
 }
@@ -33,6 +33,15 @@ namespace BiometricEvaluation
 			    const Resolution resolution,
 			    const bool hasAlphaChannel);
 
+			Raw(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size,
+			    const Size dimensions,
+			    const uint32_t colorDepth,
+			    const uint16_t bitDepth,
+			    const Resolution resolution,
+			    const bool hasAlphaChannel);
+
 			Raw(
 			    const BiometricEvaluation::Memory::uint8Array &data,
 			    const Size dimensions,
@@ -55,6 +64,13 @@ namespace BiometricEvaluation
 			getRawGrayscaleData(
 			    uint8_t depth) const;
 
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
 		protected:
 
 		private:
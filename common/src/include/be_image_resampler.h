@@ -0,0 +1,194 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IMAGE_RESAMPLER_H__
+#define __BE_IMAGE_RESAMPLER_H__
+
+#include <cstdint>
+#include <memory>
+
+#include <be_framework_enumeration.h>
+#include <be_image_raw.h>
+
+namespace BiometricEvaluation
+{
+	namespace Image
+	{
+		/** Filters used to compute resampled pixels */
+		enum class ResampleFilter
+		{
+			/** Average of the input pixels covered */
+			Box,
+			/** Linear interpolation (a triangle filter) */
+			Bilinear,
+			/** Windowed sinc with three lobes */
+			Lanczos3
+		};
+
+		/**
+		 * @brief
+		 * Resample images to new dimensions or resolutions.
+		 *
+		 * @details
+		 * The filter is applied separably, first along rows and then
+		 * along columns, and is widened when reducing an image so
+		 * that every input pixel contributes to the output.  Bands of
+		 * output rows are divided among threads, and each thread
+		 * filters four rows or columns at once with SIMD
+		 * instructions.  Pixels are filtered in floating point and
+		 * rounded to 8 bits per sample.
+		 */
+		class Resampler
+		{
+		public:
+			/**
+			 * @brief
+			 * Constructor.
+			 *
+			 * @param filter
+			 *	Filter used to compute output pixels.
+			 * @param threadCount
+			 *	Most threads to resample with, or 0 for one
+			 *	per processor.
+			 */
+			Resampler(
+			    ResampleFilter filter = ResampleFilter::Lanczos3,
+			    uint32_t threadCount = 0);
+
+			/**
+			 * @brief
+			 * Resample pixels to new dimensions.
+			 *
+			 * @param input
+			 *	First row of input pixels.
+			 * @param inputDimensions
+			 *	Dimensions of input.
+			 * @param inputStride
+			 *	Bytes between the start of rows in input.
+			 * @param output
+			 *	Where the first row of output pixels is
+			 *	written.
+			 * @param outputDimensions
+			 *	Dimensions of output.
+			 * @param outputStride
+			 *	Bytes between the start of rows in output.
+			 * @param format
+			 *	Format of input and output pixels (Gray8 or
+			 *	RGB24).
+			 *
+			 * @throw Error::ParameterError
+			 *	format is not Gray8 or RGB24, a dimension is
+			 *	0, or a stride is smaller than a row.
+			 */
+			void
+			resample(
+			    const uint8_t *input,
+			    const Size &inputDimensions,
+			    uint64_t inputStride,
+			    uint8_t *output,
+			    const Size &outputDimensions,
+			    uint64_t outputStride,
+			    PixelFormat format)
+			    const;
+
+			/**
+			 * @brief
+			 * Resample an image to new dimensions.
+			 *
+			 * @param image
+			 *	Image to resample.
+			 * @param dimensions
+			 *	Dimensions of the resampled image.
+			 * @param format
+			 *	Format of the resampled image (Gray8 or
+			 *	RGB24).
+			 *
+			 * @return
+			 *	Resampled image, whose resolution is scaled
+			 *	with its dimensions.
+			 *
+			 * @throw Error::ParameterError
+			 *	format is not Gray8 or RGB24, or a dimension
+			 *	is 0.
+			 * @throw Error::Exception
+			 *	Error decoding image.
+			 */
+			std::shared_ptr<Raw>
+			resample(
+			    const Image &image,
+			    const Size &dimensions,
+			    PixelFormat format = PixelFormat::Gray8)
+			    const;
+
+			/**
+			 * @brief
+			 * Resample an image to a new resolution.
+			 *
+			 * @param image
+			 *	Image to resample.
+			 * @param resolution
+			 *	Resolution of the resampled image, such as
+			 *	500 PPI.
+			 * @param format
+			 *	Format of the resampled image (Gray8 or
+			 *	RGB24).
+			 *
+			 * @return
+			 *	Resampled image, whose dimensions are those
+			 *	of image scaled by the change in resolution,
+			 *	rounded to the nearest pixel.
+			 *
+			 * @throw Error::ParameterError
+			 *	format is not Gray8 or RGB24, resolution is
+			 *	not positive or has unknown units, or the
+			 *	resampled image would be empty.
+			 * @throw Error::StrategyError
+			 *	The resolution of image, or its units, are
+			 *	not known.
+			 * @throw Error::Exception
+			 *	Error decoding image.
+			 */
+			std::shared_ptr<Raw>
+			resample(
+			    const Image &image,
+			    const Resolution &resolution,
+			    PixelFormat format = PixelFormat::Gray8)
+			    const;
+
+			/**
+			 * @return
+			 *	Filter used to compute output pixels.
+			 */
+			ResampleFilter
+			getFilter()
+			    const;
+
+			/**
+			 * @return
+			 *	Most threads to resample with.
+			 */
+			uint32_t
+			getThreadCount()
+			    const;
+
+		private:
+			/** Filter used to compute output pixels */
+			ResampleFilter _filter;
+			/** Most threads to resample with */
+			uint32_t _threadCount;
+		};
+	}
+}
+
+BE_FRAMEWORK_ENUMERATION_DECLARATIONS(
+    BiometricEvaluation::Image::ResampleFilter,
+    BE_Image_ResampleFilter_EnumToStringMap);
+
+#endif /* __BE_IMAGE_RESAMPLER_H__ */
@@ -25,6 +25,10 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    const uint64_t size);
 
+			TIFF(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
 			TIFF(
 			    const Memory::uint8Array &data);
 
@@ -39,6 +43,13 @@ namespace BiometricEvaluation
 			    uint8_t depth)
 			    const;
 
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
+
 			/**
 			 * @brief
 			 * Determine if image is encoded as TIFF.
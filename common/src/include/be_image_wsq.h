@@ -28,6 +28,10 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    const uint64_t size);
 
+			WSQ(
+			    const std::shared_ptr<const uint8_t> &data,
+			    const uint64_t size);
+
 			WSQ(
 			    const Memory::uint8Array &data);
 
@@ -40,6 +44,13 @@ namespace BiometricEvaluation
 			Memory::uint8Array
 			getRawGrayscaleData(
 			    uint8_t depth) const;
+
+			void
+			decodeInto(
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    PixelFormat format)
+			    const;
 	
 			/**
 			 * Whether or not data is a WSQ image.
@@ -58,6 +69,42 @@ namespace BiometricEvaluation
 			    const uint8_t *data,
 			    uint64_t size);
 
+			/**
+			 * @brief
+			 * Encode grayscale pixels as WSQ.
+			 *
+			 * @param[in] rawData
+			 *	8-bit grayscale pixels, in row-major order
+			 *	with no padding between rows.
+			 * @param[in] dimensions
+			 *	Dimensions of the image in rawData.
+			 * @param[in] resolution
+			 *	Resolution recorded in the encoded image, or
+			 *	Resolution::Units::NA if unknown.
+			 * @param[in] bitrate
+			 *	Target bit rate.  0.75 yields approximately
+			 *	15:1 compression, and 2.25 approximately 5:1.
+			 *
+			 * @return
+			 *	WSQ-encoded image.
+			 *
+			 * @throw Error::ParameterError
+			 *	rawData is nullptr or bitrate is not positive.
+			 * @throw Error::StrategyError
+			 *	libwsq could not encode the image.
+			 *
+			 * @note
+			 * libwsq keeps its tables in global state, so
+			 * encoding and decoding WSQ images is serialized
+			 * between threads.
+			 */
+			static Memory::uint8Array
+			encode(
+			    const uint8_t *rawData,
+			    const Size &dimensions,
+			    const Resolution &resolution,
+			    float bitrate = 0.75);
+
 		protected:
 
 		private:
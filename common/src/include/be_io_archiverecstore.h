@@ -11,6 +11,8 @@
 #ifndef __BE_ARCHIVERECSTORE_H__
 #define __BE_ARCHIVERECSTORE_H__
 
+#include <functional>
+
 #include <be_io_recordstore.h>
 
 namespace BiometricEvaluation {
@@ -39,6 +41,26 @@ namespace BiometricEvaluation {
  * entries in the manifest for one key.  The last entry for the key is 
  * considered accurate.  If the last offset for a key is 
  * ARCHIVE_RECORD_REMOVED, the information is treated as unavailable.
+ *
+ * read(), length(), and containsKey() may be called concurrently from
+ * multiple threads on a single ArchiveRecordStore opened read-only.
+ * Records are read with pread(2) from a shared file descriptor, so
+ * concurrent readers do not contend for a stream position.  Reads must
+ * not be concurrent with any modifying operation or with sequencing.
+ *
+ * Space held by removed and replaced records can be reclaimed without
+ * closing a read/write store by compact() or startCompaction().  Live
+ * records are slid toward the start of the archive a bounded segment at
+ * a time, so no second copy of the archive is needed and the store
+ * remains usable between segments.  The manifest is updated after each
+ * segment is written, so an interrupted compaction leaves a consistent
+ * store.
+ *
+ * sync() forces the archive to storage before the manifest, so the
+ * manifest never names data that was lost.  If a process stops between
+ * syncs, entries at the end of the manifest that are incomplete or name
+ * data past the end of the archive are discarded when the store is next
+ * opened, and the record count is taken from the manifest.
  */
 		class ArchiveRecordStore : public RecordStore {
 		public:	
@@ -46,6 +68,30 @@ namespace BiometricEvaluation {
 			static const std::string MANIFEST_FILE_NAME;
 			/** Name of the archive file on disk */
 			static const std::string ARCHIVE_FILE_NAME;
+			/** Bytes copied per compaction segment by default */
+			static const uint64_t DEFAULT_COMPACTION_SEGMENT_SIZE;
+
+			/** State of a compaction, passed to a callback */
+			struct CompactionProgress
+			{
+				/** Bytes of the archive examined so far */
+				uint64_t bytesExamined;
+				/** Size of the archive when compaction began */
+				uint64_t bytesTotal;
+				/** Dead bytes reclaimed so far */
+				uint64_t bytesReclaimed;
+				/** Whether the compaction has completed */
+				bool finished;
+			};
+
+			/**
+			 * Function called after each compaction segment.
+			 * It is called from the compacting thread, and
+			 * must not start, wait for, or cancel a
+			 * compaction.
+			 */
+			using CompactionCallback =
+			    std::function<void(const CompactionProgress&)>;
 
 			/**
 			 * Create a new ArchiveRecordStore, read/write mode.
@@ -144,10 +190,70 @@ namespace BiometricEvaluation {
 			void changeDescription(
                             const std::string &description) override;
 
+			/**
+			 * @brief
+			 * Read the beginning of a record, reading no
+			 * more than size bytes from the archive.
+			 *
+			 * @param[in] key
+			 *	The key of the record to be read.
+			 * @param[in] size
+			 *	Maximum number of bytes to read.
+			 * @return
+			 *	The first size bytes of the record, or the
+			 *	complete record if it is shorter.
+			 * @throw Error::ObjectDoesNotExist
+			 *	A record for the key does not exist.
+			 * @throw Error::StrategyError
+			 *	The archive could not be read.
+			 */
+			Memory::uint8Array readPrefix(
+			    const std::string &key,
+			    uint64_t size) const override;
+
+			/**
+			 * @brief
+			 * Advise the operating system that the archive will
+			 * be read sequentially.
+			 *
+			 * @param[in] records
+			 *	Non-zero to advise sequential access, or 0 to
+			 *	restore the default.
+			 */
+			void adviseSequentialRead(
+			    unsigned int records) override;
+
+			/**
+			 * @brief
+			 * Split the manifest into ranges of records that
+			 * may be sequenced in parallel.
+			 *
+			 * @details
+			 * Partitions share this store's archive descriptor
+			 * and read with positional reads, so no files are
+			 * opened.  The store must not be compacted or
+			 * vacuumed while partitions are in use.
+			 *
+			 * @param[in] count
+			 *	Number of partitions.
+			 *
+			 * @return
+			 *	count partitions, in sequence order.
+			 *
+			 * @throw Error::ParameterError
+			 *	count is 0.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 */
+			std::vector<std::shared_ptr<RecordStore::Partition>>
+			partition(
+			    unsigned int count) override;
+
 			/**
 			 * See if the ArchiveRecordStore would benefit from
-			 * calling vacuum() to remove deleted entries, since
-			 * vacuum() is an expensive operation.
+			 * calling vacuum() or compact() to remove deleted
+			 * entries, since vacuum() is an expensive operation.
 			 *
 			 * @return
 			 *	true if vacuum() would be beneficial
@@ -190,6 +296,162 @@ namespace BiometricEvaluation {
 			 */
 			static void vacuum(
 			    const std::string &pathname);
+
+			/**
+			 * @brief
+			 * Create an ArchiveRecordStore holding the records
+			 * of several others.
+			 *
+			 * @details
+			 * The live regions of each source archive are
+			 * copied in bulk and manifest entries are rewritten
+			 * with new offsets, so records are never read
+			 * individually.  Records keep their source order,
+			 * and dead space is not copied.  Every source is
+			 * checked for duplicate keys before the new store
+			 * is created.
+			 *
+			 * @param[in] mergePathname
+			 *	The path name of the new store.
+			 * @param[in] description
+			 *	The description of the new store.
+			 * @param[in] pathnames
+			 *	Path names of the ArchiveRecordStores
+			 *	to merge.
+			 *
+			 * @throw Error::ObjectExists
+			 *	The new store already exists, or a key
+			 *	appears in more than one source.
+			 * @throw Error::StrategyError
+			 *	A source could not be opened, or an error
+			 *	occurred when using the underlying storage
+			 *	system.
+			 */
+			static void mergeArchives(
+			    const std::string &mergePathname,
+			    const std::string &description,
+			    const std::vector<std::string> &pathnames);
+
+			/**
+			 * @brief
+			 * Obtain the number of bytes in the archive that
+			 * do not belong to a live record.
+			 *
+			 * @return
+			 *	Bytes that compaction could reclaim.
+			 */
+			uint64_t getDeadSpace() const;
+
+			/**
+			 * @brief
+			 * Reclaim dead space in the archive while the store
+			 * remains open.
+			 *
+			 * @details
+			 * Live records are moved toward the start of the
+			 * archive in segments of at most segmentSize bytes.
+			 * The store is locked only while a segment is
+			 * copied, so other threads may continue to read
+			 * (and this store may be modified) between segments.
+			 * When all records have been examined, the manifest
+			 * is rewritten without stale entries and the
+			 * archive is truncated.
+			 *
+			 * @param[in] segmentSize
+			 *	Maximum number of bytes to copy while
+			 *	holding the store lock.
+			 * @param[in] callback
+			 *	Function to call with progress after each
+			 *	segment, or nullptr.
+			 *
+			 * @throw Error::StrategyError
+			 *	The store was opened read-only, or an error
+			 *	occurred when using the underlying storage
+			 *	system.
+			 */
+			void compact(
+			    uint64_t segmentSize =
+			    DEFAULT_COMPACTION_SEGMENT_SIZE,
+			    const CompactionCallback &callback = nullptr);
+
+			/**
+			 * @brief
+			 * Run compact() on a background thread.
+			 *
+			 * @param[in] segmentSize
+			 *	Maximum number of bytes to copy while
+			 *	holding the store lock.
+			 * @param[in] callback
+			 *	Function to call with progress after each
+			 *	segment, or nullptr.
+			 *
+			 * @throw Error::StrategyError
+			 *	The store was opened read-only or a
+			 *	compaction is already running.
+			 */
+			void startCompaction(
+			    uint64_t segmentSize =
+			    DEFAULT_COMPACTION_SEGMENT_SIZE,
+			    const CompactionCallback &callback = nullptr);
+
+			/**
+			 * @brief
+			 * Wait for a background compaction to finish.
+			 *
+			 * @throw Error::StrategyError
+			 *	The background compaction failed.
+			 */
+			void waitForCompaction();
+
+			/**
+			 * @brief
+			 * Stop a background compaction after its current
+			 * segment and wait for it to finish.
+			 *
+			 * @note
+			 * Space reclaimed by completed segments is not
+			 * returned to the file system until a later
+			 * compaction runs to completion.
+			 */
+			void cancelCompaction();
+
+			/**
+			 * @return
+			 *	Whether a background compaction is running.
+			 */
+			bool isCompacting() const;
+
+			/**
+			 * @brief
+			 * Start a background compaction automatically when
+			 * enough of the archive is dead.
+			 *
+			 * @details
+			 * After each remove() (and so each replace()), if
+			 * needsVacuum() is true and getDeadSpace() is at
+			 * least threshold of the archive's size, and no
+			 * compaction is running, startCompaction() is
+			 * called.
+			 *
+			 * @param[in] threshold
+			 *	Fraction of the archive, in (0, 1], that
+			 *	must be dead to trigger compaction, or 0
+			 *	to disable automatic compaction.
+			 * @param[in] segmentSize
+			 *	Passed to startCompaction().
+			 * @param[in] callback
+			 *	Passed to startCompaction().
+			 *
+			 * @throw Error::ParameterError
+			 *	threshold is not within [0, 1].
+			 * @throw Error::StrategyError
+			 *	The store was opened read-only.
+			 */
+			void setAutoCompaction(
+			    double threshold,
+			    uint64_t segmentSize =
+			    DEFAULT_COMPACTION_SEGMENT_SIZE,
+			    const CompactionCallback &callback = nullptr);
 	
 			/**
 			 * Obtain the name of the file storing the data for 
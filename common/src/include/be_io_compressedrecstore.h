@@ -122,6 +122,10 @@ namespace BiometricEvaluation
 			void changeDescription(
                             const std::string &description) override;
 
+			void
+			adviseSequentialRead(
+			    unsigned int records) override;
+
 			void
 			insert(
 			    const std::string &key,
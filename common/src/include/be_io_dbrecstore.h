@@ -24,6 +24,15 @@ namespace BiometricEvaluation {
 		 * @brief
 		 * A class that implements IO::RecordStore using a Berkeley
 		 * DB database as the underlying record storage system.
+		 *
+		 * @details
+		 * read(), length(), and containsKey() may be called
+		 * concurrently from multiple threads on a single
+		 * DBRecordStore opened read-only.  Each reading thread is
+		 * given its own database handles the first time it reads,
+		 * which remain open until the DBRecordStore is destroyed.
+		 * Reads must not be concurrent with any modifying operation
+		 * or with sequencing.
 		 */
 		class DBRecordStore : public RecordStore {
 		public:
@@ -125,6 +134,22 @@ namespace BiometricEvaluation {
 			void changeDescription(
                             const std::string &description) override;
 
+			/**
+			 * @brief
+			 * Split the records into ranges of keys that may
+			 * be sequenced in parallel.
+			 *
+			 * @details
+			 * The keys that bound the ranges are found by
+			 * walking the keys of the B-tree once.  Each
+			 * partition opens its own read-only database
+			 * handles when first sequenced and reads its range
+			 * with a B-tree cursor.
+			 */
+			std::vector<std::shared_ptr<RecordStore::Partition>>
+			partition(
+			    unsigned int count) override;
+
 			/* Prevent copying of DBRecordStore objects */
 			DBRecordStore(const DBRecordStore&) = delete;
 			DBRecordStore& operator=(const DBRecordStore&) = delete;
@@ -29,10 +29,25 @@ namespace BiometricEvaluation {
 		 * is not compliant. A FileRecordStore has the additional
 		 * requirement that a key name may not contain path delimiter
 		 * characters ('/' and '\'), or begin with whitespace.
+		 *
+		 * The store keeps an index of its keys and the space used
+		 * by each record, saved when the store is synced, so that
+		 * sequencing, positioning the cursor, and computing space
+		 * used do not scan the file system. Records sequence in
+		 * the order they were inserted. When the saved index is
+		 * missing or stale (e.g., the store was not synced before
+		 * the process ended), it is rebuilt from the files when the
+		 * store is opened.
+		 *
+		 * Record files may be spread over levels of subdirectories,
+		 * each chosen by a hash of the key, so that very large
+		 * stores do not place every file in one directory.
 		 */
 		class FileRecordStore : public RecordStore {
 		public:
-			
+			/** Maximum levels of hashed subdirectories */
+			static const unsigned int MAX_FANOUT_DEPTH;
+
 			/**
 			 * Create a new FileRecordStore, read/write mode.
 			 *
@@ -40,15 +55,22 @@ namespace BiometricEvaluation {
 			 *	The directory where the store is to be created.
 			 * @param[in] description
 			 *	The store's description.
+			 * @param[in] fanOutDepth
+			 *	Levels of subdirectories, each of up to 256
+			 *	entries, over which to spread record files.
+			 *	When 0, all record files share a directory.
 			 * @throw  Error::ObjectExists
 			 *	The store already exists.
+			 * @throw Error::ParameterError
+			 *	fanOutDepth exceeds MAX_FANOUT_DEPTH.
 			 * @throw Error::StrategyError
 			 * 	An error occurred when accessing the underlying
 			 * 	file system.
 			 */
 			FileRecordStore(
 			    const std::string &pathname,
-			    const std::string &description);
+			    const std::string &description,
+			    const unsigned int fanOutDepth = 0);
 
 			/**
 			 * Open an existing FileRecordStore.
@@ -130,6 +152,49 @@ namespace BiometricEvaluation {
 			void changeDescription(
 			    const std::string &description) override;
 
+			/**
+			 * @brief
+			 * Read the beginning of a record, reading no
+			 * more than size bytes of its file.
+			 *
+			 * @param[in] key
+			 *	The key of the record to be read.
+			 * @param[in] size
+			 *	Maximum number of bytes to read.
+			 * @return
+			 *	The first size bytes of the record, or the
+			 *	complete record if it is shorter.
+			 * @throw Error::ObjectDoesNotExist
+			 *	A record for the key does not exist.
+			 * @throw Error::StrategyError
+			 *	The record file could not be read.
+			 */
+			Memory::uint8Array readPrefix(
+			    const std::string &key,
+			    uint64_t size) const override;
+
+			/**
+			 * @brief
+			 * Ask the operating system to read record files
+			 * ahead of the sequence cursor.
+			 *
+			 * @param[in] records
+			 *	Number of record files to keep requested
+			 *	ahead of the cursor, or 0 to stop.
+			 */
+			void adviseSequentialRead(
+			    unsigned int records) override;
+
+			/**
+			 * @brief
+			 * Obtain the levels of hashed subdirectories over
+			 * which record files are spread.
+			 *
+			 * @return
+			 *	Fan-out depth given when the store was created.
+			 */
+			unsigned int getFanOutDepth() const;
+
 			/* Prevent copying of FileRecordStore objects */
 			FileRecordStore(const FileRecordStore&) = delete;
 			FileRecordStore& operator=(const FileRecordStore&) =
@@ -45,11 +45,23 @@ namespace BiometricEvaluation
 		 *	Type = List
 		 *	Source Record Store = /Users/wsalamon/sandbox/SD29.rs
 		 *
+		 * When opened, the store indexes the offset of every key in
+		 * 'KeyList.txt', so that positioning the cursor at a key or
+		 * at an ordinal position does not read the list.  Opening
+		 * never writes to the store, but reads an index cached by
+		 * indexKeyList() when 'KeyList.txt' has not changed since.
+		 *
+		 * While sequencing with data, records for upcoming keys are
+		 * read from the source RecordStore in the background.
+		 *
 		 * @note
 		 * List RecordStores must be opened read-only.
 		 */
 		class ListRecordStore : public RecordStore {
 		public:
+			/** Number of records read ahead while sequencing */
+			static const unsigned int DEFAULT_PREFETCH_DEPTH;
+
 			/** Constructor, always opening read-only */
 			ListRecordStore(
 			    const std::string &pathname);
@@ -131,6 +143,58 @@ namespace BiometricEvaluation
 			void changeDescription(
                             const std::string &description) override;
 
+			/**
+			 * @brief
+			 * Set the cursor so the next sequenced record is at
+			 * an ordinal position within the key list.
+			 *
+			 * @param[in] position
+			 *	Position of the record in the key list, where
+			 *	0 is the first.
+			 *
+			 * @throw Error::ObjectDoesNotExist
+			 *	The key list has no record at position.
+			 */
+			void
+			setCursorAtPosition(
+			    uint64_t position);
+
+			/**
+			 * @brief
+			 * Set the number of records read ahead of the cursor
+			 * while sequencing.
+			 *
+			 * @param[in] depth
+			 *	Records to read ahead.  0 disables reading
+			 *	ahead.
+			 */
+			void
+			setPrefetchDepth(
+			    unsigned int depth);
+
+			/**
+			 * @brief
+			 * Cache the index of the key list of a
+			 * ListRecordStore, so that opening the store need
+			 * not build it.
+			 *
+			 * @details
+			 * Call after writing 'KeyList.txt'.  A cache that
+			 * does not match the current key list is ignored.
+			 *
+			 * @param[in] pathname
+			 *	Path name of the ListRecordStore.
+			 *
+			 * @throw Error::ObjectDoesNotExist
+			 *	pathname does not exist.
+			 * @throw Error::StrategyError
+			 *	The store could not be opened, or the cache
+			 *	could not be written.
+			 */
+			static void
+			indexKeyList(
+			    const std::string &pathname);
+
 		private:
 			class Impl;
 			std::unique_ptr<ListRecordStore::Impl> pimpl;
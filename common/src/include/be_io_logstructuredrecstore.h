@@ -0,0 +1,311 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IO_LOGSTRUCTUREDRECSTORE_H__
+#define __BE_IO_LOGSTRUCTUREDRECSTORE_H__
+
+#include <memory>
+
+#include <be_io_recordstore.h>
+
+namespace BiometricEvaluation {
+	namespace IO {
+/**
+ * @brief
+ * A RecordStore that appends every change to a segmented log.
+ *
+ * @details
+ * insert(), replace(), and remove() each append a single checksummed
+ * entry to the newest segment file of the log, so updating a record
+ * costs the same as inserting one and never rewrites existing data.
+ * The location of each live record is kept in an in-memory hash index.
+ * When a segment reaches its maximum size, it is sealed and a new
+ * segment is started.
+ *
+ * The index is periodically written to a checkpoint file, along with
+ * the position in the log that it reflects.  Opening a store loads the
+ * checkpoint and replays only the log entries written after it, so
+ * reopening does not require reading the whole log.  An entry that was
+ * only partially written when a process stopped is detected by its
+ * checksum and discarded.
+ *
+ * Space held by replaced and removed records in sealed segments is
+ * reclaimed by compaction, which copies the remaining live records of
+ * mostly-dead segments to the end of the log and then deletes those
+ * segments.  Compaction may run on a background thread while the store
+ * is in use, and by default starts automatically when a sealed segment
+ * is mostly dead.
+ *
+ * All operations other than sequencing and cursor positioning may be
+ * performed from multiple threads at the same time.  Reads proceed
+ * concurrently with one another.
+ *
+ * Records are sequenced in the order in which their keys were inserted.
+ * replace() does not change the position of a record in the sequence.
+ */
+		class LogStructuredRecordStore : public RecordStore {
+		public:
+			/** Prefix of the name of each log segment file */
+			static const std::string SEGMENT_FILE_PREFIX;
+			/** Name of the index checkpoint file */
+			static const std::string CHECKPOINT_FILE_NAME;
+			/** Size at which a segment is sealed, by default */
+			static const uint64_t DEFAULT_SEGMENT_SIZE;
+			/** Bytes logged between checkpoints, by default */
+			static const uint64_t DEFAULT_CHECKPOINT_INTERVAL;
+			/** Dead fraction of a segment that is compacted */
+			static const double DEFAULT_COMPACTION_THRESHOLD;
+
+			/**
+			 * Create a new LogStructuredRecordStore, read/write
+			 * mode.
+			 *
+			 * @param[in] pathname
+			 * 	The directory where the store is to be created.
+			 * @param[in] description
+			 *	The store's description.
+			 * @param[in] segmentSize
+			 *	Size, in bytes, at which a segment of the log
+			 *	is sealed and a new segment started.
+			 * @param[in] checkpointInterval
+			 *	Bytes appended to the log after which the
+			 *	index is checkpointed, or 0 to checkpoint
+			 *	only from sync() and when the store is
+			 *	closed.
+			 *
+			 * @throw Error::ObjectExists
+			 * 	The store already exists.
+			 * @throw Error::ParameterError
+			 *	segmentSize is 0.
+			 * @throw Error::StrategyError
+			 * 	An error occurred when accessing the underlying
+			 * 	file system.
+			 */
+			LogStructuredRecordStore(
+			    const std::string &pathname,
+			    const std::string &description,
+			    uint64_t segmentSize = DEFAULT_SEGMENT_SIZE,
+			    uint64_t checkpointInterval =
+			    DEFAULT_CHECKPOINT_INTERVAL);
+
+			/**
+			 * Open an existing LogStructuredRecordStore.
+			 *
+			 * @param[in] pathname
+			 *	The path name of the store.
+			 * @param[in] mode
+			 *	Open mode, read-only or read-write.
+			 *
+			 * @throw Error::ObjectDoesNotExist
+			 *	The store does not exist.
+			 * @throw Error::StrategyError
+			 *	A sealed segment is damaged, or an error
+			 *	occurred when accessing the underlying file
+			 *	system.
+			 */
+			LogStructuredRecordStore(
+			    const std::string &pathname,
+			    IO::Mode mode = IO::Mode::ReadOnly);
+
+			~LogStructuredRecordStore();
+
+			/*
+			 * Implementation of the RecordStore interface.
+			 */
+
+			/*
+			 * We need the base class insert() and replace() as well
+			 * otherwise, they are hidden by the declarations below.
+			 */
+			using RecordStore::insert;
+			using RecordStore::replace;
+
+			void sync() const override;
+
+			void insert(
+			    const std::string &key,
+			    const void *const data,
+			    const uint64_t size)
+			    override;
+
+			void replace(
+			    const std::string &key,
+			    const void *const data,
+			    const uint64_t size)
+			    override;
+
+			void remove(
+			    const std::string &key)
+			    override;
+
+			Memory::uint8Array read(
+			    const std::string &key)
+			    const override;
+
+			uint64_t length(
+			    const std::string &key)
+			    const override;
+
+			void flush(
+			    const std::string &key)
+			    const override;
+
+			RecordStore::Record sequence(
+			    int cursor = BE_RECSTORE_SEQ_NEXT)
+			    override;
+
+			std::string sequenceKey(
+			    int cursor = BE_RECSTORE_SEQ_NEXT)
+			    override;
+
+			void setCursorAtKey(
+			    const std::string &key)
+			    override;
+
+			void move(
+			    const std::string &pathname)
+			    override;
+
+			uint64_t getSpaceUsed() const override;
+			unsigned int getCount() const override;
+			std::string getPathname() const override;
+			std::string getDescription() const override;
+			void changeDescription(
+			    const std::string &description) override;
+
+			/**
+			 * @brief
+			 * Write the index to the checkpoint file.
+			 *
+			 * @details
+			 * Log data referenced by the checkpoint is forced
+			 * to storage first.  This is done by sync(), when
+			 * the store is closed, and after every
+			 * checkpointInterval bytes are logged.
+			 *
+			 * @throw Error::StrategyError
+			 *	The store was opened read-only, or an error
+			 *	occurred when accessing the underlying file
+			 *	system.
+			 */
+			void checkpoint() const;
+
+			/**
+			 * @brief
+			 * Reclaim space from sealed segments.
+			 *
+			 * @details
+			 * Each sealed segment of which at least threshold
+			 * is held by replaced or removed records has its
+			 * live records appended to the log, and is then
+			 * deleted.  The store remains usable by other
+			 * threads throughout.
+			 *
+			 * @param[in] threshold
+			 *	Fraction of a segment, in [0, 1], that must
+			 *	be dead for the segment to be compacted.
+			 *
+			 * @throw Error::ParameterError
+			 *	threshold is not within [0, 1].
+			 * @throw Error::StrategyError
+			 *	The store was opened read-only, or an error
+			 *	occurred when accessing the underlying file
+			 *	system.
+			 */
+			void compact(
+			    double threshold = DEFAULT_COMPACTION_THRESHOLD);
+
+			/**
+			 * @brief
+			 * Run compact() on a background thread.
+			 *
+			 * @param[in] threshold
+			 *	Passed to compact().
+			 *
+			 * @throw Error::StrategyError
+			 *	The store was opened read-only, or a
+			 *	compaction is already running.
+			 */
+			void startCompaction(
+			    double threshold = DEFAULT_COMPACTION_THRESHOLD);
+
+			/**
+			 * @brief
+			 * Wait for a background compaction to finish.
+			 *
+			 * @throw Error::StrategyError
+			 *	The background compaction failed.
+			 */
+			void waitForCompaction();
+
+			/**
+			 * @brief
+			 * Stop a background compaction after its current
+			 * record and wait for it to finish.
+			 */
+			void cancelCompaction();
+
+			/**
+			 * @return
+			 *	Whether a background compaction is running.
+			 */
+			bool isCompacting() const;
+
+			/**
+			 * @brief
+			 * Set when compaction starts automatically.
+			 *
+			 * @details
+			 * Whenever a segment is sealed, if any sealed
+			 * segment is at least threshold dead and no
+			 * compaction is running, startCompaction() is
+			 * called with threshold.
+			 *
+			 * @param[in] threshold
+			 *	Fraction of a segment, in (0, 1], that must
+			 *	be dead to trigger compaction, or 0 to
+			 *	disable automatic compaction.
+			 *
+			 * @throw Error::ParameterError
+			 *	threshold is not within [0, 1].
+			 * @throw Error::StrategyError
+			 *	The store was opened read-only.
+			 */
+			void setAutoCompaction(
+			    double threshold);
+
+			/**
+			 * @return
+			 *	Bytes of sealed segments held by replaced
+			 *	and removed records.
+			 */
+			uint64_t getDeadSpace() const;
+
+			/**
+			 * @return
+			 *	Number of segment files in the log.
+			 */
+			unsigned int getSegmentCount() const;
+
+			/* Prevent copying of LogStructuredRecordStore objects */
+			LogStructuredRecordStore(
+			    const LogStructuredRecordStore&) = delete;
+			LogStructuredRecordStore&
+			operator=(
+			    const LogStructuredRecordStore&) = delete;
+
+		private:
+			class Impl;
+			std::unique_ptr<LogStructuredRecordStore::Impl> pimpl;
+		};
+	}
+}
+
+#endif /* __BE_IO_LOGSTRUCTUREDRECSTORE_H__ */
@@ -89,6 +89,35 @@ namespace BiometricEvaluation
 			void
 			sync();
 
+			void
+			setProperty(
+			    const std::string &property,
+			    const std::string &value)
+			    override;
+
+			void
+			setPropertyFromInteger(
+			    const std::string &property,
+			    int64_t value)
+			    override;
+
+			void
+			setPropertyFromDouble(
+			    const std::string &property,
+			    double value)
+			    override;
+
+			void
+			setPropertyFromBoolean(
+			    const std::string &property,
+			    bool value)
+			    override;
+
+			void
+			removeProperty(
+			    const std::string &property)
+			    override;
+
 			/**
 			 * @brief
 			 * Change the name of the Properties, which means
@@ -110,7 +139,13 @@ namespace BiometricEvaluation
 			changeName(
 			    const std::string &pathname);
 
-			/** Destructor */
+			/**
+			 * @brief
+			 * Destructor.
+			 * @details
+			 * Properties changed since the file was read or
+			 * last synchronized are written to the file.
+			 */
 			~PropertiesFile();
 
 			/**
@@ -148,6 +183,9 @@ namespace BiometricEvaluation
 			/** The file name of the underlying properties file */
 			std::string _pathname;
 
+			/** Whether properties changed since the last sync */
+			bool _dirty;
+
 			/**
 			 * @brief.
 			 * Common initialization function.
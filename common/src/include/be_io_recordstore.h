@@ -10,6 +10,7 @@
 #ifndef __BE_IO_RECORDSTORE_H__
 #define __BE_IO_RECORDSTORE_H__
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -73,6 +74,88 @@ namespace BiometricEvaluation {
 
 			using iterator = IO::RecordStoreIterator;
 
+			/**
+			 * Function that may change the key and data of a
+			 * record before it is added to a merged RecordStore.
+			 * It is called concurrently from several threads.
+			 */
+			using MergeTransform = std::function<void(Record&)>;
+
+			/**
+			 * Function called after a record is added to a
+			 * merged RecordStore, with the record's key in the
+			 * merged store and its key in the source store.
+			 * Calls are made one at a time, in merge order.
+			 */
+			using MergeCallback = std::function<void(
+			    const std::string&, const std::string&)>;
+
+			/**
+			 * @brief
+			 * A cursor over one contiguous range of the records
+			 * of a RecordStore, independent of the store's own
+			 * cursor and of the cursors of other partitions.
+			 *
+			 * @details
+			 * Partitions are obtained from partition().  Each
+			 * partition may be sequenced by a different thread
+			 * at the same time.
+			 */
+			class Partition
+			{
+			public:
+				virtual ~Partition();
+
+				/**
+				 * @brief
+				 * Sequence through the records of the
+				 * partition.
+				 *
+				 * @param[in] cursor
+				 *	BE_RECSTORE_SEQ_START to return the
+				 *	first record of the partition, or
+				 *	BE_RECSTORE_SEQ_NEXT for the record
+				 *	after the last one returned.  The
+				 *	first call always starts from the
+				 *	beginning of the partition.
+				 *
+				 * @return
+				 *	The record that is next in sequence.
+				 *
+				 * @throw Error::ObjectDoesNotExist
+				 *	End of the partition.
+				 * @throw Error::StrategyError
+				 *	Invalid cursor, or an error occurred
+				 *	when using the underlying storage
+				 *	system.
+				 */
+				virtual Record
+				sequence(
+				    int cursor = BE_RECSTORE_SEQ_NEXT) = 0;
+
+				/**
+				 * @brief
+				 * Sequence through the keys of the
+				 * partition.
+				 *
+				 * @param[in] cursor
+				 *	As for sequence().
+				 *
+				 * @return
+				 *	The key that is next in sequence.
+				 *
+				 * @throw Error::ObjectDoesNotExist
+				 *	End of the partition.
+				 * @throw Error::StrategyError
+				 *	Invalid cursor, or an error occurred
+				 *	when using the underlying storage
+				 *	system.
+				 */
+				virtual std::string
+				sequenceKey(
+				    int cursor = BE_RECSTORE_SEQ_NEXT) = 0;
+			};
+
 			/** Possible types of RecordStore */
 			enum class Kind
 			{
@@ -88,6 +171,10 @@ namespace BiometricEvaluation {
 				Compressed,
 				/** ListRecordStore */
 				List,
+				/** ShardedArchiveRecordStore */
+				ShardedArchive,
+				/** LogStructuredRecordStore */
+				LogStructured,
 
 				/** "Default" RecordStore kind */
 				Default = BerkeleyDB
@@ -99,6 +186,11 @@ namespace BiometricEvaluation {
 			 */
 			static const std::string INVALIDKEYCHARS;
 
+			/** Records read ahead by prefetchingBegin(), default */
+			static const unsigned int DEFAULT_PREFETCH_RECORDS;
+			/** Bytes read ahead by prefetchingBegin(), default */
+			static const uint64_t DEFAULT_PREFETCH_BYTES;
+
 			virtual ~RecordStore();
 			
 			/**
@@ -257,6 +349,33 @@ namespace BiometricEvaluation {
 			read(
 			    const std::string &key) const = 0;
 
+			/**
+			 * @brief
+			 * Read the beginning of a record from a store.
+			 * @details
+			 * The default implementation reads the complete
+			 * record and discards the remainder.  Stores that
+			 * can read part of a record read no more than
+			 * size bytes.
+			 *
+			 * @param[in] key
+			 *	The key of the record to be read.
+			 * @param[in] size
+			 *	Maximum number of bytes to read.
+			 * @return
+			 *	The first size bytes of the record, or the
+			 *	complete record if it is shorter.
+			 * @throw Error::ObjectDoesNotExist
+			 *	A record for the key does not exist.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 */
+			virtual Memory::uint8Array
+			readPrefix(
+			    const std::string &key,
+			    uint64_t size) const;
+
 			/**
 			 * Replace a complete record in a RecordStore.
 			 *
@@ -435,6 +554,103 @@ namespace BiometricEvaluation {
 			end()
 			    noexcept;
 
+			/**
+			 * @brief
+			 * Obtain an iterator that reads records ahead on a
+			 * background thread.
+			 *
+			 * @details
+			 * Records are sequenced from the start of the store
+			 * while the caller works on earlier records.  At
+			 * least one record is always read ahead, even if it
+			 * is larger than prefetchBytes.  The store is
+			 * advised of the read-ahead with
+			 * adviseSequentialRead().
+			 *
+			 * @param[in] prefetchRecords
+			 *	Most records to hold ahead of the iterator.
+			 * @param[in] prefetchBytes
+			 *	Most bytes of record data to hold ahead of
+			 *	the iterator.
+			 *
+			 * @return
+			 *	Iterator to the first record.
+			 *
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.  Errors reading ahead are
+			 *	thrown when the iterator reaches the record
+			 *	that could not be read.
+			 *
+			 * @note
+			 * Until the iterator and all copies of it have
+			 * reached the end or been destroyed, no other
+			 * method of the store may be called.
+			 */
+			iterator
+			prefetchingBegin(
+			    unsigned int prefetchRecords =
+			    DEFAULT_PREFETCH_RECORDS,
+			    uint64_t prefetchBytes = DEFAULT_PREFETCH_BYTES);
+
+			/**
+			 * @brief
+			 * Advise the store that it is about to be
+			 * sequenced, so that it can ask the operating
+			 * system to read ahead.
+			 *
+			 * @details
+			 * The default implementation does nothing.
+			 *
+			 * @param[in] records
+			 *	Number of records that will be read ahead of
+			 *	the cursor, or 0 to withdraw the advice.
+			 */
+			virtual void
+			adviseSequentialRead(
+			    unsigned int records);
+
+			/**
+			 * @brief
+			 * Split the records of the store into disjoint
+			 * ranges that may be sequenced in parallel.
+			 *
+			 * @details
+			 * Together, the partitions hold every record of
+			 * the store exactly once, in the store's sequence
+			 * order, and hold similar numbers of records.
+			 * Partitions may be empty, such as when the store
+			 * holds fewer than count records.
+			 *
+			 * The default implementation sequences the keys of
+			 * the store, resetting the store's cursor, and each
+			 * partition reads its records through a read-only
+			 * instance of the store that it opens when first
+			 * sequenced.  Implementations may instead split
+			 * their own indexes.
+			 *
+			 * @param[in] count
+			 *	Number of partitions.
+			 *
+			 * @return
+			 *	count partitions, in sequence order.
+			 *
+			 * @throw Error::ParameterError
+			 *	count is 0.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 *
+			 * @note
+			 * The store must not be modified while its
+			 * partitions are in use, and partitions must not
+			 * be used after the store is destroyed.  Changes
+			 * not yet synced may not be seen.
+			 */
+			virtual std::vector<std::shared_ptr<Partition>>
+			partition(
+			    unsigned int count);
+
 			/**
 			 * @brief
 			 * Open an existing RecordStore and return a managed
@@ -538,6 +754,64 @@ namespace BiometricEvaluation {
 			    const IO::RecordStore::Kind &kind,
 			    const std::vector<std::string> &pathnames);
 
+			/**
+			 * @brief
+			 * Create a new RecordStore that contains the
+			 * transformed contents of several other RecordStores.
+			 *
+			 * @details
+			 * Source stores are read in parallel, transform is
+			 * applied on a pool of threads, and records are
+			 * added to the merged store by a single writer in
+			 * the order of pathnames, and within each source in
+			 * sequence order.  Records read ahead of the writer
+			 * are limited in total size.
+			 *
+			 * When neither transform nor callback is set and
+			 * kind and all source stores are Archive, archive
+			 * files are copied in bulk and manifests rewritten
+			 * instead.
+			 *
+			 * @param[in] mergePathname
+			 *	The path name of the new RecordStore that
+			 *	will be created.
+			 * @param[in] description
+			 *	The text used to describe the new RecordStore.
+			 * @param[in] kind
+			 *	The kind of the new, merged RecordStore.
+			 * @param[in] pathnames
+			 *	Vector of path names to RecordStores to open.
+			 *	These are the RecordStores that will be merged
+			 *	to create the new RecordStore.
+			 * @param[in] transform
+			 *	Function to apply to each record before it
+			 *	is added, or nullptr.
+			 * @param[in] callback
+			 *	Function to call after each record is
+			 *	added, or nullptr.
+			 * @param[in] numThreads
+			 *	Maximum number of threads used to read and
+			 *	transform records, or 0 for one per core.
+			 *
+			 * @throw Error::ObjectExists
+			 *	A RecordStore at mergePathname already exists,
+			 *	or a key appears in more than one source.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 * @note
+			 *	Exceptions thrown by transform and callback
+			 *	stop the merge and are rethrown.
+			 */
+			static void mergeRecordStores(
+			    const std::string &mergePathname,
+			    const std::string &description,
+			    const IO::RecordStore::Kind &kind,
+			    const std::vector<std::string> &pathnames,
+			    const MergeTransform &transform,
+			    const MergeCallback &callback = nullptr,
+			    unsigned int numThreads = 0);
+
 			class Impl;
 		protected:
 		private:
@@ -552,8 +826,11 @@ namespace BiometricEvaluation {
 		 * Modifying a non-const iterator does not manipulate the
 		 * underlying RecordStore.
 		 * @note
-		 * This generic iterator provides no optimization over
-		 * RecordStore::sequence().
+		 * Unless created by RecordStore::prefetchingBegin(), this
+		 * generic iterator provides no optimization over
+		 * RecordStore::sequence().  Copies of a prefetching
+		 * iterator share its read-ahead, so advancing one copy
+		 * consumes records that the others will not see.
 		 */
 		class RecordStoreIterator
 		{
@@ -604,6 +881,30 @@ namespace BiometricEvaluation {
 			    IO::RecordStore *recordStore,
 			    bool atEnd);
 
+			/**
+			 * @brief
+			 * Constructor for an iterator that reads records
+			 * ahead on a background thread.
+			 *
+			 * @param recordStore
+			 * Pointer to a RecordStore that will be iterated over.
+			 * @param prefetchRecords
+			 * Most records to hold ahead of the iterator.
+			 * @param prefetchBytes
+			 * Most bytes of record data to hold ahead of the
+			 * iterator.
+			 *
+			 * @note
+			 * Iterator starts at the beginning of the RecordStore.
+			 * @note
+			 * RecordStoreIterator does not retain any ownership
+			 * of recordStore.
+			 */
+			RecordStoreIterator(
+			    IO::RecordStore *recordStore,
+			    unsigned int prefetchRecords,
+			    uint64_t prefetchBytes);
+
 			/** Default copy constructor */
 			RecordStoreIterator(
 			    const RecordStoreIterator &rhs) = default;
@@ -715,6 +1016,11 @@ namespace BiometricEvaluation {
 			/** Current record returned when dereferencing */
 			value_type _currentRecord{};
 
+			/** Reads records ahead of the iterator */
+			class Prefetcher;
+			/** Read-ahead shared by copies, if prefetching */
+			std::shared_ptr<Prefetcher> _prefetcher{};
+
 			/** Iterate the first object. */
 			void
 			setBegin();
@@ -0,0 +1,262 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IO_SHARDEDARCHIVERECSTORE_H__
+#define __BE_IO_SHARDEDARCHIVERECSTORE_H__
+
+#include <memory>
+#include <vector>
+
+#include <be_io_recordstore.h>
+
+namespace BiometricEvaluation {
+	namespace IO {
+/**
+ * @brief
+ * A RecordStore that spreads its records over several ArchiveRecordStores.
+ *
+ * @details
+ * Each key is hashed to exactly one of N shards, each of which is an
+ * independent ArchiveRecordStore with its own archive and manifest file.
+ * Shards live in subdirectories of the store by default, but may instead be
+ * placed in other directories (e.g., on other disks), so that no single file
+ * grows without bound and I/O can be striped across devices.
+ *
+ * Operations on keys that hash to different shards may be performed from
+ * multiple threads at the same time; operations on the same shard are
+ * serialized, except that reads from a store opened read-only never
+ * block one another. Sequencing and cursor operations are not
+ * thread-safe.
+ *
+ * Records are sequenced shard by shard, and within each shard in the order
+ * they were inserted. This order is stable for an unmodified store.
+ */
+		class ShardedArchiveRecordStore : public RecordStore {
+		public:
+			/** Number of shards used when none is specified */
+			static const unsigned int DEFAULT_SHARD_COUNT;
+
+			/**
+			 * Create a new ShardedArchiveRecordStore, read/write
+			 * mode.
+			 *
+			 * @param[in] pathname
+			 * 	The directory where the store is to be created.
+			 * @param[in] description
+			 *	The store's description.
+			 * @param[in] shardCount
+			 *	Number of shards to hash records into.
+			 * @param[in] shardDirectories
+			 *	Existing directories in which to place shards,
+			 *	assigned round-robin.  When empty, shards
+			 *	are placed within pathname.
+			 *
+			 * @throw Error::ObjectExists
+			 * 	The store already exists.
+			 * @throw Error::ParameterError
+			 *	shardCount is 0 or a shard directory does
+			 *	not exist.
+			 * @throw Error::StrategyError
+			 * 	An error occurred when accessing the underlying
+			 * 	file system.
+			 */
+			ShardedArchiveRecordStore(
+			    const std::string &pathname,
+			    const std::string &description,
+			    const unsigned int shardCount = DEFAULT_SHARD_COUNT,
+			    const std::vector<std::string> &shardDirectories =
+			    {});
+
+			/**
+			 * Open an existing ShardedArchiveRecordStore.
+			 *
+			 * @param[in] pathname
+			 *	The path name of the store.
+			 * @param[in] mode
+			 *	Open mode, read-only or read-write.
+			 *
+			 * @throw Error::ObjectDoesNotExist
+			 *	The store or one of its shards does not exist.
+			 * @throw Error::StrategyError
+			 *	An error occurred when accessing the underlying
+			 *	file system.
+			 */
+			ShardedArchiveRecordStore(
+			    const std::string &pathname,
+			    IO::Mode mode = IO::Mode::ReadOnly);
+
+			~ShardedArchiveRecordStore();
+
+			/*
+			 * Implementation of the RecordStore interface.
+			 */
+
+			/*
+			 * We need the base class insert() and replace() as well
+			 * otherwise, they are hidden by the declarations below.
+			 */
+			using RecordStore::insert;
+			using RecordStore::replace;
+
+			void sync() const override;
+
+			void insert(
+			    const std::string &key,
+			    const void *const data,
+			    const uint64_t size)
+			    override;
+
+			void remove(
+			    const std::string &key)
+			    override;
+
+			Memory::uint8Array read(
+			    const std::string &key)
+			    const override;
+
+			uint64_t length(
+			    const std::string &key)
+			    const override;
+
+			void flush(
+			    const std::string &key)
+			    const override;
+
+			RecordStore::Record sequence(
+			    int cursor = BE_RECSTORE_SEQ_NEXT)
+			    override;
+
+			std::string sequenceKey(
+			    int cursor = BE_RECSTORE_SEQ_NEXT)
+			    override;
+
+			void setCursorAtKey(
+			    const std::string &key)
+			    override;
+
+			void move(
+			    const std::string &pathname)
+			    override;
+
+			uint64_t getSpaceUsed() const override;
+			unsigned int getCount() const override;
+			std::string getPathname() const override;
+			std::string getDescription() const override;
+			void changeDescription(
+			    const std::string &description) override;
+
+			/**
+			 * @brief
+			 * Read the beginning of a record from the shard
+			 * holding it, reading no more than size bytes.
+			 *
+			 * @param[in] key
+			 *	The key of the record to be read.
+			 * @param[in] size
+			 *	Maximum number of bytes to read.
+			 * @return
+			 *	The first size bytes of the record, or the
+			 *	complete record if it is shorter.
+			 * @throw Error::ObjectDoesNotExist
+			 *	A record for the key does not exist.
+			 * @throw Error::StrategyError
+			 *	The shard could not be read.
+			 */
+			Memory::uint8Array readPrefix(
+			    const std::string &key,
+			    uint64_t size) const override;
+
+			/**
+			 * @brief
+			 * Advise every shard that it will be read
+			 * sequentially.
+			 *
+			 * @param[in] records
+			 *	Passed to each shard.
+			 */
+			void adviseSequentialRead(
+			    unsigned int records) override;
+
+			/**
+			 * @brief
+			 * Obtain the number of shards in this store.
+			 *
+			 * @return
+			 *	Number of shards.
+			 */
+			unsigned int getShardCount() const;
+
+			/**
+			 * @brief
+			 * Obtain the shard that holds, or would hold, a key.
+			 *
+			 * @param[in] key
+			 *	Key to locate.
+			 *
+			 * @return
+			 *	Index of the shard for key, in the range
+			 *	[0, getShardCount()).
+			 */
+			unsigned int getShardForKey(
+			    const std::string &key)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the path to each shard.
+			 *
+			 * @return
+			 *	Path to each shard's ArchiveRecordStore,
+			 *	indexed by shard.
+			 */
+			std::vector<std::string> getShardPathnames() const;
+
+			/**
+			 * See if any shard would benefit from calling
+			 * vacuum() to remove deleted entries.
+			 *
+			 * @return
+			 *	true if vacuum() would be beneficial
+			 *	false otherwise
+			 */
+			bool needsVacuum();
+
+			/**
+			 * Remove deleted entries from the manifest and
+			 * archive files of each shard that needs it.
+			 *
+			 * @param[in] pathname
+			 *	The pathname of the existing RecordStore.
+			 * @throw Error::ObjectDoesNotExist
+			 *	The RecordStore does not exist.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 * @note
+			 * This is an expensive operation.
+			 */
+			static void vacuum(
+			    const std::string &pathname);
+
+			/* Prevent copying of ShardedArchiveRecordStore objects */
+			ShardedArchiveRecordStore(
+			    const ShardedArchiveRecordStore&) = delete;
+			ShardedArchiveRecordStore&
+			operator=(
+			    const ShardedArchiveRecordStore&) = delete;
+
+		private:
+			class Impl;
+			std::unique_ptr<ShardedArchiveRecordStore::Impl> pimpl;
+		};
+	}
+}
+
+#endif /* __BE_IO_SHARDEDARCHIVERECSTORE_H__ */
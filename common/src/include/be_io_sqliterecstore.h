@@ -97,6 +97,22 @@ namespace BiometricEvaluation
 			    const std::string &key)
 			    override;
 
+			/**
+			 * @brief
+			 * Split the records into ranges of ROWIDs that may
+			 * be sequenced in parallel.
+			 *
+			 * @details
+			 * ROWID boundaries are spaced evenly between the
+			 * smallest and largest ROWID.  Each partition
+			 * opens its own read-only database connection
+			 * when first sequenced.
+			 */
+			std::vector<std::shared_ptr<RecordStore::Partition>>
+			partition(
+			    unsigned int count)
+			    override;
+
 			~SQLiteRecordStore();
 
 			SQLiteRecordStore(const SQLiteRecordStore&) = delete;
@@ -244,6 +244,29 @@ namespace BiometricEvaluation
 			    const Memory::uint8Array &buffer,
 			    const uint32_t viewNumber);
 
+			/**
+			 * @brief
+			 * Construct an INCITS iris view from a record
+			 * contained in a buffer, taking ownership of
+			 * the buffer so that images are shared with it
+			 * instead of copied.
+			 * @details
+			 * See documentation in child classes of INCITS for
+			 * information on constructing INCITS-derived iris
+			 * views.
+			 * @param[in] buffer
+			 *	The buffer containing the complete iris image
+			 *	record.
+			 * @param[in] viewNumber
+			 *	The eye number to use.
+			 *
+			 * @throw Error::DataError
+			 *	Invalid record format.
+			 */
+			INCITSView(
+			    Memory::uint8Array &&buffer,
+			    const uint32_t viewNumber);
+
 			/**
 			 * @brief
 			 * Obtain a reference to the iris image record
@@ -294,7 +317,9 @@ namespace BiometricEvaluation
 			    Memory::IndexedBuffer &buf);
 
 		private:
-			BiometricEvaluation::Memory::uint8Array _iir;
+			/** The entire record, shared with Images */
+			std::shared_ptr<BiometricEvaluation::Memory::uint8Array>
+			    _iir;
 			uint8_t _certFlag;
 
 			BiometricEvaluation::Iris::CaptureDeviceTechnology
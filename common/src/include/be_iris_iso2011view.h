@@ -68,6 +68,25 @@ namespace BiometricEvaluation
 			    const Memory::uint8Array &buffer,
 			    const uint32_t viewNumber);
 
+			/**
+			 * @brief
+			 * Construct an ISO 2011 iris view from a record
+			 * contained in a buffer, taking ownership of
+			 * the buffer so that images are shared with it
+			 * instead of copied.
+			 * @param[in] buffer
+			 *	The buffer containing the complete iris image
+			 *	record.
+			 * @param[in] viewNumber
+			 *	The eye number to use.
+			 *
+			 * @throw Error::DataError
+			 *	Invalid record format.
+			 */
+			ISO2011View(
+			    Memory::uint8Array &&buffer,
+			    const uint32_t viewNumber);
+
 		protected:
 			static const uint32_t BASE_SPEC_VERSION = 0x30323000;
 			/* '0''2''0' 'nul' */
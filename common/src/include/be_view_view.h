@@ -170,6 +170,36 @@ namespace BiometricEvaluation
 			    const BiometricEvaluation::Memory::uint8Array
 				&imageData);
 
+			/**
+			 * @brief
+			 * Mutator for the image data, taking ownership
+			 * of the buffer.
+			 * @param[in] imageData
+			 * The image data object, which is moved from.
+			 */
+			void setImageData(
+			    BiometricEvaluation::Memory::uint8Array
+				&&imageData);
+
+			/**
+			 * @brief
+			 * Mutator for the image data, sharing the buffer
+			 * with the Image objects returned from getImage().
+			 * @details
+			 * imageData may point into the record the view
+			 * was read from, using the aliasing constructor of
+			 * std::shared_ptr, so that the image data is never
+			 * copied.
+			 * @param[in] imageData
+			 * The image data, which must not be modified for
+			 * the lifetime of this object.
+			 * @param[in] size
+			 * The size of the image data, in bytes.
+			 */
+			void setImageData(
+			    const std::shared_ptr<const uint8_t> &imageData,
+			    uint64_t size);
+
 			/**
 			 * @brief
 			 * Mutator for the compression algorithm.
@@ -184,7 +214,8 @@ namespace BiometricEvaluation
 			Image::Size _imageSize;
 			Image::Resolution _imageResolution;
 			Image::Resolution _scanResolution;
-			Memory::AutoArray<uint8_t> _imageData;
+			std::shared_ptr<const uint8_t> _imageData;
+			uint64_t _imageDataSize{0};
 			Image::CompressionAlgorithm _compressionAlgorithm;
 			uint32_t _imageColorDepth;
 
@@ -19,7 +19,8 @@
 namespace BE = BiometricEvaluation;
 using namespace BE::Framework::Enumeration;
 
-BiometricEvaluation::Face::INCITSView::INCITSView()
+BiometricEvaluation::Face::INCITSView::INCITSView() :
+    _fid(std::make_shared<Memory::uint8Array>())
 {
 }
 
@@ -30,7 +31,8 @@ BiometricEvaluation::Face::INCITSView::INCITSView()
  */
 BiometricEvaluation::Face::INCITSView::INCITSView(
     const std::string &filename,
-    const uint32_t viewNumber)
+    const uint32_t viewNumber) :
+    _fid(std::make_shared<Memory::uint8Array>())
 {
 	FILE *fp;
 	if (!BE::IO::Utility::fileExists(filename)) {
@@ -41,8 +43,8 @@ BiometricEvaluation::Face::INCITSView::INCITSView(
 		throw (BE::Error::FileError("Could not open file."));
 	}
 	uint64_t size = IO::Utility::getFileSize(filename);
-	this->_fid.resize(size);
-	if (fread(this->_fid, 1, size, fp) != size){
+	this->_fid->resize(size);
+	if (fread(*this->_fid, 1, size, fp) != size){
 		fclose(fp);
 		throw (BE::Error::FileError("Could not read file"));
 	}
@@ -51,9 +53,16 @@ BiometricEvaluation::Face::INCITSView::INCITSView(
 
 BiometricEvaluation::Face::INCITSView::INCITSView(
     const Memory::uint8Array &buffer,
-    const uint32_t viewNumber)
+    const uint32_t viewNumber) :
+    _fid(std::make_shared<Memory::uint8Array>(buffer))
+{
+}
+
+BiometricEvaluation::Face::INCITSView::INCITSView(
+    Memory::uint8Array &&buffer,
+    const uint32_t viewNumber) :
+    _fid(std::make_shared<Memory::uint8Array>(std::move(buffer)))
 {
-	this->_fid = buffer;
 }
 
 /******************************************************************************/
@@ -151,7 +160,7 @@ BiometricEvaluation::Face::INCITSView::getImageDataType() const
 BiometricEvaluation::Memory::uint8Array const&
 BiometricEvaluation::Face::INCITSView::getFIDData() const
 {
-	return (this->_fid);
+	return (*this->_fid);
 }
 
 void
@@ -286,9 +295,17 @@ BiometricEvaluation::Face::INCITSView::readFaceView(
 	    Image::Resolution(0, 0, BE::Image::Resolution::Units::NA));
 	this->setScanResolution(
 	    Image::Resolution(0, 0, BE::Image::Resolution::Units::NA));
-	BE::Memory::uint8Array imageData(remainLen);
-	buf.scan(&imageData[0], remainLen);
-	this->setImageData(imageData);
+	const uint8_t *imageData = buf.get() + buf.getIndex();
+	buf.scan(nullptr, remainLen);
+	if (buf.get() == static_cast<const uint8_t *>(*this->_fid)) {
+		/* Point into the record instead of copying the image */
+		this->setImageData(std::shared_ptr<const uint8_t>(this->_fid,
+		    imageData), remainLen);
+	} else {
+		BE::Memory::uint8Array copy;
+		copy.copy(imageData, remainLen);
+		this->setImageData(std::move(copy));
+	}
 }
 
 /******************************************************************************/
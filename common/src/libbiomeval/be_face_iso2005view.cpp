@@ -21,8 +21,7 @@ BiometricEvaluation::Face::ISO2005View::ISO2005View(
     const uint32_t viewNumber) :
     BiometricEvaluation::Face::INCITSView::INCITSView(filename, viewNumber)
 {
-	BE::Memory::uint8Array recordData = Face::INCITSView::getFIDData();
-	BE::Memory::IndexedBuffer iBuf(recordData, recordData.size());
+	BE::Memory::IndexedBuffer iBuf(Face::INCITSView::getFIDData());
 	this->readISOHeader(iBuf);
 
 	//XXX Really should use a skipFaceView() function here
@@ -35,8 +34,21 @@ BiometricEvaluation::Face::ISO2005View::ISO2005View(
     const uint32_t viewNumber) :
     BiometricEvaluation::Face::INCITSView::INCITSView(buffer, viewNumber)
 {
-	BE::Memory::IndexedBuffer iBuf(
-	    const_cast<BE::Memory::uint8Array &>(buffer), buffer.size());
+	BE::Memory::IndexedBuffer iBuf(Face::INCITSView::getFIDData());
+	this->readISOHeader(iBuf);
+
+	//XXX Really should use a skipFaceView() function here
+	for (uint32_t i = 1; i <= viewNumber; i++)
+		this->readFaceView(iBuf);
+}
+
+BiometricEvaluation::Face::ISO2005View::ISO2005View(
+    BiometricEvaluation::Memory::uint8Array &&buffer,
+    const uint32_t viewNumber) :
+    BiometricEvaluation::Face::INCITSView::INCITSView(
+    std::move(buffer), viewNumber)
+{
+	BE::Memory::IndexedBuffer iBuf(Face::INCITSView::getFIDData());
 	this->readISOHeader(iBuf);
 
 	//XXX Really should use a skipFaceView() function here
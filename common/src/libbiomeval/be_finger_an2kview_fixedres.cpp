@@ -122,11 +122,10 @@ BiometricEvaluation::Finger::AN2KViewFixedResolution::readImageRecord(
 	/* Retrieve the image data */
 	if (lookup_ANSI_NIST_field(&field, &idx, BIN_IMAGE_ID, record) != TRUE)
 		throw Error::DataError("Field BIN_IMAGE not found");
-	Memory::AutoArray<uint8_t> data = Memory::AutoArray<uint8_t>(
-		    field->subfields[0]->items[0]->num_bytes);
-	for (unsigned int i = 0; i < data.size(); i++)
-		data[i] = field->subfields[0]->items[0]->value[i];
+	Memory::uint8Array data;
+	data.copy(field->subfields[0]->items[0]->value,
+	    field->subfields[0]->items[0]->num_bytes);
 
-	AN2KView::setImageData(data);
+	AN2KView::setImageData(std::move(data));
 }
 
@@ -79,6 +79,13 @@ BiometricEvaluation::Image::ROI::ROI(
     path{path}
 { }
 
+BiometricEvaluation::Image::DecodeRequest::DecodeRequest(
+    const ROI &roi,
+    const uint8_t scaleDenominator) :
+    roi{roi},
+    scaleDenominator{scaleDenominator}
+{ }
+
 const std::map<BiometricEvaluation::Image::PixelFormat, std::string>
 BE_Image_PixelFormat_EnumToStringMap = {
     {BiometricEvaluation::Image::PixelFormat::MonoWhite, "Monochrome white"},
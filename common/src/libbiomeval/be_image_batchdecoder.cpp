@@ -0,0 +1,273 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <be_error_exception.h>
+#include <be_framework_enumeration.h>
+#include <be_image_batchdecoder.h>
+
+namespace BE = BiometricEvaluation;
+
+namespace
+{
+	/**
+	 * @brief
+	 * Work shared by the threads decoding a batch.
+	 */
+	struct Batch
+	{
+		std::mutex mutex;
+		/** Signaled when an image has been decoded */
+		std::condition_variable decoded;
+		/** Signaled when an image has been delivered */
+		std::condition_variable delivered;
+
+		/** Decoded images waiting for earlier images */
+		std::map<uint64_t, BE::Image::DecodedImage> results;
+		/** Pixel buffers returned after delivery */
+		std::vector<BE::Memory::uint8Array> buffers;
+		/** Index of the next image to decode */
+		uint64_t next{0};
+		/** Index of the next image to deliver */
+		uint64_t delivering{0};
+		/** Whether workers should stop early */
+		bool stopped{false};
+	};
+
+	/*
+	 * Images a worker may decode ahead of delivery, per thread, which
+	 * bounds the memory held by a slow callback.
+	 */
+	const uint64_t IMAGES_AHEAD_PER_THREAD = 4;
+}
+
+/**
+ * @brief
+ * Decode images from a batch until it is exhausted or stopped.
+ *
+ * @param batch
+ * Work shared with other threads.
+ * @param count
+ * Number of images in the batch.
+ * @param window
+ * Most images that may be decoded but not yet delivered.
+ * @param open
+ * Function to open each image.
+ * @param keys
+ * Key of each image, or empty.
+ * @param format
+ * Format of decoded pixels.
+ */
+static void
+decodeImages(
+    Batch &batch,
+    uint64_t count,
+    uint64_t window,
+    const std::function<std::shared_ptr<BE::Image::Image>(uint64_t)> &open,
+    const std::vector<std::string> &keys,
+    BE::Image::PixelFormat format);
+
+BiometricEvaluation::Image::BatchDecoder::BatchDecoder(
+    uint32_t threadCount,
+    PixelFormat format) :
+    _threadCount(threadCount == 0 ?
+    std::max(1U, std::thread::hardware_concurrency()) : threadCount),
+    _format(format)
+{
+	if ((format != PixelFormat::Gray8) && (format != PixelFormat::RGB24))
+		throw Error::ParameterError("Decoding to " +
+		    Framework::Enumeration::to_string(format));
+}
+
+void
+BiometricEvaluation::Image::BatchDecoder::decode(
+    const std::vector<Memory::uint8Array> &images,
+    const Callback &callback)
+    const
+{
+	/*
+	 * Copy each buffer on the worker that decodes it, so delivered
+	 * images do not refer to the caller's buffers.
+	 */
+	this->decodeBatch(images.size(), [&](uint64_t index) {
+		return (Image::openImage(images[index]));
+	    }, {}, callback);
+}
+
+void
+BiometricEvaluation::Image::BatchDecoder::decode(
+    const std::shared_ptr<IO::RecordStore> &recordStore,
+    const std::vector<std::string> &keys,
+    const Callback &callback)
+    const
+{
+	std::mutex readMutex;
+	this->decodeBatch(keys.size(), [&](uint64_t index) {
+		Memory::uint8Array data;
+		{
+			std::lock_guard<std::mutex> lock(readMutex);
+			data = recordStore->read(keys[index]);
+		}
+		return (Image::openImage(std::move(data)));
+	    }, keys, callback);
+}
+
+uint32_t
+BiometricEvaluation::Image::BatchDecoder::getThreadCount()
+    const
+{
+	return (this->_threadCount);
+}
+
+BiometricEvaluation::Image::PixelFormat
+BiometricEvaluation::Image::BatchDecoder::getPixelFormat()
+    const
+{
+	return (this->_format);
+}
+
+void
+BiometricEvaluation::Image::BatchDecoder::decodeBatch(
+    uint64_t count,
+    const Opener &open,
+    const std::vector<std::string> &keys,
+    const Callback &callback)
+    const
+{
+	if (count == 0)
+		return;
+
+	Batch batch;
+	const uint64_t threadCount = std::min<uint64_t>(count,
+	    this->_threadCount);
+	const uint64_t window = threadCount * IMAGES_AHEAD_PER_THREAD;
+
+	std::vector<std::thread> workers;
+	const auto stop = [&]() {
+		{
+			std::lock_guard<std::mutex> lock(batch.mutex);
+			batch.stopped = true;
+		}
+		batch.delivered.notify_all();
+		for (auto &worker : workers)
+			worker.join();
+	};
+
+	try {
+		for (uint64_t i = 0; i < threadCount; ++i)
+			workers.emplace_back(decodeImages, std::ref(batch),
+			    count, window, std::cref(open), std::cref(keys),
+			    this->_format);
+	} catch (std::system_error &e) {
+		stop();
+		throw Error::StrategyError("Could not start decoding "
+		    "threads: " + std::string(e.what()));
+	}
+
+	/* Deliver images in order, as they become available */
+	for (uint64_t index = 0; index < count; ++index) {
+		DecodedImage result;
+		{
+			std::unique_lock<std::mutex> lock(batch.mutex);
+			batch.decoded.wait(lock, [&]() {
+				return (batch.results.count(index) != 0);
+			});
+			auto it = batch.results.find(index);
+			result = std::move(it->second);
+			batch.results.erase(it);
+		}
+
+		try {
+			callback(result);
+		} catch (...) {
+			stop();
+			throw;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(batch.mutex);
+			batch.delivering = index + 1;
+			if (result.pixels.size() != 0)
+				batch.buffers.push_back(
+				    std::move(result.pixels));
+		}
+		batch.delivered.notify_all();
+	}
+
+	for (auto &worker : workers)
+		worker.join();
+}
+
+static void
+decodeImages(
+    Batch &batch,
+    uint64_t count,
+    uint64_t window,
+    const std::function<std::shared_ptr<BE::Image::Image>(uint64_t)> &open,
+    const std::vector<std::string> &keys,
+    BE::Image::PixelFormat format)
+{
+	for (;;) {
+		BE::Image::DecodedImage result;
+		{
+			std::unique_lock<std::mutex> lock(batch.mutex);
+			batch.delivered.wait(lock, [&]() {
+				return (batch.stopped ||
+				    (batch.next >= count) ||
+				    (batch.next < (batch.delivering +
+				    window)));
+			});
+			if (batch.stopped || (batch.next >= count))
+				return;
+
+			result.index = batch.next++;
+			if (!batch.buffers.empty()) {
+				result.pixels = std::move(batch.buffers.back());
+				batch.buffers.pop_back();
+			}
+		}
+
+		if (!keys.empty())
+			result.key = keys[result.index];
+		bool success = false;
+		try {
+			result.image = open(result.index);
+			/* Images are already decoded in parallel */
+			result.image->setDecodeThreadCount(1);
+
+			const uint64_t stride =
+			    result.image->getDecodedRowSize(format);
+			result.pixels.resize(stride *
+			    result.image->getDimensions().ySize);
+			result.image->decodeInto(result.pixels, stride, format);
+			success = true;
+		} catch (BE::Error::Exception &e) {
+			result.error = e.whatString();
+		} catch (std::exception &e) {
+			result.error = e.what();
+		}
+		if (!success) {
+			result.image.reset();
+			result.pixels.resize(0);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(batch.mutex);
+			batch.results.emplace(result.index, std::move(result));
+		}
+		batch.decoded.notify_one();
+	}
+}
@@ -19,11 +19,21 @@ static const int DIBHDRSZ = 40;
 BiometricEvaluation::Image::BMP::BMP(
     const uint8_t *data,
     const uint64_t size) :
+    BiometricEvaluation::Image::BMP::BMP(
+    copyData(data, size),
+    size)
+{
+
+}
+
+BiometricEvaluation::Image::BMP::BMP(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size) :
     Image::Image(data,
     size,
     CompressionAlgorithm::BMP)
 {
-	if (BMP::isBMP(data, size) == false)
+	if (BMP::isBMP(data.get(), size) == false)
 		throw Error::StrategyError("Not a BMP");
 
 	BITMAPINFOHEADER dibHeader;
@@ -33,7 +43,7 @@ BiometricEvaluation::Image::BMP::BMP(
 		 * if this type of BMP is supported.
 		 */
 		BMPHeader bmpHeader;
-		BMP::getBMPHeader(data, size, &bmpHeader);
+		BMP::getBMPHeader(data.get(), size, &bmpHeader);
 
 		/* 
 		 * The types of BMP supported in this class do not support
@@ -41,7 +51,7 @@ BiometricEvaluation::Image::BMP::BMP(
 		 */
 		this->setHasAlphaChannel(false);
 
-		BMP::getDIBHeader(data, size, &dibHeader);
+		BMP::getDIBHeader(data.get(), size, &dibHeader);
 	} catch (Error::NotImplemented &e) {
 		throw Error::StrategyError(e.what());
 	}
@@ -67,7 +77,7 @@ BiometricEvaluation::Image::BMP::BMP(
 		} else {
 			numColors = dibHeader.numberOfColors;
 		}
-		BMP::getColorTable(data, size, numColors, this->_colorTable);
+		BMP::getColorTable(data.get(), size, numColors, this->_colorTable);
 		for (auto cte : this->_colorTable) {
 			if ((cte.red == cte.green) && (cte.green == cte.blue)) {
 				continue;
@@ -253,6 +263,86 @@ BiometricEvaluation::Image::BMP::getRawGrayscaleData(
 	return (Image::getRawGrayscaleData(depth));
 }
 
+void
+BiometricEvaluation::Image::BMP::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->checkDecodeArguments(buffer, stride, format);
+
+	const uint8_t *bmpData = this->getDataPointer();
+	uint64_t bmpDataSize = this->getDataSize();
+
+	BMPHeader bmpHeader;
+	BITMAPINFOHEADER dibHeader;
+	try {
+		BMP::getBMPHeader(bmpData, bmpDataSize, &bmpHeader);
+		BMP::getDIBHeader(bmpData, bmpDataSize, &dibHeader);
+	} catch (Error::NotImplemented &e) {
+		throw Error::DataError(e.what());
+	}
+
+	/* Run-length encoded rows are decoded with getRawData() */
+	const uint16_t bitsPerPixel = dibHeader.bitsPerPixel;
+	if ((dibHeader.compressionMethod != BI_RGB) ||
+	    ((bitsPerPixel != 8) && (bitsPerPixel != 24) &&
+	    (bitsPerPixel != 32))) {
+		Image::decodeInto(buffer, stride, format);
+		return;
+	}
+
+	/* See getRawData() for the layout of BMP rows */
+	const uint32_t width = dibHeader.width;
+	const int32_t absHeight = abs(dibHeader.height);
+	const uint64_t bmpStride = ((bitsPerPixel * width) + 7) / 8;
+	const uint64_t bmpRowSz = (((bitsPerPixel * width) + 31) / 32) * 4;
+	if ((absHeight > 0) && ((bmpHeader.startingAddress +
+	    ((absHeight - 1) * bmpRowSz) + bmpStride) > bmpDataSize))
+		throw Error::DataError("Buffer length too small");
+
+	/* Indexed gray images use only the red component of the table */
+	const bool grayTable = (this->getColorDepth() == 8);
+	const uint8_t pixelSz = bitsPerPixel / 8;
+	uint8_t r, g, b;
+	for (int32_t row = 0; row < absHeight; row++) {
+		/* Pixels are stored top to bottom if height is < 0 */
+		const uint8_t *bmpRow = bmpData + bmpHeader.startingAddress +
+		    ((dibHeader.height < 0 ? row : (absHeight - row - 1)) *
+		    bmpRowSz);
+		uint8_t *out = buffer + (row * stride);
+
+		for (uint32_t col = 0; col < width; col++) {
+			if (bitsPerPixel == 8) {
+				if (bmpRow[col] >= this->_colorTable.size())
+					throw Error::DataError("Color table "
+					    "index out of range");
+				const ColorTableEntry &entry =
+				    this->_colorTable[bmpRow[col]];
+				r = entry.red;
+				g = (grayTable ? r : entry.green);
+				b = (grayTable ? r : entry.blue);
+			} else {
+				/* BGR(A) -> RGB */
+				r = bmpRow[(col * pixelSz) + 2];
+				g = bmpRow[(col * pixelSz) + 1];
+				b = bmpRow[col * pixelSz];
+			}
+
+			if (format == PixelFormat::RGB24) {
+				*out++ = r;
+				*out++ = g;
+				*out++ = b;
+			} else if (grayTable) {
+				*out++ = r;
+			} else {
+				*out++ = grayValue(r, g, b);
+			}
+		}
+	}
+}
+
 bool
 BiometricEvaluation::Image::BMP::isBMP(
     const uint8_t *data,
@@ -360,7 +450,12 @@ BiometricEvaluation::Image::BMP::getColorTable(
     int count,
     BE::Image::BMP::ColorTable &colorTable)
 {
-	//XXX check bufsz against header sizes + color table size
+	/* Buffer may be a prefix of the image, as when probing */
+	if ((count < 0) || (bufsz < (BMPHDRSZ + DIBHDRSZ +
+	    (static_cast<uint64_t>(count) * 4))))
+		throw Error::StrategyError("Invalid buffer size for BMP "
+		    "color table");
+
 	/*
 	 * Skip over the headers.
 	 * Color table follows the DIB header.
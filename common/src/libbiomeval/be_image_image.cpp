@@ -8,10 +8,22 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
 #include <cmath>
+#include <cstring>
+#include <functional>
 #include <stdexcept>
 #include <memory>
+#include <thread>
+#include <vector>
 
+#include <be_error.h>
 #include <be_image_image.h>
 #include <be_image_bmp.h>
 #include <be_image_jpeg.h>
@@ -22,12 +34,175 @@
 #include <be_image_png.h>
 #include <be_image_tiff.h>
 #include <be_image_wsq.h>
+#include <be_io_recordstore.h>
 #include <be_io_utility.h>
 #include <be_memory_autoarrayiterator.h>
 #include <be_memory_mutableindexedbuffer.h>
 
 namespace BE = BiometricEvaluation;
 
+namespace
+{
+	/**
+	 * @brief
+	 * Leading bytes that identify an image format.
+	 */
+	struct Signature
+	{
+		/** Format identified by the signature */
+		BE::Image::CompressionAlgorithm compression;
+		/** Number of bytes in magic */
+		uint8_t length;
+		/** Bytes that begin data in this format */
+		uint8_t magic[12];
+		/** Size data must exceed to be recognized */
+		uint8_t minimumSize;
+		/**
+		 * Optional check of data beginning with magic, returning
+		 * the format of data or CompressionAlgorithm::None.
+		 */
+		BE::Image::CompressionAlgorithm (*classify)(
+		    const uint8_t *data, uint64_t size);
+	};
+
+	/** @return NetPBM if data is NetPBM, None otherwise */
+	BE::Image::CompressionAlgorithm
+	classifyNetPBM(
+	    const uint8_t *data,
+	    uint64_t size)
+	{
+		return (BE::Image::NetPBM::isNetPBM(data, size) ?
+		    BE::Image::CompressionAlgorithm::NetPBM :
+		    BE::Image::CompressionAlgorithm::None);
+	}
+
+	/*
+	 * Signatures of every format openImage() supports. Where
+	 * signatures overlap, the first match wins, in the order formats
+	 * were historically probed.
+	 */
+	using CA = BE::Image::CompressionAlgorithm;
+	const Signature SIGNATURES[] = {
+	    /* NetPBM may be preceded by comments */
+	    {CA::NetPBM, 1, {'#'}, 1, classifyNetPBM},
+	    {CA::NetPBM, 2, {'P', '1'}, 1, nullptr},
+	    {CA::NetPBM, 2, {'P', '2'}, 1, nullptr},
+	    {CA::NetPBM, 2, {'P', '3'}, 1, nullptr},
+	    {CA::NetPBM, 2, {'P', '4'}, 1, nullptr},
+	    {CA::NetPBM, 2, {'P', '5'}, 1, nullptr},
+	    {CA::NetPBM, 2, {'P', '6'}, 1, nullptr},
+	    {CA::JP2, 12, {0x00, 0x00, 0x00, 0x0C, 0x6A, 0x50, 0x20, 0x20,
+	        0x0D, 0x0A, 0x87, 0x0A}, 11, nullptr},
+	    /* Lossy and lossless JPEG share a start of image marker */
+	    {CA::JPEGB, 2, {0xFF, 0xD8}, 1,
+	        BE::Image::JPEG::getJPEGCompressionAlgorithm},
+	    {CA::PNG, 8, {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A}, 8,
+	        nullptr},
+	    {CA::BMP, 2, {'B', 'M'}, 1, nullptr},
+	    {CA::BMP, 2, {'B', 'A'}, 1, nullptr},
+	    {CA::BMP, 2, {'C', 'I'}, 1, nullptr},
+	    {CA::BMP, 2, {'C', 'P'}, 1, nullptr},
+	    {CA::BMP, 2, {'I', 'C'}, 1, nullptr},
+	    {CA::BMP, 2, {'P', 'T'}, 1, nullptr},
+	    {CA::WSQ20, 2, {0xFF, 0xA0}, 1, nullptr},
+	    /* Byte order marks, followed by a 16-bit version */
+	    {CA::TIFF, 2, {'I', 'I'}, 3, nullptr},
+	    {CA::TIFF, 2, {'M', 'M'}, 3, nullptr}
+	};
+
+	/**
+	 * @brief
+	 * Index SIGNATURES by their first byte.
+	 *
+	 * @return
+	 *	For each possible first byte, the signatures beginning with
+	 *	that byte, in precedence order.
+	 */
+	std::vector<std::vector<const Signature*>>
+	indexSignatures()
+	{
+		std::vector<std::vector<const Signature*>> index(UINT8_MAX + 1);
+		for (const auto &signature : SIGNATURES)
+			index[signature.magic[0]].push_back(&signature);
+		return (index);
+	}
+
+	/**
+	 * @brief
+	 * Read the properties of an image from the start of its data.
+	 *
+	 * @param data
+	 *	Start of the image data.
+	 * @param available
+	 *	Number of bytes of data available.
+	 * @param compression
+	 *	Compression algorithm of data.
+	 * @param size
+	 *	Size of the complete image data, in bytes.
+	 *
+	 * @return
+	 *	Properties of the image.
+	 */
+	BE::Image::Metadata
+	probeHeader(
+	    const uint8_t *data,
+	    uint64_t available,
+	    BE::Image::CompressionAlgorithm compression,
+	    uint64_t size)
+	{
+		/* Images only parse headers when constructed; lend data */
+		const auto image = BE::Image::Image::openImage(
+		    std::shared_ptr<const uint8_t>(data, [](const uint8_t*) {}),
+		    available, compression);
+		return (BE::Image::Metadata{compression, size,
+		    image->getDimensions(), image->getResolution(),
+		    image->getColorDepth(), image->getBitDepth(),
+		    image->hasAlphaChannel()});
+	}
+
+	/**
+	 * @brief
+	 * Read the properties of an image from a prefix of its data,
+	 * reading the complete data only if the prefix is not enough.
+	 *
+	 * @param read
+	 *	Function returning at most the requested number of bytes
+	 *	from the start of the image data.
+	 * @param size
+	 *	Size of the complete image data, in bytes.
+	 * @param prefixSize
+	 *	Number of bytes to read first.
+	 *
+	 * @return
+	 *	Properties of the image.
+	 */
+	BE::Image::Metadata
+	probePrefix(
+	    const std::function<BE::Memory::uint8Array(uint64_t)> &read,
+	    uint64_t size,
+	    uint64_t prefixSize)
+	{
+		BE::Memory::uint8Array data = read(std::min(prefixSize, size));
+		if (data.size() < size) {
+			/* TIFF directories may be anywhere in the file */
+			const BE::Image::CompressionAlgorithm compression =
+			    BE::Image::Image::getCompressionAlgorithm(data);
+			if ((compression != CA::None) &&
+			    (compression != CA::TIFF)) {
+				try {
+					return (probeHeader(data, data.size(),
+					    compression, size));
+				} catch (BE::Error::Exception &e) {
+					/* Header may extend past the prefix */
+				}
+			}
+			data = read(size);
+		}
+
+		return (BE::Image::Image::probe(data));
+	}
+}
+
 BiometricEvaluation::Image::Image::Image(
     const uint8_t *data,
     const uint64_t size,
@@ -37,15 +212,40 @@ BiometricEvaluation::Image::Image::Image(
     const Resolution resolution,
     const CompressionAlgorithm compressionAlgorithm,
     const bool hasAlphaChannel) :
+    BiometricEvaluation::Image::Image::Image(
+    copyData(data, size),
+    size,
+    dimensions,
+    colorDepth,
+    bitDepth,
+    resolution,
+    compressionAlgorithm,
+    hasAlphaChannel)
+{
+
+}
+
+BiometricEvaluation::Image::Image::Image(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size,
+    const Size dimensions,
+    const uint32_t colorDepth,
+    const uint16_t bitDepth,
+    const Resolution resolution,
+    const CompressionAlgorithm compressionAlgorithm,
+    const bool hasAlphaChannel) :
     _dimensions(dimensions),
     _colorDepth(colorDepth),
     _hasAlphaChannel(hasAlphaChannel),
     _bitDepth(bitDepth),
     _resolution(resolution),
-    _data(size),
-    _compressionAlgorithm(compressionAlgorithm)
+    _data(data),
+    _dataSize(size),
+    _compressionAlgorithm(compressionAlgorithm),
+    _decodeThreadCount(0)
 {
-	std::memcpy(_data, data, size);
+	if ((this->_data == nullptr) && (size != 0))
+		throw Error::StrategyError("No image data");
 }
 
 BiometricEvaluation::Image::Image::Image(
@@ -65,6 +265,23 @@ BiometricEvaluation::Image::Image::Image(
 
 }
 
+BiometricEvaluation::Image::Image::Image(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size,
+    const CompressionAlgorithm compressionAlgorithm) :
+    BiometricEvaluation::Image::Image::Image(
+    data,
+    size,
+    Size(),
+    0,
+    0,
+    Resolution(),
+    compressionAlgorithm,
+    false)
+{
+
+}
+
 BiometricEvaluation::Image::CompressionAlgorithm
 BiometricEvaluation::Image::Image::getCompressionAlgorithm()
     const
@@ -100,6 +317,22 @@ BiometricEvaluation::Image::Image::getBitDepth()
 	return (this->_bitDepth);
 }
 
+void
+BiometricEvaluation::Image::Image::setDecodeThreadCount(
+    uint32_t count)
+{
+	this->_decodeThreadCount = count;
+}
+
+uint32_t
+BiometricEvaluation::Image::Image::getDecodeThreadCount()
+    const
+{
+	if (this->_decodeThreadCount != 0)
+		return (this->_decodeThreadCount);
+	return (std::max(1U, std::thread::hardware_concurrency()));
+}
+
 BiometricEvaluation::Memory::uint8Array
 BiometricEvaluation::Image::Image::getRawData(
     const bool removeAlphaChannelIfPresent)
@@ -253,11 +486,289 @@ BiometricEvaluation::Image::Image::getRawGrayscaleData(
 	return (rawGray);
 }
 
+void
+BiometricEvaluation::Image::Image::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->checkDecodeArguments(buffer, stride, format);
+
+	const Memory::uint8Array rawData{this->getRawData()};
+	this->convertRawData(rawData, rawData.size(), buffer, stride, format);
+}
+
+void
+BiometricEvaluation::Image::Image::decodeRegionInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format,
+    const DecodeRequest &request)
+    const
+{
+	uint32_t horzOffset, vertOffset;
+	Size dimensions;
+	this->checkDecodeArguments(buffer, stride, format, request,
+	    horzOffset, vertOffset, dimensions);
+
+	if ((request.scaleDenominator == 1) &&
+	    (dimensions == this->getDimensions())) {
+		this->decodeInto(buffer, stride, format);
+		return;
+	}
+
+	/* Codec cannot decode partial images; decode all and reduce */
+	const uint64_t imageStride = this->getDecodedRowSize(format);
+	Memory::uint8Array image(imageStride * this->getDimensions().ySize);
+	this->decodeInto(image, imageStride, format);
+	reduceRegion(image, imageStride, this->getDimensions(), format,
+	    request.scaleDenominator, horzOffset, vertOffset, dimensions,
+	    buffer, stride);
+}
+
+BiometricEvaluation::Image::Size
+BiometricEvaluation::Image::Image::getDecodedDimensions(
+    const DecodeRequest &request)
+    const
+{
+	const uint8_t scale = request.scaleDenominator;
+	if ((scale != 1) && (scale != 2) && (scale != 4) && (scale != 8))
+		throw Error::ParameterError("Invalid scale denominator: " +
+		    std::to_string(scale));
+
+	const Size imageDimensions = this->getDimensions();
+	const ROI &roi = request.roi;
+	if ((roi.size.xSize == 0) && (roi.size.ySize == 0))
+		return (Size((imageDimensions.xSize + scale - 1) / scale,
+		    (imageDimensions.ySize + scale - 1) / scale));
+
+	if ((roi.size.xSize == 0) || (roi.size.ySize == 0))
+		throw Error::ParameterError("ROI is empty in one dimension");
+	if ((static_cast<uint64_t>(roi.horzOffset) + roi.size.xSize >
+	    imageDimensions.xSize) ||
+	    (static_cast<uint64_t>(roi.vertOffset) + roi.size.ySize >
+	    imageDimensions.ySize))
+		throw Error::ParameterError("ROI extends beyond image");
+
+	const uint64_t x1 = (static_cast<uint64_t>(roi.horzOffset) +
+	    roi.size.xSize + scale - 1) / scale;
+	const uint64_t y1 = (static_cast<uint64_t>(roi.vertOffset) +
+	    roi.size.ySize + scale - 1) / scale;
+	return (Size(static_cast<uint32_t>(x1 - (roi.horzOffset / scale)),
+	    static_cast<uint32_t>(y1 - (roi.vertOffset / scale))));
+}
+
+uint64_t
+BiometricEvaluation::Image::Image::getDecodedRowSize(
+    PixelFormat format)
+    const
+{
+	return (static_cast<uint64_t>(this->getDimensions().xSize) *
+	    getDecodedPixelSize(format));
+}
+
+uint8_t
+BiometricEvaluation::Image::Image::getDecodedPixelSize(
+    PixelFormat format)
+{
+	switch (format) {
+	case PixelFormat::Gray8:
+		return (1);
+	case PixelFormat::RGB24:
+		return (3);
+	default:
+		throw Error::NotImplemented("Decoding to " +
+		    BE::Framework::Enumeration::to_string(format));
+	}
+}
+
+void
+BiometricEvaluation::Image::Image::checkDecodeArguments(
+    const uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	if (stride < this->getDecodedRowSize(format))
+		throw Error::ParameterError("Stride is smaller than a row");
+	if (buffer == nullptr)
+		throw Error::ParameterError("Buffer is nullptr");
+}
+
+void
+BiometricEvaluation::Image::Image::checkDecodeArguments(
+    const uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format,
+    const DecodeRequest &request,
+    uint32_t &horzOffset,
+    uint32_t &vertOffset,
+    Size &dimensions)
+    const
+{
+	dimensions = this->getDecodedDimensions(request);
+	if (stride < (static_cast<uint64_t>(dimensions.xSize) *
+	    getDecodedPixelSize(format)))
+		throw Error::ParameterError("Stride is smaller than a row");
+	if (buffer == nullptr)
+		throw Error::ParameterError("Buffer is nullptr");
+
+	if ((request.roi.size.xSize == 0) && (request.roi.size.ySize == 0)) {
+		horzOffset = vertOffset = 0;
+	} else {
+		horzOffset = request.roi.horzOffset / request.scaleDenominator;
+		vertOffset = request.roi.vertOffset / request.scaleDenominator;
+	}
+}
+
+void
+BiometricEvaluation::Image::Image::reduceBand(
+    const uint8_t *band,
+    uint64_t bandStride,
+    uint32_t bandRows,
+    uint32_t bandWidth,
+    uint8_t scaleDenominator,
+    PixelFormat format,
+    uint8_t *out,
+    uint32_t outWidth)
+{
+	const uint8_t pixelSize = getDecodedPixelSize(format);
+	if (scaleDenominator == 1) {
+		std::memcpy(out, band, static_cast<uint64_t>(outWidth) *
+		    pixelSize);
+		return;
+	}
+
+	for (uint32_t col = 0; col < outWidth; col++) {
+		/* Partial blocks at the right and bottom edges */
+		const uint64_t x0 = static_cast<uint64_t>(col) *
+		    scaleDenominator;
+		const uint32_t blockWidth = static_cast<uint32_t>(std::min<
+		    uint64_t>(scaleDenominator, bandWidth - x0));
+		const uint32_t count = blockWidth * bandRows;
+
+		for (uint8_t c = 0; c < pixelSize; c++) {
+			uint32_t sum = 0;
+			for (uint32_t row = 0; row < bandRows; row++) {
+				const uint8_t *in = band + (row * bandStride) +
+				    (x0 * pixelSize) + c;
+				for (uint32_t i = 0; i < blockWidth; i++)
+					sum += in[i * pixelSize];
+			}
+			*out++ = static_cast<uint8_t>((sum + (count / 2)) /
+			    count);
+		}
+	}
+}
+
+void
+BiometricEvaluation::Image::Image::reduceRegion(
+    const uint8_t *image,
+    uint64_t imageStride,
+    const Size &imageDimensions,
+    PixelFormat format,
+    uint8_t scaleDenominator,
+    uint32_t horzOffset,
+    uint32_t vertOffset,
+    const Size &dimensions,
+    uint8_t *buffer,
+    uint64_t stride)
+{
+	const uint8_t pixelSize = getDecodedPixelSize(format);
+	const uint64_t x0 = static_cast<uint64_t>(horzOffset) *
+	    scaleDenominator;
+	const uint32_t bandWidth = static_cast<uint32_t>(
+	    imageDimensions.xSize - x0);
+
+	for (uint32_t row = 0; row < dimensions.ySize; row++) {
+		const uint64_t y0 = static_cast<uint64_t>(vertOffset + row) *
+		    scaleDenominator;
+		const uint32_t bandRows = static_cast<uint32_t>(std::min<
+		    uint64_t>(scaleDenominator, imageDimensions.ySize - y0));
+		reduceBand(image + (y0 * imageStride) + (x0 * pixelSize),
+		    imageStride, bandRows, bandWidth, scaleDenominator, format,
+		    buffer + (row * stride), dimensions.xSize);
+	}
+}
+
+void
+BiometricEvaluation::Image::Image::convertRawData(
+    const uint8_t *rawData,
+    uint64_t rawDataSize,
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	/* Bitmap images are upped to 8-bit in getRawData() */
+	const uint8_t bytesPerComponent = (this->getBitDepth() > 8 ? 2 : 1);
+	const uint8_t components = std::max(1u,
+	    this->getColorDepth() / (bytesPerComponent * 8));
+	const uint32_t width = this->getDimensions().xSize;
+	const uint64_t rawRowSize = static_cast<uint64_t>(width) *
+	    components * bytesPerComponent;
+
+	if (rawDataSize < (rawRowSize * this->getDimensions().ySize))
+		throw Error::DataError("Decompressed image is truncated");
+	for (uint32_t row = 0; row < this->getDimensions().ySize; row++)
+		convertRow(rawData + (row * rawRowSize), width, components,
+		    bytesPerComponent, buffer + (row * stride), format);
+}
+
+void
+BiometricEvaluation::Image::Image::convertRow(
+    const uint8_t *in,
+    uint32_t width,
+    uint8_t components,
+    uint8_t bytesPerComponent,
+    uint8_t *out,
+    PixelFormat format)
+{
+	/* Already in the requested layout */
+	if ((bytesPerComponent == 1) &&
+	    (((components == 1) && (format == PixelFormat::Gray8)) ||
+	    ((components == 3) && (format == PixelFormat::RGB24)))) {
+		std::memcpy(out, in, static_cast<uint64_t>(width) * components);
+		return;
+	}
+
+	const bool color = (components >= 3);
+	const uint64_t pixelSize = components * bytesPerComponent;
+	uint8_t r, g, b;
+	for (uint32_t i = 0; i < width; i++, in += pixelSize) {
+		if (bytesPerComponent == 1) {
+			r = in[0];
+			g = (color ? in[1] : r);
+			b = (color ? in[2] : r);
+		} else {
+			/* Interpolate 16-bit values in 8-bit colorspace */
+			uint16_t value[3];
+			std::memcpy(value, in, (color ? 3 : 1) * 2);
+			r = (value[0] * UINT8_MAX) / UINT16_MAX;
+			g = (color ? (value[1] * UINT8_MAX) / UINT16_MAX : r);
+			b = (color ? (value[2] * UINT8_MAX) / UINT16_MAX : r);
+		}
+
+		if (format == PixelFormat::RGB24) {
+			*out++ = r;
+			*out++ = g;
+			*out++ = b;
+		} else if (color) {
+			*out++ = grayValue(r, g, b);
+		} else {
+			*out++ = r;
+		}
+	}
+}
+
 BiometricEvaluation::Memory::uint8Array
 BiometricEvaluation::Image::Image::getData()
     const
 {
-	return (Memory::uint8Array(_data));
+	Memory::uint8Array data;
+	data.copy(this->_data.get(), this->_dataSize);
+	return (data);
 }
 
 void
@@ -292,14 +803,35 @@ const uint8_t *
 BiometricEvaluation::Image::Image::getDataPointer()
     const
 {
-	return (&(*(this->_data)));
+	return (this->_data.get());
 }
 
 uint64_t
 BiometricEvaluation::Image::Image::getDataSize()
     const
 {
-	return (this->_data.size());
+	return (this->_dataSize);
+}
+
+std::shared_ptr<const uint8_t>
+BiometricEvaluation::Image::Image::copyData(
+    const uint8_t *data,
+    const uint64_t size)
+{
+	Memory::uint8Array copy;
+	copy.copy(data, size);
+	return (Image::shareData(std::move(copy)));
+}
+
+std::shared_ptr<const uint8_t>
+BiometricEvaluation::Image::Image::shareData(
+    Memory::uint8Array &&data)
+{
+	/* Alias the first element, keeping the whole AutoArray alive */
+	const auto owner = std::make_shared<const Memory::uint8Array>(
+	    std::move(data));
+	return (std::shared_ptr<const uint8_t>(owner,
+	    static_cast<const uint8_t *>(*owner)));
 }
 
 BiometricEvaluation::Image::Image::~Image()
@@ -329,7 +861,64 @@ BiometricEvaluation::Image::Image::openImage(
     const uint8_t *data,
     const uint64_t size)
 {
-	switch (Image::getCompressionAlgorithm(data, size)) {
+	return (Image::openImage(copyData(data, size), size));
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Image>
+BiometricEvaluation::Image::Image::openImage(
+    const Memory::uint8Array &data)
+{
+	return (Image::openImage(data, data.size()));
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Image>
+BiometricEvaluation::Image::Image::openImage(
+    Memory::uint8Array &&data)
+{
+	const uint64_t size = data.size();
+	return (Image::openImage(shareData(std::move(data)), size));
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Image>
+BiometricEvaluation::Image::Image::openImage(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size)
+{
+	const CompressionAlgorithm compression =
+	    Image::getCompressionAlgorithm(data.get(), size);
+	if (compression == CompressionAlgorithm::None)
+		throw Error::StrategyError("Could not determine compression "
+		    "algorithm");
+
+	return (Image::openImage(data, size, compression));
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Image>
+BiometricEvaluation::Image::Image::openImage(
+    const Memory::uint8Array &data,
+    const CompressionAlgorithm compression)
+{
+	return (Image::openImage(copyData(data, data.size()), data.size(),
+	    compression));
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Image>
+BiometricEvaluation::Image::Image::openImage(
+    Memory::uint8Array &&data,
+    const CompressionAlgorithm compression)
+{
+	const uint64_t size = data.size();
+	return (Image::openImage(shareData(std::move(data)), size,
+	    compression));
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Image>
+BiometricEvaluation::Image::Image::openImage(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size,
+    const CompressionAlgorithm compression)
+{
+	switch (compression) {
 	case CompressionAlgorithm::JPEGB:
 		return (std::shared_ptr<Image>(new JPEG(data, size)));
 	case CompressionAlgorithm::JPEGL:
@@ -349,24 +938,16 @@ BiometricEvaluation::Image::Image::openImage(
 	case CompressionAlgorithm::TIFF:
 		return (std::shared_ptr<Image>(new TIFF(data, size)));
 	default:
-		throw Error::StrategyError("Could not determine compression "
-		    "algorithm");
+		throw Error::ParameterError("Cannot open images compressed "
+		    "with " + Framework::Enumeration::to_string(compression));
 	}
 }
 
-std::shared_ptr<BiometricEvaluation::Image::Image>
-BiometricEvaluation::Image::Image::openImage(
-    const Memory::uint8Array &data)
-{
-	return (Image::openImage(data, data.size()));
-}
-
 std::shared_ptr<BiometricEvaluation::Image::Image>
 BiometricEvaluation::Image::Image::openImage(
     const std::string &path)
 {
-	Memory::uint8Array data = IO::Utility::readFile(path);
-	return (Image::openImage(data));
+	return (Image::openImage(IO::Utility::readFile(path)));
 }
 
 BiometricEvaluation::Image::CompressionAlgorithm
@@ -374,22 +955,29 @@ BiometricEvaluation::Image::Image::getCompressionAlgorithm(
     const uint8_t *data,
     const uint64_t size)
 {
-	if (NetPBM::isNetPBM(data, size))
-		return (CompressionAlgorithm::NetPBM);
-	else if (JPEG2000::isJPEG2000(data, size))
-		return (CompressionAlgorithm::JP2);
-	else if (JPEG::isJPEG(data, size))
-		return (CompressionAlgorithm::JPEGB);
-	else if (JPEGL::isJPEGL(data, size))
-		return (CompressionAlgorithm::JPEGL);
-	else if (PNG::isPNG(data, size))
-		return (CompressionAlgorithm::PNG);
-	else if (BMP::isBMP(data, size))
-		return (CompressionAlgorithm::BMP);
-	else if (WSQ::isWSQ(data, size))
-		return (CompressionAlgorithm::WSQ20);
-	else if (TIFF::isTIFF(data, size))
-		return (CompressionAlgorithm::TIFF);
+	if ((data == nullptr) || (size == 0))
+		return (CompressionAlgorithm::None);
+
+	/* Only signatures sharing the first byte need to be compared */
+	static const std::vector<std::vector<const Signature*>> index =
+	    indexSignatures();
+	for (const auto signature : index[data[0]]) {
+		if (size <= signature->minimumSize)
+			continue;
+		uint8_t i = 1;
+		while ((i < signature->length) &&
+		    (data[i] == signature->magic[i]))
+			i++;
+		if (i != signature->length)
+			continue;
+		if (signature->classify == nullptr)
+			return (signature->compression);
+
+		const CompressionAlgorithm compression = signature->classify(
+		    data, size);
+		if (compression != CompressionAlgorithm::None)
+			return (compression);
+	}
 		
 	return (CompressionAlgorithm::None);
 }
@@ -409,6 +997,96 @@ BiometricEvaluation::Image::Image::getCompressionAlgorithm(
 	return (Image::getCompressionAlgorithm(data));
 }
 
+BiometricEvaluation::Image::Metadata
+BiometricEvaluation::Image::Image::probe(
+    const uint8_t *data,
+    const uint64_t size)
+{
+	const CompressionAlgorithm compression =
+	    Image::getCompressionAlgorithm(data, size);
+	if (compression == CompressionAlgorithm::None)
+		throw Error::StrategyError("Could not determine compression "
+		    "algorithm");
+
+	return (probeHeader(data, size, compression, size));
+}
+
+BiometricEvaluation::Image::Metadata
+BiometricEvaluation::Image::Image::probe(
+    const Memory::uint8Array &data)
+{
+	return (Image::probe(data, data.size()));
+}
+
+BiometricEvaluation::Image::Metadata
+BiometricEvaluation::Image::Image::probe(
+    int fd,
+    uint64_t prefixSize)
+{
+	struct stat sb;
+	if (fstat(fd, &sb) != 0)
+		throw Error::StrategyError("Could not stat file descriptor (" +
+		    Error::errorStr() + ")");
+	if (!S_ISREG(sb.st_mode))
+		throw Error::StrategyError("File descriptor is not a regular "
+		    "file");
+
+	/* pread() leaves the file offset alone */
+	return (probePrefix([&](uint64_t length) {
+		Memory::uint8Array data(length);
+		uint64_t total = 0;
+		while (total < length) {
+			const ssize_t rv = pread(fd, data + total,
+			    length - total, total);
+			if (rv == -1) {
+				if (errno == EINTR)
+					continue;
+				throw Error::StrategyError("Could not read "
+				    "file descriptor (" + Error::errorStr() +
+				    ")");
+			}
+			if (rv == 0)
+				break;
+			total += rv;
+		}
+		data.resize(total);
+		return (data);
+	    }, sb.st_size, prefixSize));
+}
+
+BiometricEvaluation::Image::Metadata
+BiometricEvaluation::Image::Image::probe(
+    const std::string &path,
+    uint64_t prefixSize)
+{
+	if (!IO::Utility::fileExists(path))
+		throw Error::ObjectDoesNotExist(path);
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		throw Error::StrategyError("Could not open " + path + " (" +
+		    Error::errorStr() + ")");
+
+	try {
+		const Metadata metadata = Image::probe(fd, prefixSize);
+		close(fd);
+		return (metadata);
+	} catch (...) {
+		close(fd);
+		throw;
+	}
+}
+
+BiometricEvaluation::Image::Metadata
+BiometricEvaluation::Image::Image::probe(
+    const IO::RecordStore &recordStore,
+    const std::string &key,
+    uint64_t prefixSize)
+{
+	return (probePrefix([&](uint64_t length) {
+		return (recordStore.readPrefix(key, length));
+	    }, recordStore.length(key), prefixSize));
+}
+
 BiometricEvaluation::Image::Raw
 BiometricEvaluation::Image::Image::getRawImage(
     const std::shared_ptr<BiometricEvaluation::Image::Image> &image)
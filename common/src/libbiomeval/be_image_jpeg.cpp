@@ -8,13 +8,16 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <algorithm>
 #include <cstdio>		/* Needed for NBIS headers */
+#include <cstring>
 #include <sstream>
 
 extern "C" {
 	#include <computil.h>
 	#include <dataio.h>
 	#include <jpeglib.h>
+	#include <jerror.h>
 }
 
 #include <be_image_jpeg.h>
@@ -22,6 +25,16 @@ extern "C" {
 BiometricEvaluation::Image::JPEG::JPEG(
     const uint8_t *data,
     const uint64_t size) :
+    BiometricEvaluation::Image::JPEG::JPEG(
+    copyData(data, size),
+    size)
+{
+
+}
+
+BiometricEvaluation::Image::JPEG::JPEG(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size) :
     Image::Image(
     data,
     size,
@@ -44,8 +57,13 @@ BiometricEvaluation::Image::JPEG::JPEG(
 	    this->getDataSize());
 #endif
 
-	if (jpeg_read_header(&dinfo, TRUE) != JPEG_HEADER_OK)
-		throw Error::DataError("jpeg_read_header()");
+	try {
+		if (jpeg_read_header(&dinfo, TRUE) != JPEG_HEADER_OK)
+			throw Error::DataError("jpeg_read_header()");
+	} catch (Error::Exception &e) {
+		jpeg_destroy_decompress(&dinfo);
+		throw;
+	}
 
 	this->setHasAlphaChannel(false);
 	setDimensions(Size(dinfo.image_width, dinfo.image_height));
@@ -185,10 +203,151 @@ BiometricEvaluation::Image::JPEG::getRawGrayscaleData(
 	return (rawGray);
 }
 
+void
+BiometricEvaluation::Image::JPEG::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->decodeRegionInto(buffer, stride, format, DecodeRequest());
+}
+
+void
+BiometricEvaluation::Image::JPEG::decodeRegionInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format,
+    const DecodeRequest &request)
+    const
+{
+	uint32_t horzOffset, vertOffset;
+	Size dimensions;
+	this->checkDecodeArguments(buffer, stride, format, request,
+	    horzOffset, vertOffset, dimensions);
+
+	/* Initialize custom JPEG error manager to throw exceptions */
+	struct jpeg_error_mgr jpeg_error_mgr;
+	jpeg_std_error(&jpeg_error_mgr);
+	jpeg_error_mgr.error_exit = JPEG::error_exit;
+
+	struct jpeg_decompress_struct dinfo;
+	dinfo.err = &jpeg_error_mgr;
+	jpeg_create_decompress(&dinfo);
+
+	try {
+#if JPEG_LIB_VERSION >= 80
+		::jpeg_mem_src(&dinfo, (unsigned char *)this->getDataPointer(),
+		    this->getDataSize());
+#else
+		JPEG::jpeg_mem_src(&dinfo,
+		    (unsigned char *)this->getDataPointer(),
+		    this->getDataSize());
+#endif
+
+		if (jpeg_read_header(&dinfo, TRUE) != JPEG_HEADER_OK)
+			throw Error::StrategyError("jpeg_read_header()");
+
+		/* libjpeg cannot convert CMYK to gray or RGB */
+		if ((dinfo.jpeg_color_space == JCS_CMYK) ||
+		    (dinfo.jpeg_color_space == JCS_YCCK)) {
+			jpeg_destroy_decompress(&dinfo);
+			if ((request.scaleDenominator == 1) &&
+			    (dimensions == this->getDimensions()))
+				Image::decodeInto(buffer, stride, format);
+			else
+				Image::decodeRegionInto(buffer, stride, format,
+				    request);
+			return;
+		}
+
+		/*
+		 * Have libjpeg convert colorspace as rows are decoded, and
+		 * scale in the DCT domain so that full-resolution blocks
+		 * are never reconstructed.
+		 */
+		if (format == PixelFormat::Gray8)
+			dinfo.out_color_space = JCS_GRAYSCALE;
+		else
+			dinfo.out_color_space = JCS_RGB;
+		dinfo.scale_num = 1;
+		dinfo.scale_denom = request.scaleDenominator;
+		if (jpeg_start_decompress(&dinfo) != TRUE)
+			throw Error::StrategyError("jpeg_start_decompress()");
+		if (((horzOffset + dimensions.xSize) > dinfo.output_width) ||
+		    ((vertOffset + dimensions.ySize) > dinfo.output_height))
+			throw Error::DataError("Scaled image is smaller than "
+			    "header dimensions");
+
+		/*
+		 * libjpeg-turbo can skip the entropy-coded data outside
+		 * of the region.  Crops are widened to iMCU boundaries,
+		 * and by a pixel on each side so that chroma upsampling
+		 * at the edges of the region sees its neighbors.
+		 */
+		JDIMENSION cropOffset = 0;
+		JDIMENSION cropWidth = dinfo.output_width;
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER) && \
+    (LIBJPEG_TURBO_VERSION_NUMBER >= 1005000)
+		if (dimensions.xSize != dinfo.output_width) {
+			cropOffset = (horzOffset > 0 ? horzOffset - 1 : 0);
+			cropWidth = std::min<JDIMENSION>(dinfo.output_width -
+			    cropOffset, (horzOffset - cropOffset) +
+			    dimensions.xSize + 1);
+			jpeg_crop_scanline(&dinfo, &cropOffset, &cropWidth);
+		}
+		if (vertOffset > 0)
+			jpeg_skip_scanlines(&dinfo, vertOffset);
+#endif
+
+		/* Decode into a scratch row when not cropped exactly */
+		const uint8_t pixelSize = getDecodedPixelSize(format);
+		JSAMPARRAY scratch = nullptr;
+		if ((cropOffset != horzOffset) ||
+		    (cropWidth != dimensions.xSize) ||
+		    (dinfo.output_scanline < vertOffset))
+			scratch = (*dinfo.mem->alloc_sarray)(
+			    (j_common_ptr)&dinfo, JPOOL_IMAGE,
+			    cropWidth * pixelSize, 1);
+		while (dinfo.output_scanline < vertOffset)
+			jpeg_read_scanlines(&dinfo, scratch, 1);
+
+		const uint64_t scratchOffset = static_cast<uint64_t>(
+		    horzOffset - cropOffset) * pixelSize;
+		JSAMPROW row;
+		for (uint32_t i = 0; i < dimensions.ySize; i++) {
+			row = buffer + (i * stride);
+			if (scratch == nullptr) {
+				jpeg_read_scanlines(&dinfo, &row, 1);
+			} else {
+				jpeg_read_scanlines(&dinfo, scratch, 1);
+				std::memcpy(row, scratch[0] + scratchOffset,
+				    static_cast<uint64_t>(dimensions.xSize) *
+				    pixelSize);
+			}
+		}
+
+		/* Rows below the region are abandoned, not decoded */
+	} catch (Error::Exception &e) {
+		jpeg_destroy_decompress(&dinfo);
+		throw;
+	}
+	jpeg_destroy_decompress(&dinfo);
+}
+
 bool
 BiometricEvaluation::Image::JPEG::isJPEG(
     const uint8_t *data,
     uint64_t size)
+{
+	return (getJPEGCompressionAlgorithm(data, size) ==
+	    CompressionAlgorithm::JPEGB);
+}
+
+BiometricEvaluation::Image::CompressionAlgorithm
+BiometricEvaluation::Image::JPEG::getJPEGCompressionAlgorithm(
+    const uint8_t *data,
+    uint64_t size)
 {
 	uint8_t *markerBuf = (uint8_t *)data;
 	uint8_t *endPtr = (uint8_t *)data + size;
@@ -220,21 +379,21 @@ BiometricEvaluation::Image::JPEG::isJPEG(
 	/* First marker should be start of image */
 	uint16_t marker;
 	if (getc_ushort(&marker, &markerBuf, endPtr) != 0)
-		return (false);
+		return (CompressionAlgorithm::None);
 	if (marker != startOfImage)
-		return (false);
+		return (CompressionAlgorithm::None);
 	
 	/* Read markers until end of buffer or an identifying marker is found */
 	for (;;) {
 		/* Get next 16 bits */
 		if (getc_ushort(&marker, &markerBuf, endPtr) != 0)
-			return (false);
+			return (CompressionAlgorithm::None);
 			
 		/* 16-bit markers start with 0xFF but aren't 0xFF00 or 0xFFFF */ 
 		while (((marker >> 8) != 0xFF) &&
 		    ((marker == 0xFF00) || (marker == 0xFFFF)))
 			if (getc_ushort(&marker, &markerBuf, endPtr) != 0)
-				return (false);
+				return (CompressionAlgorithm::None);
 		
 		switch (marker) {
 		/* Lossy start of frame markers */
@@ -255,7 +414,7 @@ BiometricEvaluation::Image::JPEG::isJPEG(
 		case SOFDifferentialSequentialDCTArith:
 			/* FALLTHROUGH */
 		case SOFDifferentialProgressiveDCTArith:
-			return (true);
+			return (CompressionAlgorithm::JPEGB);
 
 		/* Lossless start of frame markers */
 		case SOFLosslessSequential:
@@ -265,19 +424,19 @@ BiometricEvaluation::Image::JPEG::isJPEG(
 		case SOFLosslessArith:
 			/* FALLTHROUGH */
 		case SOFDifferentialLosslessArith:
-			/* FALLTHROUGH */
-					
+			return (CompressionAlgorithm::JPEGL);
+
 		/* Start of scan found before a start of frame */
 		case startOfScan:
-			return (false);
+			return (CompressionAlgorithm::None);
 		}
 		
 		/* Reposition marker pointer after current marker segment */
 		if (JPEG::getc_skip_marker_segment(marker, &markerBuf, endPtr))
-			return (false);
+			return (CompressionAlgorithm::None);
 	}
 	
-	return (false);
+	return (CompressionAlgorithm::None);
 }
 
 void
@@ -353,11 +512,18 @@ boolean
 BiometricEvaluation::Image::JPEG::fill_input_buffer_mem(
     j_decompress_ptr cinfo)
 {
-	/* 
+	/*
 	 * The entire buffer should be loaded already, so getting here
-	 * really is an error.
+	 * means the data was truncated.  As libjpeg does, warn and insert
+	 * an EOI marker so that decoding stops instead of reading past
+	 * the end of the buffer.
 	 */
-	
+	static const JOCTET EOIBuffer[] = {0xFF, JPEG_EOI};
+
+	WARNMS(cinfo, JWRN_JPEG_EOF);
+	cinfo->src->next_input_byte = EOIBuffer;
+	cinfo->src->bytes_in_buffer = sizeof(EOIBuffer);
+
 	return (TRUE);
 }
 
@@ -369,6 +535,10 @@ BiometricEvaluation::Image::JPEG::skip_input_data_mem(
 	struct jpeg_source_mgr * src = cinfo->src;
 
 	if (num_bytes > 0) {
+		while (num_bytes > (long)src->bytes_in_buffer) {
+			num_bytes -= (long)src->bytes_in_buffer;
+			(void)src->fill_input_buffer(cinfo);
+		}
 		src->next_input_byte += (size_t) num_bytes;
 		src->bytes_in_buffer -= (size_t) num_bytes;
 	}
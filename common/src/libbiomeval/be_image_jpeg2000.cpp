@@ -10,16 +10,174 @@
 
 #include <openjpeg.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <be_image_jpeg2000.h>
 #include <be_memory_mutableindexedbuffer.h>
 
 namespace BE = BiometricEvaluation;
 
+/** Growable, seekable buffer for writing JP2 data with libopenjp2. */
+struct opj_output_buffer
+{
+	/** JP2-encoded buffer, whose size is its capacity */
+	BE::Memory::uint8Array data;
+	/** Number of bytes written by libopenjp2 */
+	uint64_t length;
+	/** Current write position */
+	uint64_t offset;
+};
+using opj_output_buffer = struct opj_output_buffer;
+
+/**
+ * @brief
+ * libopenjp2 callback to write to an opj_output_buffer.
+ *
+ * @param p_buffer
+ * Encoded data to write at the current position.
+ * @param p_nb_bytes
+ * Number of bytes in p_buffer.
+ * @param p_user_data
+ * Pointer to an opj_output_buffer.
+ *
+ * @return
+ * Number of bytes written.
+ */
+static OPJ_SIZE_T
+opj_write_mem_dest(
+    void *p_buffer,
+    OPJ_SIZE_T p_nb_bytes,
+    void *p_user_data);
+
+/**
+ * @brief
+ * libopenjp2 callback to skip forward in an opj_output_buffer.
+ *
+ * @param p_nb_bytes
+ * Number of bytes to skip.
+ * @param p_user_data
+ * Pointer to an opj_output_buffer.
+ *
+ * @return
+ * Number of bytes skipped.
+ */
+static OPJ_OFF_T
+opj_skip_mem_dest(
+    OPJ_OFF_T p_nb_bytes,
+    void *p_user_data);
+
+/**
+ * @brief
+ * libopenjp2 callback to seek within an opj_output_buffer.
+ *
+ * @param p_nb_bytes
+ * Offset from the start of the buffer.
+ * @param p_user_data
+ * Pointer to an opj_output_buffer.
+ *
+ * @return
+ * OPJ_TRUE.
+ */
+static OPJ_BOOL
+opj_seek_mem_dest(
+    OPJ_OFF_T p_nb_bytes,
+    void *p_user_data);
+
+/**
+ * @brief
+ * Add a capture resolution box to the JP2 header box.
+ *
+ * @param jp2
+ * JP2-encoded data, as written by libopenjp2.
+ * @param resolution
+ * Resolution to record.
+ *
+ * @return
+ * jp2 with a resolution superbox appended to the JP2 header box.
+ *
+ * @throw Error::StrategyError
+ * jp2 has no JP2 header box.
+ */
+static BE::Memory::uint8Array
+addCaptureResolutionBox(
+    const BE::Memory::uint8Array &jp2,
+    const BE::Image::Resolution &resolution);
+
+/**
+ * @brief
+ * Interleave decoded component planes into packed samples.
+ * @details
+ * Samples of 8 bits or fewer are written as uint8_t, and samples of
+ * 9 to 16 bits as native-endian uint16_t.
+ *
+ * @param planes
+ * First sample of each component plane.
+ * @param components
+ * Number of component planes.
+ * @param precision
+ * Bits per sample, at most 16.
+ * @param count
+ * Number of samples to pack from each plane.
+ * @param output
+ * Where count * components samples are written.
+ */
+static void
+packComponents(
+    const OPJ_INT32 * const *planes,
+    uint32_t components,
+    uint8_t precision,
+    uint64_t count,
+    uint8_t *output);
+
+/**
+ * @brief
+ * packComponents() for 8-bit samples from N component planes.
+ */
+template<uint32_t N>
+static void
+packComponents8(
+    const OPJ_INT32 * const *planes,
+    OPJ_INT32 mask,
+    uint64_t count,
+    uint8_t *output);
+
+/**
+ * @brief
+ * packComponents() for 16-bit samples from N component planes.
+ */
+template<uint32_t N>
+static void
+packComponents16(
+    const OPJ_INT32 * const *planes,
+    OPJ_INT32 mask,
+    uint64_t count,
+    uint8_t *output);
+
 BiometricEvaluation::Image::JPEG2000::JPEG2000(
     const uint8_t *data,
     const uint64_t size,
     const int8_t codecFormat) :
+    BiometricEvaluation::Image::JPEG2000::JPEG2000(
+    copyData(data, size),
+    size,
+    codecFormat)
+{
+
+}
+
+BiometricEvaluation::Image::JPEG2000::JPEG2000(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size,
+    const int8_t codecFormat) :
     Image::Image(
     data,
     size,
@@ -135,39 +293,23 @@ BiometricEvaluation::Image::JPEG2000::getRawData()
 	const uint32_t h = this->getDimensions().ySize;
 	const uint8_t bpc = image->comps[0].prec;
 
-	std::vector<int32_t*> ptr;
+	if (bpc > 16)
+		throw Error::NotImplemented("libopenjp2: " +
+		    std::to_string(bpc) + "-bit-per-component images");
+
+	std::vector<const OPJ_INT32*> planes;
 	for (uint32_t i = 0; i < image->numcomps; ++i) {
-		ptr.push_back(image->comps[i].data);
+		planes.push_back(image->comps[i].data);
 		if ((image->comps[i].w != w) || (image->comps[i].h != h) ||
 		    (image->comps[i].prec != bpc))
 			throw Error::NotImplemented("libopenjp2: Non-equal "
 			    "components");
 	}
 
-	Memory::uint8Array rawData(image->numcomps * (bpc / 8) * image->x1 *
-	    image->y1);
-	Memory::MutableIndexedBuffer buffer(rawData);
-
-	const int32_t mask = (1 << image->comps[0].prec) - 1;
-	for (uint32_t row = 0; row < h; ++row) {
-		for (uint32_t col = 0; col < w; ++col) {
-			if (bpc <= 8) {
-				for (uint32_t i = 0; i < image->numcomps; ++i) {
-					buffer.pushU8Val(*ptr[i] & mask);
-					ptr[i]++;
-				}
-			} else if (bpc <= 16) {
-				for (uint32_t i = 0; i < image->numcomps; ++i) {
-					buffer.pushU16Val(*ptr[i] & mask);
-					ptr[i]++;
-				}
-			} else {
-				throw Error::NotImplemented(
-				    "libopenjp2: " + std::to_string(bpc) +
-				    "-bit-per-component images");
-			}
-		}
-	}
+	Memory::uint8Array rawData(image->numcomps * ((bpc + 7) / 8) *
+	    image->x1 * image->y1);
+	packComponents(planes.data(), image->numcomps, bpc,
+	    static_cast<uint64_t>(w) * h, rawData);
 
 	return (rawData);
 }
@@ -180,6 +322,154 @@ BiometricEvaluation::Image::JPEG2000::getRawGrayscaleData(
 	return (Image::getRawGrayscaleData(depth));
 }
 
+void
+BiometricEvaluation::Image::JPEG2000::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->decodeRegionInto(buffer, stride, format, DecodeRequest());
+}
+
+void
+BiometricEvaluation::Image::JPEG2000::decodeRegionInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format,
+    const DecodeRequest &request)
+    const
+{
+	uint32_t horzOffset, vertOffset;
+	Size dimensions;
+	this->checkDecodeArguments(buffer, stride, format, request,
+	    horzOffset, vertOffset, dimensions);
+	const uint8_t scale = request.scaleDenominator;
+	const Size scaledDimensions = this->getDecodedDimensions(
+	    DecodeRequest(ROI(), scale));
+
+	std::unique_ptr<opj_codec_t, void(*)(opj_codec_t*)> codec(
+	    static_cast<opj_codec_t*>(this->getDecompressionCodec()),
+	    opj_destroy_codec);
+	std::unique_ptr<opj_stream_t, void(*)(opj_stream_t*)> stream(
+	    static_cast<opj_stream_t*>(this->getDecompressionStream()),
+	    opj_stream_destroy);
+
+	opj_image_t *imagePtr = nullptr;
+	if (opj_read_header(stream.get(), codec.get(), &imagePtr) == OPJ_FALSE)
+		throw Error::Exception("libopenjp2: opj_read_header");
+	if (imagePtr == nullptr)
+		throw Error::Exception("libopenjp2: image is nullptr");
+	std::unique_ptr<opj_image_t, void(*)(opj_image_t*)> image(
+	    imagePtr, opj_image_destroy);
+
+	if (image->numcomps <= 0)
+		throw Error::NotImplemented("libopenjp2: No components");
+	if (image->comps[0].sgnd == 1)
+		throw Error::NotImplemented("libopenjp2: Signed buffers");
+
+	/*
+	 * Discard resolution levels instead of decoding and reducing
+	 * them, and only decode the code-blocks covering the region.
+	 */
+	uint32_t reduce = 0;
+	while ((1u << reduce) < scale)
+		reduce++;
+	if (reduce > 0) {
+		opj_codestream_info_v2_t *info = opj_get_cstr_info(
+		    codec.get());
+		const uint32_t resolutions = info->m_default_tile_info.
+		    tccp_info[0].numresolutions;
+		opj_destroy_cstr_info(&info);
+
+		if ((reduce >= resolutions) || (image->x0 != 0) ||
+		    (image->y0 != 0)) {
+			Image::decodeRegionInto(buffer, stride, format,
+			    request);
+			return;
+		}
+		if (opj_set_decoded_resolution_factor(codec.get(), reduce) ==
+		    OPJ_FALSE)
+			throw Error::StrategyError("libopenjp2: "
+			    "opj_set_decoded_resolution_factor");
+	}
+	if (dimensions != scaledDimensions) {
+		const uint32_t width = this->getDimensions().xSize;
+		const uint32_t height = this->getDimensions().ySize;
+		if (opj_set_decode_area(codec.get(), image.get(),
+		    image->x0 + (horzOffset * scale),
+		    image->y0 + (vertOffset * scale),
+		    image->x0 + std::min<uint64_t>(width,
+		    static_cast<uint64_t>(horzOffset + dimensions.xSize) *
+		    scale),
+		    image->y0 + std::min<uint64_t>(height,
+		    static_cast<uint64_t>(vertOffset + dimensions.ySize) *
+		    scale)) == OPJ_FALSE)
+			throw Error::StrategyError("libopenjp2: "
+			    "opj_set_decode_area");
+	}
+
+	if (opj_decode(codec.get(), stream.get(), image.get()) == OPJ_FALSE)
+		throw Error::StrategyError("libopenjp2: opj_decode");
+
+	const uint32_t w = dimensions.xSize;
+	const uint32_t h = dimensions.ySize;
+	const uint8_t bpc = image->comps[0].prec;
+	if ((bpc == 0) || (bpc > 16))
+		throw Error::NotImplemented("libopenjp2: " +
+		    std::to_string(bpc) + "-bit-per-component images");
+
+	/* Alpha, if present, follows the gray or RGB components */
+	const uint32_t colorComps = (image->numcomps >= 3 ? 3 : 1);
+	const int32_t *planes[3];
+	for (uint32_t i = 0; i < colorComps; ++i) {
+		planes[i] = image->comps[i].data;
+		if ((image->comps[i].w != w) || (image->comps[i].h != h) ||
+		    (image->comps[i].prec != bpc))
+			throw Error::NotImplemented("libopenjp2: Non-equal "
+			    "components");
+	}
+
+	/* 8-bit samples in the requested layout need no conversion */
+	if ((bpc == 8) && (colorComps == (format == PixelFormat::Gray8 ?
+	    1 : 3))) {
+		for (uint32_t row = 0; row < h; ++row) {
+			packComponents(planes, colorComps, bpc, w,
+			    buffer + (row * stride));
+			for (uint32_t i = 0; i < colorComps; ++i)
+				planes[i] += w;
+		}
+		return;
+	}
+
+	/*
+	 * Pack samples straight from the component planes, scaling
+	 * from the component precision to 8 bits.
+	 */
+	const int32_t mask = (1 << bpc) - 1;
+	uint8_t value[3];
+	for (uint32_t row = 0; row < h; ++row) {
+		uint8_t *out = buffer + (row * stride);
+		for (uint32_t col = 0; col < w; ++col) {
+			for (uint32_t i = 0; i < colorComps; ++i) {
+				value[i] = ((*planes[i] & mask) * UINT8_MAX) /
+				    mask;
+				planes[i]++;
+			}
+			if (format == PixelFormat::Gray8) {
+				if (colorComps == 3)
+					*out++ = grayValue(value[0], value[1],
+					    value[2]);
+				else
+					*out++ = value[0];
+			} else {
+				for (uint32_t i = 0; i < 3; ++i)
+					*out++ = value[colorComps == 3 ? i : 0];
+			}
+		}
+	}
+}
+
 bool
 BiometricEvaluation::Image::JPEG2000::isJPEG2000(
     const uint8_t *data,
@@ -196,6 +486,121 @@ BiometricEvaluation::Image::JPEG2000::isJPEG2000(
 	return (memcmp(data, SOC, SOC_size) == 0);
 }
 
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::Image::JPEG2000::encode(
+    const uint8_t *rawData,
+    const Size &dimensions,
+    uint32_t colorDepth,
+    uint16_t bitDepth,
+    const Resolution &resolution,
+    float compressionRatio)
+{
+	if (rawData == nullptr)
+		throw Error::ParameterError("Raw data is nullptr");
+	if ((bitDepth != 8) && (bitDepth != 16))
+		throw Error::ParameterError("Unsupported bit depth: " +
+		    std::to_string(bitDepth));
+	const uint32_t numcomps = colorDepth / bitDepth;
+	if ((numcomps < 1) || (numcomps > 4) || ((colorDepth % bitDepth) != 0))
+		throw Error::ParameterError("Unsupported color depth: " +
+		    std::to_string(colorDepth));
+	if ((compressionRatio != 0) && (compressionRatio < 1))
+		throw Error::ParameterError("Invalid compression ratio: " +
+		    std::to_string(compressionRatio));
+
+	opj_cparameters_t parameters;
+	opj_set_default_encoder_parameters(&parameters);
+	parameters.tcp_numlayers = 1;
+	parameters.cp_disto_alloc = 1;
+	if (compressionRatio == 0) {
+		parameters.irreversible = 0;
+		parameters.tcp_rates[0] = 0;
+	} else {
+		parameters.irreversible = 1;
+		parameters.tcp_rates[0] = compressionRatio;
+	}
+	parameters.tcp_mct = (numcomps >= 3 ? 1 : 0);
+	/* Each resolution level halves the smallest dimension */
+	while ((parameters.numresolution > 1) && ((1u <<
+	    (parameters.numresolution - 1)) > std::min(dimensions.xSize,
+	    dimensions.ySize)))
+		parameters.numresolution--;
+
+	std::vector<opj_image_cmptparm_t> cmptparm(numcomps);
+	for (auto &c : cmptparm) {
+		std::memset(&c, 0, sizeof(c));
+		c.dx = c.dy = 1;
+		c.w = dimensions.xSize;
+		c.h = dimensions.ySize;
+		c.prec = c.bpp = bitDepth;
+		c.sgnd = 0;
+	}
+	std::unique_ptr<opj_image_t, void(*)(opj_image_t*)> image(
+	    opj_image_create(numcomps, cmptparm.data(), (numcomps >= 3 ?
+	    OPJ_CLRSPC_SRGB : OPJ_CLRSPC_GRAY)), opj_image_destroy);
+	if (image.get() == nullptr)
+		throw Error::StrategyError("libopenjp2: opj_image_create");
+	image->x0 = image->y0 = 0;
+	image->x1 = dimensions.xSize;
+	image->y1 = dimensions.ySize;
+	if ((numcomps == 2) || (numcomps == 4))
+		image->comps[numcomps - 1].alpha = 1;
+
+	/* Split interleaved components into planes */
+	const uint64_t numPixels = static_cast<uint64_t>(dimensions.xSize) *
+	    dimensions.ySize;
+	for (uint32_t c = 0; c < numcomps; c++) {
+		int32_t *plane = image->comps[c].data;
+		if (bitDepth == 8) {
+			const uint8_t *in = rawData + c;
+			for (uint64_t i = 0; i < numPixels; i++, in += numcomps)
+				plane[i] = *in;
+		} else {
+			const uint8_t *in = rawData + (c * 2);
+			uint16_t value;
+			for (uint64_t i = 0; i < numPixels;
+			    i++, in += (numcomps * 2)) {
+				std::memcpy(&value, in, 2);
+				plane[i] = value;
+			}
+		}
+	}
+
+	std::unique_ptr<opj_codec_t, void(*)(opj_codec_t*)> codec(
+	    opj_create_compress(OPJ_CODEC_JP2), opj_destroy_codec);
+	opj_set_error_handler(codec.get(), openjpeg_message, nullptr);
+	opj_set_warning_handler(codec.get(), openjpeg_message, nullptr);
+	opj_set_info_handler(codec.get(), nullptr, nullptr);
+	if (opj_setup_encoder(codec.get(), &parameters, image.get()) ==
+	    OPJ_FALSE)
+		throw Error::StrategyError("libopenjp2: opj_setup_encoder");
+
+	/* Write encoded JP2 data to a buffer using our extension */
+	opj_output_buffer output{Memory::uint8Array(
+	    (numPixels * numcomps * (bitDepth / 8) / 2) + 1024), 0, 0};
+	std::unique_ptr<opj_stream_t, void(*)(opj_stream_t*)> stream(
+	    opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, OPJ_FALSE),
+	    opj_stream_destroy);
+	opj_stream_set_user_data(stream.get(), &output, nullptr);
+	opj_stream_set_write_function(stream.get(), opj_write_mem_dest);
+	opj_stream_set_skip_function(stream.get(), opj_skip_mem_dest);
+	opj_stream_set_seek_function(stream.get(), opj_seek_mem_dest);
+
+	if (opj_start_compress(codec.get(), image.get(), stream.get()) ==
+	    OPJ_FALSE)
+		throw Error::StrategyError("libopenjp2: opj_start_compress");
+	if (opj_encode(codec.get(), stream.get()) == OPJ_FALSE)
+		throw Error::StrategyError("libopenjp2: opj_encode");
+	if (opj_end_compress(codec.get(), stream.get()) == OPJ_FALSE)
+		throw Error::StrategyError("libopenjp2: opj_end_compress");
+	stream.reset();
+
+	output.data.resize(output.length);
+	if (resolution.units == Resolution::Units::NA)
+		return (std::move(output.data));
+	return (addCaptureResolutionBox(output.data, resolution));
+}
+
 void
 BiometricEvaluation::Image::JPEG2000::openjpeg_message(
     const char *msg,
@@ -332,6 +737,15 @@ BiometricEvaluation::Image::JPEG2000::getDecompressionCodec()
 		throw Error::StrategyError("libopenjp2: opj_setup_decoder");
 	}
 
+#if (OPJ_VERSION_MAJOR > 2) || \
+    ((OPJ_VERSION_MAJOR == 2) && (OPJ_VERSION_MINOR >= 2))
+	/* Decode tiles and code-blocks in parallel (libopenjp2 >= 2.2) */
+	if (opj_has_thread_support() == OPJ_TRUE)
+		opj_codec_set_threads(codec, static_cast<int>(
+		    std::min<uint32_t>(this->getDecodeThreadCount(),
+		    INT32_MAX)));
+#endif
+
 	return (codec);
 }
 
@@ -415,3 +829,410 @@ BiometricEvaluation::Image::JPEG2000::libopenjp2Seek(
 		return (OPJ_FALSE);
 	}
 }
+
+/*
+ * libopenjp2 output stream callbacks.
+ */
+
+static void
+opj_reserve_mem_dest(
+    opj_output_buffer *output,
+    uint64_t size)
+{
+	if (size > output->data.size())
+		output->data.resize(std::max<uint64_t>(output->data.size() * 2,
+		    size));
+}
+
+OPJ_SIZE_T
+opj_write_mem_dest(
+    void *p_buffer,
+    OPJ_SIZE_T p_nb_bytes,
+    void *p_user_data)
+{
+	opj_output_buffer *output = static_cast<opj_output_buffer *>(
+	    p_user_data);
+
+	try {
+		opj_reserve_mem_dest(output, output->offset + p_nb_bytes);
+	} catch (BE::Error::Exception &e) {
+		return (static_cast<OPJ_SIZE_T>(-1));
+	}
+	std::memcpy(output->data + output->offset, p_buffer, p_nb_bytes);
+	output->offset += p_nb_bytes;
+	output->length = std::max(output->length, output->offset);
+
+	return (p_nb_bytes);
+}
+
+OPJ_OFF_T
+opj_skip_mem_dest(
+    OPJ_OFF_T p_nb_bytes,
+    void *p_user_data)
+{
+	opj_output_buffer *output = static_cast<opj_output_buffer *>(
+	    p_user_data);
+
+	if ((p_nb_bytes < 0) &&
+	    (static_cast<uint64_t>(-p_nb_bytes) > output->offset))
+		return (-1);
+	try {
+		opj_reserve_mem_dest(output, output->offset + p_nb_bytes);
+	} catch (BE::Error::Exception &e) {
+		return (-1);
+	}
+	output->offset += p_nb_bytes;
+	output->length = std::max(output->length, output->offset);
+
+	return (p_nb_bytes);
+}
+
+OPJ_BOOL
+opj_seek_mem_dest(
+    OPJ_OFF_T p_nb_bytes,
+    void *p_user_data)
+{
+	opj_output_buffer *output = static_cast<opj_output_buffer *>(
+	    p_user_data);
+
+	if (p_nb_bytes < 0)
+		return (OPJ_FALSE);
+	try {
+		opj_reserve_mem_dest(output, p_nb_bytes);
+	} catch (BE::Error::Exception &e) {
+		return (OPJ_FALSE);
+	}
+	output->offset = p_nb_bytes;
+
+	return (OPJ_TRUE);
+}
+
+BE::Memory::uint8Array
+addCaptureResolutionBox(
+    const BE::Memory::uint8Array &jp2,
+    const BE::Image::Resolution &resolution)
+{
+	static const uint8_t jp2h[4] = { 0x6A, 0x70, 0x32, 0x68 };
+	static const uint8_t res[4] = { 0x72, 0x65, 0x73, 0x20 };
+	static const uint8_t resc[4] = { 0x72, 0x65, 0x73, 0x63 };
+	/* Superbox containing a 10-byte capture resolution box */
+	static const uint32_t resBoxSize = 8 + 8 + 10;
+
+	/* Find the JP2 header box among the top-level boxes */
+	BE::Memory::IndexedBuffer ib(jp2);
+	uint64_t jp2hOffset = 0, jp2hSize = 0;
+	while ((ib.getSize() - ib.getIndex()) >= 8) {
+		const uint64_t offset = ib.getIndex();
+		const uint32_t size = ib.scanBeU32Val();
+		uint8_t type[4];
+		ib.scan(type, 4);
+		if (std::memcmp(type, jp2h, 4) == 0) {
+			jp2hOffset = offset;
+			jp2hSize = size;
+			break;
+		}
+		/* Header boxes precede the codestream and are never large */
+		if ((size < 8) || (size > (ib.getSize() - offset)))
+			break;
+		ib.setIndex(offset + size);
+	}
+	if (jp2hSize == 0)
+		throw BE::Error::StrategyError("No JP2 header box");
+
+	/*
+	 * I.7.3.6.1: Resolution in pixels per meter, as N / D * 10^E.
+	 * One inch is 127/5000 m, so integral resolutions in pixels per
+	 * inch are exact with D = 127.
+	 */
+	const BE::Image::Resolution ppi = resolution.toUnits(
+	    BE::Image::Resolution::Units::PPI);
+	uint16_t numerator[2];
+	int8_t exponent[2];
+	for (int i = 0; i < 2; i++) {
+		double value = (i == 0 ? ppi.yRes : ppi.xRes) * 5000;
+		exponent[i] = 0;
+		while (value > UINT16_MAX) {
+			value /= 10;
+			exponent[i]++;
+		}
+		numerator[i] = static_cast<uint16_t>(std::round(value));
+	}
+
+	BE::Memory::uint8Array output(jp2.size() + resBoxSize);
+	BE::Memory::MutableIndexedBuffer mib(output);
+	mib.push(jp2, jp2hOffset);
+	mib.pushBeU32Val(jp2hSize + resBoxSize);
+	mib.push(jp2 + jp2hOffset + 4, jp2hSize - 4);
+	mib.pushBeU32Val(resBoxSize);
+	mib.push(res, 4);
+	mib.pushBeU32Val(resBoxSize - 8);
+	mib.push(resc, 4);
+	mib.pushBeU16Val(numerator[0]);
+	mib.pushBeU16Val(127);
+	mib.pushBeU16Val(numerator[1]);
+	mib.pushBeU16Val(127);
+	mib.pushU8Val(static_cast<uint8_t>(exponent[0]));
+	mib.pushU8Val(static_cast<uint8_t>(exponent[1]));
+	mib.push(jp2 + jp2hOffset + jp2hSize,
+	    jp2.size() - (jp2hOffset + jp2hSize));
+
+	return (output);
+}
+
+static void
+packComponents(
+    const OPJ_INT32 * const *planes,
+    uint32_t components,
+    uint8_t precision,
+    uint64_t count,
+    uint8_t *output)
+{
+	const OPJ_INT32 mask = (1 << precision) - 1;
+	if (precision <= 8) {
+		switch (components) {
+		case 1:
+			packComponents8<1>(planes, mask, count, output);
+			return;
+		case 2:
+			packComponents8<2>(planes, mask, count, output);
+			return;
+		case 3:
+			packComponents8<3>(planes, mask, count, output);
+			return;
+		case 4:
+			packComponents8<4>(planes, mask, count, output);
+			return;
+		}
+	} else {
+		switch (components) {
+		case 1:
+			packComponents16<1>(planes, mask, count, output);
+			return;
+		case 2:
+			packComponents16<2>(planes, mask, count, output);
+			return;
+		case 3:
+			packComponents16<3>(planes, mask, count, output);
+			return;
+		case 4:
+			packComponents16<4>(planes, mask, count, output);
+			return;
+		}
+	}
+
+	/* Uncommon numbers of components */
+	const uint8_t sampleSize = (precision <= 8 ? 1 : 2);
+	for (uint64_t i = 0; i < count; ++i) {
+		for (uint32_t c = 0; c < components; ++c) {
+			const uint16_t value = planes[c][i] & mask;
+			if (sampleSize == 1)
+				*output = static_cast<uint8_t>(value);
+			else
+				std::memcpy(output, &value, sampleSize);
+			output += sampleSize;
+		}
+	}
+}
+
+template<uint32_t N>
+static void
+packComponents8(
+    const OPJ_INT32 * const *planes,
+    OPJ_INT32 mask,
+    uint64_t count,
+    uint8_t *output)
+{
+	/* 16 samples from each plane per iteration */
+	uint64_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i m = _mm_set1_epi32(mask);
+	for (; (i + 16) <= count; i += 16) {
+		/* Masked samples fit in 8 bits, so packing can't saturate */
+		__m128i v[N];
+		for (uint32_t c = 0; c < N; ++c) {
+			const __m128i *p = reinterpret_cast<const __m128i*>(
+			    planes[c] + i);
+			v[c] = _mm_packus_epi16(
+			    _mm_packs_epi32(
+			    _mm_and_si128(_mm_loadu_si128(p), m),
+			    _mm_and_si128(_mm_loadu_si128(p + 1), m)),
+			    _mm_packs_epi32(
+			    _mm_and_si128(_mm_loadu_si128(p + 2), m),
+			    _mm_and_si128(_mm_loadu_si128(p + 3), m)));
+		}
+
+		/* (% N keeps indices valid in branches not taken for N) */
+		__m128i *out = reinterpret_cast<__m128i*>(output + (i * N));
+		if (N == 1) {
+			_mm_storeu_si128(out, v[0]);
+		} else if (N == 2) {
+			_mm_storeu_si128(out,
+			    _mm_unpacklo_epi8(v[0], v[1 % N]));
+			_mm_storeu_si128(out + 1,
+			    _mm_unpackhi_epi8(v[0], v[1 % N]));
+		} else if (N == 4) {
+			const __m128i lo01 = _mm_unpacklo_epi8(v[0], v[1 % N]);
+			const __m128i hi01 = _mm_unpackhi_epi8(v[0], v[1 % N]);
+			const __m128i lo23 = _mm_unpacklo_epi8(v[2 % N],
+			    v[3 % N]);
+			const __m128i hi23 = _mm_unpackhi_epi8(v[2 % N],
+			    v[3 % N]);
+			_mm_storeu_si128(out, _mm_unpacklo_epi16(lo01, lo23));
+			_mm_storeu_si128(out + 1,
+			    _mm_unpackhi_epi16(lo01, lo23));
+			_mm_storeu_si128(out + 2,
+			    _mm_unpacklo_epi16(hi01, hi23));
+			_mm_storeu_si128(out + 3,
+			    _mm_unpackhi_epi16(hi01, hi23));
+		} else {
+			/* No 3-way byte shuffle before SSSE3 */
+			uint8_t narrowed[N][16];
+			for (uint32_t c = 0; c < N; ++c)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(
+				    narrowed[c]), v[c]);
+			uint8_t *o = output + (i * N);
+			for (uint32_t s = 0; s < 16; ++s)
+				for (uint32_t c = 0; c < N; ++c)
+					*o++ = narrowed[c][s];
+		}
+	}
+#elif defined(__ARM_NEON)
+	const uint32x4_t m = vdupq_n_u32(mask);
+	for (; (i + 16) <= count; i += 16) {
+		uint8x16_t v[N];
+		for (uint32_t c = 0; c < N; ++c) {
+			const uint32_t *p = reinterpret_cast<const uint32_t*>(
+			    planes[c] + i);
+			v[c] = vcombine_u8(
+			    vmovn_u16(vcombine_u16(
+			    vmovn_u32(vandq_u32(vld1q_u32(p), m)),
+			    vmovn_u32(vandq_u32(vld1q_u32(p + 4), m)))),
+			    vmovn_u16(vcombine_u16(
+			    vmovn_u32(vandq_u32(vld1q_u32(p + 8), m)),
+			    vmovn_u32(vandq_u32(vld1q_u32(p + 12), m)))));
+		}
+
+		uint8_t *out = output + (i * N);
+		if (N == 1) {
+			vst1q_u8(out, v[0]);
+		} else if (N == 2) {
+			vst2q_u8(out, (uint8x16x2_t){{v[0], v[1 % N]}});
+		} else if (N == 3) {
+			vst3q_u8(out, (uint8x16x3_t){{v[0], v[1 % N],
+			    v[2 % N]}});
+		} else {
+			vst4q_u8(out, (uint8x16x4_t){{v[0], v[1 % N],
+			    v[2 % N], v[3 % N]}});
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+		for (uint32_t c = 0; c < N; ++c)
+			output[(i * N) + c] = planes[c][i] & mask;
+}
+
+template<uint32_t N>
+static void
+packComponents16(
+    const OPJ_INT32 * const *planes,
+    OPJ_INT32 mask,
+    uint64_t count,
+    uint8_t *output)
+{
+	/* 8 samples from each plane per iteration */
+	uint64_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+	/*
+	 * SSE2 only packs with signed saturation, so bias masked samples
+	 * into the signed range and remove the bias after packing.
+	 */
+	const __m128i m = _mm_set1_epi32(mask);
+	const __m128i bias32 = _mm_set1_epi32(0x8000);
+	const __m128i bias16 = _mm_set1_epi16(INT16_MIN);
+	for (; (i + 8) <= count; i += 8) {
+		__m128i v[N];
+		for (uint32_t c = 0; c < N; ++c) {
+			const __m128i *p = reinterpret_cast<const __m128i*>(
+			    planes[c] + i);
+			v[c] = _mm_xor_si128(_mm_packs_epi32(
+			    _mm_sub_epi32(_mm_and_si128(
+			    _mm_loadu_si128(p), m), bias32),
+			    _mm_sub_epi32(_mm_and_si128(
+			    _mm_loadu_si128(p + 1), m), bias32)), bias16);
+		}
+
+		__m128i *out = reinterpret_cast<__m128i*>(output +
+		    (i * N * sizeof(uint16_t)));
+		if (N == 1) {
+			_mm_storeu_si128(out, v[0]);
+		} else if (N == 2) {
+			_mm_storeu_si128(out,
+			    _mm_unpacklo_epi16(v[0], v[1 % N]));
+			_mm_storeu_si128(out + 1,
+			    _mm_unpackhi_epi16(v[0], v[1 % N]));
+		} else if (N == 4) {
+			const __m128i lo01 = _mm_unpacklo_epi16(v[0], v[1 % N]);
+			const __m128i hi01 = _mm_unpackhi_epi16(v[0], v[1 % N]);
+			const __m128i lo23 = _mm_unpacklo_epi16(v[2 % N],
+			    v[3 % N]);
+			const __m128i hi23 = _mm_unpackhi_epi16(v[2 % N],
+			    v[3 % N]);
+			_mm_storeu_si128(out, _mm_unpacklo_epi32(lo01, lo23));
+			_mm_storeu_si128(out + 1,
+			    _mm_unpackhi_epi32(lo01, lo23));
+			_mm_storeu_si128(out + 2,
+			    _mm_unpacklo_epi32(hi01, hi23));
+			_mm_storeu_si128(out + 3,
+			    _mm_unpackhi_epi32(hi01, hi23));
+		} else {
+			uint16_t narrowed[N][8];
+			for (uint32_t c = 0; c < N; ++c)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(
+				    narrowed[c]), v[c]);
+			uint8_t *o = output + (i * N * sizeof(uint16_t));
+			for (uint32_t s = 0; s < 8; ++s) {
+				for (uint32_t c = 0; c < N; ++c) {
+					std::memcpy(o, &narrowed[c][s],
+					    sizeof(uint16_t));
+					o += sizeof(uint16_t);
+				}
+			}
+		}
+	}
+#elif defined(__ARM_NEON)
+	const uint32x4_t m = vdupq_n_u32(mask);
+	for (; (i + 8) <= count; i += 8) {
+		uint16x8_t v[N];
+		for (uint32_t c = 0; c < N; ++c) {
+			const uint32_t *p = reinterpret_cast<const uint32_t*>(
+			    planes[c] + i);
+			v[c] = vcombine_u16(
+			    vmovn_u32(vandq_u32(vld1q_u32(p), m)),
+			    vmovn_u32(vandq_u32(vld1q_u32(p + 4), m)));
+		}
+
+		uint16_t *out = reinterpret_cast<uint16_t*>(output +
+		    (i * N * sizeof(uint16_t)));
+		if (N == 1) {
+			vst1q_u16(out, v[0]);
+		} else if (N == 2) {
+			vst2q_u16(out, (uint16x8x2_t){{v[0], v[1 % N]}});
+		} else if (N == 3) {
+			vst3q_u16(out, (uint16x8x3_t){{v[0], v[1 % N],
+			    v[2 % N]}});
+		} else {
+			vst4q_u16(out, (uint16x8x4_t){{v[0], v[1 % N],
+			    v[2 % N], v[3 % N]}});
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		for (uint32_t c = 0; c < N; ++c) {
+			const uint16_t value = planes[c][i] & mask;
+			std::memcpy(output + (((i * N) + c) * sizeof(uint16_t)),
+			    &value, sizeof(uint16_t));
+		}
+	}
+}
@@ -21,6 +21,16 @@ extern "C" {
 BiometricEvaluation::Image::JPEGL::JPEGL(
     const uint8_t *data,
     const uint64_t size) :
+    BiometricEvaluation::Image::JPEGL::JPEGL(
+    copyData(data, size),
+    size)
+{
+
+}
+
+BiometricEvaluation::Image::JPEGL::JPEGL(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size) :
     Image::Image(
     data,
     size,
@@ -72,6 +82,11 @@ BiometricEvaluation::Image::JPEGL::JPEGL(
 			throw Error::DataError("libjpegl: Could not read size "
 			    " of table");
 		/* Table size includes size of field but not the marker */
+		if ((tableSize < sizeof(tableSize)) || ((tableSize -
+		    sizeof(tableSize)) > static_cast<uint64_t>(endPtr -
+		    markerBuf)))
+			throw Error::DataError("libjpegl: Table extends past "
+			    "end of data");
 		markerBuf += tableSize - sizeof(tableSize);
 	}
 	
@@ -128,98 +143,66 @@ BiometricEvaluation::Image::JPEGL::getRawGrayscaleData(
 	return (Image::getRawGrayscaleData(depth));
 }
 
-bool
-BiometricEvaluation::Image::JPEGL::isJPEGL(
-    const uint8_t *data,
-    uint64_t size)
+void
+BiometricEvaluation::Image::JPEGL::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
 {
-	uint8_t *markerBuf = (uint8_t *)data;
-	uint8_t *endPtr = (uint8_t *)data + size;
-	
+	this->checkDecodeArguments(buffer, stride, format);
+
+	IMG_DAT *imgDat = nullptr;
+	int32_t lossy;
+	if (jpegl_decode_mem(&imgDat, &lossy,
+	    (unsigned char *)this->getDataPointer(), this->getDataSize()))
+		throw Error::DataError("libjpegl: Could not decode Lossless "
+		    "JPEG data");
+	const int32_t components = imgDat->n_cmpnts;
+	const int32_t width = imgDat->max_width;
+	const int32_t height = imgDat->max_height;
+	if ((static_cast<uint32_t>(width) != this->getDimensions().xSize) ||
+	    (static_cast<uint32_t>(height) != this->getDimensions().ySize) ||
+	    ((components != 1) && (components != 3))) {
+		free_IMG_DAT(imgDat, FREE_IMAGE);
+		throw Error::DataError("libjpegl: Unsupported component "
+		    "layout");
+	}
+
 	/*
-	 * JPEG markers (ISO/IEC 10918-1:1993)
+	 * Read straight from the component planes instead of having
+	 * libjpegl concatenate them, replicating subsampled components.
 	 */
-	static const uint16_t startOfScan = 0xFFDA;
-	static const uint16_t startOfImage = 0xFFD8;
-	
-	/* Start of frame, non-differential, Huffman coding */
-	static const uint16_t SOFBaselineDCT = 0xFFC0;
-	static const uint16_t SOFExtendedSequentialDCT = 0xFFC1;
-	static const uint16_t SOFProgressiveDCT = 0xFFC2;
-	static const uint16_t SOFLosslessSequential = 0xFFC3;
-	/* Start of frame, differential, Huffman coding */
-	static const uint16_t SOFDifferentialSequentialDCT = 0xFFC5;
-	static const uint16_t SOFDifferentialProgressiveDCT = 0xFFC6;
-	static const uint16_t SOFDifferentialLossless = 0xFFC7;
-	/* Start of frame, non-differential, arithmetic coding */
-	static const uint16_t SOFExtendedSequentialDCTArith = 0xFFC9;
-	static const uint16_t SOFProgressiveDCTArith = 0xFFCA;
-	static const uint16_t SOFLosslessArith = 0xFFCB;
-	/* Start of frame, differential, arithmetic coding */
-	static const uint16_t SOFDifferentialSequentialDCTArith = 0xFFCD;
-	static const uint16_t SOFDifferentialProgressiveDCTArith = 0xFFCE;
-	static const uint16_t SOFDifferentialLosslessArith = 0xFFCF;
-	
-	/* First marker should be start of image */
-	uint16_t marker;
-	if (getc_ushort(&marker, &markerBuf, endPtr) != 0)
-		return (false);
-	if (marker != startOfImage)
-		return (false);
-	
-	/* Read markers until end of buffer or an identifying marker is found */
-	for (;;) {
-		/* Get next 16 bits */
-		if (getc_ushort(&marker, &markerBuf, endPtr) != 0)
-			return (false);
-			
-		/* 16-bit markers start with 0xFF but aren't 0xFF00 or 0xFFFF */ 
-		while (((marker >> 8) != 0xFF) &&
-		    ((marker == 0xFF00) || (marker == 0xFFFF)))
-			if (getc_ushort(&marker, &markerBuf, endPtr) != 0)
-				return (false);
-		
-		switch (marker) {
-		/* Lossless start of frame markers */
-		case SOFLosslessSequential:
-			/* FALLTHROUGH */
-		case SOFDifferentialLossless:
-			/* FALLTHROUGH */
-		case SOFLosslessArith:
-			/* FALLTHROUGH */
-		case SOFDifferentialLosslessArith:
-			return (true);
-
-		/* Lossy start of frame markers */
-		case SOFBaselineDCT:
-			/* FALLTHROUGH */
-		case SOFExtendedSequentialDCT:
-			/* FALLTHROUGH */
-		case SOFProgressiveDCT:
-			/* FALLTHROUGH */
-		case SOFDifferentialSequentialDCT:
-			/* FALLTHROUGH */
-		case SOFDifferentialProgressiveDCT:
-			/* FALLTHROUGH */
-		case SOFExtendedSequentialDCTArith:
-			/* FALLTHROUGH */
-		case SOFProgressiveDCTArith:
-			/* FALLTHROUGH */
-		case SOFDifferentialSequentialDCTArith:
-			/* FALLTHROUGH */
-		case SOFDifferentialProgressiveDCTArith:
-			/* FALLTHROUGH */
-					
-		/* Start of scan found before a start of frame */
-		case startOfScan:
-			return (false);
+	if (components == 1) {
+		for (int32_t row = 0; row < height; row++)
+			convertRow(imgDat->image[0] + (row * width), width,
+			    1, 1, buffer + (row * stride), format);
+	} else {
+		Memory::uint8Array interleaved(width * components);
+		for (int32_t row = 0; row < height; row++) {
+			for (int32_t c = 0; c < components; c++) {
+				const uint8_t *plane = imgDat->image[c] +
+				    (((row * imgDat->samp_height[c]) /
+				    height) * imgDat->samp_width[c]);
+				for (int32_t col = 0; col < width; col++)
+					interleaved[(col * components) + c] =
+					    plane[(col *
+					    imgDat->samp_width[c]) / width];
+			}
+			convertRow(interleaved, width, components, 1,
+			    buffer + (row * stride), format);
 		}
-		
-		/* Reposition marker pointer after current marker segment */
-		if (JPEG::getc_skip_marker_segment(marker, &markerBuf, endPtr))
-			return (false);
 	}
-	
-	return (false);
+
+	free_IMG_DAT(imgDat, FREE_IMAGE);
+}
+
+bool
+BiometricEvaluation::Image::JPEGL::isJPEGL(
+    const uint8_t *data,
+    uint64_t size)
+{
+	return (JPEG::getJPEGCompressionAlgorithm(data, size) ==
+	    CompressionAlgorithm::JPEGL);
 }
 
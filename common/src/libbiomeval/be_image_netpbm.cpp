@@ -33,12 +33,22 @@ BE_FRAMEWORK_ENUMERATION_DEFINITIONS(
 BiometricEvaluation::Image::NetPBM::NetPBM(
     const uint8_t *data,
     const uint64_t size) :
+    BiometricEvaluation::Image::NetPBM::NetPBM(
+    copyData(data, size),
+    size)
+{
+
+}
+
+BiometricEvaluation::Image::NetPBM::NetPBM(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size) :
     Image::Image(
     data,
     size,
     CompressionAlgorithm::NetPBM)
 {
-	if (isNetPBM(data, size) != true)
+	if (isNetPBM(data.get(), size) != true)
 		throw Error::DataError("Not a NetPBM formatted image");
 	
 	try {
@@ -55,7 +65,9 @@ BiometricEvaluation::Image::NetPBM::parseHeader()
 	const uint64_t dataSize = this->getDataSize();
 
 	size_t offset = 0;
-	skipComment(data, this->getDataSize(), offset);
+	skipComment(data, dataSize, offset);
+	if ((offset + 2) > dataSize)
+		throw Error::DataError("Truncated header for NetPBM image");
 	if (data[offset++] != 'P')
 		throw Error::DataError("Not a valid NetPBM file");
 		
@@ -148,6 +160,8 @@ BiometricEvaluation::Image::NetPBM::parseHeader()
 	setResolution(Resolution(72, 72, Resolution::Units::PPI));
 
 	/* Payload comes a minimum of one whitespace after last header item */
+	if (offset >= dataSize)
+		throw Error::DataError("Truncated header for NetPBM image");
 	_headerLength = offset + 1;
 }
 
@@ -214,8 +228,12 @@ BiometricEvaluation::Image::NetPBM::skipComment(
     size_t dataSize,
     size_t &offset)
 {
-	while (data[offset] == '#')
+	while ((offset < dataSize) && (data[offset] == '#')) {
 		skipLine(data, dataSize, offset);
+		/* Step over the newline to the next line */
+		if (offset < dataSize)
+			offset++;
+	}
 }
 
 void
@@ -224,7 +242,8 @@ BiometricEvaluation::Image::NetPBM::skipLine(
     size_t dataSize,
     size_t &offset)
 {
-	while (data[offset] != '\n')
+	/* Data may be a prefix of the image, as when probing */
+	while ((offset < dataSize) && (data[offset] != '\n'))
 		offset++;
 }
 
@@ -378,6 +397,81 @@ BiometricEvaluation::Image::NetPBM::getRawGrayscaleData(
 	return (Image::getRawGrayscaleData(depth));
 }
 
+void
+BiometricEvaluation::Image::NetPBM::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->checkDecodeArguments(buffer, stride, format);
+
+	const uint8_t *data = this->getDataPointer() + this->_headerLength;
+	const uint64_t dataSize = this->getDataSize() - this->_headerLength;
+	const uint32_t width = this->getDimensions().xSize;
+	const uint32_t height = this->getDimensions().ySize;
+
+	switch (_kind) {
+	case Kind::BinaryPortableBitmap: {
+		/* Rows are padded to a whole byte */
+		const uint64_t bitmapStride = (width + 7) / 8;
+		if ((bitmapStride * height) > dataSize)
+			throw Error::DataError("Buffer length too small");
+
+		uint8_t value;
+		for (uint32_t row = 0; row < height; row++) {
+			const uint8_t *bitmapRow = data + (row * bitmapStride);
+			uint8_t *out = buffer + (row * stride);
+			for (uint32_t col = 0; col < width; col++) {
+				/* 0 is white, 1 is black */
+				value = (((bitmapRow[col / 8] <<
+				    (col % 8)) & 0x80) == 0) ? 0xFF : 0x00;
+				*out++ = value;
+				if (format == PixelFormat::RGB24) {
+					*out++ = value;
+					*out++ = value;
+				}
+			}
+		}
+		break;
+	}
+	case Kind::BinaryPortableGraymap:
+		/* FALLTHROUGH */
+	case Kind::BinaryPortablePixmap: {
+		const uint8_t components = (_kind ==
+		    Kind::BinaryPortablePixmap ? 3 : 1);
+		const uint8_t bytesPerComponent = (this->getBitDepth() > 8 ?
+		    2 : 1);
+		const uint64_t rowSize = static_cast<uint64_t>(width) *
+		    components * bytesPerComponent;
+		if ((rowSize * height) > dataSize)
+			throw Error::DataError("Buffer length too small");
+
+		/* NetPBM stores data big-endian */
+		const bool swap = ((bytesPerComponent == 2) &&
+		    Memory::isLittleEndian());
+		Memory::uint8Array nativeRow(swap ? rowSize : 0);
+		for (uint32_t row = 0; row < height; row++) {
+			const uint8_t *in = data + (row * rowSize);
+			if (swap) {
+				for (uint64_t i = 0; i < rowSize; i += 2) {
+					nativeRow[i] = in[i + 1];
+					nativeRow[i + 1] = in[i];
+				}
+				in = nativeRow;
+			}
+			convertRow(in, width, components, bytesPerComponent,
+			    buffer + (row * stride), format);
+		}
+		break;
+	}
+	default:
+		/* ASCII formats must be parsed into raw data first */
+		Image::decodeInto(buffer, stride, format);
+		break;
+	}
+}
+
 bool
 BiometricEvaluation::Image::NetPBM::isNetPBM(
     const uint8_t *data,
@@ -8,6 +8,9 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include <png.h>
 
 #include <be_image_png.h>
@@ -30,6 +33,16 @@ struct png_buffer
 };
 using png_buffer = struct png_buffer;
 
+/** Growable buffer for writing PNG-encoded data with libpng. */
+struct png_output_buffer
+{
+	/** PNG-encoded buffer, whose size is its capacity */
+	BE::Memory::uint8Array data;
+	/** Number of bytes currently written by libpng */
+	png_size_t length;
+};
+using png_output_buffer = struct png_output_buffer;
+
 /**
  * @brief
  * libpng callback to read data from an AutoArray.
@@ -52,6 +65,37 @@ png_read_mem_src(
     png_bytep buffer,
     png_size_t length);
 
+/**
+ * @brief
+ * libpng callback to write data to a growable buffer.
+ *
+ * @param png_ptr
+ * Pointer to a PNG struct for the image.
+ * @param buffer
+ * Encoded data to append to the png_output_buffer.
+ * @param length
+ * Number of bytes in buffer.
+ *
+ * @throw Error::StrategyError
+ * Output buffer given to libpng is nullptr.
+ */
+static void
+png_write_mem_dest(
+    png_structp png_ptr,
+    png_bytep buffer,
+    png_size_t length);
+
+/**
+ * @brief
+ * libpng callback to flush written data, which is a no-op for buffers.
+ *
+ * @param png_ptr
+ * Pointer to a PNG struct for the image.
+ */
+static void
+png_flush_mem_dest(
+    png_structp png_ptr);
+
 /**
  * @brief
  * Convert libpng errors into C++ exceptions.
@@ -72,6 +116,16 @@ png_error_callback(
 BiometricEvaluation::Image::PNG::PNG(
     const uint8_t *data,
     const uint64_t size) :
+    BiometricEvaluation::Image::PNG::PNG(
+    copyData(data, size),
+    size)
+{
+
+}
+
+BiometricEvaluation::Image::PNG::PNG(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size) :
     Image::Image(
     data,
     size,
@@ -94,7 +148,12 @@ BiometricEvaluation::Image::PNG::PNG(
 		throw Error::StrategyError("libpng could not create "
 		    "png_info");
 	}
-	png_read_info(png_ptr, png_info_ptr);
+	try {
+		png_read_info(png_ptr, png_info_ptr);
+	} catch (Error::Exception &e) {
+		png_destroy_read_struct(&png_ptr, &png_info_ptr, nullptr);
+		throw;
+	}
 
 	setColorDepth(png_get_bit_depth(png_ptr, png_info_ptr) *
 	    png_get_channels(png_ptr, png_info_ptr));
@@ -244,6 +303,141 @@ BiometricEvaluation::Image::PNG::getRawGrayscaleData(
 	return (Image::getRawGrayscaleData(depth));
 }
 
+void
+BiometricEvaluation::Image::PNG::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->decodeRegionInto(buffer, stride, format, DecodeRequest());
+}
+
+void
+BiometricEvaluation::Image::PNG::decodeRegionInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format,
+    const DecodeRequest &request)
+    const
+{
+	uint32_t horzOffset, vertOffset;
+	Size dimensions;
+	this->checkDecodeArguments(buffer, stride, format, request,
+	    horzOffset, vertOffset, dimensions);
+	const bool entireImage = ((request.scaleDenominator == 1) &&
+	    (dimensions == this->getDimensions()));
+
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING,
+	    nullptr, png_error_callback, png_error_callback);
+	if (png_ptr == nullptr)
+		throw Error::StrategyError("libpng could not create "
+		    "png_struct");
+
+	/* Read encoded PNG data from a buffer using our extension */
+	png_buffer png_buf = { this->getDataPointer(), this->getDataSize(), 0 };
+	png_set_read_fn(png_ptr, &png_buf, png_read_mem_src);
+
+	png_infop png_info_ptr = png_create_info_struct(png_ptr);
+	if (png_info_ptr == nullptr) {
+		png_destroy_read_struct(&png_ptr, nullptr, nullptr);
+		throw Error::StrategyError("libpng could not create "
+		    "png_info");
+	}
+
+	try {
+		png_read_info(png_ptr, png_info_ptr);
+
+		/* Every pass of an interlaced image covers the entire image */
+		if (!entireImage && (png_get_interlace_type(png_ptr,
+		    png_info_ptr) != PNG_INTERLACE_NONE)) {
+			png_destroy_read_struct(&png_ptr, &png_info_ptr,
+			    nullptr);
+			Image::decodeRegionInto(buffer, stride, format,
+			    request);
+			return;
+		}
+
+		/*
+		 * Have libpng produce 8-bit gray or RGB: expand palettes
+		 * and low bit depths, drop alpha, and reduce 16-bit
+		 * samples.
+		 */
+		png_set_expand(png_ptr);
+		png_set_strip_alpha(png_ptr);
+#ifdef PNG_READ_SCALE_16_TO_8_SUPPORTED
+		png_set_scale_16(png_ptr);
+#else
+		png_set_strip_16(png_ptr);
+#endif
+		const bool color = ((png_get_color_type(png_ptr,
+		    png_info_ptr) & PNG_COLOR_MASK_COLOR) != 0);
+		if ((format == PixelFormat::Gray8) && color)
+			/* Weights from ITU-R BT.601, in 1/100000 */
+			png_set_rgb_to_gray_fixed(png_ptr, 1, 29900, 58700);
+		else if ((format == PixelFormat::RGB24) && !color)
+			png_set_gray_to_rgb(png_ptr);
+		const int passes = png_set_interlace_handling(png_ptr);
+		png_read_update_info(png_ptr, png_info_ptr);
+
+		if (png_get_rowbytes(png_ptr, png_info_ptr) !=
+		    this->getDecodedRowSize(format))
+			throw Error::StrategyError("libpng could not convert "
+			    "to " + BE::Framework::Enumeration::to_string(
+			    format));
+
+		const uint32_t height = this->getDimensions().ySize;
+		if (entireImage) {
+			/* Decode directly into the caller's rows */
+			for (int pass = 0; pass < passes; pass++)
+				for (uint32_t row = 0; row < height; row++)
+					png_read_row(png_ptr,
+					    buffer + (row * stride), nullptr);
+		} else {
+			/*
+			 * Stream rows through a band of scaleDenominator
+			 * rows, reducing each band as it fills, and stop
+			 * reading once past the region.
+			 */
+			const uint8_t scale = request.scaleDenominator;
+			const uint64_t rowSize = this->getDecodedRowSize(
+			    format);
+			Memory::uint8Array band(rowSize * scale);
+
+			const uint32_t firstRow = vertOffset * scale;
+			const uint32_t lastRow = static_cast<uint32_t>(
+			    std::min<uint64_t>(height, static_cast<uint64_t>(
+			    vertOffset + dimensions.ySize) * scale));
+			for (uint32_t row = 0; row < firstRow; row++)
+				png_read_row(png_ptr, band, nullptr);
+
+			const uint32_t x0 = horzOffset * scale;
+			const uint32_t bandWidth =
+			    this->getDimensions().xSize - x0;
+			const uint64_t bandOffset = static_cast<uint64_t>(
+			    x0) * getDecodedPixelSize(format);
+			uint32_t bandRow = 0;
+			uint8_t *out = buffer;
+			for (uint32_t row = firstRow; row < lastRow; row++) {
+				png_read_row(png_ptr, band + (bandRow *
+				    rowSize), nullptr);
+				if ((++bandRow == scale) ||
+				    ((row + 1) == lastRow)) {
+					reduceBand(band + bandOffset, rowSize,
+					    bandRow, bandWidth, scale, format,
+					    out, dimensions.xSize);
+					out += stride;
+					bandRow = 0;
+				}
+			}
+		}
+	} catch (Error::Exception &e) {
+		png_destroy_read_struct(&png_ptr, &png_info_ptr, nullptr);
+		throw;
+	}
+	png_destroy_read_struct(&png_ptr, &png_info_ptr, nullptr);
+}
+
 bool
 BiometricEvaluation::Image::PNG::isPNG(
     const uint8_t *data,
@@ -258,6 +452,100 @@ BiometricEvaluation::Image::PNG::isPNG(
 	return (png_sig_cmp(header, 0, PNG_SIG_LENGTH) == 0);
 }
 
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::Image::PNG::encode(
+    const uint8_t *rawData,
+    const Size &dimensions,
+    uint32_t colorDepth,
+    uint16_t bitDepth,
+    const Resolution &resolution,
+    int8_t compressionLevel)
+{
+	if (rawData == nullptr)
+		throw Error::ParameterError("Raw data is nullptr");
+	if ((bitDepth != 8) && (bitDepth != 16))
+		throw Error::ParameterError("Unsupported bit depth: " +
+		    std::to_string(bitDepth));
+	if ((compressionLevel < -1) || (compressionLevel > 9))
+		throw Error::ParameterError("Invalid compression level: " +
+		    std::to_string(compressionLevel));
+
+	int colorType;
+	switch (colorDepth / bitDepth) {
+	case 1:
+		colorType = PNG_COLOR_TYPE_GRAY;
+		break;
+	case 2:
+		colorType = PNG_COLOR_TYPE_GRAY_ALPHA;
+		break;
+	case 3:
+		colorType = PNG_COLOR_TYPE_RGB;
+		break;
+	case 4:
+		colorType = PNG_COLOR_TYPE_RGB_ALPHA;
+		break;
+	default:
+		throw Error::ParameterError("Unsupported color depth: " +
+		    std::to_string(colorDepth));
+	}
+	if ((colorDepth % bitDepth) != 0)
+		throw Error::ParameterError("Unsupported color depth: " +
+		    std::to_string(colorDepth));
+
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+	    nullptr, png_error_callback, png_error_callback);
+	if (png_ptr == nullptr)
+		throw Error::StrategyError("libpng could not create "
+		    "png_struct");
+	png_infop png_info_ptr = png_create_info_struct(png_ptr);
+	if (png_info_ptr == nullptr) {
+		png_destroy_write_struct(&png_ptr, nullptr);
+		throw Error::StrategyError("libpng could not create "
+		    "png_info");
+	}
+
+	/* Write encoded PNG data to a buffer using our extension */
+	const uint64_t rowSize = (static_cast<uint64_t>(dimensions.xSize) *
+	    colorDepth) / 8;
+	png_output_buffer png_buf{Memory::uint8Array(
+	    (rowSize * dimensions.ySize / 2) + 1024), 0};
+	png_set_write_fn(png_ptr, &png_buf, png_write_mem_dest,
+	    png_flush_mem_dest);
+
+	try {
+		png_set_IHDR(png_ptr, png_info_ptr, dimensions.xSize,
+		    dimensions.ySize, bitDepth, colorType, PNG_INTERLACE_NONE,
+		    PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		if (compressionLevel != -1)
+			png_set_compression_level(png_ptr, compressionLevel);
+		if (resolution.units != Resolution::Units::NA) {
+			const Resolution ppcm = resolution.toUnits(
+			    Resolution::Units::PPCM);
+			png_set_pHYs(png_ptr, png_info_ptr,
+			    static_cast<png_uint_32>(std::round(
+			    ppcm.xRes * 100.0)),
+			    static_cast<png_uint_32>(std::round(
+			    ppcm.yRes * 100.0)), PNG_RESOLUTION_METER);
+		}
+		png_write_info(png_ptr, png_info_ptr);
+
+		/* PNG stores 16-bit samples big-endian */
+		if ((bitDepth == 16) && BE::Memory::isLittleEndian())
+			png_set_swap(png_ptr);
+		for (uint32_t row = 0; row < dimensions.ySize; row++)
+			png_write_row(png_ptr, const_cast<png_bytep>(
+			    rawData + (row * rowSize)));
+		png_write_end(png_ptr, nullptr);
+	} catch (Error::Exception &e) {
+		png_destroy_write_struct(&png_ptr, &png_info_ptr);
+		throw;
+	}
+	png_destroy_write_struct(&png_ptr, &png_info_ptr);
+
+	png_buf.data.resize(png_buf.length);
+	return (std::move(png_buf.data));
+}
+
 void
 png_read_mem_src(
     png_structp png_ptr,
@@ -288,3 +576,29 @@ png_error_callback(
 {
 	throw BE::Error::StrategyError("libpng: " + std::string(msg));
 }
+
+void
+png_write_mem_dest(
+    png_structp png_ptr,
+    png_bytep buffer,
+    png_size_t length)
+{
+	if (png_get_io_ptr(png_ptr) == nullptr)
+		throw BE::Error::StrategyError("libpng has no io_ptr set");
+
+	png_output_buffer *output = (png_output_buffer *)png_get_io_ptr(
+	    png_ptr);
+	if (length > (output->data.size() - output->length))
+		output->data.resize(std::max<uint64_t>(output->data.size() * 2,
+		    output->length + length));
+
+	memcpy(output->data + output->length, buffer, length);
+	output->length += length;
+}
+
+void
+png_flush_mem_dest(
+    png_structp png_ptr)
+{
+
+}
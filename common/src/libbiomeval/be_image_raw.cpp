@@ -19,6 +19,26 @@ BiometricEvaluation::Image::Raw::Raw(
     const uint16_t bitDepth,
     const Resolution resolution,
     const bool hasAlphaChannel) :
+    BiometricEvaluation::Image::Raw::Raw(
+    copyData(data, size),
+    size,
+    dimensions,
+    colorDepth,
+    bitDepth,
+    resolution,
+    hasAlphaChannel)
+{
+
+}
+
+BiometricEvaluation::Image::Raw::Raw(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size,
+    const Size dimensions,
+    const uint32_t colorDepth,
+    const uint16_t bitDepth,
+    const Resolution resolution,
+    const bool hasAlphaChannel) :
     Image(data,
     size,
     dimensions,
@@ -63,3 +83,20 @@ BiometricEvaluation::Image::Raw::getRawGrayscaleData(
 {
 	return (Image::getRawGrayscaleData(depth));
 }
+
+void
+BiometricEvaluation::Image::Raw::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->checkDecodeArguments(buffer, stride, format);
+	if (this->getColorDepth() < 8)
+		throw Error::NotImplemented("Decoding " +
+		    std::to_string(this->getColorDepth()) + "-bit raw images");
+
+	/* Raw data is already decompressed, so convert without a copy */
+	this->convertRawData(this->getDataPointer(), this->getDataSize(),
+	    buffer, stride, format);
+}
@@ -0,0 +1,670 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_image_resampler.h>
+#include "be_image_simd.h"
+
+namespace BE = BiometricEvaluation;
+
+const std::map<BiometricEvaluation::Image::ResampleFilter, std::string>
+BE_Image_ResampleFilter_EnumToStringMap = {
+    {BiometricEvaluation::Image::ResampleFilter::Box, "Box"},
+    {BiometricEvaluation::Image::ResampleFilter::Bilinear, "Bilinear"},
+    {BiometricEvaluation::Image::ResampleFilter::Lanczos3, "Lanczos3"}
+};
+BE_FRAMEWORK_ENUMERATION_DEFINITIONS(
+    BiometricEvaluation::Image::ResampleFilter,
+    BE_Image_ResampleFilter_EnumToStringMap);
+
+namespace
+{
+	using namespace BE::Image::SIMD;
+
+	/** Rows or columns filtered together by SIMD */
+	const uint32_t LANES = 4;
+
+	/*
+	 * Output rows resampled as a unit by one thread.  Smaller bands
+	 * need less scratch memory, but filter more of the input rows
+	 * shared with neighboring bands twice.
+	 */
+	const uint32_t BAND_ROWS = 128;
+
+	/** Fewest output pixels worth handing to another thread */
+	const uint64_t MIN_PIXELS_PER_THREAD = 128 * 1024;
+
+	/**
+	 * @brief
+	 * Input samples and weights that make up each output sample along
+	 * one axis.
+	 */
+	struct Contributions
+	{
+		/** First input sample of each output sample */
+		std::vector<uint32_t> first;
+		/** Number of input samples in each output sample */
+		std::vector<uint32_t> count;
+		/** Weights of the input samples, taps per output sample */
+		std::vector<float> weights;
+		/** Most input samples in an output sample */
+		uint32_t taps{0};
+	};
+
+	/** Everything shared by the threads resampling an image */
+	struct Job
+	{
+		const uint8_t *input;
+		uint64_t inputStride;
+		uint32_t inputWidth;
+		uint8_t *output;
+		uint64_t outputStride;
+		uint32_t outputWidth;
+		uint32_t outputHeight;
+		/** Samples per pixel */
+		uint32_t channels;
+		Contributions horizontal;
+		Contributions vertical;
+	};
+
+	/** Scratch memory used by one thread */
+	struct Scratch
+	{
+		/** Input rows interleaved so each sample fills a vector */
+		std::vector<float> transposed;
+		/** Band of input rows filtered horizontally */
+		std::vector<float> rows;
+		/** Destination of rows past the end of the band */
+		std::vector<float> spare;
+		/** One output row before conversion to 8 bits */
+		std::vector<float> sums;
+	};
+}
+
+/**
+ * @brief
+ * Value of a filter.
+ *
+ * @param filter
+ * Filter to evaluate.
+ * @param x
+ * Distance from the center of the filter, in input samples.
+ *
+ * @return
+ * Unnormalized weight of a sample x from the center.
+ */
+static double
+filterWeight(
+    BE::Image::ResampleFilter filter,
+    double x);
+
+/**
+ * @brief
+ * Half the width of a filter, beyond which it is 0.
+ *
+ * @param filter
+ * Filter whose support is desired.
+ *
+ * @return
+ * Support of filter, in input samples when not reducing.
+ */
+static double
+filterSupport(
+    BE::Image::ResampleFilter filter);
+
+/**
+ * @brief
+ * Compute the contributions of input samples to output samples
+ * along one axis.
+ *
+ * @param filter
+ * Filter to apply.
+ * @param inputSize
+ * Number of input samples.
+ * @param outputSize
+ * Number of output samples.
+ *
+ * @return
+ * Contributions for each of outputSize samples, whose weights sum to 1.
+ */
+static Contributions
+computeContributions(
+    BE::Image::ResampleFilter filter,
+    uint32_t inputSize,
+    uint32_t outputSize);
+
+/**
+ * @brief
+ * Resample bands of output rows until none remain.
+ *
+ * @param job
+ * Image being resampled.
+ * @param nextBand
+ * Index of the next band to resample, shared with other threads.
+ */
+static void
+resampleBands(
+    const Job &job,
+    std::atomic<uint32_t> &nextBand);
+
+/**
+ * @brief
+ * Resample one band of output rows.
+ *
+ * @param job
+ * Image being resampled.
+ * @param firstRow
+ * First output row of the band.
+ * @param lastRow
+ * One past the last output row of the band.
+ * @param scratch
+ * Scratch memory of this thread.
+ */
+static void
+resampleBand(
+    const Job &job,
+    uint32_t firstRow,
+    uint32_t lastRow,
+    Scratch &scratch);
+
+/**
+ * @brief
+ * Filter LANES input rows horizontally.
+ *
+ * @param job
+ * Image being resampled.
+ * @param rows
+ * Input rows.
+ * @param transposed
+ * Scratch memory for inputWidth * channels * LANES samples.
+ * @param output
+ * Where outputWidth * channels filtered samples of each row are written.
+ */
+static void
+filterRows(
+    const Job &job,
+    const uint8_t *const rows[LANES],
+    float *transposed,
+    float *const output[LANES]);
+
+/**
+ * @brief
+ * Filter horizontally filtered rows vertically into one output row.
+ *
+ * @param job
+ * Image being resampled.
+ * @param row
+ * Output row to compute.
+ * @param rows
+ * Horizontally filtered input rows, starting with input row top.
+ * @param rowFloats
+ * Distance between rows of rows, a multiple of LANES.
+ * @param top
+ * Input row of the first of rows.
+ * @param sums
+ * Scratch memory for rowFloats samples.
+ */
+static void
+filterColumns(
+    const Job &job,
+    uint32_t row,
+    const float *rows,
+    uint64_t rowFloats,
+    uint32_t top,
+    float *sums);
+
+/**
+ * @brief
+ * Resample an image and describe the result.
+ *
+ * @param resampler
+ * Resampler to use.
+ * @param image
+ * Image to resample.
+ * @param dimensions
+ * Dimensions of the resampled image.
+ * @param resolution
+ * Resolution of the resampled image.
+ * @param format
+ * Format of the resampled image.
+ *
+ * @return
+ * Resampled image.
+ */
+static std::shared_ptr<BE::Image::Raw>
+resampleImage(
+    const BE::Image::Resampler &resampler,
+    const BE::Image::Image &image,
+    const BE::Image::Size &dimensions,
+    const BE::Image::Resolution &resolution,
+    BE::Image::PixelFormat format);
+
+BiometricEvaluation::Image::Resampler::Resampler(
+    ResampleFilter filter,
+    uint32_t threadCount) :
+    _filter(filter),
+    _threadCount(threadCount == 0 ?
+    std::max(1U, std::thread::hardware_concurrency()) : threadCount)
+{
+
+}
+
+void
+BiometricEvaluation::Image::Resampler::resample(
+    const uint8_t *input,
+    const Size &inputDimensions,
+    uint64_t inputStride,
+    uint8_t *output,
+    const Size &outputDimensions,
+    uint64_t outputStride,
+    PixelFormat format)
+    const
+{
+	if ((format != PixelFormat::Gray8) && (format != PixelFormat::RGB24))
+		throw Error::ParameterError("Resampling " +
+		    Framework::Enumeration::to_string(format));
+	if ((inputDimensions.xSize == 0) || (inputDimensions.ySize == 0) ||
+	    (outputDimensions.xSize == 0) || (outputDimensions.ySize == 0))
+		throw Error::ParameterError("Cannot resample empty images");
+	const uint32_t channels = (format == PixelFormat::RGB24 ? 3 : 1);
+	if ((inputStride < static_cast<uint64_t>(inputDimensions.xSize) *
+	    channels) || (outputStride < static_cast<uint64_t>(
+	    outputDimensions.xSize) * channels))
+		throw Error::ParameterError("Stride is smaller than a row");
+	if ((input == nullptr) || (output == nullptr))
+		throw Error::ParameterError("Buffer is null");
+
+	/* Every filter leaves samples alone when the size is unchanged */
+	if (inputDimensions == outputDimensions) {
+		for (uint32_t row = 0; row < inputDimensions.ySize; row++)
+			std::memcpy(output + (row * outputStride),
+			    input + (row * inputStride),
+			    static_cast<uint64_t>(inputDimensions.xSize) *
+			    channels);
+		return;
+	}
+
+	Job job;
+	job.input = input;
+	job.inputStride = inputStride;
+	job.inputWidth = inputDimensions.xSize;
+	job.output = output;
+	job.outputStride = outputStride;
+	job.outputWidth = outputDimensions.xSize;
+	job.outputHeight = outputDimensions.ySize;
+	job.channels = channels;
+	job.horizontal = computeContributions(this->_filter,
+	    inputDimensions.xSize, outputDimensions.xSize);
+	job.vertical = computeContributions(this->_filter,
+	    inputDimensions.ySize, outputDimensions.ySize);
+
+	const uint32_t bands = (job.outputHeight + BAND_ROWS - 1) / BAND_ROWS;
+	const uint64_t pixels = static_cast<uint64_t>(job.outputWidth) *
+	    job.outputHeight;
+	const uint32_t threadCount = static_cast<uint32_t>(std::max<uint64_t>(
+	    1, std::min<uint64_t>(std::min(this->_threadCount, bands),
+	    pixels / MIN_PIXELS_PER_THREAD)));
+
+	std::atomic<uint32_t> nextBand(0);
+	std::vector<std::exception_ptr> errors(threadCount);
+	const auto work = [&](uint32_t thread) {
+		try {
+			resampleBands(job, nextBand);
+		} catch (...) {
+			errors[thread] = std::current_exception();
+		}
+	};
+
+	/* Threads that cannot be started leave more bands for the rest */
+	std::vector<std::thread> threads;
+	try {
+		for (uint32_t thread = 1; thread < threadCount; thread++)
+			threads.emplace_back(work, thread);
+	} catch (std::system_error &e) {}
+	work(0);
+	for (auto &thread : threads)
+		thread.join();
+
+	for (const auto &error : errors)
+		if (error)
+			std::rethrow_exception(error);
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Raw>
+BiometricEvaluation::Image::Resampler::resample(
+    const Image &image,
+    const Size &dimensions,
+    PixelFormat format)
+    const
+{
+	const Size inputDimensions = image.getDimensions();
+	const Resolution inputResolution = image.getResolution();
+	if ((inputDimensions.xSize == 0) || (inputDimensions.ySize == 0))
+		throw Error::ParameterError("Cannot resample empty images");
+
+	return (resampleImage(*this, image, dimensions, Resolution(
+	    inputResolution.xRes * dimensions.xSize / inputDimensions.xSize,
+	    inputResolution.yRes * dimensions.ySize / inputDimensions.ySize,
+	    inputResolution.units), format));
+}
+
+std::shared_ptr<BiometricEvaluation::Image::Raw>
+BiometricEvaluation::Image::Resampler::resample(
+    const Image &image,
+    const Resolution &resolution,
+    PixelFormat format)
+    const
+{
+	if (resolution.units == Resolution::Units::NA)
+		throw Error::ParameterError("Units of resolution are not "
+		    "known");
+	if (!(resolution.xRes > 0) || !(resolution.yRes > 0))
+		throw Error::ParameterError("Resolution must be positive");
+
+	const Resolution inputResolution = image.getResolution().toUnits(
+	    resolution.units);
+	if (!(inputResolution.xRes > 0) || !(inputResolution.yRes > 0))
+		throw Error::StrategyError("Resolution of image is not known");
+
+	const Size inputDimensions = image.getDimensions();
+	const Size dimensions(
+	    static_cast<uint32_t>(std::round(inputDimensions.xSize *
+	    (resolution.xRes / inputResolution.xRes))),
+	    static_cast<uint32_t>(std::round(inputDimensions.ySize *
+	    (resolution.yRes / inputResolution.yRes))));
+	if ((dimensions.xSize == 0) || (dimensions.ySize == 0))
+		throw Error::ParameterError("Resampled image would be empty");
+
+	return (resampleImage(*this, image, dimensions, resolution, format));
+}
+
+BiometricEvaluation::Image::ResampleFilter
+BiometricEvaluation::Image::Resampler::getFilter()
+    const
+{
+	return (this->_filter);
+}
+
+uint32_t
+BiometricEvaluation::Image::Resampler::getThreadCount()
+    const
+{
+	return (this->_threadCount);
+}
+
+static double
+filterWeight(
+    BE::Image::ResampleFilter filter,
+    double x)
+{
+	static const double Pi = std::acos(-1.0);
+	const auto sinc = [](double x) {
+		return (x == 0 ? 1.0 : std::sin(x * Pi) / (x * Pi));
+	};
+
+	switch (filter) {
+	case BE::Image::ResampleFilter::Box:
+		/* Half-open, so a sample midway between two counts once */
+		return ((x > -0.5) && (x <= 0.5) ? 1.0 : 0.0);
+	case BE::Image::ResampleFilter::Bilinear:
+		x = std::fabs(x);
+		return (x < 1.0 ? 1.0 - x : 0.0);
+	case BE::Image::ResampleFilter::Lanczos3:
+		return (std::fabs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0);
+	}
+
+	return (0.0);
+}
+
+static double
+filterSupport(
+    BE::Image::ResampleFilter filter)
+{
+	switch (filter) {
+	case BE::Image::ResampleFilter::Box:
+		return (0.5);
+	case BE::Image::ResampleFilter::Bilinear:
+		return (1.0);
+	case BE::Image::ResampleFilter::Lanczos3:
+		return (3.0);
+	}
+
+	return (0.0);
+}
+
+static Contributions
+computeContributions(
+    BE::Image::ResampleFilter filter,
+    uint32_t inputSize,
+    uint32_t outputSize)
+{
+	/* Widen the filter when reducing so every input sample counts */
+	const double scale = static_cast<double>(inputSize) / outputSize;
+	const double filterScale = std::max(scale, 1.0);
+	const double support = filterSupport(filter) * filterScale;
+
+	Contributions contributions;
+	contributions.taps = (static_cast<uint32_t>(std::ceil(support)) * 2) +
+	    1;
+	contributions.first.resize(outputSize);
+	contributions.count.resize(outputSize);
+	contributions.weights.assign(static_cast<uint64_t>(outputSize) *
+	    contributions.taps, 0);
+
+	for (uint32_t i = 0; i < outputSize; i++) {
+		/* Centers of pixels are at half-pixel offsets */
+		const double center = (i + 0.5) * scale;
+		const int64_t first = std::max<int64_t>(0,
+		    static_cast<int64_t>(center - support + 0.5));
+		const int64_t last = std::min<int64_t>(inputSize,
+		    static_cast<int64_t>(center + support + 0.5));
+		const uint32_t count = static_cast<uint32_t>(std::min<int64_t>(
+		    last - first, contributions.taps));
+
+		float *weights = &contributions.weights[
+		    static_cast<uint64_t>(i) * contributions.taps];
+		double total = 0;
+		for (uint32_t k = 0; k < count; k++) {
+			const double weight = filterWeight(filter,
+			    (first + k - center + 0.5) / filterScale);
+			weights[k] = static_cast<float>(weight);
+			total += weight;
+		}
+		if (total != 0)
+			for (uint32_t k = 0; k < count; k++)
+				weights[k] = static_cast<float>(weights[k] /
+				    total);
+
+		contributions.first[i] = static_cast<uint32_t>(first);
+		contributions.count[i] = count;
+	}
+
+	return (contributions);
+}
+
+static void
+resampleBands(
+    const Job &job,
+    std::atomic<uint32_t> &nextBand)
+{
+	Scratch scratch;
+	for (;;) {
+		const uint32_t band = nextBand++;
+		const uint64_t firstRow = static_cast<uint64_t>(band) *
+		    BAND_ROWS;
+		if (firstRow >= job.outputHeight)
+			return;
+		resampleBand(job, static_cast<uint32_t>(firstRow),
+		    static_cast<uint32_t>(std::min<uint64_t>(firstRow +
+		    BAND_ROWS, job.outputHeight)), scratch);
+	}
+}
+
+static void
+resampleBand(
+    const Job &job,
+    uint32_t firstRow,
+    uint32_t lastRow,
+    Scratch &scratch)
+{
+	/* Input rows needed by this band */
+	const Contributions &vertical = job.vertical;
+	const uint32_t top = vertical.first[firstRow];
+	uint32_t bottom = top;
+	for (uint32_t row = firstRow; row < lastRow; row++)
+		bottom = std::max(bottom, vertical.first[row] +
+		    vertical.count[row]);
+
+	/* Pad rows so the vertical pass need not handle a partial vector */
+	const uint64_t samples = static_cast<uint64_t>(job.outputWidth) *
+	    job.channels;
+	const uint64_t rowFloats = ((samples + LANES - 1) / LANES) * LANES;
+	scratch.transposed.resize(static_cast<uint64_t>(job.inputWidth) *
+	    job.channels * LANES);
+	scratch.rows.resize(rowFloats * (bottom - top));
+	scratch.spare.resize(rowFloats);
+	scratch.sums.resize(rowFloats);
+
+	for (uint32_t row = top; row < bottom; row += LANES) {
+		/* Lanes past the band repeat its last row into spare */
+		const uint8_t *input[LANES];
+		float *output[LANES];
+		for (uint32_t lane = 0; lane < LANES; lane++) {
+			const uint32_t r = std::min(row + lane, bottom - 1);
+			input[lane] = job.input + (r * job.inputStride);
+			output[lane] = (row + lane < bottom ?
+			    scratch.rows.data() + ((row + lane - top) *
+			    rowFloats) : scratch.spare.data());
+		}
+		filterRows(job, input, scratch.transposed.data(), output);
+	}
+
+	for (uint32_t row = firstRow; row < lastRow; row++)
+		filterColumns(job, row, scratch.rows.data(), rowFloats, top,
+		    scratch.sums.data());
+}
+
+static void
+filterRows(
+    const Job &job,
+    const uint8_t *const rows[LANES],
+    float *transposed,
+    float *const output[LANES])
+{
+	/* Each input sample becomes one vector, a lane per row */
+	const uint64_t samples = static_cast<uint64_t>(job.inputWidth) *
+	    job.channels;
+	for (uint64_t s = 0; s < samples; s++)
+		for (uint32_t lane = 0; lane < LANES; lane++)
+			transposed[(s * LANES) + lane] = rows[lane][s];
+
+	const Contributions &horizontal = job.horizontal;
+	const uint64_t pixelFloats = static_cast<uint64_t>(job.channels) *
+	    LANES;
+	float sums[LANES];
+	for (uint32_t x = 0; x < job.outputWidth; x++) {
+		const float *weights = &horizontal.weights[
+		    static_cast<uint64_t>(x) * horizontal.taps];
+		const uint32_t count = horizontal.count[x];
+		const float *pixel = transposed + (horizontal.first[x] *
+		    pixelFloats);
+
+		for (uint32_t c = 0; c < job.channels; c++) {
+			FloatVector sum = splatVector(0);
+			for (uint32_t k = 0; k < count; k++)
+				sum = addVectors(sum, multiplyVectors(
+				    splatVector(weights[k]), loadVector(
+				    pixel + (k * pixelFloats) + (c * LANES))));
+			storeVector(sums, sum);
+
+			const uint64_t s = (static_cast<uint64_t>(x) *
+			    job.channels) + c;
+			for (uint32_t lane = 0; lane < LANES; lane++)
+				output[lane][s] = sums[lane];
+		}
+	}
+}
+
+static void
+filterColumns(
+    const Job &job,
+    uint32_t row,
+    const float *rows,
+    uint64_t rowFloats,
+    uint32_t top,
+    float *sums)
+{
+	const Contributions &vertical = job.vertical;
+	const float *weights = &vertical.weights[
+	    static_cast<uint64_t>(row) * vertical.taps];
+	const uint32_t count = vertical.count[row];
+	const float *first = rows + ((vertical.first[row] - top) * rowFloats);
+
+	for (uint64_t i = 0; i < rowFloats; i += LANES) {
+		FloatVector sum = splatVector(0);
+		for (uint32_t k = 0; k < count; k++)
+			sum = addVectors(sum, multiplyVectors(
+			    splatVector(weights[k]),
+			    loadVector(first + (k * rowFloats) + i)));
+		storeVector(sums + i, sum);
+	}
+
+	/* Round to the nearest sample, clamping Lanczos overshoot */
+	uint8_t *output = job.output + (row * job.outputStride);
+	const uint64_t samples = static_cast<uint64_t>(job.outputWidth) *
+	    job.channels;
+	for (uint64_t s = 0; s < samples; s++) {
+		const float sum = sums[s];
+		output[s] = (sum <= 0 ? 0 : (sum >= 255 ? 255 :
+		    static_cast<uint8_t>(sum + 0.5f)));
+	}
+}
+
+static std::shared_ptr<BE::Image::Raw>
+resampleImage(
+    const BE::Image::Resampler &resampler,
+    const BE::Image::Image &image,
+    const BE::Image::Size &dimensions,
+    const BE::Image::Resolution &resolution,
+    BE::Image::PixelFormat format)
+{
+	if ((format != BE::Image::PixelFormat::Gray8) &&
+	    (format != BE::Image::PixelFormat::RGB24))
+		throw BE::Error::ParameterError("Resampling " +
+		    BE::Framework::Enumeration::to_string(format));
+	if ((dimensions.xSize == 0) || (dimensions.ySize == 0))
+		throw BE::Error::ParameterError("Cannot resample to an empty "
+		    "image");
+
+	const BE::Image::Size inputDimensions = image.getDimensions();
+	const uint64_t inputStride = image.getDecodedRowSize(format);
+	BE::Memory::uint8Array input(inputStride * inputDimensions.ySize);
+	image.decodeInto(input, inputStride, format);
+
+	const uint32_t channels = (format == BE::Image::PixelFormat::RGB24 ?
+	    3 : 1);
+	const uint64_t outputStride = static_cast<uint64_t>(
+	    dimensions.xSize) * channels;
+	BE::Memory::uint8Array output(outputStride * dimensions.ySize);
+	resampler.resample(input, inputDimensions, inputStride, output,
+	    dimensions, outputStride, format);
+
+	return (std::make_shared<BE::Image::Raw>(output, dimensions,
+	    channels * 8, 8, resolution, false));
+}
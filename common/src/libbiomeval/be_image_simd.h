@@ -0,0 +1,175 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IMAGE_SIMD_H__
+#define __BE_IMAGE_SIMD_H__
+
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace BiometricEvaluation
+{
+	namespace Image
+	{
+		/**
+		 * @brief
+		 * Four floats operated on together, with SSE, NEON, or
+		 * plain C++.
+		 * @details
+		 * Lanes are independent, so each lane sees exactly the
+		 * scalar sequence of operations and produces the same
+		 * result as scalar code.
+		 */
+		namespace SIMD
+		{
+#if defined(__SSE__) || defined(_M_X64)
+			typedef __m128 FloatVector;
+
+			inline FloatVector
+			loadVector(
+			    const float *p)
+			{
+				return (_mm_loadu_ps(p));
+			}
+
+			inline void
+			storeVector(
+			    float *p,
+			    FloatVector v)
+			{
+				_mm_storeu_ps(p, v);
+			}
+
+			inline FloatVector
+			splatVector(
+			    float f)
+			{
+				return (_mm_set1_ps(f));
+			}
+
+			inline FloatVector
+			multiplyVectors(
+			    FloatVector a,
+			    FloatVector b)
+			{
+				return (_mm_mul_ps(a, b));
+			}
+
+			inline FloatVector
+			addVectors(
+			    FloatVector a,
+			    FloatVector b)
+			{
+				return (_mm_add_ps(a, b));
+			}
+#elif defined(__ARM_NEON)
+			typedef float32x4_t FloatVector;
+
+			inline FloatVector
+			loadVector(
+			    const float *p)
+			{
+				return (vld1q_f32(p));
+			}
+
+			inline void
+			storeVector(
+			    float *p,
+			    FloatVector v)
+			{
+				vst1q_f32(p, v);
+			}
+
+			inline FloatVector
+			splatVector(
+			    float f)
+			{
+				return (vdupq_n_f32(f));
+			}
+
+			/*
+			 * Separate multiply and add, so results match
+			 * scalar code that does not fuse them.
+			 */
+			inline FloatVector
+			multiplyVectors(
+			    FloatVector a,
+			    FloatVector b)
+			{
+				return (vmulq_f32(a, b));
+			}
+
+			inline FloatVector
+			addVectors(
+			    FloatVector a,
+			    FloatVector b)
+			{
+				return (vaddq_f32(a, b));
+			}
+#else
+			struct FloatVector
+			{
+				float lane[4];
+			};
+
+			inline FloatVector
+			loadVector(
+			    const float *p)
+			{
+				FloatVector v;
+				std::memcpy(v.lane, p, sizeof(v.lane));
+				return (v);
+			}
+
+			inline void
+			storeVector(
+			    float *p,
+			    FloatVector v)
+			{
+				std::memcpy(p, v.lane, sizeof(v.lane));
+			}
+
+			inline FloatVector
+			splatVector(
+			    float f)
+			{
+				return (FloatVector{{f, f, f, f}});
+			}
+
+			inline FloatVector
+			multiplyVectors(
+			    FloatVector a,
+			    FloatVector b)
+			{
+				for (int i = 0; i < 4; i++)
+					a.lane[i] *= b.lane[i];
+				return (a);
+			}
+
+			inline FloatVector
+			addVectors(
+			    FloatVector a,
+			    FloatVector b)
+			{
+				for (int i = 0; i < 4; i++)
+					a.lane[i] += b.lane[i];
+				return (a);
+			}
+#endif
+		}
+	}
+}
+
+#endif /* __BE_IMAGE_SIMD_H__ */
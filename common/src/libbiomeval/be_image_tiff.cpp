@@ -10,6 +10,8 @@
 
 #include <tiffio.h>
 
+#include <algorithm>
+
 #include <be_image_tiff.h>
 #include <be_memory_mutableindexedbuffer.h>
 
@@ -114,9 +116,19 @@ libtiff_unmap(
 BiometricEvaluation::Image::TIFF::TIFF(
     const uint8_t *data,
     const uint64_t size) :
+    BiometricEvaluation::Image::TIFF::TIFF(
+    copyData(data, size),
+    size)
+{
+
+}
+
+BiometricEvaluation::Image::TIFF::TIFF(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size) :
     Image(data, size, CompressionAlgorithm::TIFF)
 {
-	if (!isTIFF(data, size))
+	if (!isTIFF(data.get(), size))
 		throw BE::Error::StrategyError("Not a TIFF image");
 
 	TIFFSetWarningHandler(TIFF::warningHandler);
@@ -256,6 +268,71 @@ BiometricEvaluation::Image::TIFF::getRawGrayscaleData(
 	return (BE::Image::Image::getRawGrayscaleData(depth));
 }
 
+void
+BiometricEvaluation::Image::TIFF::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->checkDecodeArguments(buffer, stride, format);
+
+	const auto dim = this->getDimensions();
+	const auto numChannels = (this->getColorDepth() / this->getBitDepth());
+	if ((numChannels != 1) && (numChannels != 3) && (numChannels != 4))
+		throw BE::Error::NotImplemented("TIFF number of "
+		    "channels == " + std::to_string(numChannels));
+
+	std::unique_ptr<::TIFF, void(*)(::TIFF*)> tiff(
+	    static_cast<::TIFF*>(this->getDecompressionStream()), TIFFClose);
+
+	char message[1024];
+	TIFFRGBAImage rgba;
+	if (TIFFRGBAImageBegin(&rgba, tiff.get(), 0, message) != 1)
+		throw BE::Error::StrategyError("libtiff: " +
+		    std::string(message));
+	std::unique_ptr<TIFFRGBAImage, void(*)(TIFFRGBAImage*)> rgbaPtr(
+	    &rgba, TIFFRGBAImageEnd);
+	rgba.req_orientation = ORIENTATION_TOPLEFT;
+
+	/*
+	 * Decompress a band of rows at a time instead of the whole
+	 * image, so only a small staging raster is needed.
+	 */
+	static const uint32_t bandHeight{64};
+	BE::Memory::AutoArray<uint32_t> band(dim.xSize *
+	    std::min(bandHeight, dim.ySize));
+	for (uint32_t top = 0; top < dim.ySize; top += bandHeight) {
+		const uint32_t rows = std::min(bandHeight, dim.ySize - top);
+		rgba.row_offset = top;
+		rgba.col_offset = 0;
+		if (TIFFRGBAImageGet(&rgba, band, dim.xSize, rows) != 1)
+			throw BE::Error::StrategyError("Error decompressing "
+			    "TIFF");
+
+		const uint32_t *pixel = band;
+		for (uint32_t row = top; row < (top + rows); row++) {
+			uint8_t *out = buffer + (row * stride);
+			for (uint32_t col = 0; col < dim.xSize; col++) {
+				const uint8_t r = TIFFGetR(*pixel);
+				const uint8_t g = TIFFGetG(*pixel);
+				const uint8_t b = TIFFGetB(*pixel);
+				pixel++;
+
+				if (format == PixelFormat::RGB24) {
+					*out++ = r;
+					*out++ = g;
+					*out++ = b;
+				} else if (numChannels == 1) {
+					*out++ = r;
+				} else {
+					*out++ = grayValue(r, g, b);
+				}
+			}
+		}
+	}
+}
+
 bool
 BiometricEvaluation::Image::TIFF::isTIFF(
     const uint8_t *data,
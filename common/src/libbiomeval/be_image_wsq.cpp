@@ -8,7 +8,10 @@
  * about its quality, reliability, or any other characteristic.
  */
  
+#include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <mutex>
 
 extern "C" {
 	#include <dataio.h>
@@ -17,10 +20,56 @@ extern "C" {
 }
 
 #include <be_image_wsq.h>
+#include "be_image_wsq_decoder.h"
+
+/** Serializes access to libwsq, whose tables are global */
+static std::mutex libwsqMutex;
+
+/**
+ * @brief
+ * Decode WSQ data into 8-bit grayscale pixels.
+ * @details
+ * Uses WSQDecoder, falling back to libwsq for any stream that decoder
+ * rejects.
+ *
+ * @param data
+ *	WSQ data.
+ * @param size
+ *	Size of data, in bytes.
+ * @param dimensions
+ *	Dimensions of the image.
+ * @param buffer
+ *	Where the first row of pixels is written.
+ * @param stride
+ *	Bytes between the start of rows in buffer.
+ * @param threadCount
+ *	Most threads to decode with.
+ *
+ * @throw Error::DataError
+ *	Could not decode data.
+ */
+static void
+decodeWSQ(
+    const uint8_t *data,
+    uint64_t size,
+    const BiometricEvaluation::Image::Size &dimensions,
+    uint8_t *buffer,
+    uint64_t stride,
+    uint32_t threadCount);
 
 BiometricEvaluation::Image::WSQ::WSQ(
     const uint8_t *data,
     const uint64_t size) :
+    BiometricEvaluation::Image::WSQ::WSQ(
+    copyData(data, size),
+    size)
+{
+
+}
+
+BiometricEvaluation::Image::WSQ::WSQ(
+    const std::shared_ptr<const uint8_t> &data,
+    const uint64_t size) :
     Image::Image(
     data,
     size,
@@ -50,6 +99,11 @@ BiometricEvaluation::Image::WSQ::WSQ(
 			throw Error::StrategyError("libwsq could not read size "
 			    "of table");
 		/* Table size includes size of field but not the marker */
+		if ((tbl_size < sizeof(tbl_size)) || ((tbl_size -
+		    sizeof(tbl_size)) > static_cast<uint64_t>((wsq_buf +
+		    size) - marker_buf)))
+			throw Error::StrategyError("libwsq table extends "
+			    "past end of data");
 		marker_buf += tbl_size - sizeof(tbl_size);
 	}
 	
@@ -97,18 +151,11 @@ BiometricEvaluation::Memory::uint8Array
 BiometricEvaluation::Image::WSQ::getRawData()
     const
 {
-	uint8_t *rawbuf = nullptr;
-	int32_t depth, height, lossy, ppi, rv, width;
-	if ((rv = wsq_decode_mem(&rawbuf, &width, &height, &depth, &ppi,
-	    &lossy, (unsigned char *)this->getDataPointer(),
-	    this->getDataSize())))
-		throw Error::DataError("Could not convert WSQ to raw.");
-
-	/* rawbuf allocated within libwsq.  Copy to manage with AutoArray. */
-	/* TODO: AutoBuffer-wrapped AutoArray */
-	Memory::uint8Array rawData(width * height * (depth / 8));
-	rawData.copy(rawbuf);
-	free(rawbuf);
+	const Size dimensions = this->getDimensions();
+	Memory::uint8Array rawData(static_cast<uint64_t>(dimensions.xSize) *
+	    dimensions.ySize);
+	decodeWSQ(this->getDataPointer(), this->getDataSize(), dimensions,
+	    rawData, dimensions.xSize, this->getDecodeThreadCount());
 
 	return (rawData);
 }
@@ -121,6 +168,65 @@ BiometricEvaluation::Image::WSQ::getRawGrayscaleData(
 	return (Image::getRawGrayscaleData(depth));
 }
 
+void
+BiometricEvaluation::Image::WSQ::decodeInto(
+    uint8_t *buffer,
+    uint64_t stride,
+    PixelFormat format)
+    const
+{
+	this->checkDecodeArguments(buffer, stride, format);
+
+	const Size dimensions = this->getDimensions();
+	if (format == PixelFormat::Gray8) {
+		decodeWSQ(this->getDataPointer(), this->getDataSize(),
+		    dimensions, buffer, stride, this->getDecodeThreadCount());
+		return;
+	}
+
+	const Memory::uint8Array rawData = this->getRawData();
+	for (uint32_t row = 0; row < dimensions.ySize; row++)
+		convertRow(rawData + (row * dimensions.xSize),
+		    dimensions.xSize, 1, 1, buffer + (row * stride), format);
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::Image::WSQ::encode(
+    const uint8_t *rawData,
+    const Size &dimensions,
+    const Resolution &resolution,
+    float bitrate)
+{
+	if (rawData == nullptr)
+		throw Error::ParameterError("Raw data is nullptr");
+	if (bitrate <= 0)
+		throw Error::ParameterError("Bit rate must be positive");
+
+	int32_t ppi = -1;
+	if (resolution.units != Resolution::Units::NA)
+		ppi = static_cast<int32_t>(std::round(resolution.toUnits(
+		    Resolution::Units::PPI).xRes));
+
+	uint8_t *wsqbuf = nullptr;
+	int32_t rv, wsqlen;
+	{
+		std::lock_guard<std::mutex> lock(libwsqMutex);
+		rv = wsq_encode_mem(&wsqbuf, &wsqlen, bitrate,
+		    const_cast<uint8_t *>(rawData), dimensions.xSize,
+		    dimensions.ySize, 8, ppi, nullptr);
+	}
+	if (rv != 0)
+		throw Error::StrategyError("libwsq could not encode image (" +
+		    std::to_string(rv) + ")");
+
+	/* wsqbuf allocated within libwsq.  Copy to manage with AutoArray. */
+	Memory::uint8Array wsqData(wsqlen);
+	wsqData.copy(wsqbuf);
+	free(wsqbuf);
+
+	return (wsqData);
+}
+
 bool
 BiometricEvaluation::Image::WSQ::isWSQ(
     const uint8_t *data,
@@ -132,3 +238,45 @@ BiometricEvaluation::Image::WSQ::isWSQ(
 
 	return (memcmp(data, WSQ_SOI, 2) == 0);
 }
+
+static void
+decodeWSQ(
+    const uint8_t *data,
+    uint64_t size,
+    const BiometricEvaluation::Image::Size &dimensions,
+    uint8_t *buffer,
+    uint64_t stride,
+    uint32_t threadCount)
+{
+	try {
+		BiometricEvaluation::Image::WSQDecoder::decode(data, size,
+		    dimensions, buffer, stride, threadCount);
+		return;
+	} catch (BiometricEvaluation::Error::DataError &e) {
+		/* Let libwsq decide */
+	}
+
+	uint8_t *rawbuf = nullptr;
+	int32_t depth, height, lossy, ppi, rv, width;
+	{
+		std::lock_guard<std::mutex> lock(libwsqMutex);
+		rv = wsq_decode_mem(&rawbuf, &width, &height, &depth, &ppi,
+		    &lossy, const_cast<uint8_t *>(data), size);
+	}
+	if (rv != 0)
+		throw BiometricEvaluation::Error::DataError("Could not "
+		    "convert WSQ to raw.");
+	if ((static_cast<uint32_t>(width) != dimensions.xSize) ||
+	    (static_cast<uint32_t>(height) != dimensions.ySize) ||
+	    (depth != 8)) {
+		free(rawbuf);
+		throw BiometricEvaluation::Error::DataError("WSQ frame header "
+		    "does not match decoded image");
+	}
+
+	/* rawbuf allocated within libwsq */
+	for (int32_t row = 0; row < height; row++)
+		std::memcpy(buffer + (row * stride), rawbuf + (row * width),
+		    width);
+	free(rawbuf);
+}
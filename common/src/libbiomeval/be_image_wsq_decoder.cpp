@@ -0,0 +1,1334 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+extern "C" {
+	#include <wsq.h>
+}
+
+#include <be_error_exception.h>
+#include <be_memory_autoarray.h>
+#include "be_image_simd.h"
+#include "be_image_wsq_decoder.h"
+
+namespace BE = BiometricEvaluation;
+
+namespace
+{
+	using namespace BE::Image::SIMD;
+
+	/** Bits of Huffman code resolved by a single table lookup */
+	const int HUFFMAN_LOOKUP_BITS = 9;
+
+	/** Rows or columns transformed together by SIMD */
+	const uint32_t SYNTHESIS_LANES = 16;
+
+	/** Fewest pixels worth handing to another thread */
+	const uint64_t MIN_PIXELS_PER_THREAD = 128 * 1024;
+
+	/** What a SynthesisStep does to its output */
+	enum class StepKind : uint8_t
+	{
+		/** output = 0 */
+		Zero,
+		/** output = input * coefficient */
+		Assign,
+		/** output += input * coefficient */
+		Accumulate
+	};
+
+	/**
+	 * @brief
+	 * One operation of NBIS's join_lets() on a line of samples.
+	 * @details
+	 * join_lets() performs the same operations on every line of a
+	 * subband, so a line's operations are recorded once and replayed
+	 * against many lines at a time.
+	 */
+	struct SynthesisStep
+	{
+		/** Index of the output sample */
+		uint32_t output;
+		/** Index of the input sample */
+		uint32_t input;
+		/** Filter coefficient, with any symmetric extension sign */
+		float coefficient;
+		StepKind kind;
+	};
+
+	/** Steps that reconstruct one line */
+	using SynthesisPlan = std::vector<SynthesisStep>;
+
+	/** Huffman decoding tables for one entropy-coded block */
+	struct HuffmanTable
+	{
+		/** Largest code of each length, or -1 (from NBIS) */
+		int maxcode[MAX_HUFFBITS + 1];
+		/** Smallest code of each length (from NBIS) */
+		int mincode[MAX_HUFFBITS + 1];
+		/** Index of the first value of each length (from NBIS) */
+		int valptr[MAX_HUFFBITS + 1];
+		/** Values, in code order */
+		uint8_t values[MAX_HUFFCOUNTS_WSQ + 1];
+		/**
+		 * Length (high byte) and value (low byte) of the code that
+		 * begins each possible HUFFMAN_LOOKUP_BITS bits, or 0 when
+		 * the code is longer.
+		 */
+		uint16_t lookup[1 << HUFFMAN_LOOKUP_BITS];
+	};
+
+	/** Entropy-coded coefficients of one WSQ block */
+	struct EntropyBlock
+	{
+		/** First byte of coded data */
+		const uint8_t *start;
+		/** Marker that terminates the coded data */
+		const uint8_t *end;
+		/** Table named by the block header */
+		HuffmanTable table;
+	};
+
+	/** Tables and headers of a WSQ image */
+	struct WSQStream
+	{
+		WSQStream()
+		{
+			std::memset(&this->transform, 0,
+			    sizeof(this->transform));
+			std::memset(&this->quantization, 0,
+			    sizeof(this->quantization));
+			std::memset(&this->frame, 0, sizeof(this->frame));
+		}
+
+		~WSQStream()
+		{
+			/* Filters are allocated within libwsq */
+			std::free(this->transform.lofilt);
+			std::free(this->transform.hifilt);
+		}
+
+		WSQStream(const WSQStream&) = delete;
+		WSQStream &operator=(const WSQStream&) = delete;
+
+		DTT_TABLE transform;
+		DQT_TABLE quantization;
+		FRM_HEADER_WSQ frame;
+		W_TREE wTree[W_TREELEN];
+		Q_TREE qTree[Q_TREELEN];
+		std::vector<EntropyBlock> blocks;
+	};
+
+	/**
+	 * @brief
+	 * Reads the bits of an entropy-coded segment, most significant
+	 * first, dropping the zero byte stuffed after each 0xFF.
+	 */
+	class BitReader
+	{
+	public:
+		/**
+		 * @param start
+		 *	First byte of the segment.
+		 * @param end
+		 *	Marker ending the segment.  Every 0xFF before end
+		 *	must be followed by a stuffed zero.
+		 */
+		BitReader(
+		    const uint8_t *start,
+		    const uint8_t *end) :
+		    _next(start),
+		    _end(end),
+		    _bits(0),
+		    _count(0)
+		{
+		}
+
+		/**
+		 * @return
+		 *	Number of bits available without another fill(),
+		 *	at least 57 unless the segment is exhausted.
+		 */
+		int
+		fill()
+		{
+			while ((this->_count <= 56) &&
+			    (this->_next < this->_end)) {
+				const uint8_t byte = *this->_next++;
+				if (byte == 0xFF)
+					this->_next++;
+				this->_bits |= static_cast<uint64_t>(byte) <<
+				    (56 - this->_count);
+				this->_count += 8;
+			}
+			return (this->_count);
+		}
+
+		/** @return The next count bits, which must be available */
+		uint32_t
+		peek(
+		    int count)
+		    const
+		{
+			return (static_cast<uint32_t>(this->_bits >>
+			    (64 - count)));
+		}
+
+		void
+		consume(
+		    int count)
+		{
+			this->_bits <<= count;
+			this->_count -= count;
+		}
+
+		/**
+		 * @throw Error::DataError
+		 *	The segment ends first.
+		 */
+		uint32_t
+		read(
+		    int count)
+		{
+			if (this->fill() < count)
+				throw BE::Error::DataError("WSQ block ends "
+				    "within a coefficient");
+			const uint32_t value = this->peek(count);
+			this->consume(count);
+			return (value);
+		}
+
+	private:
+		const uint8_t *_next;
+		const uint8_t *_end;
+		/** Unread bits, left-aligned */
+		uint64_t _bits;
+		/** Number of valid bits in _bits */
+		int _count;
+	};
+
+	/** Blocks threads until all have reached the same point */
+	class Barrier
+	{
+	public:
+		explicit Barrier(
+		    uint32_t count) :
+		    _count(count),
+		    _waiting(0),
+		    _generation(0)
+		{
+		}
+
+		void
+		wait()
+		{
+			if (this->_count == 1)
+				return;
+
+			std::unique_lock<std::mutex> lock(this->_mutex);
+			const uint64_t generation = this->_generation;
+			if (++this->_waiting == this->_count) {
+				this->_waiting = 0;
+				this->_generation++;
+				this->_cv.notify_all();
+				return;
+			}
+			this->_cv.wait(lock, [&]() {
+			    return (generation != this->_generation); });
+		}
+
+	private:
+		const uint32_t _count;
+		uint32_t _waiting;
+		uint64_t _generation;
+		std::mutex _mutex;
+		std::condition_variable _cv;
+	};
+
+	/** Shared state of the threads reconstructing an image */
+	struct Reconstruction
+	{
+		const WSQStream *stream;
+		/** Quantized coefficients, in subband order */
+		const int16_t *coefficients;
+		/** Index into coefficients of the first of each subband */
+		uint64_t subbandOffset[NUM_SUBBANDS];
+		/** Column plan of each node of the wavelet tree */
+		const SynthesisPlan *columnPlan[W_TREELEN];
+		/** Row plan of each node of the wavelet tree */
+		const SynthesisPlan *rowPlan[W_TREELEN];
+		/** Wavelet coefficients, and then reconstructed pixels */
+		float *image;
+		/** Image after each column transform */
+		float *columns;
+		uint32_t width;
+		uint32_t height;
+		uint8_t *buffer;
+		uint64_t stride;
+		uint32_t threadCount;
+		Barrier *barrier;
+	};
+}
+
+/**
+ * @brief
+ * Read the tables and frame header of a WSQ image and locate its
+ * entropy-coded blocks.
+ *
+ * @throw Error::DataError
+ *	Data is not a valid WSQ image.
+ */
+static void
+parseStream(
+    const uint8_t *data,
+    uint64_t size,
+    WSQStream &stream);
+
+/**
+ * @brief
+ * Read the table following marker into stream or dht.
+ *
+ * @throw Error::DataError
+ *	The table is invalid.
+ */
+static void
+readTable(
+    uint16_t marker,
+    WSQStream &stream,
+    std::vector<DHT_TABLE> &dht,
+    uint8_t **cbufptr,
+    uint8_t *ebufptr);
+
+/**
+ * @brief
+ * Build Huffman decoding tables from a WSQ DHT table.
+ *
+ * @throw Error::DataError
+ *	The table is invalid.
+ */
+static void
+buildHuffmanTable(
+    const DHT_TABLE &dht,
+    HuffmanTable &table);
+
+/**
+ * @brief
+ * Decode the quantized coefficients of one block.
+ *
+ * @return
+ *	Number of coefficients decoded.
+ *
+ * @throw Error::DataError
+ *	The block is invalid or decodes to more than capacity
+ *	coefficients.
+ */
+static uint64_t
+decodeBlock(
+    const EntropyBlock &block,
+    int16_t *coefficients,
+    uint64_t capacity);
+
+/**
+ * @brief
+ * Decode the quantized coefficients of every block, decoding the
+ * three standard blocks concurrently when threadCount allows.
+ */
+static void
+decodeCoefficients(
+    const WSQStream &stream,
+    uint32_t threadCount,
+    std::vector<int16_t> &coefficients);
+
+/**
+ * @brief
+ * Record the operations join_lets() performs on one line.
+ *
+ * @param length
+ *	Samples in the line.
+ * @param lowpass
+ *	Low-pass filter coefficients.
+ * @param lowpassSize
+ *	Number of low-pass coefficients.
+ * @param highpass
+ *	High-pass filter coefficients.
+ * @param highpassSize
+ *	Number of high-pass coefficients.
+ * @param inverted
+ *	Whether the high-pass subband precedes the low-pass subband.
+ *
+ * @throw Error::DataError
+ *	The line is too short for the filters.
+ */
+static SynthesisPlan
+buildSynthesisPlan(
+    int length,
+    const float *lowpass,
+    int lowpassSize,
+    const float *highpass,
+    int highpassSize,
+    bool inverted);
+
+/**
+ * @brief
+ * Apply a plan to Vectors * 4 adjacent lines.
+ *
+ * @param plan
+ *	Steps to apply.
+ * @param input
+ *	First sample of the first input line.
+ * @param inputStride
+ *	Floats between consecutive samples of a line.
+ * @param output
+ *	First sample of the first output line.
+ * @param outputStride
+ *	Floats between consecutive samples of a line.
+ */
+template<unsigned int Vectors>
+static void
+synthesizeLines(
+    const SynthesisPlan &plan,
+    const float *input,
+    uint64_t inputStride,
+    float *output,
+    uint64_t outputStride);
+
+/** Apply a plan to a single line */
+static void
+synthesizeLine(
+    const SynthesisPlan &plan,
+    const float *input,
+    uint64_t inputStride,
+    float *output,
+    uint64_t outputStride);
+
+/**
+ * @brief
+ * One thread's share of unquantizing, reconstructing, and converting
+ * an image.
+ *
+ * @param job
+ *	State shared by all threads.
+ * @param part
+ *	Index of this thread, from 0 to job.threadCount - 1.
+ */
+static void
+reconstructPart(
+    const Reconstruction &job,
+    uint32_t part);
+
+/** Split count items into parts, returning [first, last) of one part */
+static void
+splitRange(
+    uint64_t count,
+    uint32_t part,
+    uint32_t parts,
+    uint64_t &first,
+    uint64_t &last);
+
+void
+BiometricEvaluation::Image::WSQDecoder::decode(
+    const uint8_t *data,
+    uint64_t size,
+    const Size &dimensions,
+    uint8_t *buffer,
+    uint64_t stride,
+    uint32_t threadCount)
+{
+	WSQStream stream;
+	parseStream(data, size, stream);
+	if ((stream.frame.width != dimensions.xSize) ||
+	    (stream.frame.height != dimensions.ySize))
+		throw Error::DataError("WSQ frame header does not match "
+		    "decoded image");
+
+	const uint32_t width = stream.frame.width;
+	const uint32_t height = stream.frame.height;
+	const uint64_t pixels = static_cast<uint64_t>(width) * height;
+	threadCount = static_cast<uint32_t>(std::max<uint64_t>(1,
+	    std::min<uint64_t>(threadCount, pixels / MIN_PIXELS_PER_THREAD)));
+
+	std::vector<int16_t> coefficients;
+	decodeCoefficients(stream, threadCount, coefficients);
+
+	Reconstruction job;
+	job.stream = &stream;
+	job.coefficients = coefficients.data();
+	uint64_t offset = 0;
+	for (int subband = 0; subband < NUM_SUBBANDS; subband++) {
+		job.subbandOffset[subband] = offset;
+		if (stream.quantization.q_bin[subband] != 0.0)
+			offset += stream.qTree[subband].lenx *
+			    stream.qTree[subband].leny;
+	}
+
+	/* Nodes share line lengths, so share plans between them */
+	std::map<std::pair<int, bool>, SynthesisPlan> plans;
+	const auto planFor = [&](int length, bool inverted) ->
+	    const SynthesisPlan* {
+		const auto key = std::make_pair(length, inverted);
+		auto it = plans.find(key);
+		if (it == plans.end())
+			it = plans.emplace(key, buildSynthesisPlan(length,
+			    stream.transform.lofilt, stream.transform.losz,
+			    stream.transform.hifilt, stream.transform.hisz,
+			    inverted)).first;
+		return (&it->second);
+	};
+	for (int node = 0; node < W_TREELEN; node++) {
+		job.columnPlan[node] = planFor(stream.wTree[node].leny,
+		    stream.wTree[node].inv_cl != 0);
+		job.rowPlan[node] = planFor(stream.wTree[node].lenx,
+		    stream.wTree[node].inv_rw != 0);
+	}
+
+	Memory::AutoArray<float> image(pixels);
+	Memory::AutoArray<float> columns(pixels);
+	Barrier barrier(threadCount);
+	job.image = image;
+	job.columns = columns;
+	job.width = width;
+	job.height = height;
+	job.buffer = buffer;
+	job.stride = stride;
+	job.threadCount = threadCount;
+	job.barrier = &barrier;
+
+	std::vector<std::thread> threads;
+	for (uint32_t part = 1; part < threadCount; part++)
+		threads.emplace_back(reconstructPart, std::cref(job), part);
+	reconstructPart(job, 0);
+	for (auto &thread : threads)
+		thread.join();
+}
+
+static void
+parseStream(
+    const uint8_t *data,
+    uint64_t size,
+    WSQStream &stream)
+{
+	uint8_t *cbufptr = const_cast<uint8_t *>(data);
+	uint8_t *ebufptr = cbufptr + size;
+
+	/*
+	 * Block headers may name any of 256 tables, more than NBIS
+	 * provides room for.
+	 */
+	std::vector<DHT_TABLE> dht(256);
+	for (auto &table : dht)
+		table.tabdef = 0;
+
+	uint16_t marker;
+	if (getc_marker_wsq(&marker, SOI_WSQ, &cbufptr, ebufptr) != 0)
+		throw BE::Error::DataError("libwsq could not read to SOI_WSQ");
+	if (getc_marker_wsq(&marker, TBLS_N_SOF, &cbufptr, ebufptr) != 0)
+		throw BE::Error::DataError("libwsq could not read to "
+		    "TBLS_N_SOF");
+	while (marker != SOF_WSQ) {
+		readTable(marker, stream, dht, &cbufptr, ebufptr);
+		if (getc_marker_wsq(&marker, TBLS_N_SOF, &cbufptr,
+		    ebufptr) != 0)
+			throw BE::Error::DataError("libwsq could not read to "
+			    "TBLS_N_SOF");
+	}
+	if (getc_frame_header_wsq(&stream.frame, &cbufptr, ebufptr) != 0)
+		throw BE::Error::DataError("libwsq could not read frame "
+		    "header");
+	if ((stream.frame.width == 0) || (stream.frame.height == 0))
+		throw BE::Error::DataError("WSQ image has no pixels");
+	build_wsq_trees(stream.wTree, W_TREELEN, stream.qTree, Q_TREELEN,
+	    stream.frame.width, stream.frame.height);
+
+	/* Tables and blocks, up to the end of the image */
+	if (getc_marker_wsq(&marker, TBLS_N_SOB, &cbufptr, ebufptr) != 0)
+		throw BE::Error::DataError("libwsq could not read to "
+		    "TBLS_N_SOB");
+	while (marker != EOI_WSQ) {
+		if (marker != SOB_WSQ) {
+			readTable(marker, stream, dht, &cbufptr, ebufptr);
+			if (getc_marker_wsq(&marker, ANY_WSQ, &cbufptr,
+			    ebufptr) != 0)
+				throw BE::Error::DataError("libwsq could not "
+				    "read marker");
+			continue;
+		}
+
+		uint8_t tableID;
+		if (getc_block_header(&tableID, &cbufptr, ebufptr) != 0)
+			throw BE::Error::DataError("libwsq could not read "
+			    "block header");
+		if (dht[tableID].tabdef != 1)
+			throw BE::Error::DataError("WSQ block uses undefined "
+			    "Huffman table " + std::to_string(tableID));
+
+		stream.blocks.emplace_back();
+		EntropyBlock &block = stream.blocks.back();
+		buildHuffmanTable(dht[tableID], block.table);
+
+		/* Coded data runs to the first unstuffed 0xFF */
+		const uint8_t *p = cbufptr;
+		for (;;) {
+			if (p + 1 >= ebufptr)
+				throw BE::Error::DataError("WSQ block is not "
+				    "terminated");
+			if (p[0] != 0xFF)
+				p++;
+			else if (p[1] == 0x00)
+				p += 2;
+			else
+				break;
+		}
+		block.start = cbufptr;
+		block.end = p;
+
+		cbufptr = const_cast<uint8_t *>(p);
+		if (getc_marker_wsq(&marker, ANY_WSQ, &cbufptr, ebufptr) != 0)
+			throw BE::Error::DataError("libwsq could not read "
+			    "marker");
+	}
+
+	if (stream.quantization.dqt_def != 1)
+		throw BE::Error::DataError("WSQ quantization table not "
+		    "defined");
+	if ((stream.transform.lodef != 1) || (stream.transform.hidef != 1))
+		throw BE::Error::DataError("WSQ transform table not defined");
+}
+
+static void
+readTable(
+    uint16_t marker,
+    WSQStream &stream,
+    std::vector<DHT_TABLE> &dht,
+    uint8_t **cbufptr,
+    uint8_t *ebufptr)
+{
+	/*
+	 * libwsq frees the previous filters before reading new ones, and
+	 * frees the new ones on error without clearing the pointers, so
+	 * read into a separate table.
+	 */
+	DTT_TABLE transform;
+	std::memset(&transform, 0, sizeof(transform));
+	if (getc_table_wsq(marker, &transform, &stream.quantization,
+	    dht.data(), cbufptr, ebufptr) != 0)
+		throw BE::Error::DataError("libwsq could not read table");
+	if (marker == DTT_WSQ) {
+		std::free(stream.transform.lofilt);
+		std::free(stream.transform.hifilt);
+		stream.transform = transform;
+	}
+}
+
+static void
+buildHuffmanTable(
+    const DHT_TABLE &dht,
+    HuffmanTable &table)
+{
+	HUFFCODE *huffcodes;
+	int lastSize;
+	if (build_huffsizes(&huffcodes, &lastSize,
+	    const_cast<uint8_t *>(dht.huffbits), MAX_HUFFCOUNTS_WSQ) != 0)
+		throw BE::Error::DataError("libwsq could not build Huffman "
+		    "table");
+	build_huffcodes(huffcodes);
+	gen_decode_table(huffcodes, table.maxcode, table.mincode,
+	    table.valptr, const_cast<uint8_t *>(dht.huffbits));
+	std::free(huffcodes);
+	std::memcpy(table.values, dht.huffvalues, sizeof(table.values));
+
+	/* The first length whose largest code is not exceeded decodes */
+	for (uint32_t bits = 0; bits < (1 << HUFFMAN_LOOKUP_BITS); bits++) {
+		table.lookup[bits] = 0;
+		for (int length = 1; length <= HUFFMAN_LOOKUP_BITS; length++) {
+			const int code = bits >> (HUFFMAN_LOOKUP_BITS - length);
+			if (code > table.maxcode[length])
+				continue;
+
+			/* Invalid tables fall back to decodeSymbol() */
+			const int index = table.valptr[length] + code -
+			    table.mincode[length];
+			if ((index >= 0) && (index <= MAX_HUFFCOUNTS_WSQ))
+				table.lookup[bits] = (length << 8) |
+				    table.values[index];
+			break;
+		}
+	}
+}
+
+/**
+ * @brief
+ * Decode one Huffman code, as NBIS's decode_data_mem().
+ *
+ * @return
+ *	Decoded value, or -1 when the block ends before the code does.
+ *
+ * @throw Error::DataError
+ *	The code is invalid.
+ */
+static inline int
+decodeSymbol(
+    BitReader &reader,
+    const HuffmanTable &table)
+{
+	const int available = reader.fill();
+	if (available >= HUFFMAN_LOOKUP_BITS) {
+		const uint16_t entry = table.lookup[reader.peek(
+		    HUFFMAN_LOOKUP_BITS)];
+		if (entry != 0) {
+			reader.consume(entry >> 8);
+			return (entry & 0xFF);
+		}
+	}
+
+	/* Long code, or the end of the block is near */
+	for (int length = 1; length <= MAX_HUFFBITS; length++) {
+		if (available < length)
+			return (-1);
+		const int code = reader.peek(length);
+		if (code > table.maxcode[length])
+			continue;
+
+		const int index = table.valptr[length] + code -
+		    table.mincode[length];
+		if ((index < 0) || (index > MAX_HUFFCOUNTS_WSQ))
+			break;
+		reader.consume(length);
+		return (table.values[index]);
+	}
+	throw BE::Error::DataError("Invalid WSQ Huffman code");
+}
+
+static uint64_t
+decodeBlock(
+    const EntropyBlock &block,
+    int16_t *coefficients,
+    uint64_t capacity)
+{
+	BitReader reader(block.start, block.end);
+	uint64_t count = 0;
+	for (;;) {
+		const int symbol = decodeSymbol(reader, block.table);
+		if (symbol == -1)
+			return (count);
+
+		/* Categories as in NBIS's huffman_decode_data_mem() */
+		uint32_t run = 0;
+		int32_t value;
+		if ((symbol > 0) && (symbol <= 100)) {
+			run = symbol;
+		} else if ((symbol > 106) && (symbol < 0xFF)) {
+			value = symbol - 180;
+		} else {
+			switch (symbol) {
+			case 101:
+				value = reader.read(8);
+				break;
+			case 102:
+				value = -static_cast<int32_t>(reader.read(8));
+				break;
+			case 103:
+				value = reader.read(16);
+				break;
+			case 104:
+				value = -static_cast<int32_t>(reader.read(16));
+				break;
+			case 105:
+				run = reader.read(8);
+				break;
+			case 106:
+				run = reader.read(16);
+				break;
+			default:
+				throw BE::Error::DataError("Invalid WSQ "
+				    "Huffman value " + std::to_string(symbol));
+			}
+		}
+
+		if ((symbol <= 100) || (symbol == 105) || (symbol == 106)) {
+			if (run > (capacity - count))
+				throw BE::Error::DataError("WSQ block decodes "
+				    "past the end of the image");
+			std::fill_n(coefficients + count, run, 0);
+			count += run;
+		} else {
+			if (count == capacity)
+				throw BE::Error::DataError("WSQ block decodes "
+				    "past the end of the image");
+			coefficients[count++] = static_cast<int16_t>(value);
+		}
+	}
+}
+
+static void
+decodeCoefficients(
+    const WSQStream &stream,
+    uint32_t threadCount,
+    std::vector<int16_t> &coefficients)
+{
+	uint64_t total = 0;
+	for (int subband = 0; subband < NUM_SUBBANDS; subband++)
+		if (stream.quantization.q_bin[subband] != 0.0)
+			total += stream.qTree[subband].lenx *
+			    stream.qTree[subband].leny;
+	/* Coefficients not coded are zero */
+	coefficients.assign(total, 0);
+
+	/*
+	 * Standard images have three blocks of known size, which can be
+	 * decoded independently.
+	 */
+	int qsize[3];
+	quant_block_sizes2(&qsize[0], &qsize[1], &qsize[2],
+	    &stream.quantization, const_cast<W_TREE *>(stream.wTree),
+	    W_TREELEN, const_cast<Q_TREE *>(stream.qTree), Q_TREELEN);
+	if ((threadCount > 1) && (stream.blocks.size() == 3) &&
+	    (static_cast<uint64_t>(qsize[0]) + qsize[1] + qsize[2] == total)) {
+		uint64_t offset[3] = {0, static_cast<uint64_t>(qsize[0]),
+		    static_cast<uint64_t>(qsize[0]) + qsize[1]};
+		uint64_t count[3] = {0, 0, 0};
+		std::exception_ptr error[3];
+		const auto decodeOne = [&](int i) {
+			try {
+				count[i] = decodeBlock(stream.blocks[i],
+				    coefficients.data() + offset[i], qsize[i]);
+			} catch (...) {
+				error[i] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < 3; i++)
+			threads.emplace_back(decodeOne, i);
+		decodeOne(0);
+		for (auto &thread : threads)
+			thread.join();
+
+		bool decoded = true;
+		for (int i = 0; i < 3; i++)
+			if (error[i] || (count[i] != static_cast<uint64_t>(
+			    qsize[i])))
+				decoded = false;
+		if (decoded)
+			return;
+
+		/* Blocks split elsewhere are decoded one after another */
+		std::fill(coefficients.begin(), coefficients.end(), 0);
+	}
+
+	uint64_t count = 0;
+	for (const auto &block : stream.blocks)
+		count += decodeBlock(block, coefficients.data() + count,
+		    total - count);
+}
+
+static SynthesisPlan
+buildSynthesisPlan(
+    int length,
+    const float *lowpass,
+    int lowpassSize,
+    const float *highpass,
+    int highpassSize,
+    bool inverted)
+{
+	/*
+	 * This follows NBIS's join_lets() statement for statement, with
+	 * pointers replaced by sample indices and arithmetic replaced by
+	 * recorded steps.
+	 */
+	SynthesisPlan plan;
+	const auto step = [&](int output, int input, float coefficient,
+	    StepKind kind) {
+		if ((output < 0) || (output >= length) || (input < 0) ||
+		    (input >= length))
+			throw BE::Error::DataError("WSQ subband too small "
+			    "for transform filters");
+		plan.push_back({static_cast<uint32_t>(output),
+		    static_cast<uint32_t>(input), coefficient, kind});
+	};
+	const int lsz = lowpassSize;
+	const int hsz = highpassSize;
+	const float *lo = lowpass;
+	std::vector<float> hi(highpass, highpass + hsz);
+
+	const int da_ev = length % 2;
+	const int fi_ev = lsz % 2;
+	const int pstr = 1;
+	const int nstr = -1;
+	int llen, hlen;
+	if (da_ev) {
+		llen = (length + 1) / 2;
+		hlen = llen - 1;
+	} else {
+		llen = length / 2;
+		hlen = llen;
+	}
+
+	int asym, ofhre, loc, hoc, lotap, hotap, olle, olre, ohle, ohre;
+	float ssfac;
+	if (fi_ev) {
+		asym = 0;
+		ssfac = 1.0;
+		ofhre = 0;
+		loc = (lsz - 1) / 4;
+		hoc = (hsz + 1) / 4 - 1;
+		lotap = ((lsz - 1) / 2) % 2;
+		hotap = ((hsz + 1) / 2) % 2;
+		if (da_ev) {
+			olle = 0;
+			olre = 0;
+			ohle = 1;
+			ohre = 1;
+		} else {
+			olle = 0;
+			olre = 1;
+			ohle = 1;
+			ohre = 0;
+		}
+	} else {
+		asym = 1;
+		ssfac = -1.0;
+		ofhre = 2;
+		loc = lsz / 4 - 1;
+		hoc = hsz / 4 - 1;
+		lotap = (lsz / 2) % 2;
+		hotap = (hsz / 2) % 2;
+		if (da_ev) {
+			olle = 1;
+			olre = 0;
+			ohle = 1;
+			ohre = 1;
+		} else {
+			olle = 1;
+			olre = 1;
+			ohle = 1;
+			ohre = 1;
+		}
+		if (loc == -1) {
+			loc = 0;
+			olle = 0;
+		}
+		if (hoc == -1) {
+			hoc = 0;
+			ohle = 0;
+		}
+		for (int i = 0; i < hsz; i++)
+			hi[i] *= -1.0;
+	}
+
+	int limg = 0;
+	int himg = limg;
+	/* join_lets() clears two samples, even of a one-sample line */
+	step(himg, 0, 0, StepKind::Zero);
+	if (length > 1)
+		step(himg + 1, 0, 0, StepKind::Zero);
+	int lopass, hipass;
+	if (inverted) {
+		hipass = 0;
+		lopass = hipass + hlen;
+	} else {
+		lopass = 0;
+		hipass = lopass + llen;
+	}
+
+	const int lp0 = lopass;
+	const int lp1 = lp0 + (llen - 1);
+	int lspx = lp0 + loc;
+	int lspxstr = nstr;
+	int lstap = lotap;
+	int lle2 = olle;
+	int lre2 = olre;
+
+	const int hp0 = hipass;
+	const int hp1 = hp0 + (hlen - 1);
+	int hspx = hp0 + hoc;
+	int hspxstr = nstr;
+	int hstap = hotap;
+	int hle2 = ohle;
+	int hre2 = ohre;
+	float osfac = ssfac;
+
+	int lle, lre, lpx, lpxstr, hle, hre, hpx, hpxstr, fhre = 0;
+	float sfac;
+	for (int pix = 0; pix < hlen; pix++) {
+		for (int tap = lstap; tap >= 0; tap--) {
+			lle = lle2;
+			lre = lre2;
+			lpx = lspx;
+			lpxstr = lspxstr;
+
+			step(limg, lpx, lo[tap], StepKind::Assign);
+			for (int i = tap + 2; i < lsz; i += 2) {
+				if (lpx == lp0) {
+					if (lle) {
+						lpxstr = 0;
+						lle = 0;
+					} else
+						lpxstr = pstr;
+				}
+				if (lpx == lp1) {
+					if (lre) {
+						lpxstr = 0;
+						lre = 0;
+					} else
+						lpxstr = nstr;
+				}
+				lpx += lpxstr;
+				step(limg, lpx, lo[i], StepKind::Accumulate);
+			}
+			limg++;
+		}
+		if (lspx == lp0) {
+			if (lle2) {
+				lspxstr = 0;
+				lle2 = 0;
+			} else
+				lspxstr = pstr;
+		}
+		lspx += lspxstr;
+		lstap = 1;
+
+		for (int tap = hstap; tap >= 0; tap--) {
+			hle = hle2;
+			hre = hre2;
+			hpx = hspx;
+			hpxstr = hspxstr;
+			fhre = ofhre;
+			sfac = osfac;
+
+			for (int i = tap; i < hsz; i += 2) {
+				if (hpx == hp0) {
+					if (hle) {
+						hpxstr = 0;
+						hle = 0;
+					} else {
+						hpxstr = pstr;
+						sfac = 1.0;
+					}
+				}
+				if (hpx == hp1) {
+					if (hre) {
+						hpxstr = 0;
+						hre = 0;
+						if (asym && da_ev) {
+							hre = 1;
+							fhre--;
+							sfac = (float)fhre;
+							if (sfac == 0.0)
+								hre = 0;
+						}
+					} else {
+						hpxstr = nstr;
+						if (asym)
+							sfac = -1.0;
+					}
+				}
+				/*
+				 * sfac is 0 or +/-1, so folding it into
+				 * the coefficient does not change the sum.
+				 */
+				step(himg, hpx, hi[i] * sfac,
+				    StepKind::Accumulate);
+				hpx += hpxstr;
+			}
+			himg++;
+		}
+		if (hspx == hp0) {
+			if (hle2) {
+				hspxstr = 0;
+				hle2 = 0;
+			} else {
+				hspxstr = pstr;
+				osfac = 1.0;
+			}
+		}
+		hspx += hspxstr;
+		hstap = 1;
+	}
+
+	if (da_ev)
+		lstap = lotap ? 1 : 0;
+	else
+		lstap = lotap ? 2 : 1;
+	for (int tap = 1; tap >= lstap; tap--) {
+		lle = lle2;
+		lre = lre2;
+		lpx = lspx;
+		lpxstr = lspxstr;
+
+		step(limg, lpx, lo[tap], StepKind::Assign);
+		for (int i = tap + 2; i < lsz; i += 2) {
+			if (lpx == lp0) {
+				if (lle) {
+					lpxstr = 0;
+					lle = 0;
+				} else
+					lpxstr = pstr;
+			}
+			if (lpx == lp1) {
+				if (lre) {
+					lpxstr = 0;
+					lre = 0;
+				} else
+					lpxstr = nstr;
+			}
+			lpx += lpxstr;
+			step(limg, lpx, lo[i], StepKind::Accumulate);
+		}
+		limg++;
+	}
+
+	if (da_ev) {
+		hstap = hotap ? 1 : 0;
+		if (hsz == 2) {
+			hspx -= hspxstr;
+			fhre = 1;
+		}
+	} else
+		hstap = hotap ? 2 : 1;
+	for (int tap = 1; tap >= hstap; tap--) {
+		hle = hle2;
+		hre = hre2;
+		hpx = hspx;
+		hpxstr = hspxstr;
+		sfac = osfac;
+		if (hsz != 2)
+			fhre = ofhre;
+
+		for (int i = tap; i < hsz; i += 2) {
+			if (hpx == hp0) {
+				if (hle) {
+					hpxstr = 0;
+					hle = 0;
+				} else {
+					hpxstr = pstr;
+					sfac = 1.0;
+				}
+			}
+			if (hpx == hp1) {
+				if (hre) {
+					hpxstr = 0;
+					hre = 0;
+					if (asym && da_ev) {
+						hre = 1;
+						fhre--;
+						sfac = (float)fhre;
+						if (sfac == 0.0)
+							hre = 0;
+					}
+				} else {
+					hpxstr = nstr;
+					if (asym)
+						sfac = -1.0;
+				}
+			}
+			step(himg, hpx, hi[i] * sfac, StepKind::Accumulate);
+			hpx += hpxstr;
+		}
+		himg++;
+	}
+
+	return (plan);
+}
+
+template<unsigned int Vectors>
+static void
+synthesizeLines(
+    const SynthesisPlan &plan,
+    const float *input,
+    uint64_t inputStride,
+    float *output,
+    uint64_t outputStride)
+{
+	FloatVector v[Vectors];
+	for (const auto &step : plan) {
+		float *out = output + (step.output * outputStride);
+		const float *in = input + (step.input * inputStride);
+		switch (step.kind) {
+		case StepKind::Zero:
+			for (unsigned int i = 0; i < Vectors; i++)
+				storeVector(out + (i * 4), splatVector(0));
+			break;
+		case StepKind::Assign:
+			for (unsigned int i = 0; i < Vectors; i++)
+				storeVector(out + (i * 4), multiplyVectors(
+				    loadVector(in + (i * 4)),
+				    splatVector(step.coefficient)));
+			break;
+		case StepKind::Accumulate:
+			for (unsigned int i = 0; i < Vectors; i++)
+				v[i] = multiplyVectors(loadVector(in + (i * 4)),
+				    splatVector(step.coefficient));
+			for (unsigned int i = 0; i < Vectors; i++)
+				storeVector(out + (i * 4), addVectors(
+				    loadVector(out + (i * 4)), v[i]));
+			break;
+		}
+	}
+}
+
+static void
+synthesizeLine(
+    const SynthesisPlan &plan,
+    const float *input,
+    uint64_t inputStride,
+    float *output,
+    uint64_t outputStride)
+{
+	for (const auto &step : plan) {
+		float &out = output[step.output * outputStride];
+		const float in = input[step.input * inputStride];
+		switch (step.kind) {
+		case StepKind::Zero:
+			out = 0;
+			break;
+		case StepKind::Assign:
+			out = in * step.coefficient;
+			break;
+		case StepKind::Accumulate:
+			out += in * step.coefficient;
+			break;
+		}
+	}
+}
+
+static void
+reconstructPart(
+    const Reconstruction &job,
+    uint32_t part)
+{
+	const WSQStream &stream = *job.stream;
+	const uint32_t width = job.width;
+	uint64_t first, last;
+
+	/* Subbands not coded, and any area outside subbands, are zero */
+	splitRange(job.height, part, job.threadCount, first, last);
+	std::fill(job.image + (first * width), job.image + (last * width),
+	    0.0f);
+	job.barrier->wait();
+
+	/* Unquantize, as NBIS's unquantize() */
+	const float C = stream.quantization.bin_center;
+	for (int subband = 0; subband < NUM_SUBBANDS; subband++) {
+		const float q = stream.quantization.q_bin[subband];
+		if (q == 0.0)
+			continue;
+		const double halfZ = stream.quantization.z_bin[subband] / 2.0;
+		const Q_TREE &tree = stream.qTree[subband];
+
+		splitRange(tree.leny, part, job.threadCount, first, last);
+		for (uint64_t row = first; row < last; row++) {
+			const int16_t *s = job.coefficients +
+			    job.subbandOffset[subband] + (row * tree.lenx);
+			float *f = job.image + ((tree.y + row) * width) +
+			    tree.x;
+			for (int col = 0; col < tree.lenx; col++) {
+				if (s[col] == 0)
+					f[col] = 0.0;
+				else if (s[col] > 0)
+					f[col] = (q * ((float)s[col] - C)) +
+					    halfZ;
+				else
+					f[col] = (q * ((float)s[col] + C)) -
+					    halfZ;
+			}
+		}
+	}
+	job.barrier->wait();
+
+	/* Inverse transform, as NBIS's wsq_reconstruct() */
+	const uint32_t lanes = SYNTHESIS_LANES;
+	std::vector<float> rowsIn(static_cast<uint64_t>(width) * lanes, 0);
+	std::vector<float> rowsOut(rowsIn.size(), 0);
+	for (int node = W_TREELEN - 1; node >= 0; node--) {
+		const W_TREE &tree = stream.wTree[node];
+		float *base = job.image + (tree.y * width) + tree.x;
+
+		/* Columns, lanes at a time, straight from the image */
+		const SynthesisPlan &columnPlan = *job.columnPlan[node];
+		splitRange((tree.lenx + lanes - 1) / lanes, part,
+		    job.threadCount, first, last);
+		uint64_t col = first * lanes;
+		const uint64_t lastCol = std::min<uint64_t>(last * lanes,
+		    tree.lenx);
+		for (; col + lanes <= lastCol; col += lanes)
+			synthesizeLines<SYNTHESIS_LANES / 4>(columnPlan,
+			    base + col, width, job.columns + col, width);
+		for (; col + 4 <= lastCol; col += 4)
+			synthesizeLines<1>(columnPlan, base + col, width,
+			    job.columns + col, width);
+		for (; col < lastCol; col++)
+			synthesizeLine(columnPlan, base + col, width,
+			    job.columns + col, width);
+		job.barrier->wait();
+
+		/* Rows, lanes at a time, through transposed copies */
+		const SynthesisPlan &rowPlan = *job.rowPlan[node];
+		splitRange(tree.leny, part, job.threadCount, first, last);
+		for (uint64_t row = first; row < last; row += lanes) {
+			const uint32_t count = std::min<uint64_t>(lanes,
+			    last - row);
+			for (uint32_t lane = 0; lane < count; lane++) {
+				const float *in = job.columns +
+				    ((row + lane) * width);
+				for (int i = 0; i < tree.lenx; i++)
+					rowsIn[(i * lanes) + lane] = in[i];
+			}
+			synthesizeLines<SYNTHESIS_LANES / 4>(rowPlan,
+			    rowsIn.data(), lanes, rowsOut.data(), lanes);
+			for (uint32_t lane = 0; lane < count; lane++) {
+				float *out = base + ((row + lane) * width);
+				for (int i = 0; i < tree.lenx; i++)
+					out[i] = rowsOut[(i * lanes) + lane];
+			}
+		}
+		job.barrier->wait();
+	}
+
+	/* Convert to 8-bit pixels, as NBIS's conv_img_2_uchar() */
+	const float m_shift = stream.frame.m_shift;
+	const float r_scale = stream.frame.r_scale;
+	splitRange(job.height, part, job.threadCount, first, last);
+	for (uint64_t row = first; row < last; row++) {
+		const float *img = job.image + (row * width);
+		uint8_t *data = job.buffer + (row * job.stride);
+		for (uint32_t col = 0; col < width; col++) {
+			float img_tmp = (img[col] * r_scale) + m_shift;
+			img_tmp += 0.5;
+			if (img_tmp < 0.0)
+				data[col] = 0;
+			else if (img_tmp > 255.0)
+				data[col] = 255;
+			else
+				data[col] = (uint8_t)img_tmp;
+		}
+	}
+}
+
+static void
+splitRange(
+    uint64_t count,
+    uint32_t part,
+    uint32_t parts,
+    uint64_t &first,
+    uint64_t &last)
+{
+	first = (count * part) / parts;
+	last = (count * (part + 1)) / parts;
+}
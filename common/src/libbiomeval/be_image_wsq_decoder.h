@@ -0,0 +1,69 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IMAGE_WSQ_DECODER_H__
+#define __BE_IMAGE_WSQ_DECODER_H__
+
+#include <cstdint>
+
+#include <be_image.h>
+
+namespace BiometricEvaluation
+{
+	namespace Image
+	{
+		/**
+		 * @brief
+		 * Reentrant, multithreaded WSQ decoding.
+		 * @details
+		 * Performs the same floating point operations, in the same
+		 * order, as the NBIS decoder (wsq_decode_mem()), so decoded
+		 * pixels match those from NBIS.  Unlike NBIS, all state is
+		 * local to the decode, the entropy-coded blocks are decoded
+		 * concurrently, and the inverse wavelet transform is split
+		 * among threads and runs several rows or columns at once
+		 * with SIMD instructions.
+		 */
+		namespace WSQDecoder
+		{
+			/**
+			 * @brief
+			 * Decode a WSQ image into 8-bit grayscale pixels.
+			 *
+			 * @param data
+			 *	WSQ data.
+			 * @param size
+			 *	Size of data, in bytes.
+			 * @param dimensions
+			 *	Dimensions the frame header must describe.
+			 * @param buffer
+			 *	Where the first row of pixels is written.
+			 * @param stride
+			 *	Bytes between the start of rows in buffer.
+			 * @param threadCount
+			 *	Most threads to decode with.
+			 *
+			 * @throw Error::DataError
+			 *	data is not a valid WSQ image with the expected
+			 *	dimensions.
+			 */
+			void
+			decode(
+			    const uint8_t *data,
+			    uint64_t size,
+			    const Size &dimensions,
+			    uint8_t *buffer,
+			    uint64_t stride,
+			    uint32_t threadCount);
+		}
+	}
+}
+
+#endif /* __BE_IMAGE_WSQ_DECODER_H__ */
@@ -14,6 +14,8 @@ const std::string BiometricEvaluation::IO::ArchiveRecordStore::
     MANIFEST_FILE_NAME{"manifest"};
 const std::string BiometricEvaluation::IO::ArchiveRecordStore::
     ARCHIVE_FILE_NAME{"archive"};
+const uint64_t BiometricEvaluation::IO::ArchiveRecordStore::
+    DEFAULT_COMPACTION_SEGMENT_SIZE{64 * 1024 * 1024};
 
 BiometricEvaluation::IO::ArchiveRecordStore::ArchiveRecordStore(
     const std::string &pathname,
@@ -82,6 +84,15 @@ BiometricEvaluation::IO::ArchiveRecordStore::read(
 	return (this->pimpl->read(key));
 }
 
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ArchiveRecordStore::readPrefix(
+    const std::string &key,
+    uint64_t size)
+    const
+{
+	return (this->pimpl->readPrefix(key, size));
+}
+
 uint64_t
 BiometricEvaluation::IO::ArchiveRecordStore::length(
     const std::string &key)
@@ -147,6 +158,20 @@ BiometricEvaluation::IO::ArchiveRecordStore::changeDescription(
 	return (this->pimpl->changeDescription(description));
 }
 
+void
+BiometricEvaluation::IO::ArchiveRecordStore::adviseSequentialRead(
+    unsigned int records)
+{
+	this->pimpl->adviseSequentialRead(records);
+}
+
+std::vector<std::shared_ptr<BiometricEvaluation::IO::RecordStore::Partition>>
+BiometricEvaluation::IO::ArchiveRecordStore::partition(
+    unsigned int count)
+{
+	return (this->pimpl->partition(count));
+}
+
 bool
 BiometricEvaluation::IO::ArchiveRecordStore::needsVacuum()
 {
@@ -167,6 +192,67 @@ BiometricEvaluation::IO::ArchiveRecordStore::vacuum(
 	return (IO::ArchiveRecordStore::Impl::vacuum(pathname));
 }
 
+void
+BiometricEvaluation::IO::ArchiveRecordStore::mergeArchives(
+    const std::string &mergePathname,
+    const std::string &description,
+    const std::vector<std::string> &pathnames)
+{
+	return (IO::ArchiveRecordStore::Impl::mergeArchives(mergePathname,
+	    description, pathnames));
+}
+
+uint64_t
+BiometricEvaluation::IO::ArchiveRecordStore::getDeadSpace()
+    const
+{
+	return (this->pimpl->getDeadSpace());
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::compact(
+    uint64_t segmentSize,
+    const CompactionCallback &callback)
+{
+	this->pimpl->compact(segmentSize, callback);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::startCompaction(
+    uint64_t segmentSize,
+    const CompactionCallback &callback)
+{
+	this->pimpl->startCompaction(segmentSize, callback);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::waitForCompaction()
+{
+	this->pimpl->waitForCompaction();
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::cancelCompaction()
+{
+	this->pimpl->cancelCompaction();
+}
+
+bool
+BiometricEvaluation::IO::ArchiveRecordStore::isCompacting()
+    const
+{
+	return (this->pimpl->isCompacting());
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::setAutoCompaction(
+    double threshold,
+    uint64_t segmentSize,
+    const CompactionCallback &callback)
+{
+	this->pimpl->setAutoCompaction(threshold, segmentSize, callback);
+}
+
 std::string
 BiometricEvaluation::IO::ArchiveRecordStore::getArchiveName() const
 {
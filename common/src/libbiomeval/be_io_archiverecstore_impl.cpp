@@ -12,14 +12,19 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 
+#include <fcntl.h>
+
 #include <unistd.h>
 
 #include <algorithm>
 #include <cerrno>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include <be_error.h>
 #include <be_io_utility.h>
@@ -29,12 +34,70 @@
 
 namespace BE = BiometricEvaluation;
 
+namespace
+{
+	/** Largest chunk of a record copied at once during compaction */
+	const uint64_t COMPACTION_BUFFER_SIZE = 1024 * 1024;
+
+	/** Largest chunk of an archive copied at once when merging */
+	const uint64_t MERGE_BUFFER_SIZE = 8 * 1024 * 1024;
+
+	/** pread() exactly size bytes */
+	void
+	readFully(
+	    int fd,
+	    uint8_t *buf,
+	    uint64_t size,
+	    uint64_t offset)
+	{
+		uint64_t total = 0;
+		while (total < size) {
+			ssize_t rv = pread(fd, buf + total, size - total,
+			    offset + total);
+			if (rv == -1) {
+				if (errno == EINTR)
+					continue;
+				throw BE::Error::StrategyError("Archive cannot "
+				    "read (" + BE::Error::errorStr() + ")");
+			}
+			if (rv == 0)
+				throw BE::Error::StrategyError("Archive cannot "
+				    "read (unexpected end of file)");
+			total += rv;
+		}
+	}
+
+	/** pwrite() exactly size bytes */
+	void
+	writeFully(
+	    int fd,
+	    const uint8_t *buf,
+	    uint64_t size,
+	    uint64_t offset)
+	{
+		uint64_t total = 0;
+		while (total < size) {
+			ssize_t rv = pwrite(fd, buf + total, size - total,
+			    offset + total);
+			if (rv == -1) {
+				if (errno == EINTR)
+					continue;
+				throw BE::Error::StrategyError("Archive cannot "
+				    "write (" + BE::Error::errorStr() + ")");
+			}
+			total += rv;
+		}
+	}
+}
+
 BiometricEvaluation::IO::ArchiveRecordStore::Impl::Impl(
     const std::string &pathname,
     const std::string &description) :
-    RecordStore::Impl(pathname, description, RecordStore::Kind::Archive)
+    RecordStore::Impl(pathname, description, RecordStore::Kind::Archive),
+    _archivefd(-1),
+    _archiveUnflushed(false)
 {
-	_dirty = false;
+	this->init();
 
 	try {
 		this->open_streams();
@@ -46,12 +109,25 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::Impl(
 BiometricEvaluation::IO::ArchiveRecordStore::Impl::Impl(
     const std::string &pathname,
     IO::Mode mode) :
-    RecordStore::Impl(pathname, mode)
+    RecordStore::Impl(pathname, mode),
+    _archivefd(-1),
+    _archiveUnflushed(false)
 {
-	_dirty = false;
+	this->init();
 
 	try {
 		this->open_streams();
+	} catch (Error::FileError &e) {
+		throw Error::StrategyError(e.what());
+	}
+
+	struct stat sb;
+	if (fstat(_archivefd, &sb) != 0)
+		throw Error::StrategyError("Could not stat archive (" +
+		    Error::errorStr() + ")");
+	_archiveSize = sb.st_size;
+
+	try {
 		read_manifest();
 	} catch (Error::ConversionError &e) {
 		throw Error::StrategyError(e.what());
@@ -62,6 +138,12 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::Impl(
 
 BiometricEvaluation::IO::ArchiveRecordStore::Impl::~Impl()
 {
+	try {
+		this->cancelCompaction();
+	} catch (...) {
+		/* The compaction left the store consistent */
+	}
+
 	try {
 		close_streams();
 	} catch (Error::StrategyError &e) {
@@ -71,6 +153,24 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::~Impl()
 		 * detail on our behalf.
 		 */
 	}
+
+	pthread_rwlock_destroy(&_lock);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::init()
+{
+	_dirty = false;
+	_manifestHasRemovals = false;
+	_archiveSize = 0;
+	_liveBytes = 0;
+	_compacting = false;
+	_cancelCompaction = false;
+	_autoCompactThreshold = 0;
+	_autoCompactSegmentSize = DEFAULT_COMPACTION_SEGMENT_SIZE;
+
+	if (pthread_rwlock_init(&_lock, nullptr) != 0)
+		throw Error::StrategyError("Could not create archive lock");
 }
 
 void
@@ -133,6 +233,14 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::open_streams()
 		if (!_archivefp || (_archivefp.is_open() == false))
 			throw Error::FileError("Could not open archive");
 	}
+
+	if (_archivefd == -1) {
+		_archivefd = open(canonicalName(ARCHIVE_FILE_NAME).c_str(),
+		    O_RDONLY);
+		if (_archivefd == -1)
+			throw Error::FileError("Could not open archive (" +
+			    Error::errorStr() + ")");
+	}
 		
 	_archivefp.clear();
 	_manifestfp.clear();
@@ -156,6 +264,15 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::close_streams()
 			throw Error::StrategyError("Could not close archive");
 	}
 	_archivefp.clear();
+	_archiveUnflushed = false;
+
+	if (_archivefd != -1) {
+		int rv = close(_archivefd);
+		_archivefd = -1;
+		if (rv != 0)
+			throw Error::StrategyError("Could not close archive "
+			    "descriptor (" + Error::errorStr() + ")");
+	}
 }
 
 uint64_t
@@ -166,7 +283,12 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::getSpaceUsed()
 	uint64_t total;
 
 	total = RecordStore::Impl::getSpaceUsed();
-	sync();
+	if (getMode() == Mode::ReadWrite) {
+		ScopedRWLock lock(&_lock, true);
+		this->flush_archive();
+		_manifestfp.clear();
+		_manifestfp.flush();
+	}
 	if (stat(canonicalName(MANIFEST_FILE_NAME).c_str(), &sb) != 0)
 		throw Error::StrategyError("Could not find manifest file");
 	total += sb.st_blocks * S_BLKSIZE;
@@ -185,20 +307,38 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::sync()
 	if (getMode() == Mode::ReadOnly)
 		return;
 
-	RecordStore::Impl::sync();
-	if (_manifestfp.is_open()) {
-		_manifestfp.clear();
-		_manifestfp.sync();
-		if (!_manifestfp)
-			throw Error::StrategyError("Could not sync manifest");
-	}
+	ScopedRWLock lock(&_lock, true);
 
+	/* Data first, so the manifest never names data that was lost */
 	if (_archivefp.is_open()) {
 		_archivefp.clear();
-		_archivefp.sync();
+		_archivefp.flush();
 		if (!_archivefp)
 			throw Error::StrategyError("Could not sync archive");
+		_archiveUnflushed = false;
 	}
+	if ((_archivefd != -1) && (fsync(_archivefd) != 0))
+		throw Error::StrategyError("Could not sync archive (" +
+		    Error::errorStr() + ")");
+
+	if (_manifestfp.is_open()) {
+		_manifestfp.clear();
+		_manifestfp.flush();
+		if (!_manifestfp)
+			throw Error::StrategyError("Could not sync manifest");
+		const int manifestfd = open(canonicalName(
+		    MANIFEST_FILE_NAME).c_str(), O_RDONLY);
+		if (manifestfd == -1)
+			throw Error::StrategyError("Could not open manifest (" +
+			    Error::errorStr() + ")");
+		const int rv = fsync(manifestfd);
+		close(manifestfd);
+		if (rv != 0)
+			throw Error::StrategyError("Could not sync manifest (" +
+			    Error::errorStr() + ")");
+	}
+
+	RecordStore::Impl::sync();
 }
 
 uint64_t
@@ -208,6 +348,7 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::length(
 {
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
 	const std::shared_ptr<ManifestMap::value_type> entry =
 	    _entries.find_quick(key);
 	if ((entry.get() == nullptr) ||
@@ -233,38 +374,127 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::read_manifest()
 	if (!_manifestfp)
 		throw Error::FileError("Could not rewind manifest");
 		
+	/*
+	 * A process that stopped between syncs can leave a partial last
+	 * line, or entries for data that never reached the archive.
+	 * Manifest pages may reach the disk before archive pages, so
+	 * later entries (such as removals) can follow such an entry.
+	 * Everything from the first invalid entry on is discarded.
+	 */
+	uint64_t position = 0;
+	uint64_t validEnd = 0;
+	bool damaged = false;
+	uint64_t count = 0;
 	std::vector<std::string> pieces;
 	for (;;) {
 		getline(_manifestfp, linebuf);
-		if (_manifestfp.eof())
+		if (_manifestfp.eof()) {
+			if (!linebuf.empty())
+				damaged = true;
 			break;
+		}
 		if (!_manifestfp)
 			throw Error::FileError("Error reading entry from "
 			    "manifest.");
+		position += linebuf.size() + 1;
 		
 		pieces = Text::split(linebuf, ' ');
-		if (pieces.size() < 3)
-			throw Error::FileError(linebuf);
-		key.clear();
-		for (size_t i = 0; i < pieces.size() - 2; i++) {
-			if (i != 0 && key.empty() == false)
-				key += ' ';
-			key += pieces[i];
+		bool valid = (pieces.size() >= 3);
+		if (valid) {
+			key.clear();
+			for (size_t i = 0; i < pieces.size() - 2; i++) {
+				if (i != 0 && key.empty() == false)
+					key += ' ';
+				key += pieces[i];
+			}
+
+			char *end;
+			const char *field = pieces[pieces.size() - 2].c_str();
+			errno = 0;
+			entry.size = (uint64_t)strtoll(field, &end, 10);
+			if (errno == ERANGE)
+				throw Error::ConversionError("Value out of "
+				    "range");
+			valid = ((*field != '\0') && (*end == '\0'));
+
+			field = pieces[pieces.size() - 1].c_str();
+			entry.offset = (long)strtol(field, &end, 10);
+			if (errno == ERANGE)
+				throw Error::ConversionError("Value out of "
+				    "range");
+			valid = valid && (*field != '\0') && (*end == '\0') &&
+			    ((entry.offset == OFFSET_RECORD_REMOVED) ||
+			    ((entry.offset >= 0) &&
+			    ((entry.offset + entry.size) <= _archiveSize)));
+		}
+		if (!valid) {
+			damaged = true;
+			break;
 		}
-		
-		entry.size = (uint64_t)strtoll(
-		    pieces[pieces.size() - 2].c_str(), nullptr, 10);
-		if (errno == ERANGE)
-			throw Error::ConversionError("Value out of range");
-		entry.offset = (long)strtol(pieces[pieces.size() - 1].c_str(),
-		    nullptr, 10);
-    		if (errno == ERANGE)
-			throw Error::ConversionError("Value out of range");
 
+		/* Only the last entry for a key describes a live record */
+		if (_entries.keyExists(key)) {
+			const ManifestEntry &previous = _entries[key];
+			if (previous.offset != OFFSET_RECORD_REMOVED) {
+				_liveBytes -= previous.size;
+				count--;
+			}
+		}
 		efficient_insert(_entries, key, entry);
 
-		if (!_dirty && entry.offset == OFFSET_RECORD_REMOVED)
+		if (entry.offset == OFFSET_RECORD_REMOVED) {
 			_dirty = true;
+			_manifestHasRemovals = true;
+		} else {
+			_liveBytes += entry.size;
+			count++;
+		}
+		validEnd = position;
+	}
+
+	if (damaged && (getMode() == Mode::ReadWrite)) {
+		if (truncate(canonicalName(MANIFEST_FILE_NAME).c_str(),
+		    validEnd) != 0)
+			throw Error::FileError("Could not truncate manifest "
+			    "(" + Error::errorStr() + ")");
+	}
+	_manifestfp.clear();
+
+	/* The manifest, not the last synced count, is authoritative */
+	this->setCount(count);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::prepare_read()
+    const
+{
+	/* Writers change the streams only while holding _lock exclusively */
+	if ((_archivefd != -1) && !_archiveUnflushed)
+		return;
+
+	std::lock_guard<std::mutex> streamLock(_streamMutex);
+	if (_archivefd == -1) {
+		try {
+			this->open_streams();
+		} catch (Error::FileError &e) {
+			throw Error::StrategyError(e.what());
+		}
+	}
+
+	/* Make buffered writes visible to the descriptor */
+	this->flush_archive();
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::flush_archive()
+    const
+{
+	if (_archiveUnflushed) {
+		_archivefp.clear();
+		_archivefp.flush();
+		if (!_archivefp)
+			throw Error::StrategyError("Could not flush archive");
+		_archiveUnflushed = false;
 	}
 }
 
@@ -276,6 +506,29 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::read(
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
 
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	return (this->i_read(key));
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::readPrefix(
+    const std::string &key,
+    uint64_t size)
+    const
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	return (this->i_read(key, size));
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::i_read(
+    const std::string &key,
+    uint64_t size)
+    const
+{
 	/* Check for existance */
 	std::shared_ptr<ManifestMap::value_type> entry =
 	    _entries.find_quick(key);
@@ -286,22 +539,15 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::read(
 	if (entry->second.offset == OFFSET_RECORD_REMOVED)
 		throw Error::ObjectDoesNotExist(key + " was removed");
 
-	if (_archivefp.is_open() == false) {
-		try {
-			this->open_streams();
-		} catch (Error::FileError &e) {
-			throw Error::StrategyError(e.what());
-		}
-	}
-	_archivefp.clear();
-	_archivefp.seekg(entry->second.offset, std::ios_base::beg);
-	if (!_archivefp)
-		throw Error::StrategyError("Archive cannot seek");
+	this->prepare_read();
 
-	Memory::uint8Array data(entry->second.size);
-	_archivefp.read((char *)&data[0], entry->second.size);
-	if (!_archivefp)
-		throw Error::StrategyError("Archive cannot read");
+	/*
+	 * pread() does not use or modify the descriptor's file offset, so
+	 * any number of threads may read through _archivefd at once.
+	 */
+	size = std::min(size, entry->second.size);
+	Memory::uint8Array data(size);
+	readFully(_archivefd, data, size, entry->second.offset);
 
 	return (data);
 }
@@ -316,7 +562,8 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::insert(
 		throw Error::StrategyError("RecordStore was opened read-only");
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
-	
+
+	ScopedRWLock lock(&_lock, true);
 	if (this->keyExists(key))
 		throw Error::ObjectExists(key);
 
@@ -330,13 +577,18 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::insert(
 			throw Error::StrategyError(e.what());
 		}
 	}
+	/*
+	 * The stream appends, but its position is not the end of the
+	 * archive until it has written, so track the end ourselves.
+	 */
 	_archivefp.clear();
-	offset = _archivefp.tellp();
-	if (!_archivefp)
-		throw Error::StrategyError("Could not get archive position");
+	offset = static_cast<long>(_archiveSize);
 	_archivefp.write(static_cast<const char *>(data), size);
 	if (!_archivefp)
 		throw Error::StrategyError("Could not write to archive file");
+	_archiveUnflushed = true;
+	_archiveSize = offset + size;
+	_liveBytes += size;
 
 	/* Write to manifest */
 	ManifestEntry entry;
@@ -380,24 +632,31 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::remove(
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
 
-	if (this->keyExists(key) == false)
-		throw Error::ObjectDoesNotExist(key);
+	{
+		ScopedRWLock lock(&_lock, true);
+		if (this->keyExists(key) == false)
+			throw Error::ObjectDoesNotExist(key);
 
-	/* At this point, the key is known to exist */
-	std::shared_ptr<ManifestMap::value_type> entry =
-	    _entries.find_quick(key);
-	if (entry.get() == nullptr)
-		throw Error::ObjectDoesNotExist(key);
-	entry->second.offset = OFFSET_RECORD_REMOVED;
-	_entries[key] = entry->second;
-	    
-	try {
-		write_manifest_entry(key, entry->second);
-		RecordStore::Impl::remove(key);
-		_dirty = true;
-	} catch (Error::StrategyError &e) {
-		throw;
+		/* At this point, the key is known to exist */
+		std::shared_ptr<ManifestMap::value_type> entry =
+		    _entries.find_quick(key);
+		if (entry.get() == nullptr)
+			throw Error::ObjectDoesNotExist(key);
+		_liveBytes -= entry->second.size;
+		entry->second.offset = OFFSET_RECORD_REMOVED;
+		_entries[key] = entry->second;
+
+		try {
+			write_manifest_entry(key, entry->second);
+			RecordStore::Impl::remove(key);
+			_dirty = true;
+			_manifestHasRemovals = true;
+		} catch (Error::StrategyError &e) {
+			throw;
+		}
 	}
+
+	this->autoCompact();
 }
 
 void
@@ -411,6 +670,7 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::flush(
 		throw Error::StrategyError("Invalid key format");
 
 	/* Fulfill the RecordStore contract */
+	ScopedRWLock lock(&_lock, true);
 	ManifestMap::const_iterator lb = _entries.find(key);
 	if (lb == _entries.end() ||
 	    (lb->second).offset == OFFSET_RECORD_REMOVED)
@@ -478,7 +738,7 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::i_sequence(
 	BE::IO::RecordStore::Record record;
 	record.key.assign(_cursorPos->first);
 	if (returnData)
-		record.data = this->read(record.key);
+		record.data = this->i_read(record.key);
 	return (record);
 }
 
@@ -486,6 +746,7 @@ BiometricEvaluation::IO::RecordStore::Record
 BiometricEvaluation::IO::ArchiveRecordStore::Impl::sequence(
     int cursor)
 {
+	ScopedRWLock lock(&_lock, true, getMode() == Mode::ReadWrite);
 	return (i_sequence(true, cursor));
 }
 
@@ -493,6 +754,7 @@ std::string
 BiometricEvaluation::IO::ArchiveRecordStore::Impl::sequenceKey(
     int cursor)
 {
+	ScopedRWLock lock(&_lock, true, getMode() == Mode::ReadWrite);
 	RecordStore::Record record = i_sequence(false, cursor);
 	return (record.key);
 }
@@ -504,6 +766,8 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::setCursorAtKey(
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
 
+	ScopedRWLock lock(&_lock, true, getMode() == Mode::ReadWrite);
+
 	/* Check for existance */
 	ManifestMap::iterator lb = _entries.find(key);
 	if (lb == _entries.end())
@@ -517,6 +781,121 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::setCursorAtKey(
 	_cursorPos = (lb == _entries.begin()) ? lb : --lb;
 }
 
+std::vector<std::shared_ptr<BiometricEvaluation::IO::RecordStore::Partition>>
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::partition(
+    unsigned int count)
+{
+	if (count == 0)
+		throw Error::ParameterError("Partition count must be positive");
+
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	/* Partitions read through _archivefd without flushing first */
+	this->prepare_read();
+
+	/* Start partition i at live record (live * i / count) */
+	const uint64_t live = this->getCount();
+	std::vector<std::shared_ptr<RecordStore::Partition>> partitions;
+	partitions.reserve(count);
+	ManifestMap::const_iterator first = _entries.begin();
+	uint64_t position = 0;
+	for (ManifestMap::const_iterator it = _entries.begin();
+	    it != _entries.end(); it++) {
+		if (it->second.offset == OFFSET_RECORD_REMOVED)
+			continue;
+		while ((partitions.size() + 1 < count) &&
+		    (position == live * (partitions.size() + 1) / count)) {
+			partitions.emplace_back(new ManifestPartition(this,
+			    first, it));
+			first = it;
+		}
+		position++;
+	}
+	while (partitions.size() < count) {
+		partitions.emplace_back(new ManifestPartition(this, first,
+		    _entries.end()));
+		first = _entries.end();
+	}
+
+	return (partitions);
+}
+
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::ManifestPartition::
+ManifestPartition(
+    const ArchiveRecordStore::Impl *store,
+    ManifestMap::const_iterator first,
+    ManifestMap::const_iterator last) :
+    _store(store),
+    _first(first),
+    _last(last),
+    _next(first)
+{
+
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::ManifestPartition::
+sequence(
+    int cursor)
+{
+	return (this->i_sequence(true, cursor));
+}
+
+std::string
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::ManifestPartition::
+sequenceKey(
+    int cursor)
+{
+	return (this->i_sequence(false, cursor).key);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::ManifestPartition::
+i_sequence(
+    bool returnData,
+    int cursor)
+{
+	if (cursor == BE_RECSTORE_SEQ_START)
+		_next = _first;
+	else if (cursor != BE_RECSTORE_SEQ_NEXT)
+		throw Error::StrategyError("Invalid cursor position as "
+		    "argument");
+
+	ScopedRWLock lock(&_store->_lock, false,
+	    _store->getMode() == Mode::ReadWrite);
+	while ((_next != _last) &&
+	    (_next->second.offset == OFFSET_RECORD_REMOVED))
+		_next++;
+	if (_next == _last)
+		throw Error::ObjectDoesNotExist("No record at position");
+
+	/* The manifest entry locates the data without a lookup */
+	RecordStore::Record record;
+	record.key = _next->first;
+	if (returnData) {
+		const ManifestEntry entry = _next->second;
+		record.data.resize(entry.size);
+		readFully(_store->_archivefd, record.data, entry.size,
+		    entry.offset);
+	}
+	_next++;
+	return (record);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::adviseSequentialRead(
+    unsigned int records)
+{
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	this->prepare_read();
+
+	/* Records are sequenced in increasing offset order */
+	errno = posix_fadvise(_archivefd, 0, 0,
+	    (records > 0) ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_NORMAL);
+	if (errno != 0)
+		throw Error::StrategyError("Could not advise archive (" +
+		    Error::errorStr() + ")");
+}
+
 void
 BiometricEvaluation::IO::ArchiveRecordStore::Impl::efficient_insert(
     ManifestMap &m,
@@ -570,6 +949,7 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::move(
 	if (this->getMode() == Mode::ReadOnly)
 		throw Error::StrategyError("RecordStore was opened read-only");
 
+	this->cancelCompaction();
 	RecordStore::Impl::move(pathname);
 	this->close_streams();
 }
@@ -577,7 +957,8 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::move(
 bool
 BiometricEvaluation::IO::ArchiveRecordStore::Impl::needsVacuum()
 {
-	return (this->_dirty);
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	return (_manifestHasRemovals || (_archiveSize > _liveBytes));
 }
 
 bool
@@ -620,3 +1001,470 @@ BiometricEvaluation::IO::ArchiveRecordStore::Impl::getArchiveName() const
 	return (canonicalName(ARCHIVE_FILE_NAME));
 }
 
+
+uint64_t
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::getDeadSpace()
+    const
+{
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	return (_archiveSize - _liveBytes);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::rewrite_manifest()
+{
+	const std::string manifestName = canonicalName(MANIFEST_FILE_NAME);
+	const std::string tempName = manifestName + ".compact";
+
+	std::ofstream temp(tempName, std::ofstream::out |
+	    std::ofstream::trunc);
+	if (!temp)
+		throw Error::StrategyError("Could not create " + tempName);
+	for (const auto &entry : _entries)
+		if (entry.second.offset != OFFSET_RECORD_REMOVED)
+			temp << entry.first << " " << entry.second.size <<
+			    " " << entry.second.offset << '\n';
+	temp.close();
+	if (!temp)
+		throw Error::StrategyError("Could not write " + tempName);
+
+	/* The new manifest must be durable before it replaces the old */
+	const int fd = open(tempName.c_str(), O_WRONLY);
+	if (fd == -1)
+		throw Error::StrategyError("Could not open " + tempName +
+		    " (" + Error::errorStr() + ")");
+	const int rv = fsync(fd);
+	close(fd);
+	if (rv != 0)
+		throw Error::StrategyError("Could not sync " + tempName +
+		    " (" + Error::errorStr() + ")");
+
+	if (std::rename(tempName.c_str(), manifestName.c_str()) != 0)
+		throw Error::StrategyError("Could not replace manifest (" +
+		    Error::errorStr() + ")");
+	_manifestHasRemovals = false;
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::compact(
+    uint64_t segmentSize,
+    const CompactionCallback &callback)
+{
+	if (getMode() == Mode::ReadOnly)
+		throw Error::StrategyError("RecordStore was opened read-only");
+
+	std::lock_guard<std::mutex> compactionLock(_compactionMutex);
+
+	/* Live records as of now, in the order they appear in the archive */
+	std::vector<Extent> extents;
+	uint64_t end;
+	{
+		ScopedRWLock lock(&_lock, true);
+		this->flush_archive();
+		for (const auto &entry : _entries)
+			if (entry.second.offset != OFFSET_RECORD_REMOVED)
+				extents.push_back({entry.first,
+				    static_cast<uint64_t>(entry.second.offset),
+				    entry.second.size});
+		end = _archiveSize;
+	}
+	std::sort(extents.begin(), extents.end(),
+	    [](const Extent &lhs, const Extent &rhs) {
+		return (lhs.offset < rhs.offset);
+	});
+
+	const int archivefd = open(canonicalName(ARCHIVE_FILE_NAME).c_str(),
+	    O_RDWR);
+	if (archivefd == -1)
+		throw Error::StrategyError("Could not open archive (" +
+		    Error::errorStr() + ")");
+	const int manifestfd = open(canonicalName(MANIFEST_FILE_NAME).c_str(),
+	    O_WRONLY);
+	if (manifestfd == -1) {
+		close(archivefd);
+		throw Error::StrategyError("Could not open manifest (" +
+		    Error::errorStr() + ")");
+	}
+
+	CompactionProgress progress{0, end, 0, false};
+	try {
+		Memory::uint8Array buffer(COMPACTION_BUFFER_SIZE);
+
+		/*
+		 * Slide live records down to write, the end of the compacted
+		 * region.  A record is only moved into space that no
+		 * committed manifest entry refers to: dead space, or space
+		 * vacated by records moved in earlier segments.  Moves
+		 * within a segment are committed to the manifest together,
+		 * so a record's destination must also lie below the old
+		 * location of every record moved earlier in the segment.
+		 *
+		 * A record too large for the dead space before it is
+		 * instead appended to the archive, adding its old space
+		 * to the gap, and is moved down again when reached.  The
+		 * gap only grows, so the archive temporarily grows by
+		 * little more than its largest record.
+		 */
+		uint64_t write = 0;
+		std::vector<Extent>::size_type next = 0;
+		while ((next < extents.size()) && !_cancelCompaction) {
+			ScopedRWLock lock(&_lock, true);
+			this->flush_archive();
+
+			std::vector<Extent> moved;
+			uint64_t limit = 0, copied = 0;
+			bool appended = false;
+			for (; next < extents.size(); next++) {
+				const Extent extent = extents[next];
+
+				/* Removed or replaced since the snapshot */
+				const std::shared_ptr<ManifestMap::value_type>
+				    current = _entries.find_quick(extent.key);
+				if ((current.get() == nullptr) ||
+				    (current->second.offset !=
+				    static_cast<long>(extent.offset)))
+					continue;
+
+				if (extent.offset == write) {
+					write += extent.size;
+					continue;
+				}
+
+				const uint64_t bound = (moved.empty() ?
+				    extent.offset : limit);
+				const bool append = ((write + extent.size) >
+				    bound);
+				if (append && !moved.empty())
+					break;
+				const uint64_t destination = (append ?
+				    _archiveSize : write);
+
+				for (uint64_t done = 0; done < extent.size;) {
+					const uint64_t chunk = std::min(
+					    extent.size - done,
+					    COMPACTION_BUFFER_SIZE);
+					readFully(archivefd, buffer, chunk,
+					    extent.offset + done);
+					writeFully(archivefd, buffer, chunk,
+					    destination + done);
+					done += chunk;
+				}
+				if (moved.empty())
+					limit = extent.offset;
+				moved.push_back({extent.key, destination,
+				    extent.size});
+				if (append) {
+					_archiveSize += extent.size;
+					end += extent.size;
+					extents.push_back(moved.back());
+					appended = true;
+				} else
+					write += extent.size;
+				copied += extent.size;
+				if (copied >= segmentSize) {
+					next++;
+					break;
+				}
+			}
+
+			/* A newly created archive's stream does not append */
+			if (appended) {
+				_archivefp.clear();
+				_archivefp.seekp(0, std::ios_base::end);
+				if (!_archivefp)
+					throw Error::StrategyError("Could not "
+					    "seek archive");
+			}
+
+			/* Commit the segment: data first, then the manifest */
+			if (!moved.empty()) {
+				if (fsync(archivefd) != 0)
+					throw Error::StrategyError("Could not "
+					    "sync archive (" +
+					    Error::errorStr() + ")");
+				for (const auto &extent : moved) {
+					ManifestEntry entry;
+					entry.offset =
+					    static_cast<long>(extent.offset);
+					entry.size = extent.size;
+					this->write_manifest_entry(extent.key,
+					    entry);
+				}
+				_manifestfp.flush();
+				if (!_manifestfp)
+					throw Error::StrategyError("Could not "
+					    "flush manifest");
+				if (fsync(manifestfd) != 0)
+					throw Error::StrategyError("Could not "
+					    "sync manifest (" +
+					    Error::errorStr() + ")");
+			}
+
+			progress.bytesExamined = std::min(progress.bytesTotal,
+			    (next < extents.size() ? extents[next].offset : end));
+			progress.bytesReclaimed = (progress.bytesExamined > write ?
+			    progress.bytesExamined - write : 0);
+			if (next == extents.size())
+				break;
+			if (callback)
+				callback(progress);
+		}
+
+		if (!_cancelCompaction) {
+			ScopedRWLock lock(&_lock, true);
+			this->flush_archive();
+			this->rewrite_manifest();
+
+			/*
+			 * Everything past write is dead unless records were
+			 * appended while compacting, in which case the space
+			 * is left for a later compaction.
+			 */
+			if (_archiveSize == end) {
+				if (ftruncate(archivefd, write) != 0)
+					throw Error::StrategyError("Could not "
+					    "truncate archive (" +
+					    Error::errorStr() + ")");
+				_archiveSize = write;
+				progress.bytesReclaimed = progress.bytesTotal -
+				    write;
+			}
+			progress.bytesExamined = progress.bytesTotal;
+			progress.finished = true;
+
+			/* Streams refer to the old manifest and archive end */
+			this->close_streams();
+			try {
+				this->open_streams();
+			} catch (Error::FileError &e) {
+				throw Error::StrategyError(e.what());
+			}
+		}
+	} catch (...) {
+		close(manifestfd);
+		close(archivefd);
+		throw;
+	}
+	close(manifestfd);
+	close(archivefd);
+
+	if (progress.finished && callback)
+		callback(progress);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::startCompaction(
+    uint64_t segmentSize,
+    const CompactionCallback &callback)
+{
+	if (getMode() == Mode::ReadOnly)
+		throw Error::StrategyError("RecordStore was opened read-only");
+	if (_compacting)
+		throw Error::StrategyError("Compaction is already running");
+
+	if (_compactionThread.joinable())
+		_compactionThread.join();
+	_compactionError = nullptr;
+	_cancelCompaction = false;
+	_compacting = true;
+	_compactionThread = std::thread([this, segmentSize, callback]() {
+		try {
+			this->compact(segmentSize, callback);
+		} catch (...) {
+			_compactionError = std::current_exception();
+		}
+		_compacting = false;
+	});
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::waitForCompaction()
+{
+	if (_compactionThread.joinable())
+		_compactionThread.join();
+	if (_compactionError) {
+		std::exception_ptr error = _compactionError;
+		_compactionError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::cancelCompaction()
+{
+	_cancelCompaction = true;
+	if (_compactionThread.joinable())
+		_compactionThread.join();
+	_cancelCompaction = false;
+}
+
+bool
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::isCompacting()
+    const
+{
+	return (_compacting);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::setAutoCompaction(
+    double threshold,
+    uint64_t segmentSize,
+    const CompactionCallback &callback)
+{
+	if (getMode() == Mode::ReadOnly)
+		throw Error::StrategyError("RecordStore was opened read-only");
+	if ((threshold < 0) || (threshold > 1))
+		throw Error::ParameterError("Threshold must be within [0, 1]");
+
+	_autoCompactThreshold = threshold;
+	_autoCompactSegmentSize = segmentSize;
+	_autoCompactCallback = callback;
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::autoCompact()
+{
+	if ((_autoCompactThreshold == 0) || _compacting)
+		return;
+
+	{
+		ScopedRWLock lock(&_lock, false);
+		if (!(_manifestHasRemovals || (_archiveSize > _liveBytes)) ||
+		    (_archiveSize == 0))
+			return;
+		if ((static_cast<double>(_archiveSize - _liveBytes) /
+		    _archiveSize) < _autoCompactThreshold)
+			return;
+	}
+
+	this->startCompaction(_autoCompactSegmentSize, _autoCompactCallback);
+}
+
+void
+BiometricEvaluation::IO::ArchiveRecordStore::Impl::mergeArchives(
+    const std::string &mergePathname,
+    const std::string &description,
+    const std::vector<std::string> &pathnames)
+{
+	/*
+	 * Find the live records of every source, in manifest order, so
+	 * that a duplicate key is found before anything is written.
+	 */
+	std::vector<std::string> archiveNames;
+	std::vector<std::vector<Extent>> sources;
+	std::unordered_set<std::string> keys;
+	for (const auto &pathname : pathnames) {
+		std::unique_ptr<ArchiveRecordStore::Impl> source;
+		try {
+			source.reset(new ArchiveRecordStore::Impl(
+			    pathname, Mode::ReadOnly));
+		} catch (Error::Exception &e) {
+			throw Error::StrategyError(e.whatString());
+		}
+
+		archiveNames.push_back(source->canonicalName(
+		    ARCHIVE_FILE_NAME));
+		sources.emplace_back();
+		for (const auto &entry : source->_entries) {
+			if (entry.second.offset == OFFSET_RECORD_REMOVED)
+				continue;
+			if (keys.insert(entry.first).second == false)
+				throw Error::ObjectExists(entry.first);
+			sources.back().push_back({entry.first,
+			    static_cast<uint64_t>(entry.second.offset),
+			    entry.second.size});
+		}
+	}
+
+	ArchiveRecordStore::Impl merged(mergePathname, description);
+
+	const int mergedfd = open(merged.canonicalName(
+	    ARCHIVE_FILE_NAME).c_str(), O_WRONLY);
+	if (mergedfd == -1)
+		throw Error::StrategyError("Could not open archive (" +
+		    Error::errorStr() + ")");
+
+	int sourcefd = -1;
+	try {
+		Memory::uint8Array buffer(MERGE_BUFFER_SIZE);
+		for (std::vector<Extent>::size_type s = 0; s < sources.size();
+		    s++) {
+			const std::vector<Extent> &extents = sources[s];
+			sourcefd = open(archiveNames[s].c_str(), O_RDONLY);
+			if (sourcefd == -1)
+				throw Error::StrategyError("Could not open " +
+				    archiveNames[s] + " (" +
+				    Error::errorStr() + ")");
+
+			/*
+			 * Copy maximal runs of adjacent live records, in
+			 * archive order, noting where each record lands.
+			 */
+			std::vector<std::vector<Extent>::size_type> order(
+			    extents.size());
+			for (std::vector<Extent>::size_type i = 0;
+			    i < order.size(); i++)
+				order[i] = i;
+			std::sort(order.begin(), order.end(),
+			    [&extents](std::vector<Extent>::size_type lhs,
+			    std::vector<Extent>::size_type rhs) {
+				return (extents[lhs].offset <
+				    extents[rhs].offset);
+			});
+
+			std::vector<uint64_t> newOffsets(extents.size());
+			std::vector<Extent>::size_type i = 0;
+			while (i < order.size()) {
+				const uint64_t runStart =
+				    extents[order[i]].offset;
+				const uint64_t destination =
+				    merged._archiveSize;
+				uint64_t runEnd = runStart;
+				for (; (i < order.size()) &&
+				    (extents[order[i]].offset == runEnd);
+				    i++) {
+					newOffsets[order[i]] = destination +
+					    (runEnd - runStart);
+					runEnd += extents[order[i]].size;
+				}
+
+				for (uint64_t done = 0;
+				    done < (runEnd - runStart);) {
+					const uint64_t chunk = std::min(
+					    runEnd - runStart - done,
+					    MERGE_BUFFER_SIZE);
+					readFully(sourcefd, buffer, chunk,
+					    runStart + done);
+					writeFully(mergedfd, buffer, chunk,
+					    destination + done);
+					done += chunk;
+				}
+				merged._archiveSize += runEnd - runStart;
+			}
+			close(sourcefd);
+			sourcefd = -1;
+
+			for (i = 0; i < extents.size(); i++) {
+				ManifestEntry entry;
+				entry.offset = static_cast<long>(newOffsets[i]);
+				entry.size = extents[i].size;
+				merged.write_manifest_entry(extents[i].key,
+				    entry);
+				merged._liveBytes += entry.size;
+				merged.RecordStore::Impl::insert(
+				    extents[i].key, nullptr, entry.size);
+			}
+		}
+
+		merged.sync();
+	} catch (...) {
+		if (sourcefd != -1)
+			close(sourcefd);
+		close(mergedfd);
+		throw;
+	}
+
+	if (close(mergedfd) != 0)
+		throw Error::StrategyError("Could not close archive (" +
+		    Error::errorStr() + ")");
+}
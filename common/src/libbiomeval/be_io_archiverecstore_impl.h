@@ -11,9 +11,15 @@
 #ifndef __BE_ARCHIVERECSTORE_IMPL_H__
 #define __BE_ARCHIVERECSTORE_IMPL_H__
 
+#include <pthread.h>
+
+#include <atomic>
 #include <exception>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <be_io_archiverecstore.h>
 #include "be_io_recordstore_impl.h"
@@ -84,6 +90,10 @@ namespace BiometricEvaluation {
 			Memory::uint8Array read(
 			    const std::string &key) const;
 
+			Memory::uint8Array readPrefix(
+			    const std::string &key,
+			    uint64_t size) const;
+
 			uint64_t length(
 			    const std::string &key) const;
 
@@ -102,6 +112,13 @@ namespace BiometricEvaluation {
 
 			void move(
 			    const std::string &pathname);
+
+			void adviseSequentialRead(
+			    unsigned int records);
+
+			std::vector<std::shared_ptr<RecordStore::Partition>>
+			partition(
+			    unsigned int count);
 	
 			/**
 			 * See if the ArchiveRecordStore would benefit from
@@ -149,6 +166,113 @@ namespace BiometricEvaluation {
 			 */
 			static void vacuum(
 			    const std::string &pathname);
+
+			/**
+			 * @brief
+			 * Create an ArchiveRecordStore holding the records
+			 * of several others, copying archives in bulk.
+			 *
+			 * @param[in] mergePathname
+			 *	The path name of the new store.
+			 * @param[in] description
+			 *	The description of the new store.
+			 * @param[in] pathnames
+			 *	Path names of the ArchiveRecordStores
+			 *	to merge.
+			 *
+			 * @throw Error::ObjectExists
+			 *	The new store already exists, or a key
+			 *	appears in more than one source.
+			 * @throw Error::StrategyError
+			 *	A source could not be opened, or an error
+			 *	occurred when using the underlying storage
+			 *	system.
+			 */
+			static void
+			mergeArchives(
+			    const std::string &mergePathname,
+			    const std::string &description,
+			    const std::vector<std::string> &pathnames);
+
+			/**
+			 * @return
+			 *	Bytes in the archive that do not belong to
+			 *	a live record.
+			 */
+			uint64_t getDeadSpace() const;
+
+			/**
+			 * @brief
+			 * Reclaim dead space while the store remains open.
+			 *
+			 * @param[in] segmentSize
+			 *	Maximum bytes to copy per segment.
+			 * @param[in] callback
+			 *	Progress callback, or nullptr.
+			 *
+			 * @throw Error::StrategyError
+			 *	Read-only store or storage system error.
+			 */
+			void compact(
+			    uint64_t segmentSize,
+			    const CompactionCallback &callback);
+
+			/**
+			 * @brief
+			 * Run compact() on a background thread.
+			 *
+			 * @param[in] segmentSize
+			 *	Maximum bytes to copy per segment.
+			 * @param[in] callback
+			 *	Progress callback, or nullptr.
+			 *
+			 * @throw Error::StrategyError
+			 *	Read-only store or compaction running.
+			 */
+			void startCompaction(
+			    uint64_t segmentSize,
+			    const CompactionCallback &callback);
+
+			/**
+			 * @brief
+			 * Wait for a background compaction to finish.
+			 *
+			 * @throw Error::StrategyError
+			 *	The background compaction failed.
+			 */
+			void waitForCompaction();
+
+			/**
+			 * @brief
+			 * Stop a background compaction after its current
+			 * segment and wait for it to finish.
+			 */
+			void cancelCompaction();
+
+			/** @return Whether a background compaction runs */
+			bool isCompacting() const;
+
+			/**
+			 * @brief
+			 * Set the dead space fraction at which remove()
+			 * starts a background compaction.
+			 *
+			 * @param[in] threshold
+			 *	Fraction in (0, 1], or 0 to disable.
+			 * @param[in] segmentSize
+			 *	Passed to startCompaction().
+			 * @param[in] callback
+			 *	Passed to startCompaction().
+			 *
+			 * @throw Error::ParameterError
+			 *	threshold is not within [0, 1].
+			 * @throw Error::StrategyError
+			 *	Read-only store.
+			 */
+			void setAutoCompaction(
+			    double threshold,
+			    uint64_t segmentSize,
+			    const CompactionCallback &callback);
 	
 			/**
 			 * Obtain the name of the file storing the data for 
@@ -197,6 +321,22 @@ namespace BiometricEvaluation {
 			mutable std::fstream _manifestfp;
 			/** Archive file handle */
 			mutable std::fstream _archivefp;
+			/**
+			 * Read-only descriptor for the archive, used for
+			 * positional reads that are safe to perform from
+			 * multiple threads.
+			 */
+			mutable std::atomic<int> _archivefd;
+			/**
+			 * Whether data written to _archivefp may not yet
+			 * be visible through _archivefd.
+			 */
+			mutable std::atomic<bool> _archiveUnflushed;
+			/**
+			 * Serializes opening and flushing the streams on
+			 * behalf of readers, which may share _lock.
+			 */
+			mutable std::mutex _streamMutex;
 	
 			/*
 			 * Offsets and sizes of data chunks within the archive.
@@ -207,19 +347,201 @@ namespace BiometricEvaluation {
 			ManifestMap::const_iterator _cursorPos;
 
 			/**
-			 * Whether or not the ArchiveRecordStore contains a 
-			 * deleted entry and would benefit from vacuum().
+			 * Whether or not _entries contains a deleted entry,
+			 * in which case keys cannot be checked for existence
+			 * by presence in _entries alone.
 			 */
 			bool _dirty;
+
+			/** Whether the manifest file lists a deleted entry */
+			bool _manifestHasRemovals;
+
+			/** Size of the archive, including unflushed data */
+			uint64_t _archiveSize;
+
+			/** Sum of the sizes of all live records */
+			uint64_t _liveBytes;
+
+			/**
+			 * Held shared by readers and exclusively by
+			 * modifiers of a read/write store, so that records
+			 * are not read while compaction moves them.  Not
+			 * used for read-only stores, which cannot change.
+			 */
+			mutable pthread_rwlock_t _lock;
+
+			/** Serializes compactions */
+			std::mutex _compactionMutex;
+
+			/** Background compaction thread */
+			std::thread _compactionThread;
+
+			/** Whether _compactionThread is running */
+			std::atomic<bool> _compacting;
+
+			/** Request that a running compaction stop */
+			std::atomic<bool> _cancelCompaction;
+
+			/** Failure of the last background compaction */
+			std::exception_ptr _compactionError;
+
+			/** Dead fraction that triggers compaction, or 0 */
+			double _autoCompactThreshold;
+
+			/** Segment size for automatic compaction */
+			uint64_t _autoCompactSegmentSize;
+
+			/** Callback for automatic compaction */
+			CompactionCallback _autoCompactCallback;
+
+			/**
+			 * @brief
+			 * A range of the manifest, read through
+			 * _archivefd.
+			 */
+			class ManifestPartition : public RecordStore::Partition
+			{
+			public:
+				/**
+				 * @param[in] store
+				 *	Store that owns the manifest.
+				 * @param[in] first
+				 *	First entry of the range.
+				 * @param[in] last
+				 *	Entry after the end of the range.
+				 */
+				ManifestPartition(
+				    const ArchiveRecordStore::Impl *store,
+				    ManifestMap::const_iterator first,
+				    ManifestMap::const_iterator last);
+
+				RecordStore::Record
+				sequence(
+				    int cursor)
+				    override;
+
+				std::string
+				sequenceKey(
+				    int cursor)
+				    override;
+
+			private:
+				const ArchiveRecordStore::Impl *_store;
+				const ManifestMap::const_iterator _first;
+				const ManifestMap::const_iterator _last;
+				/** Next entry to consider */
+				ManifestMap::const_iterator _next;
+
+				/** Sequence, optionally reading data */
+				RecordStore::Record
+				i_sequence(
+				    bool returnData,
+				    int cursor);
+			};
+
+			/** A record as found in the archive */
+			struct Extent
+			{
+				/** Key of the record */
+				std::string key;
+				/** Offset of the record in the archive */
+				uint64_t offset;
+				/** Length of the record */
+				uint64_t size;
+			};
+			
+			/**
+			 * @brief
+			 * Common member initialization for constructors.
+			 */
+			void
+			init();
+
+			/**
+			 * @brief
+			 * Read a record without taking _lock.
+			 *
+			 * @param[in] key
+			 *	Key of the record to read.
+			 * @param[in] size
+			 *	Maximum number of bytes to read.
+			 *
+			 * @return
+			 *	Contents of the record, truncated to size
+			 *	bytes.
+			 *
+			 * @throw Error::ObjectDoesNotExist
+			 *	key does not exist.
+			 * @throw Error::StrategyError
+			 *	Error reading the archive.
+			 */
+			Memory::uint8Array
+			i_read(
+			    const std::string &key,
+			    uint64_t size = UINT64_MAX)
+			    const;
+
+			/**
+			 * @brief
+			 * Ready _archivefd for positional reads.
+			 *
+			 * @details
+			 * Opens the streams if needed and flushes buffered
+			 * writes so that they are visible through
+			 * _archivefd.  Callers need hold _lock only shared.
+			 *
+			 * @throw Error::StrategyError
+			 *	Error opening or flushing the archive.
+			 */
+			void
+			prepare_read()
+			    const;
+
+			/**
+			 * @brief
+			 * Flush buffered writes to the archive.
+			 *
+			 * @throw Error::StrategyError
+			 *	Error writing the archive.
+			 */
+			void
+			flush_archive()
+			    const;
+
+			/**
+			 * @brief
+			 * Replace the manifest with one that lists only live
+			 * records, in insertion order.
+			 *
+			 * @throw Error::StrategyError
+			 *	Error writing the manifest.
+			 */
+			void
+			rewrite_manifest();
+
+			/**
+			 * @brief
+			 * Start a background compaction if the threshold
+			 * set by setAutoCompaction() has been reached.
+			 */
+			void
+			autoCompact();
 			
 			/**
 			 * @brief
 			 * Read the manifest.
 			 *
+			 * @details
+			 * Entries at the end of the manifest that are
+			 * malformed or name data past _archiveSize were
+			 * being written when a process stopped.  They are
+			 * ignored, and truncated if the store is read/write.
+			 *
 			 * @throw Error::ConversionError
 			 *	Size or offset in manifest couldn't be parsed.
 			 * @throw Error::FileError
-			 *	Manifest is malformed or could not be read.
+			 *	Manifest is malformed before its end, or
+			 *	could not be read.
 			 */
 			void read_manifest();
 		
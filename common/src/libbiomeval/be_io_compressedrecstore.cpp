@@ -163,3 +163,10 @@ BiometricEvaluation::IO::CompressedRecordStore::changeDescription(
 	return (this->pimpl->changeDescription(description));
 }
 
+void
+BiometricEvaluation::IO::CompressedRecordStore::adviseSequentialRead(
+    unsigned int records)
+{
+	this->pimpl->adviseSequentialRead(records);
+}
+
@@ -221,6 +221,14 @@ BiometricEvaluation::IO::CompressedRecordStore::Impl::move(
 	_mdrs = RecordStore::Impl::openRecordStore(rsPath, IO::Mode::ReadWrite);
 }
 
+void
+BiometricEvaluation::IO::CompressedRecordStore::Impl::adviseSequentialRead(
+    unsigned int records)
+{
+	/* The backing store is sequenced; metadata is read by key */
+	_rs->adviseSequentialRead(records);
+}
+
 void
 BiometricEvaluation::IO::CompressedRecordStore::Impl::setCursorAtKey(
     const std::string &key)
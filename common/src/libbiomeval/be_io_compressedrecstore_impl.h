@@ -145,6 +145,10 @@ namespace BiometricEvaluation
 			move(
 			    const std::string &pathname);
 
+			void
+			adviseSequentialRead(
+			    unsigned int records);
+
 			/**
 			 * @brief
 			 * Copy constructor (disabled).
@@ -146,3 +146,10 @@ BiometricEvaluation::IO::DBRecordStore::changeDescription(
 	return (this->pimpl->changeDescription(description));
 }
 
+std::vector<std::shared_ptr<BiometricEvaluation::IO::RecordStore::Partition>>
+BiometricEvaluation::IO::DBRecordStore::partition(
+    unsigned int count)
+{
+	return (this->pimpl->partition(count));
+}
+
@@ -8,6 +8,7 @@
  * about its quality, reliability, or any other characteristic.
  ******************************************************************************/
 
+#include <algorithm>
 #include <climits>
 #include <cstdio>
 #include <cstring>
@@ -82,7 +83,9 @@ BiometricEvaluation::IO::DBRecordStore::Impl::getDBFilePathname() const
 BiometricEvaluation::IO::DBRecordStore::Impl::Impl(
     const std::string &pathname,
     const std::string &description) :
-    RecordStore::Impl(pathname, description, RecordStore::Kind::BerkeleyDB)
+    RecordStore::Impl(pathname, description, RecordStore::Kind::BerkeleyDB),
+    _readHandles(new ReadHandleRegistry()),
+    _ownerThread(std::this_thread::get_id())
 {
 	/*
 	 * The BDB files previously were named after the RecordStore
@@ -116,7 +119,9 @@ BiometricEvaluation::IO::DBRecordStore::Impl::Impl(
 BiometricEvaluation::IO::DBRecordStore::Impl::Impl(
     const std::string &pathname,
     IO::Mode mode) :
-    RecordStore::Impl(pathname, mode)
+    RecordStore::Impl(pathname, mode),
+    _readHandles(new ReadHandleRegistry()),
+    _ownerThread(std::this_thread::get_id())
 { 
 	this->_dbnameP = this->getDBFilePathname();
 	if (!IO::Utility::fileExists(this->_dbnameP))
@@ -171,18 +176,190 @@ BiometricEvaluation::IO::DBRecordStore::Impl::Impl(
 
 BiometricEvaluation::IO::DBRecordStore::Impl::~Impl()
 {
+	this->_readHandles->releaseAll();
 	if (this->_dbP != nullptr)
 		this->_dbP->close(this->_dbP);
 	if (this->_dbS != nullptr)
 		this->_dbS->close(this->_dbS);
 }
 
+std::vector<std::shared_ptr<BiometricEvaluation::IO::RecordStore::Partition>>
+BiometricEvaluation::IO::DBRecordStore::Impl::partition(
+    unsigned int count)
+{
+	if (count == 0)
+		throw Error::ParameterError("Partition count must be positive");
+
+	/* Partitions read the files through handles of their own */
+	this->sync();
+
+	/*
+	 * Walk the keys with a separate cursor, so as not to move the
+	 * store's, taking every (total / count)th key as a boundary.
+	 */
+	const uint64_t total = this->getCount();
+	std::vector<std::string> bounds;
+	bounds.reserve(count - 1);
+	std::string key;
+	ReadHandles handles = this->openReadHandles();
+	DBT dbtkey, dbtdata;
+	u_int flag = R_FIRST;
+	uint64_t position = 0;
+	while (bounds.size() + 1 < count) {
+		int rc = handles.primary->seq(handles.primary, &dbtkey,
+		    &dbtdata, flag);
+		if (rc == 1)
+			break;
+		if (rc != 0) {
+			const std::string error = Error::errorStr();
+			handles.primary->close(handles.primary);
+			if (handles.subordinate != nullptr)
+				handles.subordinate->close(handles.subordinate);
+			throw Error::StrategyError("Could not read from "
+			    "primary DB (" + error + ")");
+		}
+		flag = R_NEXT;
+
+		key.assign((const char *)dbtkey.data, dbtkey.size);
+		while ((bounds.size() + 1 < count) &&
+		    (position == total * (bounds.size() + 1) / count))
+			bounds.push_back(key);
+		position++;
+	}
+	handles.primary->close(handles.primary);
+	if (handles.subordinate != nullptr)
+		handles.subordinate->close(handles.subordinate);
+
+	/* Fewer keys than counted; the last ranges are [key, key) */
+	while (bounds.size() + 1 < count)
+		bounds.push_back(key);
+
+	std::vector<std::shared_ptr<RecordStore::Partition>> partitions;
+	partitions.reserve(count);
+	for (unsigned int i = 0; i < count; i++)
+		partitions.emplace_back(new KeyRangePartition(this,
+		    (i == 0) ? "" : bounds[i - 1],
+		    (i == count - 1) ? "" : bounds[i]));
+	return (partitions);
+}
+
+BiometricEvaluation::IO::DBRecordStore::Impl::KeyRangePartition::
+KeyRangePartition(
+    const DBRecordStore::Impl *store,
+    const std::string &first,
+    const std::string &last) :
+    _store(store),
+    _first(first),
+    _last(last),
+    _handles{nullptr, nullptr},
+    _started(false),
+    _ended(false)
+{
+
+}
+
+BiometricEvaluation::IO::DBRecordStore::Impl::KeyRangePartition::
+~KeyRangePartition()
+{
+	if (_handles.primary != nullptr)
+		_handles.primary->close(_handles.primary);
+	if (_handles.subordinate != nullptr)
+		_handles.subordinate->close(_handles.subordinate);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::DBRecordStore::Impl::KeyRangePartition::
+sequence(
+    int cursor)
+{
+	return (this->i_sequence(true, cursor));
+}
+
+std::string
+BiometricEvaluation::IO::DBRecordStore::Impl::KeyRangePartition::
+sequenceKey(
+    int cursor)
+{
+	return (this->i_sequence(false, cursor).key);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::DBRecordStore::Impl::KeyRangePartition::
+i_sequence(
+    bool returnData,
+    int cursor)
+{
+	if ((cursor != IO::RecordStore::BE_RECSTORE_SEQ_START) &&
+	    (cursor != IO::RecordStore::BE_RECSTORE_SEQ_NEXT))
+		throw Error::StrategyError("Invalid cursor position as "
+		    "argument");
+
+	/* Opened by the thread sequencing this partition */
+	if (_handles.primary == nullptr)
+		_handles = _store->openReadHandles();
+
+	DBT dbtkey, dbtdata;
+	u_int flag = R_NEXT;
+	if ((cursor == IO::RecordStore::BE_RECSTORE_SEQ_START) || !_started) {
+		_started = true;
+		_ended = false;
+		if (_first.empty()) {
+			flag = R_FIRST;
+		} else {
+			/* Smallest key greater than or equal to _first */
+			flag = R_CURSOR;
+			dbtkey.data = (void *)_first.data();
+			dbtkey.size = _first.length();
+		}
+	}
+	if (_ended)
+		throw Error::ObjectDoesNotExist("No record at position");
+
+	int rc = _handles.primary->seq(_handles.primary, &dbtkey, &dbtdata,
+	    flag);
+	switch (rc) {
+		case 0:
+			break;
+		case 1:
+			_ended = true;
+			throw Error::ObjectDoesNotExist("No record at "
+			    "position");
+		default:
+			throw Error::StrategyError("Could not read from "
+			    "primary DB (" + Error::errorStr() + ")");
+	}
+
+	BE::IO::RecordStore::Record record;
+	record.key.assign((const char *)dbtkey.data, dbtkey.size);
+	if (!_last.empty() && (record.key >= _last)) {
+		_ended = true;
+		throw Error::ObjectDoesNotExist("No record at position");
+	}
+
+	if (returnData) {
+		if (dbtdata.size < MAX_REC_SIZE) {
+			/* The primary segment is the whole record */
+			record.data.resize(dbtdata.size);
+			record.data.copy((uint8_t *)dbtdata.data,
+			    dbtdata.size);
+		} else {
+			record.data.resize(_store->readRecordSegments(
+			    record.key, nullptr, _handles.primary,
+			    _handles.subordinate));
+			_store->readRecordSegments(record.key, record.data,
+			    _handles.primary, _handles.subordinate);
+		}
+	}
+	return (record);
+}
+
 void
 BiometricEvaluation::IO::DBRecordStore::Impl::move(const std::string &pathname)
 { 
 	if (getMode() == Mode::ReadOnly)
 		throw Error::StrategyError("RecordStore was opened read-only");
 
+	this->_readHandles->releaseAll();
 	if (this->_dbP != nullptr)
 		this->_dbP->close(this->_dbP);
 	if (this->_dbS != nullptr)
@@ -275,7 +452,6 @@ BiometricEvaluation::IO::DBRecordStore::Impl::sync()
 	if (getMode() == Mode::ReadOnly)
 		return;
 
-	RecordStore::Impl::sync();
 	int rc = this->_dbP->sync(this->_dbP, 0);
 	if (rc != 0)
 		throw Error::StrategyError("Could not sync primary DB (" +
@@ -289,6 +465,9 @@ BiometricEvaluation::IO::DBRecordStore::Impl::sync()
 			    Error::errorStr() + ")");
 		}
 	}
+
+	/* Journal the count only once the records it counts are synced */
+	RecordStore::Impl::sync();
 }
 
 void
@@ -590,6 +769,106 @@ BiometricEvaluation::IO::DBRecordStore::Impl::insertRecordSegments(
 	}
 }
 
+BiometricEvaluation::IO::DBRecordStore::Impl::ReadHandles
+BiometricEvaluation::IO::DBRecordStore::Impl::getReadHandles()
+    const
+{
+	const std::thread::id self = std::this_thread::get_id();
+	std::lock_guard<std::mutex> lock(this->_readHandles->mutex);
+
+	auto it = this->_readHandles->handles.find(self);
+	if (it != this->_readHandles->handles.end())
+		return (it->second);
+
+	/*
+	 * A Berkeley DB 1.x handle caches pages and returns pointers into
+	 * that cache, so each reading thread needs handles of its own.
+	 */
+	ReadHandles handles = this->openReadHandles();
+	this->_readHandles->handles[self] = handles;
+
+	/* Close the handles when this thread exits, if the store is open */
+	auto &registries = _threadRegistrations.registries;
+	registries.erase(std::remove_if(registries.begin(), registries.end(),
+	    [](const std::weak_ptr<ReadHandleRegistry> &registry) {
+		return (registry.expired());
+	    }), registries.end());
+	registries.push_back(this->_readHandles);
+
+	return (handles);
+}
+
+BiometricEvaluation::IO::DBRecordStore::Impl::ReadHandles
+BiometricEvaluation::IO::DBRecordStore::Impl::openReadHandles()
+    const
+{
+	BTREEINFO bti;
+	setBtreeInfo(&bti);
+	ReadHandles handles;
+	handles.primary = dbopen(this->_dbnameP.c_str(),
+	    O_RDONLY, DBRS_MODE_R, DB_BTREE, &bti);
+	if (handles.primary == nullptr)
+		throw Error::StrategyError("Could not open primary DB (" +
+		    Error::errorStr() + ")");
+	handles.subordinate = nullptr;
+	if (this->_dbS != nullptr) {
+		handles.subordinate = dbopen(this->_dbnameS.c_str(),
+		    O_RDONLY, DBRS_MODE_R, DB_BTREE, &bti);
+		if (handles.subordinate == nullptr) {
+			handles.primary->close(handles.primary);
+			throw Error::StrategyError("Could not open "
+			    "subordinate DB (" + Error::errorStr() + ")");
+		}
+	}
+	return (handles);
+}
+
+void
+BiometricEvaluation::IO::DBRecordStore::Impl::ReadHandleRegistry::
+release(
+    std::thread::id thread)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	auto it = this->handles.find(thread);
+	if (it == this->handles.end())
+		return;
+	if (it->second.primary != nullptr)
+		it->second.primary->close(it->second.primary);
+	if (it->second.subordinate != nullptr)
+		it->second.subordinate->close(it->second.subordinate);
+	this->handles.erase(it);
+}
+
+void
+BiometricEvaluation::IO::DBRecordStore::Impl::ReadHandleRegistry::
+releaseAll()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	for (auto &handles : this->handles) {
+		if (handles.second.primary != nullptr)
+			handles.second.primary->close(handles.second.primary);
+		if (handles.second.subordinate != nullptr)
+			handles.second.subordinate->close(
+			    handles.second.subordinate);
+	}
+	this->handles.clear();
+}
+
+thread_local BiometricEvaluation::IO::DBRecordStore::Impl::ThreadRegistrations
+BiometricEvaluation::IO::DBRecordStore::Impl::_threadRegistrations;
+
+BiometricEvaluation::IO::DBRecordStore::Impl::ThreadRegistrations::
+~ThreadRegistrations()
+{
+	const std::thread::id self = std::this_thread::get_id();
+	for (const auto &registry : this->registries) {
+		const std::shared_ptr<ReadHandleRegistry> open =
+		    registry.lock();
+		if (open)
+			open->release(self);
+	}
+}
+
 /*
  * Function to read all components of a record from the database.
  */
@@ -598,6 +877,28 @@ BiometricEvaluation::IO::DBRecordStore::Impl::readRecordSegments(
     const std::string &key,
     void *const data)
     const
+{
+	/*
+	 * Stores opened read-only may be read from many threads at once,
+	 * each through its own handles. Otherwise, reads are not
+	 * thread-safe and use the handles that are also used for writing.
+	 */
+	if ((getMode() == Mode::ReadOnly) &&
+	    (std::this_thread::get_id() != this->_ownerThread)) {
+		ReadHandles handles = this->getReadHandles();
+		return (this->readRecordSegments(key, data, handles.primary,
+		    handles.subordinate));
+	}
+	return (this->readRecordSegments(key, data, this->_dbP, this->_dbS));
+}
+
+uint64_t
+BiometricEvaluation::IO::DBRecordStore::Impl::readRecordSegments(
+    const std::string &key,
+    void *const data,
+    DB *primary,
+    DB *subordinate)
+    const
 {
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
@@ -611,7 +912,7 @@ BiometricEvaluation::IO::DBRecordStore::Impl::readRecordSegments(
 	int segnum = KEY_SEGMENT_START;
 	std::string keyseg = key;  /* First segment key is same as input key */
 	uint8_t *ptr = (uint8_t*)data;
-	DB *DBin = this->_dbP;	/* Start with the primary DB file */
+	DB *DBin = primary;	/* Start with the primary DB file */
 	do {
 		dbtkey.data = (void *)keyseg.data();
 		dbtkey.size = keyseg.length();
@@ -626,10 +927,10 @@ BiometricEvaluation::IO::DBRecordStore::Impl::readRecordSegments(
 				keyseg = genKeySegName(key, segnum);
 				segnum++;
 				/* Switch to the subordinate DB */
-				DBin = this->_dbS;
+				DBin = subordinate;
 				break;
 			case 1:
-				if (DBin == this->_dbP) /* first time through */
+				if (DBin == primary) /* first time through */
 					throw Error::ObjectDoesNotExist(
 					    "Key not in database");
 				else
@@ -10,7 +10,11 @@
 #ifndef __BE_DBRECSTORE_IMPL_H__
 #define __BE_DBRECSTORE_IMPL_H__
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "be_io_recordstore_impl.h"
@@ -115,6 +119,10 @@ namespace BiometricEvaluation {
 			void move(
 			    const std::string &pathname);
 
+			std::vector<std::shared_ptr<RecordStore::Partition>>
+			partition(
+			    unsigned int count);
+
 			/* Prevent copying of DBRecordStore::Impl objects */
 			Impl(const DBRecordStore::Impl&) = delete;
 			Impl&
@@ -137,11 +145,115 @@ namespace BiometricEvaluation {
 			 */
 			DB *_dbS;
 
+			/*
+			 * Database handles used by a single thread to read
+			 * records from a store opened read-only.
+			 */
+			struct ReadHandles
+			{
+				DB *primary;
+				DB *subordinate;
+			};
+
+			/*
+			 * Read handles for each thread that has read from
+			 * the store. The thread that opened the store uses
+			 * _dbP and _dbS.
+			 */
+			struct ReadHandleRegistry
+			{
+				std::mutex mutex;
+				std::map<std::thread::id, ReadHandles> handles;
+
+				/* Close the handles of thread, if any */
+				void release(std::thread::id thread);
+				/* Close the handles of all threads */
+				void releaseAll();
+			};
+
+			/*
+			 * Shared with each reading thread, so that a thread
+			 * that exits first can close its own handles.
+			 */
+			const std::shared_ptr<ReadHandleRegistry> _readHandles;
+
+			/*
+			 * Registries in which a thread holds handles, which
+			 * it releases when it exits.
+			 */
+			struct ThreadRegistrations
+			{
+				std::vector<std::weak_ptr<ReadHandleRegistry>>
+				    registries;
+
+				~ThreadRegistrations();
+			};
+			static thread_local ThreadRegistrations
+			    _threadRegistrations;
+
+			/* The thread that opened the store */
+			const std::thread::id _ownerThread;
+
 			/*
 			 * Return the path to the underlying DB file.
 			 */
 			std::string getDBFilePathname() const;
 
+			/*
+			 * Open new read-only handles to the database files.
+			 */
+			ReadHandles openReadHandles() const;
+
+			/*
+			 * Obtain the read handles for the calling thread,
+			 * opening them if needed.
+			 */
+			ReadHandles getReadHandles() const;
+
+			/*
+			 * A range of keys of the primary DB, read with a
+			 * cursor of its own. Empty bounds are unbounded.
+			 */
+			class KeyRangePartition : public RecordStore::Partition
+			{
+			public:
+				KeyRangePartition(
+				    const DBRecordStore::Impl *store,
+				    const std::string &first,
+				    const std::string &last);
+
+				~KeyRangePartition();
+
+				RecordStore::Record
+				sequence(
+				    int cursor)
+				    override;
+
+				std::string
+				sequenceKey(
+				    int cursor)
+				    override;
+
+			private:
+				const DBRecordStore::Impl *_store;
+				/* First key of the range */
+				const std::string _first;
+				/* Key after the end of the range */
+				const std::string _last;
+				/* Handles opened by the sequencing thread */
+				ReadHandles _handles;
+				/* Whether the cursor is within the range */
+				bool _started;
+				/* Whether the end of the range was reached */
+				bool _ended;
+
+				RecordStore::Record
+				i_sequence(
+				    bool returnData,
+				    int cursor);
+			};
+
+
 			/*
 			 * Functions to insert/read/sequence/remove all
 			 * segments of a record. 
@@ -153,6 +265,12 @@ namespace BiometricEvaluation {
 			    const std::string &key,
 			    void *const data) const;
 
+			uint64_t readRecordSegments(
+			    const std::string &key,
+			    void *const data,
+			    DB *primary,
+			    DB *subordinate) const;
+
 			void removeRecordSegments(const std::string &key);
 
 			/**
@@ -12,14 +12,19 @@
 
 namespace BE = BiometricEvaluation;
 
+const unsigned int BiometricEvaluation::IO::FileRecordStore::MAX_FANOUT_DEPTH =
+    4;
+
 BiometricEvaluation::IO::FileRecordStore::FileRecordStore(
     const std::string &pathname,
-    const std::string &description)
+    const std::string &description,
+    const unsigned int fanOutDepth)
 {
 	/*
 	 * Exceptions float out.
 	 */
-	this->pimpl.reset(new IO::FileRecordStore::Impl(pathname, description));
+	this->pimpl.reset(new IO::FileRecordStore::Impl(pathname, description,
+	    fanOutDepth));
 }
 
 BiometricEvaluation::IO::FileRecordStore::FileRecordStore(
@@ -80,6 +85,15 @@ BiometricEvaluation::IO::FileRecordStore::read(
 	return (this->pimpl->read(key));
 }
 
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::FileRecordStore::readPrefix(
+    const std::string &key,
+    uint64_t size)
+    const
+{
+	return (this->pimpl->readPrefix(key, size));
+}
+
 void
 BiometricEvaluation::IO::FileRecordStore::replace(
     const std::string &key,
@@ -154,3 +168,17 @@ BiometricEvaluation::IO::FileRecordStore::changeDescription(
 	return (this->pimpl->changeDescription(description));
 }
 
+void
+BiometricEvaluation::IO::FileRecordStore::adviseSequentialRead(
+    unsigned int records)
+{
+	this->pimpl->adviseSequentialRead(records);
+}
+
+
+unsigned int
+BiometricEvaluation::IO::FileRecordStore::getFanOutDepth()
+    const
+{
+	return (this->pimpl->getFanOutDepth());
+}
@@ -10,46 +10,103 @@
 
 #include <sys/stat.h>
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
 
 #include <be_error.h>
 #include <be_error_exception.h>
 #include <be_io_utility.h>
+#include <be_text.h>
 
 #include "be_io_filerecstore_impl.h"
 
 namespace BE = BiometricEvaluation;
 
 static const std::string _fileArea = "theFiles";
+static const std::string _indexFile = "theFiles.index";
+static const std::string FANOUT_DEPTH_PROPERTY{"Fan-out Depth"};
 
 BiometricEvaluation::IO::FileRecordStore::Impl::Impl(
     const std::string &pathname,
-    const std::string &description) :
-    RecordStore::Impl(pathname, description, RecordStore::Kind::File)
+    const std::string &description,
+    const unsigned int fanOutDepth) :
+    RecordStore::Impl(pathname, description, RecordStore::Kind::File),
+    _indexBlocks(0),
+    _indexSaved(false),
+    _fanOutDepth(fanOutDepth)
 {
-	_cursorPos = 1;
+	if (fanOutDepth > FileRecordStore::MAX_FANOUT_DEPTH)
+		throw Error::ParameterError("Fan-out depth may not exceed " +
+		    std::to_string(FileRecordStore::MAX_FANOUT_DEPTH));
+
+	_cursorPos = _keys.end();
 	_theFilesDir = RecordStore::Impl::canonicalName(_fileArea);
 	if (mkdir(_theFilesDir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) != 0)
 		throw Error::StrategyError("Could not create file area "
 		    "directory (" + Error::errorStr() + ")");
-	return;
+
+	this->setCoreProperty(FANOUT_DEPTH_PROPERTY,
+	    std::to_string(fanOutDepth));
+	this->sync();
 }
 
 BiometricEvaluation::IO::FileRecordStore::Impl::Impl(
     const std::string &pathname,
     IO::Mode mode) :
-    RecordStore::Impl(pathname, mode)
+    RecordStore::Impl(pathname, mode),
+    _indexBlocks(0),
+    _indexSaved(false),
+    _fanOutDepth(0)
 {
-	_cursorPos = 1;
+	_cursorPos = _keys.end();
 	_theFilesDir = RecordStore::Impl::canonicalName(_fileArea);
-	if (mkdir(_theFilesDir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) != 0)
-	return;
+	/* Recreate the file area if it is missing */
+	(void)mkdir(_theFilesDir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+
+	/* Stores created before fan-out was supported have none */
+	unsigned long depth;
+	try {
+		depth = std::stoul(this->getCoreProperty(
+		    FANOUT_DEPTH_PROPERTY));
+	} catch (Error::ObjectDoesNotExist) {
+		depth = 0;
+	} catch (std::exception &e) {
+		throw Error::StrategyError("Invalid " + FANOUT_DEPTH_PROPERTY);
+	}
+	if (depth > FileRecordStore::MAX_FANOUT_DEPTH)
+		throw Error::StrategyError("Invalid " + FANOUT_DEPTH_PROPERTY);
+	_fanOutDepth = static_cast<unsigned int>(depth);
+
+	this->loadIndex();
+}
+
+bool
+BiometricEvaluation::IO::FileRecordStore::Impl::isKeyCoreProperty(
+    const std::string &key)
+    const
+{
+	return ((key == FANOUT_DEPTH_PROPERTY) ||
+	    RecordStore::Impl::isKeyCoreProperty(key));
 }
 
 BiometricEvaluation::IO::FileRecordStore::Impl::~Impl()
 {
+	try {
+		this->saveIndex();
+	} catch (Error::Exception) {
+		/* The index is rebuilt when the store is next opened */
+	}
 }
 
 void
@@ -59,6 +116,7 @@ BiometricEvaluation::IO::FileRecordStore::Impl::move(
 	if (getMode() == Mode::ReadOnly)
 		throw Error::StrategyError("RecordStore was opened read-only");
 
+	this->saveIndex();
 	RecordStore::Impl::move(pathname);
 	_theFilesDir = RecordStore::Impl::canonicalName(_fileArea);
 }
@@ -68,39 +126,32 @@ BiometricEvaluation::IO::FileRecordStore::Impl::getSpaceUsed()
     const
 {
 	this->sync();
-	
-	DIR *dir;
-	dir = opendir(this->_theFilesDir.c_str());
-	if (dir == nullptr)
-		throw Error::StrategyError("Cannot open store directory");
 
-	uint64_t total = RecordStore::Impl::getSpaceUsed();
-	struct dirent *entry;
+	uint64_t total = RecordStore::Impl::getSpaceUsed() +
+	    (_indexBlocks * S_BLKSIZE);
 	struct stat sb;
-	std::string cname;
-	while ((entry = readdir(dir)) != nullptr) {
-		if (entry->d_ino == 0)
-			continue;
-		cname = entry->d_name;
-		cname = FileRecordStore::Impl::canonicalName(cname);
-		if (stat(cname.c_str(), &sb) != 0)	
-			throw Error::StrategyError("Cannot stat store file (" +
-			    Error::errorStr() + ")");
-		if ((S_IFMT & sb.st_mode) == S_IFDIR)	/* skip '.' and '..' */
-			continue;
+	if (stat(RecordStore::Impl::canonicalName(_indexFile).c_str(),
+	    &sb) == 0)
 		total += sb.st_blocks * S_BLKSIZE;
-	}	
-
-	if (dir != nullptr) {
-		if (closedir(dir)) {
-			throw Error::StrategyError("Could not close " + 
-			    this->_theFilesDir + "(" + Error::errorStr() + ")");
-		}
-	}
 
 	return (total);
 }
 
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::sync()
+    const
+{
+	this->saveIndex();
+	RecordStore::Impl::sync();
+}
+
+unsigned int
+BiometricEvaluation::IO::FileRecordStore::Impl::getFanOutDepth()
+    const
+{
+	return (_fanOutDepth);
+}
+
 void
 BiometricEvaluation::IO::FileRecordStore::Impl::insert( 
     const std::string &key,
@@ -112,15 +163,13 @@ BiometricEvaluation::IO::FileRecordStore::Impl::insert(
 
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
-	std::string pathname = FileRecordStore::Impl::canonicalName(key);
-	if (IO::Utility::fileExists(pathname))
+	if (_index.find(key) != _index.end())
 		throw Error::ObjectExists();
 
-	try {
-		writeNewRecordFile(pathname, data, size);
-	} catch (Error::StrategyError& e) {
-		throw;
-	}
+	this->invalidateSavedIndex();
+	uint64_t blocks = writeNewRecordFile(
+	    FileRecordStore::Impl::canonicalName(key), data, size);
+	this->addToIndex(key, blocks);
 	RecordStore::Impl::insert(key, data, size);
 }
 
@@ -133,13 +182,22 @@ BiometricEvaluation::IO::FileRecordStore::Impl::remove(
 
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
-	std::string pathname = FileRecordStore::Impl::canonicalName(key);
-	if (!IO::Utility::fileExists(pathname))
+	auto entry = _index.find(key);
+	if (entry == _index.end())
 		throw Error::ObjectDoesNotExist();
 
+	std::string pathname = FileRecordStore::Impl::canonicalName(key);
+	this->invalidateSavedIndex();
 	if (std::remove(pathname.c_str()) != 0)
 		throw Error::StrategyError("Could not remove " + pathname);
 
+	/* Sequencing continues with the record after the one removed */
+	if (_cursorPos == entry->second.position)
+		_cursorPos++;
+	_keys.erase(entry->second.position);
+	_indexBlocks -= entry->second.blocks;
+	_index.erase(entry);
+
 	RecordStore::Impl::remove(key);
 }
 
@@ -147,15 +205,24 @@ BiometricEvaluation::Memory::uint8Array
 BiometricEvaluation::IO::FileRecordStore::Impl::read(
     const std::string &key)
     const
+{
+	return (this->readPrefix(key, std::numeric_limits<uint64_t>::max()));
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::FileRecordStore::Impl::readPrefix(
+    const std::string &key,
+    uint64_t size)
+    const
 {
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
-	std::string pathname = FileRecordStore::Impl::canonicalName(key);
-	if (!IO::Utility::fileExists(pathname))
+	if (_index.find(key) == _index.end())
 		throw Error::ObjectDoesNotExist();
+	std::string pathname = FileRecordStore::Impl::canonicalName(key);
 
 	/* Allow exceptions to propagate out of here */
-	uint64_t size = IO::Utility::getFileSize(pathname);
+	size = std::min(size, IO::Utility::getFileSize(pathname));
 	std::FILE *fp = std::fopen(pathname.c_str(), "rb");
 	if (fp == nullptr)
 		throw Error::StrategyError("Could not open " + pathname + 
@@ -165,7 +232,7 @@ BiometricEvaluation::IO::FileRecordStore::Impl::read(
 	std::size_t sz = fread(data, 1, size, fp);
 	std::fclose(fp);
 	if (sz != size)
-		throw Error::StrategyError("Could not write " + pathname + 
+		throw Error::StrategyError("Could not read " + pathname + 
 		    " (" + Error::errorStr() + ")");
 	return(data);
 }
@@ -181,15 +248,15 @@ BiometricEvaluation::IO::FileRecordStore::Impl::replace(
 
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
-	std::string pathname = FileRecordStore::Impl::canonicalName(key);
-	if (!IO::Utility::fileExists(pathname))
+	auto entry = _index.find(key);
+	if (entry == _index.end())
 		throw Error::ObjectDoesNotExist();
 
-	try {
-		writeNewRecordFile(pathname, data, size);
-	} catch (Error::StrategyError& e) {
-		throw;
-	}
+	this->invalidateSavedIndex();
+	uint64_t blocks = writeNewRecordFile(
+	    FileRecordStore::Impl::canonicalName(key), data, size);
+	_indexBlocks = _indexBlocks - entry->second.blocks + blocks;
+	entry->second.blocks = blocks;
 }
 
 uint64_t
@@ -199,11 +266,11 @@ BiometricEvaluation::IO::FileRecordStore::Impl::length(
 {
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
-	std::string pathname = FileRecordStore::Impl::canonicalName(key);
-	if (!IO::Utility::fileExists(pathname))
+	if (_index.find(key) == _index.end())
 		throw Error::ObjectDoesNotExist();
 
-	return (IO::Utility::getFileSize(pathname));
+	return (IO::Utility::getFileSize(
+	    FileRecordStore::Impl::canonicalName(key)));
 }
 
 void
@@ -216,8 +283,7 @@ BiometricEvaluation::IO::FileRecordStore::Impl::flush(
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
 
-	std::string pathname = FileRecordStore::Impl::canonicalName(key);
-	if (!IO::Utility::fileExists(pathname))
+	if (_index.find(key) == _index.end())
 		throw Error::ObjectDoesNotExist();
 
 	/*
@@ -236,56 +302,38 @@ BiometricEvaluation::IO::FileRecordStore::Impl::i_sequence(
 		throw Error::StrategyError("Invalid cursor position as "
 		    "argument");
 
-	DIR *dir;
-	dir = opendir(_theFilesDir.c_str());
-	if (dir == nullptr)
-		throw Error::StrategyError("Cannot open store directory");
-
 	/* If the current cursor position is START, then it doesn't matter
 	 * what the client requests; we start at the first record.
 	*/
+	bool restarted = false;
 	if ((getCursor() == BE_RECSTORE_SEQ_START) ||
-	    (cursor == BE_RECSTORE_SEQ_START))
-		_cursorPos = 1;
+	    (cursor == BE_RECSTORE_SEQ_START)) {
+		_cursorPos = _keys.begin();
+		restarted = true;
+	}
 
-	if (_cursorPos > getCount())	/* Client needs to start over */
+	if (_cursorPos == _keys.end())	/* Client needs to start over */
 		throw Error::ObjectDoesNotExist("No record at position");
 
-	struct dirent *entry;
-	struct stat sb;
-	uint64_t i = 1;
-	std::string cname;
-	while ((entry = readdir(dir)) != nullptr) {
-		if (entry->d_ino == 0)
-			continue;
-		cname = _theFilesDir + "/" + entry->d_name;
-		if (stat(cname.c_str(), &sb) != 0)	
-			throw Error::StrategyError("Cannot stat store file (" +
-			    Error::errorStr() + ")");
-		if ((S_IFMT & sb.st_mode) == S_IFDIR)	/* skip '.' and '..' */
-			continue;
-		if (i == _cursorPos)
-			break;
-		i++;
-	}	
-	/* Sanity check */
-	if (i > _cursorPos)
-		throw Error::StrategyError("Record cursor position out of "
-		    "sync");
+	/*
+	 * Keep the file _readAhead records past this one requested, having
+	 * requested all of those before it when sequencing (re)started.
+	 */
+	if (returnData && (_readAhead > 0)) {
+		auto ahead = _cursorPos;
+		for (unsigned int i = 1; i <= _readAhead; i++) {
+			if (++ahead == _keys.end())
+				break;
+			if (restarted || (i == _readAhead))
+				this->adviseWillNeed(**ahead);
+		}
+	}
 
 	BE::IO::RecordStore::Record record;
-	record.key = entry->d_name;
+	record.key = **_cursorPos;
 	setCursor(BE_RECSTORE_SEQ_NEXT);
-	_cursorPos = i + 1;
+	_cursorPos++;
 
-	if (dir != nullptr) {
-		if (closedir(dir)) {
-			throw Error::StrategyError("Could not close " + 
-			    _theFilesDir + " (" + Error::errorStr() + 
-			    ")");
-		}
-	}
-	
 	if (returnData)
 		record.data = FileRecordStore::Impl::read(record.key);
 	return (record);
@@ -313,73 +361,235 @@ BiometricEvaluation::IO::FileRecordStore::Impl::setCursorAtKey(
 	if (!validateKeyString(key))
 		throw Error::StrategyError("Invalid key format");
 
-	DIR *dir;
-	dir = opendir(_theFilesDir.c_str());
-	if (dir == nullptr)
-		throw Error::StrategyError("Cannot open store directory");
-
-	struct dirent *entry;
-	struct stat sb;
-	int i = 1;
-	std::string cname;
-	while ((entry = readdir(dir)) != nullptr) {
-		if (entry->d_ino == 0)
-			continue;
-		cname = _theFilesDir + "/" + entry->d_name;
-		if (stat(cname.c_str(), &sb) != 0)	
-			throw Error::StrategyError("Cannot stat store file (" +
-			    Error::errorStr() + ")");
-		if ((S_IFMT & sb.st_mode) == S_IFDIR)	/* skip '.' and '..' */
-			continue;
-		if (key == entry->d_name) {
-			_cursorPos = i;
-			break;
-		}
-		i++;
-	}
-
-	/* Exited the loop by exhausting the directory */
-	if (entry == nullptr)
+	auto entry = _index.find(key);
+	if (entry == _index.end())
 		throw Error::ObjectDoesNotExist(key);
+	_cursorPos = entry->second.position;
+}
 
-	if (dir != nullptr) {
-		if (closedir(dir)) {
-			throw Error::StrategyError("Could not close " + 
-			    _theFilesDir + " (" + Error::errorStr() + 
-			    ")");
-		}
-	}
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::adviseSequentialRead(
+    unsigned int records)
+{
+	_readAhead = records;
+
+	/* Catch up when advised in the middle of sequencing */
+	if ((records == 0) || (getCursor() == BE_RECSTORE_SEQ_START))
+		return;
+	auto ahead = _cursorPos;
+	for (unsigned int i = 0; (i < records) && (ahead != _keys.end());
+	    i++, ahead++)
+		this->adviseWillNeed(**ahead);
 }
 
 /******************************************************************************/
 /* Private method implementations.                                            */
 /******************************************************************************/
 
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::adviseWillNeed(
+    const std::string &key)
+    const
+{
+	/* Advice only, so failures are not reported */
+	const int fd = open(this->canonicalName(key).c_str(), O_RDONLY);
+	if (fd == -1)
+		return;
+	(void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+	close(fd);
+}
+
 /*
  * Writes a file, replacing any data that previously existed in the file.
  */
-void
+uint64_t
 BiometricEvaluation::IO::FileRecordStore::Impl::writeNewRecordFile( 
     const std::string &name,
     const void *data,
     const uint64_t size)
 {
 	std::FILE *fp = std::fopen(name.c_str(), "wb");
+	if ((fp == nullptr) && (errno == ENOENT) && (_fanOutDepth > 0)) {
+		/* First record in this subdirectory */
+		if (IO::Utility::makePath(Text::dirname(name),
+		    S_IRWXU | S_IRWXG | S_IRWXO) != 0)
+			throw Error::StrategyError("Could not create " +
+			    Text::dirname(name) + " (" + Error::errorStr() +
+			    ")");
+		fp = std::fopen(name.c_str(), "wb");
+	}
 	if (fp == nullptr)
 		throw Error::StrategyError("Could not open " + name + " (" + 
 		    Error::errorStr() + ")");
 
 	std::size_t sz = fwrite(data, 1, size, fp);
+	struct stat sb;
+	int rv = std::fflush(fp);
+	if (rv == 0)
+		rv = fstat(fileno(fp), &sb);
 	std::fclose(fp);
-	if (sz != size)
+	if ((sz != size) || (rv != 0))
 		throw Error::StrategyError("Could not write " + name + " (" +
 		    Error::errorStr() + ")");
+	return (sb.st_blocks);
 }
 
 std::string
 BiometricEvaluation::IO::FileRecordStore::Impl::canonicalName(
     const std::string &name) const
 {
-	return(_theFilesDir + '/' + name);
+	return(this->recordDirectory(name) + '/' + name);
+}
+
+std::string
+BiometricEvaluation::IO::FileRecordStore::Impl::recordDirectory(
+    const std::string &key)
+    const
+{
+	if (_fanOutDepth == 0)
+		return (_theFilesDir);
+
+	const uint64_t hash = hashKey(key);
+
+	std::stringstream directory;
+	directory << _theFilesDir << std::hex << std::setfill('0');
+	for (unsigned int level = 0; level < _fanOutDepth; level++)
+		directory << '/' << std::setw(2) <<
+		    ((hash >> (8 * level)) & 0xFF);
+	return (directory.str());
+}
+
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::addToIndex(
+    const std::string &key,
+    uint64_t blocks)
+{
+	auto entry = _index.emplace(key, IndexEntry()).first;
+	entry->second.position = _keys.insert(_keys.end(), &entry->first);
+	entry->second.blocks = blocks;
+	_indexBlocks += blocks;
+
+	/* A cursor that had run off the end picks up the new record */
+	if (_cursorPos == _keys.end())
+		_cursorPos = entry->second.position;
+}
+
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::loadIndex()
+{
+	/*
+	 * The saved index is a count of records, followed by one line per
+	 * record, in sequence order, of blocks, key length, and key.
+	 */
+	std::ifstream in(RecordStore::Impl::canonicalName(_indexFile));
+	uint64_t count = 0;
+	if (in && (in >> count) && (count == this->getCount())) {
+		uint64_t blocks, length;
+		std::string key;
+		for (uint64_t i = 0; i < count; i++) {
+			if (!(in >> blocks >> length) || (in.get() != ' '))
+				break;
+			key.resize(length);
+			if (!in.read(&key[0], length) || (in.get() != '\n'))
+				break;
+			if (_index.find(key) != _index.end())
+				break;
+			this->addToIndex(key, blocks);
+		}
+		if (_index.size() == count) {
+			_indexSaved = true;
+			return;
+		}
+	}
+
+	/* Missing or stale, so rebuild from the record files */
+	_keys.clear();
+	_index.clear();
+	_indexBlocks = 0;
+	_cursorPos = _keys.end();
+	this->scanDirectory(_theFilesDir, _fanOutDepth);
+	if (getMode() == Mode::ReadWrite)
+		this->saveIndex();
 }
 
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::scanDirectory(
+    const std::string &directory,
+    unsigned int depth)
+{
+	DIR *dir;
+	dir = opendir(directory.c_str());
+	if (dir == nullptr)
+		throw Error::StrategyError("Cannot open store directory");
+
+	struct dirent *entry;
+	struct stat sb;
+	std::string cname;
+	try {
+		while ((entry = readdir(dir)) != nullptr) {
+			if (entry->d_ino == 0)
+				continue;
+			if ((strcmp(entry->d_name, ".") == 0) ||
+			    (strcmp(entry->d_name, "..") == 0))
+				continue;
+			cname = directory + "/" + entry->d_name;
+			if (stat(cname.c_str(), &sb) != 0)
+				throw Error::StrategyError("Cannot stat store "
+				    "file (" + Error::errorStr() + ")");
+			if ((S_IFMT & sb.st_mode) == S_IFDIR) {
+				if (depth > 0)
+					this->scanDirectory(cname, depth - 1);
+				continue;
+			}
+			if (depth == 0)
+				this->addToIndex(entry->d_name, sb.st_blocks);
+		}
+	} catch (Error::Exception) {
+		closedir(dir);
+		throw;
+	}
+
+	if (closedir(dir)) {
+		throw Error::StrategyError("Could not close " + directory +
+		    " (" + Error::errorStr() + ")");
+	}
+}
+
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::saveIndex()
+    const
+{
+	if ((getMode() == Mode::ReadOnly) || _indexSaved)
+		return;
+
+	/* Replace the saved index atomically */
+	const std::string indexPath =
+	    RecordStore::Impl::canonicalName(_indexFile);
+	const std::string tempPath = indexPath + ".tmp";
+	std::ofstream out(tempPath, std::ios_base::trunc);
+	out << _index.size() << '\n';
+	for (const auto key : _keys)
+		out << _index.at(*key).blocks << ' ' << key->length() << ' ' <<
+		    *key << '\n';
+	out.close();
+	if (!out)
+		throw Error::StrategyError("Could not write " + tempPath);
+	if (rename(tempPath.c_str(), indexPath.c_str()) != 0)
+		throw Error::StrategyError("Could not rename " + tempPath +
+		    " (" + Error::errorStr() + ")");
+	_indexSaved = true;
+}
+
+void
+BiometricEvaluation::IO::FileRecordStore::Impl::invalidateSavedIndex()
+{
+	if (!_indexSaved)
+		return;
+
+	const std::string indexPath =
+	    RecordStore::Impl::canonicalName(_indexFile);
+	if ((std::remove(indexPath.c_str()) != 0) && (errno != ENOENT))
+		throw Error::StrategyError("Could not remove " + indexPath +
+		    " (" + Error::errorStr() + ")");
+	_indexSaved = false;
+}
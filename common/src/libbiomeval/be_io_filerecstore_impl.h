@@ -10,6 +10,9 @@
 #ifndef __BE_FILERECSTORE_IMPL_H__
 #define __BE_FILERECSTORE_IMPL_H__
 
+#include <list>
+#include <unordered_map>
+
 #include "be_io_recordstore_impl.h"
 #include <be_io_filerecstore.h>
 
@@ -41,15 +44,21 @@ namespace BiometricEvaluation {
 			 *	The directory where the store is to be created.
 			 * @param[in] description
 			 *	The store's description.
+			 * @param[in] fanOutDepth
+			 *	Levels of hashed subdirectories over which to
+			 *	spread record files.
 			 * @throw  Error::ObjectExists
 			 *	The store already exists.
+			 * @throw Error::ParameterError
+			 *	fanOutDepth exceeds MAX_FANOUT_DEPTH.
 			 * @throw Error::StrategyError
 			 * 	An error occurred when accessing the underlying
 			 * 	file system.
 			 */
 			Impl(
 			    const std::string &pathname,
-			    const std::string &description);
+			    const std::string &description,
+			    const unsigned int fanOutDepth = 0);
 
 			/**
 			 * Open an existing FileRecordStore.
@@ -76,6 +85,8 @@ namespace BiometricEvaluation {
 			 */
 			uint64_t getSpaceUsed() const;
 
+			void sync() const;
+
 			void insert(
 			    const std::string &key,
 			    const void *const data,
@@ -87,6 +98,10 @@ namespace BiometricEvaluation {
 			Memory::uint8Array read(
 			    const std::string &key) const;
 
+			Memory::uint8Array readPrefix(
+			    const std::string &key,
+			    uint64_t size) const;
+
 			void replace(
 			    const std::string &key,
 			    const void *const data,
@@ -106,6 +121,10 @@ namespace BiometricEvaluation {
 
 			void move(const std::string &pathname);
 
+			void adviseSequentialRead(unsigned int records);
+
+			unsigned int getFanOutDepth() const;
+
 			/* Prevent copying of FileRecordStore objects */
 			Impl(const FileRecordStore&) = delete;
 			Impl& operator=(const FileRecordStore&) = delete;
@@ -114,14 +133,128 @@ namespace BiometricEvaluation {
 			std::string canonicalName(
 			    const std::string &name) const;
 
+			/* The fan-out depth is fixed when the store is made */
+			bool isKeyCoreProperty(
+			    const std::string &key) const override;
+
 		private:
-			void writeNewRecordFile(
+			/**
+			 * Write a record file, replacing any existing file.
+			 *
+			 * @return
+			 *	Number of 512-byte blocks allocated to the file.
+			 */
+			uint64_t writeNewRecordFile(
 			    const std::string &name, 
 			    const void *data,
 			    const uint64_t size);
 
-			uint64_t _cursorPos;
+			/** Keys, in sequence order */
+			using KeyList = std::list<const std::string*>;
+
+			/** Index entry for one record */
+			struct IndexEntry
+			{
+				/** Position of the key in _keys */
+				KeyList::iterator position;
+				/** 512-byte blocks allocated to the file */
+				uint64_t blocks;
+			};
+
+			/** Sequence order of the keys in _index */
+			KeyList _keys;
+			/** Every record in the store */
+			std::unordered_map<std::string, IndexEntry> _index;
+			/** Sum of the blocks of every record */
+			uint64_t _indexBlocks;
+			/** Whether the saved index matches _index */
+			mutable bool _indexSaved;
+
+			/** Next record to be sequenced */
+			KeyList::iterator _cursorPos;
 			std::string _theFilesDir;
+			/** Levels of hashed subdirectories */
+			unsigned int _fanOutDepth;
+			/** Record files requested ahead of _cursorPos */
+			unsigned int _readAhead{0};
+
+			/**
+			 * @brief
+			 * Ask the operating system to read a record file
+			 * into the page cache.
+			 *
+			 * @param[in] key
+			 *	Key of the record.
+			 */
+			void
+			adviseWillNeed(
+			    const std::string &key)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the directory that holds a key's file.
+			 *
+			 * @param[in] key
+			 *	Key of the record.
+			 *
+			 * @return
+			 *	Path to the directory, which may not exist.
+			 */
+			std::string
+			recordDirectory(
+			    const std::string &key)
+			    const;
+
+			/**
+			 * @brief
+			 * Add a record to the index, after any others.
+			 */
+			void
+			addToIndex(
+			    const std::string &key,
+			    uint64_t blocks);
+
+			/**
+			 * @brief
+			 * Populate the index from the saved index when it is
+			 * current, or else from the record files.
+			 */
+			void
+			loadIndex();
+
+			/**
+			 * @brief
+			 * Add every record file beneath a directory to the
+			 * index.
+			 *
+			 * @param[in] directory
+			 *	Directory to read.
+			 * @param[in] depth
+			 *	Levels of subdirectories beneath directory
+			 *	that hold record files.
+			 */
+			void
+			scanDirectory(
+			    const std::string &directory,
+			    unsigned int depth);
+
+			/**
+			 * @brief
+			 * Save the index, if it has changed, so that it
+			 * may be reloaded when the store is next opened.
+			 */
+			void
+			saveIndex()
+			    const;
+
+			/**
+			 * @brief
+			 * Note that the index is about to change, removing
+			 * any saved copy so a crash cannot leave it stale.
+			 */
+			void
+			invalidateSavedIndex();
 
 			/**
 			 * Internal implementation of sequencing through a
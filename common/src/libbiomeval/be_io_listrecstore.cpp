@@ -15,6 +15,9 @@
 
 namespace BE = BiometricEvaluation;
 
+const unsigned int BiometricEvaluation::IO::ListRecordStore::
+    DEFAULT_PREFETCH_DEPTH = 16;
+
 BiometricEvaluation::IO::ListRecordStore::ListRecordStore(
     const std::string &pathname)
 {
@@ -151,3 +154,23 @@ BiometricEvaluation::IO::ListRecordStore::replace(
 	this->pimpl->CRUDMethodCalled();
 }
 
+void
+BiometricEvaluation::IO::ListRecordStore::setCursorAtPosition(
+    uint64_t position)
+{
+	this->pimpl->setCursorAtPosition(position);
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::setPrefetchDepth(
+    unsigned int depth)
+{
+	this->pimpl->setPrefetchDepth(depth);
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::indexKeyList(
+    const std::string &pathname)
+{
+	ListRecordStore::Impl::indexKeyList(pathname);
+}
@@ -9,6 +9,11 @@
  */
 
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 
 #include "be_io_listrecstore_impl.h"
@@ -18,16 +23,87 @@
 namespace BE = BiometricEvaluation;
 
 static const std::string KEYLISTFILENAME("KeyList.txt");
+static const std::string KEYLISTINDEXFILENAME("KeyList.index");
 static const std::string SOURCERECORDSTOREPROPERTY("Source Record Store");
 
+/** Identifies a key list index cache, and its layout */
+static const char KEYLISTINDEXMAGIC[8] = {'B','E','K','L','I','D','X','2'};
+/** Number of fields identifying the key list version that was indexed */
+static const size_t KEYLISTIDENTITYFIELDS = 6;
+/** Size of reads when indexing the key list */
+static const size_t KEYLISTREADSIZE = 1024 * 1024;
+
+/*
+ * Identify a version of the key list.  Timestamps are compared to the
+ * nanosecond, and the change time is included because, unlike the
+ * modification time, it cannot be set back.
+ */
+static void
+keyListIdentity(
+    const struct stat &sb,
+    uint64_t identity[KEYLISTIDENTITYFIELDS])
+{
+	identity[0] = static_cast<uint64_t>(sb.st_size);
+	identity[1] = static_cast<uint64_t>(sb.st_ino);
+#ifdef Darwin
+	identity[2] = static_cast<uint64_t>(sb.st_mtimespec.tv_sec);
+	identity[3] = static_cast<uint64_t>(sb.st_mtimespec.tv_nsec);
+	identity[4] = static_cast<uint64_t>(sb.st_ctimespec.tv_sec);
+	identity[5] = static_cast<uint64_t>(sb.st_ctimespec.tv_nsec);
+#else
+	identity[2] = static_cast<uint64_t>(sb.st_mtim.tv_sec);
+	identity[3] = static_cast<uint64_t>(sb.st_mtim.tv_nsec);
+	identity[4] = static_cast<uint64_t>(sb.st_ctim.tv_sec);
+	identity[5] = static_cast<uint64_t>(sb.st_ctim.tv_nsec);
+#endif
+}
+
+/*
+ * Read exactly size bytes at offset, returning false on a short read.
+ */
+static bool
+preadFully(
+    int fd,
+    void *buffer,
+    size_t size,
+    uint64_t offset)
+{
+	char *p = static_cast<char *>(buffer);
+	while (size > 0) {
+		ssize_t rv = pread(fd, p, size, offset);
+		if (rv < 0 && errno == EINTR)
+			continue;
+		if (rv <= 0)
+			return (false);
+		p += rv;
+		size -= rv;
+		offset += rv;
+	}
+	return (true);
+}
+
 BiometricEvaluation::IO::ListRecordStore::Impl::Impl(
     const std::string &pathname) :
-    RecordStore::Impl(pathname, Mode::ReadOnly)
+    RecordStore::Impl(pathname, Mode::ReadOnly),
+    _keyListFD(-1),
+    _cursorPos(0),
+    _prefetchDepth(ListRecordStore::DEFAULT_PREFETCH_DEPTH),
+    _prefetchPos(0),
+    _prefetchGeneration(0),
+    _prefetchReading(0),
+    _prefetchFailed(false),
+    _prefetchStop(false)
 {
 	std::string keyListPath = canonicalName(KEYLISTFILENAME);
-	this->_keyListFile.reset(new std::ifstream(keyListPath.c_str()));
-	if (!this->_keyListFile->is_open())
+	this->_keyListFD = open(keyListPath.c_str(), O_RDONLY);
+	if (this->_keyListFD < 0)
 	    throw Error::StrategyError("Could not open key list file");
+	try {
+		this->loadIndex();
+	} catch (Error::Exception) {
+		close(this->_keyListFD);
+		throw;
+	}
 
 	/* Check for the source RS property and open that RS */
 	std::shared_ptr<IO::Properties> props = getProperties();
@@ -36,6 +112,7 @@ BiometricEvaluation::IO::ListRecordStore::Impl::Impl(
 		sourceRSName =
 		    props->getProperty(SOURCERECORDSTOREPROPERTY);
 	} catch (Error::Exception &e) {
+		close(this->_keyListFD);
 		throw Error::StrategyError("Could not find " +
 		    SOURCERECORDSTOREPROPERTY + " property");
 	}
@@ -43,6 +120,7 @@ BiometricEvaluation::IO::ListRecordStore::Impl::Impl(
 		this->_sourceRecordStore = IO::RecordStore::openRecordStore(
 		    sourceRSName, Mode::ReadOnly);
 	} catch (Error::Exception &e) {
+		close(this->_keyListFD);
 		throw Error::StrategyError("Could not open source "
 		    "RecordStore " + sourceRSName);
 	}
@@ -52,7 +130,8 @@ BiometricEvaluation::IO::ListRecordStore::Impl::Impl(
 
 BiometricEvaluation::IO::ListRecordStore::Impl::~Impl()
 {
-	this->_keyListFile->close();
+	this->stopPrefetching();
+	close(this->_keyListFD);
 }
 
 BiometricEvaluation::Memory::uint8Array
@@ -60,6 +139,7 @@ BiometricEvaluation::IO::ListRecordStore::Impl::read(
     const std::string &key)
     const
 {
+	std::lock_guard<std::mutex> lock(_sourceMutex);
 	return (this->_sourceRecordStore->read(key));
 }
 
@@ -68,6 +148,7 @@ BiometricEvaluation::IO::ListRecordStore::Impl::length(
     const std::string &key)
     const
 {
+	std::lock_guard<std::mutex> lock(_sourceMutex);
 	return (this->_sourceRecordStore->length(key));
 }
 
@@ -82,30 +163,20 @@ BiometricEvaluation::IO::ListRecordStore::Impl::i_sequence(
 		    "argument");
 		    
 	if ((this->getCursor() == BE_RECSTORE_SEQ_START) ||
-	    (cursor == BE_RECSTORE_SEQ_START)) {
-		/* Rewind */
-		_keyListFile->clear();
-		_keyListFile->seekg(0);
-		if (!_keyListFile)
-			throw Error::StrategyError("Could not rewind " +
-			    canonicalName(KEYLISTFILENAME));
-		if (!_keyListFile)
-			throw Error::StrategyError("Could not clear EOF on " +
-			    canonicalName(KEYLISTFILENAME));
-	}
+	    (cursor == BE_RECSTORE_SEQ_START))
+		_cursorPos = 0;
 
-	std::string line;
-	std::getline(*this->_keyListFile, line);
-	if (this->_keyListFile->eof())
+	if (_cursorPos >= (_offsets.size() - 1))
 		throw (Error::ObjectDoesNotExist("No record at position"));
 
+	const uint64_t position = _cursorPos++;
 	this->setCursor(BE_RECSTORE_SEQ_NEXT);
 
 	/* Read the record from the source store; let exceptions float out */
 	BE::IO::RecordStore::Record record;
-	record.key = Text::trimWhitespace(line);
+	record.key = this->keyAt(position);
 	if (returnData == true)
-		record.data = this->_sourceRecordStore->read(record.key);
+		record.data = this->prefetchedData(position, record.key);
 	return (record);
 }
 
@@ -129,26 +200,39 @@ void
 BiometricEvaluation::IO::ListRecordStore::Impl::setCursorAtKey(
     const std::string &key)
 {
-	this->setCursor(BE_RECSTORE_SEQ_START);
-	
-	/* Sequence until we find the key */
-	std::string sequencedKey;
-	std::string searchKey{Text::trimWhitespace(key)};
-	for (;;) {
-		try {
-			sequencedKey = this->sequenceKey();
-			if (sequencedKey == searchKey)
-				break;
-		} catch (Error::ObjectDoesNotExist) {
-			throw Error::ObjectDoesNotExist(key);
+	/* The first occurrence of the key has the lowest position */
+	const std::string searchKey{Text::trimWhitespace(key)};
+	const uint64_t hash = hashKey(searchKey);
+	for (auto it = std::lower_bound(_hashes.begin(), _hashes.end(),
+	    KeyHash{hash, 0}); (it != _hashes.end()) && (it->hash == hash);
+	    it++) {
+		if (this->keyAt(it->position) == searchKey) {
+			this->setCursorAtPosition(it->position);
+			return;
 		}
 	}
-	
-	/* Rewind size of one key, adding the stripped newline character */
-	_keyListFile->seekg(-(sequencedKey.size() + 1), std::ios_base::cur);
-	if (!_keyListFile)
-		throw Error::StrategyError("Could not rewind one key in " +
-		    RecordStore::Impl::canonicalName(KEYLISTFILENAME));
+	throw Error::ObjectDoesNotExist(key);
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::Impl::setCursorAtPosition(
+    uint64_t position)
+{
+	if (position >= (_offsets.size() - 1))
+		throw Error::ObjectDoesNotExist("No record at position " +
+		    std::to_string(position));
+
+	_cursorPos = position;
+	this->setCursor(BE_RECSTORE_SEQ_NEXT);
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::Impl::setPrefetchDepth(
+    unsigned int depth)
+{
+	std::lock_guard<std::mutex> lock(_prefetchMutex);
+	_prefetchDepth = depth;
+	_prefetchCV.notify_all();
 }
 
 uint64_t
@@ -174,3 +258,252 @@ BiometricEvaluation::IO::ListRecordStore::Impl::CRUDMethodCalled()
 	    "was opened read/write");
 }
 
+/******************************************************************************/
+/* Private method implementations.                                            */
+/******************************************************************************/
+
+std::string
+BiometricEvaluation::IO::ListRecordStore::Impl::keyAt(
+    uint64_t position)
+    const
+{
+	/* Offsets include the newline ending each line */
+	std::string line(_offsets[position + 1] - _offsets[position] - 1,
+	    '\0');
+	if (!line.empty() && !preadFully(_keyListFD, &line[0], line.size(),
+	    _offsets[position]))
+		throw Error::StrategyError("Could not read " +
+		    canonicalName(KEYLISTFILENAME));
+	return (Text::trimWhitespace(line));
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::Impl::loadIndex()
+{
+	struct stat sb;
+	if (fstat(_keyListFD, &sb) != 0)
+		throw Error::StrategyError("Could not stat " +
+		    canonicalName(KEYLISTFILENAME) + " (" + Error::errorStr() +
+		    ")");
+	if (this->readIndexCache(sb))
+		return;
+
+	_offsets.assign(1, 0);
+	_hashes.clear();
+	std::vector<char> buffer(KEYLISTREADSIZE);
+	std::string line;
+	uint64_t offset = 0;
+	for (;;) {
+		ssize_t rv = pread(_keyListFD, buffer.data(), buffer.size(),
+		    offset);
+		if (rv < 0 && errno == EINTR)
+			continue;
+		if (rv < 0)
+			throw Error::StrategyError("Could not read " +
+			    canonicalName(KEYLISTFILENAME) + " (" +
+			    Error::errorStr() + ")");
+		if (rv == 0)
+			break;
+		for (ssize_t i = 0; i < rv; i++) {
+			if (buffer[i] != '\n') {
+				line.push_back(buffer[i]);
+				continue;
+			}
+			_hashes.push_back({hashKey(Text::trimWhitespace(line)),
+			    _offsets.size() - 1});
+			_offsets.push_back(offset + i + 1);
+			line.clear();
+		}
+		offset += rv;
+	}
+	/* A final line need not end with a newline */
+	if (offset > _offsets.back()) {
+		_hashes.push_back({hashKey(Text::trimWhitespace(line)),
+		    _offsets.size() - 1});
+		_offsets.push_back(offset + 1);
+	}
+	std::sort(_hashes.begin(), _hashes.end());
+}
+
+bool
+BiometricEvaluation::IO::ListRecordStore::Impl::readIndexCache(
+    const struct stat &keyListStat)
+{
+	/*
+	 * The cache holds, in native byte order: magic, the identity of
+	 * the key list it indexes, the number of keys, every offset, and
+	 * every key hash.
+	 */
+	const int fd = open(canonicalName(KEYLISTINDEXFILENAME).c_str(),
+	    O_RDONLY);
+	if (fd < 0)
+		return (false);
+
+	bool current = false;
+	char magic[sizeof(KEYLISTINDEXMAGIC)];
+	uint64_t identity[KEYLISTIDENTITYFIELDS];
+	keyListIdentity(keyListStat, identity);
+	uint64_t header[KEYLISTIDENTITYFIELDS + 1];
+	struct stat sb;
+	if ((fstat(fd, &sb) == 0) &&
+	    preadFully(fd, magic, sizeof(magic), 0) &&
+	    (std::memcmp(magic, KEYLISTINDEXMAGIC, sizeof(magic)) == 0) &&
+	    preadFully(fd, header, sizeof(header), sizeof(magic)) &&
+	    (std::memcmp(header, identity, sizeof(identity)) == 0)) {
+		const uint64_t count = header[KEYLISTIDENTITYFIELDS];
+		const uint64_t offsetsStart = sizeof(magic) + sizeof(header);
+		const uint64_t hashesStart = offsetsStart +
+		    ((count + 1) * sizeof(uint64_t));
+		if (static_cast<uint64_t>(sb.st_size) ==
+		    (hashesStart + (count * sizeof(KeyHash)))) {
+			_offsets.resize(count + 1);
+			_hashes.resize(count);
+			current = preadFully(fd, _offsets.data(),
+			    _offsets.size() * sizeof(uint64_t),
+			    offsetsStart) &&
+			    ((count == 0) || preadFully(fd, _hashes.data(),
+			    _hashes.size() * sizeof(KeyHash), hashesStart));
+		}
+	}
+	close(fd);
+	return (current);
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::Impl::writeIndexCache(
+    const struct stat &keyListStat)
+    const
+{
+	const std::string indexPath = canonicalName(KEYLISTINDEXFILENAME);
+	const std::string tempPath = indexPath + "." +
+	    std::to_string(getpid());
+	uint64_t header[KEYLISTIDENTITYFIELDS + 1];
+	keyListIdentity(keyListStat, header);
+	header[KEYLISTIDENTITYFIELDS] = _offsets.size() - 1;
+
+	std::ofstream out(tempPath, std::ios_base::binary |
+	    std::ios_base::trunc);
+	out.write(KEYLISTINDEXMAGIC, sizeof(KEYLISTINDEXMAGIC));
+	out.write(reinterpret_cast<const char *>(header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(_offsets.data()),
+	    _offsets.size() * sizeof(uint64_t));
+	out.write(reinterpret_cast<const char *>(_hashes.data()),
+	    _hashes.size() * sizeof(KeyHash));
+	out.close();
+	if (!out || (rename(tempPath.c_str(), indexPath.c_str()) != 0)) {
+		std::remove(tempPath.c_str());
+		throw Error::StrategyError("Could not write " + indexPath);
+	}
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::Impl::indexKeyList(
+    const std::string &pathname)
+{
+	ListRecordStore::Impl store(pathname);
+	struct stat sb;
+	if (fstat(store._keyListFD, &sb) != 0)
+		throw Error::StrategyError("Could not stat " +
+		    store.canonicalName(KEYLISTFILENAME) + " (" +
+		    Error::errorStr() + ")");
+	store.writeIndexCache(sb);
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ListRecordStore::Impl::prefetchedData(
+    uint64_t position,
+    const std::string &key)
+{
+	{
+		std::unique_lock<std::mutex> lock(_prefetchMutex);
+		if (_prefetchDepth != 0) {
+			if (!_prefetchThread.joinable())
+				_prefetchThread = std::thread(
+				    &ListRecordStore::Impl::prefetch, this);
+
+			for (;;) {
+				while (!_prefetched.empty() &&
+				    (_prefetched.front().position < position))
+					_prefetched.pop_front();
+				if (!_prefetched.empty() &&
+				    (_prefetched.front().position == position)) {
+					Memory::uint8Array data(std::move(
+					    _prefetched.front().record.data));
+					_prefetched.pop_front();
+					_prefetchCV.notify_all();
+					return (data);
+				}
+
+				/* Wait for the record if it is being read */
+				if (_prefetchReading != (position + 1))
+					break;
+				_prefetchCV.wait(lock);
+			}
+		}
+
+		/* Not read ahead, so read ahead from the next record */
+		_prefetched.clear();
+		_prefetchGeneration++;
+		_prefetchPos = position + 1;
+		_prefetchFailed = false;
+		_prefetchCV.notify_all();
+	}
+
+	return (this->read(key));
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::Impl::prefetch()
+{
+	const uint64_t count = _offsets.size() - 1;
+	std::unique_lock<std::mutex> lock(_prefetchMutex);
+	for (;;) {
+		_prefetchCV.wait(lock, [&]() {
+			return (_prefetchStop || (!_prefetchFailed &&
+			    (_prefetchPos < count) &&
+			    (_prefetched.size() < _prefetchDepth)));
+		});
+		if (_prefetchStop)
+			return;
+
+		const uint64_t position = _prefetchPos++;
+		const uint64_t generation = _prefetchGeneration;
+		_prefetchReading = position + 1;
+		lock.unlock();
+
+		PrefetchedRecord prefetched{position, {}};
+		bool succeeded = true;
+		try {
+			prefetched.record.key = this->keyAt(position);
+			prefetched.record.data = this->read(
+			    prefetched.record.key);
+		} catch (...) {
+			/* Reported when the record is sequenced */
+			succeeded = false;
+		}
+
+		lock.lock();
+		_prefetchReading = 0;
+		if (generation == _prefetchGeneration) {
+			if (succeeded) {
+				_prefetched.push_back(std::move(prefetched));
+			} else {
+				_prefetchFailed = true;
+				_prefetchPos = position;
+			}
+		}
+		_prefetchCV.notify_all();
+	}
+}
+
+void
+BiometricEvaluation::IO::ListRecordStore::Impl::stopPrefetching()
+{
+	{
+		std::lock_guard<std::mutex> lock(_prefetchMutex);
+		_prefetchStop = true;
+		_prefetchCV.notify_all();
+	}
+	if (_prefetchThread.joinable())
+		_prefetchThread.join();
+}
@@ -11,7 +11,14 @@
 #ifndef __BE_IO_LISTRECSTORE_IMPL_H__
 #define __BE_IO_LISTRECSTORE_IMPL_H__
 
+#include <sys/stat.h>
+
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <be_io_listrecstore.h>
 #include "be_io_recordstore_impl.h"
@@ -53,6 +60,18 @@ namespace BiometricEvaluation
 			void
 			setCursorAtKey(const std::string &key);
 
+			void
+			setCursorAtPosition(
+			    uint64_t position);
+
+			void
+			setPrefetchDepth(
+			    unsigned int depth);
+
+			static void
+			indexKeyList(
+			    const std::string &pathname);
+
 			uint64_t
 			getSpaceUsed() const;
 
@@ -74,17 +93,140 @@ namespace BiometricEvaluation
 			CRUDMethodCalled() const;
 
 		private:
+			/** Hash of a key and its position in the key list */
+			struct KeyHash
+			{
+				uint64_t hash;
+				uint64_t position;
+
+				bool
+				operator<(
+				    const KeyHash &rhs)
+				    const
+				{
+					return ((hash < rhs.hash) ||
+					    ((hash == rhs.hash) &&
+					    (position < rhs.position)));
+				}
+			};
+
+			/** A record read ahead of the cursor */
+			struct PrefetchedRecord
+			{
+				uint64_t position;
+				RecordStore::Record record;
+			};
+
 			/**
 			 * Textfile containing a subset of keys from
 			 * the source RecordStore
 			 */
-			std::shared_ptr<std::ifstream> _keyListFile;
+			int _keyListFD;
+			/**
+			 * Offset of each line in the key list, followed by
+			 * the offset one past the end of the last line.
+			 */
+			std::vector<uint64_t> _offsets;
+			/** Hash of every key, sorted */
+			std::vector<KeyHash> _hashes;
+			/** Position of the next key to sequence */
+			uint64_t _cursorPos;
+
 			/**
 			 * RecordStore containing data referenced by KeyList
 			 * file keys
 			 */
 			std::shared_ptr<IO::RecordStore> _sourceRecordStore;
-			
+			/** Serializes access to _sourceRecordStore */
+			mutable std::mutex _sourceMutex;
+
+			/** Records to read ahead */
+			unsigned int _prefetchDepth;
+			/** Reads records ahead of the cursor */
+			std::thread _prefetchThread;
+			/** Protects the members below */
+			std::mutex _prefetchMutex;
+			/** Signals changes to the members below */
+			std::condition_variable _prefetchCV;
+			/** Records read ahead, in sequence order */
+			std::deque<PrefetchedRecord> _prefetched;
+			/** Position of the next record to read ahead */
+			uint64_t _prefetchPos;
+			/** Incremented whenever read-ahead is redirected */
+			uint64_t _prefetchGeneration;
+			/** One more than the position being read ahead, or 0 */
+			uint64_t _prefetchReading;
+			/** Whether reading ahead has failed at _prefetchPos */
+			bool _prefetchFailed;
+			/** Whether the read-ahead thread should exit */
+			bool _prefetchStop;
+
+			/**
+			 * @brief
+			 * Obtain the key at a position in the key list.
+			 */
+			std::string
+			keyAt(
+			    uint64_t position)
+			    const;
+
+			/**
+			 * @brief
+			 * Load the cached index of the key list, building
+			 * it if absent or out of date.
+			 */
+			void
+			loadIndex();
+
+			/**
+			 * @brief
+			 * Read the cached index of the key list.
+			 *
+			 * @return
+			 *	true if the cache was current and read,
+			 *	false otherwise.
+			 */
+			bool
+			readIndexCache(
+			    const struct stat &keyListStat);
+
+			/**
+			 * @brief
+			 * Cache the index of the key list.
+			 *
+			 * @throw Error::StrategyError
+			 *	The cache could not be written.
+			 */
+			void
+			writeIndexCache(
+			    const struct stat &keyListStat)
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain data for the record at a position, from the
+			 * read-ahead queue when possible, and direct reading
+			 * ahead to the records that follow.
+			 */
+			Memory::uint8Array
+			prefetchedData(
+			    uint64_t position,
+			    const std::string &key);
+
+			/**
+			 * @brief
+			 * Body of the read-ahead thread.
+			 */
+			void
+			prefetch();
+
+			/**
+			 * @brief
+			 * Stop the read-ahead thread.
+			 */
+			void
+			stopPrefetching();
+
 			/**
 			 * Internal implementation of sequencing through a
 			 * store, returning the key, and optionally, the
@@ -0,0 +1,227 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "be_io_logstructuredrecstore_impl.h"
+
+const std::string BiometricEvaluation::IO::LogStructuredRecordStore::
+    SEGMENT_FILE_PREFIX{"segment."};
+const std::string BiometricEvaluation::IO::LogStructuredRecordStore::
+    CHECKPOINT_FILE_NAME{"index.checkpoint"};
+const uint64_t BiometricEvaluation::IO::LogStructuredRecordStore::
+    DEFAULT_SEGMENT_SIZE{64 * 1024 * 1024};
+const uint64_t BiometricEvaluation::IO::LogStructuredRecordStore::
+    DEFAULT_CHECKPOINT_INTERVAL{256 * 1024 * 1024};
+const double BiometricEvaluation::IO::LogStructuredRecordStore::
+    DEFAULT_COMPACTION_THRESHOLD{0.5};
+
+BiometricEvaluation::IO::LogStructuredRecordStore::LogStructuredRecordStore(
+    const std::string &pathname,
+    const std::string &description,
+    uint64_t segmentSize,
+    uint64_t checkpointInterval)
+{
+	/*
+	 * Exceptions float out.
+	 */
+	this->pimpl.reset(new IO::LogStructuredRecordStore::Impl(
+	    pathname, description, segmentSize, checkpointInterval));
+}
+
+BiometricEvaluation::IO::LogStructuredRecordStore::LogStructuredRecordStore(
+    const std::string &pathname,
+    IO::Mode mode)
+{
+	this->pimpl.reset(new IO::LogStructuredRecordStore::Impl(
+	    pathname, mode));
+}
+
+BiometricEvaluation::IO::LogStructuredRecordStore::~LogStructuredRecordStore()
+{
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::move(
+    const std::string &pathname)
+{
+	this->pimpl->move(pathname);
+}
+
+uint64_t
+BiometricEvaluation::IO::LogStructuredRecordStore::getSpaceUsed()
+    const
+{
+	return (this->pimpl->getSpaceUsed());
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::sync()
+    const
+{
+	this->pimpl->sync();
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::insert(
+    const std::string &key,
+    const void *const data,
+    const uint64_t size)
+{
+	this->pimpl->insert(key, data, size);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::replace(
+    const std::string &key,
+    const void *const data,
+    const uint64_t size)
+{
+	this->pimpl->replace(key, data, size);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::remove(
+    const std::string &key)
+{
+	this->pimpl->remove(key);
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::LogStructuredRecordStore::read(
+    const std::string &key)
+    const
+{
+	return (this->pimpl->read(key));
+}
+
+uint64_t
+BiometricEvaluation::IO::LogStructuredRecordStore::length(
+    const std::string &key)
+    const
+{
+	return (this->pimpl->length(key));
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::flush(
+    const std::string &key)
+    const
+{
+	this->pimpl->flush(key);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::LogStructuredRecordStore::sequence(
+    int cursor)
+{
+	return (this->pimpl->sequence(cursor));
+}
+
+std::string
+BiometricEvaluation::IO::LogStructuredRecordStore::sequenceKey(
+    int cursor)
+{
+	return (this->pimpl->sequenceKey(cursor));
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::setCursorAtKey(
+    const std::string &key)
+{
+	this->pimpl->setCursorAtKey(key);
+}
+
+unsigned int
+BiometricEvaluation::IO::LogStructuredRecordStore::getCount()
+    const
+{
+	return (this->pimpl->getCount());
+}
+
+std::string
+BiometricEvaluation::IO::LogStructuredRecordStore::getPathname()
+    const
+{
+	return (this->pimpl->getPathname());
+}
+
+std::string
+BiometricEvaluation::IO::LogStructuredRecordStore::getDescription()
+    const
+{
+	return (this->pimpl->getDescription());
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::changeDescription(
+    const std::string &description)
+{
+	this->pimpl->changeDescription(description);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::checkpoint()
+    const
+{
+	this->pimpl->checkpoint();
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::compact(
+    double threshold)
+{
+	this->pimpl->compact(threshold);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::startCompaction(
+    double threshold)
+{
+	this->pimpl->startCompaction(threshold);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::waitForCompaction()
+{
+	this->pimpl->waitForCompaction();
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::cancelCompaction()
+{
+	this->pimpl->cancelCompaction();
+}
+
+bool
+BiometricEvaluation::IO::LogStructuredRecordStore::isCompacting()
+    const
+{
+	return (this->pimpl->isCompacting());
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::setAutoCompaction(
+    double threshold)
+{
+	this->pimpl->setAutoCompaction(threshold);
+}
+
+uint64_t
+BiometricEvaluation::IO::LogStructuredRecordStore::getDeadSpace()
+    const
+{
+	return (this->pimpl->getDeadSpace());
+}
+
+unsigned int
+BiometricEvaluation::IO::LogStructuredRecordStore::getSegmentCount()
+    const
+{
+	return (this->pimpl->getSegmentCount());
+}
@@ -0,0 +1,1258 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "be_io_logstructuredrecstore_impl.h"
+#include <be_error.h>
+#include <be_io_properties.h>
+#include <be_io_utility.h>
+
+namespace BE = BiometricEvaluation;
+
+static const std::string SEGMENT_SIZE_PROPERTY{"Segment Size"};
+static const std::string CHECKPOINT_INTERVAL_PROPERTY{"Checkpoint Interval"};
+
+namespace
+{
+	/** Start of every log entry ("BELR", little-endian) */
+	const uint32_t ENTRY_MAGIC = 0x524C4542;
+	/** Bytes of an entry before its key */
+	const uint64_t ENTRY_HEADER_SIZE = 32;
+	/** Start of the checkpoint file */
+	const std::string CHECKPOINT_MAGIC{"BELRIDX1"};
+	/** Bytes of the checkpoint before its first index entry */
+	const uint64_t CHECKPOINT_HEADER_SIZE = 8 + 4 + 8 + 8 + 8;
+	/** Bytes of a checkpoint index entry, excluding its key */
+	const uint64_t CHECKPOINT_ENTRY_SIZE = 4 + 4 + 8 + 8 + 8;
+
+	/** pread() exactly size bytes */
+	void
+	readFully(
+	    int fd,
+	    uint8_t *buf,
+	    uint64_t size,
+	    uint64_t offset)
+	{
+		uint64_t total = 0;
+		while (total < size) {
+			ssize_t rv = pread(fd, buf + total, size - total,
+			    offset + total);
+			if (rv == -1) {
+				if (errno == EINTR)
+					continue;
+				throw BE::Error::StrategyError("Log cannot "
+				    "read (" + BE::Error::errorStr() + ")");
+			}
+			if (rv == 0)
+				throw BE::Error::StrategyError("Log cannot "
+				    "read (unexpected end of file)");
+			total += rv;
+		}
+	}
+
+	/** pwrite() exactly size bytes */
+	void
+	writeFully(
+	    int fd,
+	    const uint8_t *buf,
+	    uint64_t size,
+	    uint64_t offset)
+	{
+		uint64_t total = 0;
+		while (total < size) {
+			ssize_t rv = pwrite(fd, buf + total, size - total,
+			    offset + total);
+			if (rv == -1) {
+				if (errno == EINTR)
+					continue;
+				throw BE::Error::StrategyError("Log cannot "
+				    "write (" + BE::Error::errorStr() + ")");
+			}
+			total += rv;
+		}
+	}
+
+	/** fsync() a descriptor */
+	void
+	syncFully(
+	    int fd)
+	{
+		if (fsync(fd) != 0)
+			throw BE::Error::StrategyError("Log cannot sync (" +
+			    BE::Error::errorStr() + ")");
+	}
+
+	/** Continue a CRC-32 over buffers of any size */
+	uint32_t
+	updateCRC(
+	    uint32_t crc,
+	    const void *const buf,
+	    uint64_t size)
+	{
+		const Bytef *p = static_cast<const Bytef*>(buf);
+		while (size > 0) {
+			const uInt chunk = static_cast<uInt>(std::min<uint64_t>(
+			    size, 1U << 30));
+			crc = static_cast<uint32_t>(crc32(crc, p, chunk));
+			p += chunk;
+			size -= chunk;
+		}
+		return (crc);
+	}
+
+	void
+	putUInt32(
+	    uint8_t *buf,
+	    uint32_t value)
+	{
+		for (unsigned int i = 0; i < 4; i++)
+			buf[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+
+	void
+	putUInt64(
+	    uint8_t *buf,
+	    uint64_t value)
+	{
+		for (unsigned int i = 0; i < 8; i++)
+			buf[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+
+	uint32_t
+	getUInt32(
+	    const uint8_t *buf)
+	{
+		uint32_t value = 0;
+		for (unsigned int i = 0; i < 4; i++)
+			value |= static_cast<uint32_t>(buf[i]) << (8 * i);
+		return (value);
+	}
+
+	uint64_t
+	getUInt64(
+	    const uint8_t *buf)
+	{
+		uint64_t value = 0;
+		for (unsigned int i = 0; i < 8; i++)
+			value |= static_cast<uint64_t>(buf[i]) << (8 * i);
+		return (value);
+	}
+
+	/** Bytes of the log taken by an entry */
+	uint64_t
+	entrySize(
+	    const std::string &key,
+	    uint64_t size)
+	{
+		return (ENTRY_HEADER_SIZE + key.size() + size);
+	}
+}
+
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::Impl(
+    const std::string &pathname,
+    const std::string &description,
+    uint64_t segmentSize,
+    uint64_t checkpointInterval) :
+    RecordStore::Impl(pathname, description,
+    RecordStore::Kind::LogStructured),
+    _segmentSize(segmentSize),
+    _checkpointInterval(checkpointInterval)
+{
+	if (segmentSize == 0)
+		throw Error::ParameterError("Segment size must be positive");
+	this->init();
+
+	std::shared_ptr<IO::Properties> props = this->getProperties();
+	props->setPropertyFromInteger(SEGMENT_SIZE_PROPERTY, segmentSize);
+	props->setPropertyFromInteger(CHECKPOINT_INTERVAL_PROPERTY,
+	    checkpointInterval);
+	this->setProperties(props);
+
+	try {
+		this->startSegment();
+		this->checkpoint();
+		RecordStore::Impl::sync();
+	} catch (Error::Exception &e) {
+		this->closeSegments();
+		pthread_rwlock_destroy(&_lock);
+		throw;
+	}
+}
+
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::Impl(
+    const std::string &pathname,
+    IO::Mode mode) :
+    RecordStore::Impl(pathname, mode)
+{
+	std::shared_ptr<IO::Properties> props = this->getProperties();
+	try {
+		_segmentSize = props->getPropertyAsInteger(
+		    SEGMENT_SIZE_PROPERTY);
+		_checkpointInterval = props->getPropertyAsInteger(
+		    CHECKPOINT_INTERVAL_PROPERTY);
+	} catch (Error::Exception &e) {
+		throw Error::StrategyError("Could not read log properties (" +
+		    e.whatString() + ")");
+	}
+	if (_segmentSize == 0)
+		throw Error::StrategyError("Invalid " + SEGMENT_SIZE_PROPERTY);
+	this->init();
+
+	try {
+		this->recover();
+	} catch (Error::Exception &e) {
+		this->closeSegments();
+		pthread_rwlock_destroy(&_lock);
+		throw;
+	}
+}
+
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::~Impl()
+{
+	try {
+		this->cancelCompaction();
+	} catch (...) {
+		/* Compaction leaves the log consistent at every entry */
+	}
+
+	/*
+	 * Don't throw exceptions in destructors.  Without a final
+	 * checkpoint, the next open replays more of the log.
+	 */
+	try {
+		this->sync();
+	} catch (Error::Exception &e) {}
+
+	this->closeSegments();
+	pthread_rwlock_destroy(&_lock);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::init()
+{
+	_activeSegment = 0;
+	_nextSerial = 1;
+	_uncheckpointedBytes = 0;
+	_seqSerial = 0;
+	_compacting = false;
+	_cancelCompaction = false;
+	_autoCompactThreshold = (this->getMode() == Mode::ReadWrite ?
+	    LogStructuredRecordStore::DEFAULT_COMPACTION_THRESHOLD : 0);
+
+	if (pthread_rwlock_init(&_lock, nullptr) != 0)
+		throw Error::StrategyError("Could not create log lock");
+}
+
+std::string
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::segmentPathname(
+    uint32_t segment)
+    const
+{
+	char number[16];
+	std::snprintf(number, sizeof(number), "%08u", segment);
+	return (this->canonicalName(SEGMENT_FILE_PREFIX + number));
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::openSegments(
+    const std::vector<uint32_t> &segments)
+{
+	const int flags = (this->getMode() == Mode::ReadOnly ? O_RDONLY :
+	    O_RDWR);
+	for (const auto segment : segments) {
+		const std::string pathname = this->segmentPathname(segment);
+		const int fd = open(pathname.c_str(), flags);
+		if (fd == -1)
+			throw Error::StrategyError("Could not open " +
+			    pathname + " (" + Error::errorStr() + ")");
+
+		const auto existing = _segments.find(segment);
+		if (existing != _segments.end()) {
+			existing->second.fd = fd;
+		} else {
+			struct stat sb;
+			if (fstat(fd, &sb) != 0) {
+				close(fd);
+				throw Error::StrategyError("Could not stat " +
+				    pathname + " (" + Error::errorStr() + ")");
+			}
+			_segments[segment] = {fd,
+			    static_cast<uint64_t>(sb.st_size), 0, false};
+		}
+		_activeSegment = std::max(_activeSegment, segment);
+	}
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::closeSegments()
+{
+	for (auto &segment : _segments) {
+		if (segment.second.fd != -1)
+			close(segment.second.fd);
+		segment.second.fd = -1;
+	}
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::startSegment()
+{
+	const uint32_t segment = _activeSegment + 1;
+	const std::string pathname = this->segmentPathname(segment);
+	const int fd = open(pathname.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+	    0666);
+	if (fd == -1)
+		throw Error::StrategyError("Could not create " + pathname +
+		    " (" + Error::errorStr() + ")");
+
+	_segments[segment] = {fd, 0, 0, true};
+	_activeSegment = segment;
+}
+
+bool
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::sealIfFull(
+    uint64_t size)
+{
+	const Segment &active = _segments.at(_activeSegment);
+	if ((active.size == 0) || ((active.size + size) <= _segmentSize))
+		return (false);
+
+	this->startSegment();
+	return (true);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::recover()
+{
+	std::vector<uint32_t> segments;
+	DIR *dir = opendir(this->getPathname().c_str());
+	if (dir == nullptr)
+		throw Error::StrategyError("Could not open " +
+		    this->getPathname() + " (" + Error::errorStr() + ")");
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != nullptr) {
+		const std::string name(entry->d_name);
+		if ((name.size() <= SEGMENT_FILE_PREFIX.size()) ||
+		    (name.compare(0, SEGMENT_FILE_PREFIX.size(),
+		    SEGMENT_FILE_PREFIX) != 0))
+			continue;
+		const std::string number = name.substr(
+		    SEGMENT_FILE_PREFIX.size());
+		if (number.find_first_not_of("0123456789") !=
+		    std::string::npos)
+			continue;
+		segments.push_back(static_cast<uint32_t>(std::strtoul(
+		    number.c_str(), nullptr, 10)));
+	}
+	closedir(dir);
+	if (segments.empty())
+		throw Error::StrategyError("Log has no segments");
+	std::sort(segments.begin(), segments.end());
+	this->openSegments(segments);
+
+	uint32_t startSegment;
+	uint64_t startOffset;
+	if (!this->loadCheckpoint(startSegment, startOffset)) {
+		/* Rebuild the index from the whole log */
+		_index.clear();
+		_order.clear();
+		for (auto &segment : _segments)
+			segment.second.liveBytes = 0;
+		_nextSerial = 1;
+		startSegment = segments.front();
+		startOffset = 0;
+		_uncheckpointedBytes = 1;
+	}
+
+	for (const auto segment : segments) {
+		if (segment < startSegment)
+			continue;
+		this->replay(segment, (segment == startSegment ?
+		    startOffset : 0), segment == _activeSegment);
+	}
+
+	if (this->getMode() == Mode::ReadWrite) {
+		/*
+		 * Segments before the checkpoint with no live records
+		 * remain when a compaction stopped before deleting them.
+		 * Only the oldest are deleted, as removals they log may
+		 * still hide records in older segments.
+		 */
+		while ((_segments.size() > 1) &&
+		    (_segments.begin()->first < startSegment) &&
+		    (_segments.begin()->second.liveBytes == 0)) {
+			close(_segments.begin()->second.fd);
+			unlink(this->segmentPathname(
+			    _segments.begin()->first).c_str());
+			_segments.erase(_segments.begin());
+		}
+		this->setCount(_index.size());
+	}
+}
+
+bool
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::loadCheckpoint(
+    uint32_t &segment,
+    uint64_t &offset)
+{
+	const std::string pathname = this->canonicalName(
+	    LogStructuredRecordStore::CHECKPOINT_FILE_NAME);
+	Memory::uint8Array buf;
+	try {
+		if (!IO::Utility::fileExists(pathname))
+			return (false);
+		buf = IO::Utility::readFile(pathname);
+	} catch (Error::Exception &e) {
+		return (false);
+	}
+
+	if ((buf.size() < (CHECKPOINT_HEADER_SIZE + 4)) ||
+	    (std::memcmp(buf, CHECKPOINT_MAGIC.data(),
+	    CHECKPOINT_MAGIC.size()) != 0))
+		return (false);
+	const uint64_t end = buf.size() - 4;
+	if (updateCRC(0, buf, end) != getUInt32(buf + end))
+		return (false);
+
+	uint64_t pos = CHECKPOINT_MAGIC.size();
+	segment = getUInt32(buf + pos);
+	pos += 4;
+	offset = getUInt64(buf + pos);
+	pos += 8;
+	const uint64_t nextSerial = getUInt64(buf + pos);
+	pos += 8;
+	const uint64_t count = getUInt64(buf + pos);
+	pos += 8;
+
+	const auto start = _segments.find(segment);
+	if ((start == _segments.end()) || (offset > start->second.size))
+		return (false);
+
+	_index.reserve(count);
+	for (uint64_t i = 0; i < count; i++) {
+		if ((end - pos) < CHECKPOINT_ENTRY_SIZE)
+			return (false);
+		const uint32_t keyLength = getUInt32(buf + pos);
+		if ((end - pos - CHECKPOINT_ENTRY_SIZE) < keyLength)
+			return (false);
+		pos += 4;
+		std::string key(reinterpret_cast<const char*>(&buf[pos]),
+		    keyLength);
+		pos += keyLength;
+		Location location;
+		location.segment = getUInt32(buf + pos);
+		location.offset = getUInt64(buf + pos + 4);
+		location.size = getUInt64(buf + pos + 12);
+		location.serial = getUInt64(buf + pos + 20);
+		pos += CHECKPOINT_ENTRY_SIZE - 4;
+
+		const auto segmentIt = _segments.find(location.segment);
+		if ((segmentIt == _segments.end()) ||
+		    (location.offset + entrySize(key, location.size) >
+		    segmentIt->second.size))
+			return (false);
+		segmentIt->second.liveBytes += entrySize(key, location.size);
+
+		const auto inserted = _index.emplace(std::move(key), location);
+		if (!inserted.second)
+			return (false);
+		_order.emplace_hint(_order.end(), location.serial,
+		    &inserted.first->first);
+	}
+	if (pos != end)
+		return (false);
+
+	_nextSerial = nextSerial;
+	return (true);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::replay(
+    uint32_t segment,
+    uint64_t offset,
+    bool last)
+{
+	Segment &seg = _segments.at(segment);
+	Entry entry;
+	Memory::uint8Array data;
+	while (offset < seg.size) {
+		if (!readEntry(seg.fd, offset, seg.size, entry, data)) {
+			if (!last)
+				throw Error::StrategyError("Log segment " +
+				    std::to_string(segment) + " is damaged "
+				    "at offset " + std::to_string(offset));
+
+			/* A partially written entry ends the log */
+			if ((this->getMode() == Mode::ReadWrite) &&
+			    (ftruncate(seg.fd, offset) != 0))
+				throw Error::StrategyError("Could not "
+				    "truncate log (" + Error::errorStr() + ")");
+			seg.size = offset;
+			break;
+		}
+
+		if (entry.type == EntryType::Put) {
+			this->setLocation(entry.key, {segment, offset,
+			    entry.size, entry.serial});
+			_nextSerial = std::max(_nextSerial, entry.serial + 1);
+		} else {
+			this->dropKey(entry.key);
+		}
+		offset += entrySize(entry.key, entry.size);
+		_uncheckpointedBytes += entrySize(entry.key, entry.size);
+	}
+}
+
+bool
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::readEntryHeader(
+    int fd,
+    uint64_t offset,
+    uint64_t fileSize,
+    Entry &entry,
+    uint32_t &expectedCRC,
+    uint32_t &crc)
+{
+	if ((offset > fileSize) || ((fileSize - offset) < ENTRY_HEADER_SIZE))
+		return (false);
+	uint8_t header[ENTRY_HEADER_SIZE];
+	readFully(fd, header, ENTRY_HEADER_SIZE, offset);
+	if (getUInt32(header) != ENTRY_MAGIC)
+		return (false);
+
+	const uint8_t type = header[8];
+	if ((type != static_cast<uint8_t>(EntryType::Put)) &&
+	    (type != static_cast<uint8_t>(EntryType::Remove)))
+		return (false);
+	entry.type = static_cast<EntryType>(type);
+	const uint32_t keyLength = getUInt32(header + 12);
+	entry.serial = getUInt64(header + 16);
+	entry.size = getUInt64(header + 24);
+
+	const uint64_t available = fileSize - offset - ENTRY_HEADER_SIZE;
+	if ((keyLength > available) || (entry.size > (available - keyLength)))
+		return (false);
+
+	entry.key.resize(keyLength);
+	if (keyLength > 0)
+		readFully(fd, reinterpret_cast<uint8_t*>(&entry.key[0]),
+		    keyLength, offset + ENTRY_HEADER_SIZE);
+
+	expectedCRC = getUInt32(header + 4);
+	crc = updateCRC(0, header + 8, ENTRY_HEADER_SIZE - 8);
+	crc = updateCRC(crc, entry.key.data(), keyLength);
+	return (true);
+}
+
+bool
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::readEntry(
+    int fd,
+    uint64_t offset,
+    uint64_t fileSize,
+    Entry &entry,
+    Memory::uint8Array &data)
+{
+	uint32_t expectedCRC, crc;
+	if (!readEntryHeader(fd, offset, fileSize, entry, expectedCRC, crc))
+		return (false);
+
+	data.resize(entry.size);
+	if (entry.size > 0)
+		readFully(fd, data, entry.size, offset + ENTRY_HEADER_SIZE +
+		    entry.key.size());
+	return (updateCRC(crc, data, entry.size) == expectedCRC);
+}
+
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::Location
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::append(
+    const Entry &entry,
+    const void *const data)
+{
+	Segment &active = _segments.at(_activeSegment);
+
+	std::vector<uint8_t> header(ENTRY_HEADER_SIZE + entry.key.size());
+	putUInt32(&header[0], ENTRY_MAGIC);
+	header[8] = static_cast<uint8_t>(entry.type);
+	putUInt32(&header[12], static_cast<uint32_t>(entry.key.size()));
+	putUInt64(&header[16], entry.serial);
+	putUInt64(&header[24], entry.size);
+	std::copy(entry.key.begin(), entry.key.end(),
+	    header.begin() + ENTRY_HEADER_SIZE);
+	uint32_t crc = updateCRC(0, &header[8], header.size() - 8);
+	crc = updateCRC(crc, data, entry.size);
+	putUInt32(&header[4], crc);
+
+	try {
+		writeFully(active.fd, header.data(), header.size(),
+		    active.size);
+		if (entry.size > 0)
+			writeFully(active.fd, static_cast<const uint8_t*>(data),
+			    entry.size, active.size + header.size());
+	} catch (Error::Exception &e) {
+		/* Don't leave a partial entry for later entries to follow */
+		if (ftruncate(active.fd, active.size) != 0) {}
+		throw;
+	}
+
+	const Location location{_activeSegment, active.size, entry.size,
+	    entry.serial};
+	active.size += header.size() + entry.size;
+	active.dirty = true;
+	_uncheckpointedBytes += header.size() + entry.size;
+	return (location);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::setLocation(
+    const std::string &key,
+    const Location &location)
+{
+	auto it = _index.find(key);
+	if (it == _index.end()) {
+		it = _index.emplace(key, location).first;
+		_order[location.serial] = &it->first;
+	} else {
+		const Location &old = it->second;
+		_segments.at(old.segment).liveBytes -= entrySize(key,
+		    old.size);
+		if (old.serial != location.serial) {
+			_order.erase(old.serial);
+			_order[location.serial] = &it->first;
+		}
+		it->second = location;
+	}
+	_segments.at(location.segment).liveBytes += entrySize(key,
+	    location.size);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::dropKey(
+    const std::string &key)
+{
+	const auto it = _index.find(key);
+	if (it == _index.end())
+		return;
+	_segments.at(it->second.segment).liveBytes -= entrySize(key,
+	    it->second.size);
+	_order.erase(it->second.serial);
+	_index.erase(it);
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::readData(
+    const std::string &key,
+    const Location &location)
+    const
+{
+	Memory::uint8Array data(location.size);
+	if (location.size > 0)
+		readFully(_segments.at(location.segment).fd, data,
+		    location.size, location.offset + ENTRY_HEADER_SIZE +
+		    key.size());
+	return (data);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::afterModification(
+    bool sealed)
+{
+	if (_checkpointInterval != 0) {
+		/* Writers that find a checkpoint underway don't wait */
+		std::unique_lock<std::mutex> lock(_checkpointMutex,
+		    std::try_to_lock);
+		if (lock.owns_lock() &&
+		    (_uncheckpointedBytes >= _checkpointInterval))
+			this->writeCheckpoint();
+	}
+
+	if (!sealed || (_autoCompactThreshold == 0) || _compacting)
+		return;
+	bool needed = false;
+	{
+		ScopedRWLock lock(&_lock, false);
+		for (const auto &segment : _segments) {
+			const uint64_t dead = segment.second.size -
+			    segment.second.liveBytes;
+			if ((segment.first != _activeSegment) && (dead > 0) &&
+			    (dead >= (_autoCompactThreshold *
+			    segment.second.size))) {
+				needed = true;
+				break;
+			}
+		}
+	}
+	if (needed) {
+		try {
+			this->startCompaction(_autoCompactThreshold);
+		} catch (Error::StrategyError &e) {
+			/* Another thread started a compaction */
+		}
+	}
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::insert(
+    const std::string &key,
+    const void *const data,
+    const uint64_t size)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	bool sealed;
+	{
+		ScopedRWLock lock(&_lock, true);
+		if (_index.find(key) != _index.end())
+			throw Error::ObjectExists(key);
+
+		sealed = this->sealIfFull(entrySize(key, size));
+		const Location location = this->append(
+		    {EntryType::Put, key, _nextSerial, size}, data);
+		_nextSerial++;
+		this->setLocation(key, location);
+		this->setCount(_index.size());
+	}
+	this->afterModification(sealed);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::replace(
+    const std::string &key,
+    const void *const data,
+    const uint64_t size)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	bool sealed;
+	{
+		ScopedRWLock lock(&_lock, true);
+		const auto it = _index.find(key);
+		if (it == _index.end())
+			throw Error::ObjectDoesNotExist(key);
+
+		/* The record keeps its place in the sequence */
+		sealed = this->sealIfFull(entrySize(key, size));
+		const Location location = this->append(
+		    {EntryType::Put, key, it->second.serial, size}, data);
+		this->setLocation(key, location);
+	}
+	this->afterModification(sealed);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::remove(
+    const std::string &key)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	bool sealed;
+	{
+		ScopedRWLock lock(&_lock, true);
+		const auto it = _index.find(key);
+		if (it == _index.end())
+			throw Error::ObjectDoesNotExist(key);
+
+		sealed = this->sealIfFull(entrySize(key, 0));
+		(void)this->append({EntryType::Remove, key, it->second.serial,
+		    0}, nullptr);
+		this->dropKey(key);
+		this->setCount(_index.size());
+	}
+	this->afterModification(sealed);
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::read(
+    const std::string &key)
+    const
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	const auto it = _index.find(key);
+	if (it == _index.end())
+		throw Error::ObjectDoesNotExist(key);
+	return (this->readData(key, it->second));
+}
+
+uint64_t
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::length(
+    const std::string &key)
+    const
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	const auto it = _index.find(key);
+	if (it == _index.end())
+		throw Error::ObjectDoesNotExist(key);
+	return (it->second.size);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::flush(
+    const std::string &key)
+    const
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	ScopedRWLock lock(&_lock, false);
+	const auto it = _index.find(key);
+	if (it == _index.end())
+		throw Error::ObjectDoesNotExist(key);
+	syncFully(_segments.at(it->second.segment).fd);
+}
+
+unsigned int
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::getCount()
+    const
+{
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	return (static_cast<unsigned int>(_index.size()));
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::sync()
+    const
+{
+	if (this->getMode() == Mode::ReadOnly)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_checkpointMutex);
+		if (_uncheckpointedBytes != 0)
+			this->writeCheckpoint();
+	}
+	RecordStore::Impl::sync();
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::checkpoint()
+    const
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+
+	std::lock_guard<std::mutex> lock(_checkpointMutex);
+	this->writeCheckpoint();
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::writeCheckpoint()
+    const
+{
+	std::vector<uint8_t> buf;
+	{
+		/* Excludes writers, but not readers */
+		ScopedRWLock lock(&_lock, false);
+
+		/* Everything the checkpoint refers to must be durable */
+		for (const auto &segment : _segments) {
+			if (segment.second.dirty) {
+				syncFully(segment.second.fd);
+				segment.second.dirty = false;
+			}
+		}
+
+		buf.reserve(CHECKPOINT_HEADER_SIZE + 4 + (_index.size() *
+		    (CHECKPOINT_ENTRY_SIZE + 16)));
+		buf.resize(CHECKPOINT_HEADER_SIZE);
+		std::copy(CHECKPOINT_MAGIC.begin(), CHECKPOINT_MAGIC.end(),
+		    buf.begin());
+		uint64_t pos = CHECKPOINT_MAGIC.size();
+		putUInt32(&buf[pos], _activeSegment);
+		pos += 4;
+		putUInt64(&buf[pos], _segments.at(_activeSegment).size);
+		pos += 8;
+		putUInt64(&buf[pos], _nextSerial);
+		pos += 8;
+		putUInt64(&buf[pos], _index.size());
+
+		/* Entries are in serial order, so loading needs no sort */
+		uint8_t fixed[CHECKPOINT_ENTRY_SIZE];
+		for (const auto &ordered : _order) {
+			const std::string &key = *ordered.second;
+			const Location &location = _index.at(key);
+			putUInt32(fixed, static_cast<uint32_t>(key.size()));
+			putUInt32(fixed + 4, location.segment);
+			putUInt64(fixed + 8, location.offset);
+			putUInt64(fixed + 16, location.size);
+			putUInt64(fixed + 24, location.serial);
+			buf.insert(buf.end(), fixed, fixed + 4);
+			buf.insert(buf.end(), key.begin(), key.end());
+			buf.insert(buf.end(), fixed + 4,
+			    fixed + CHECKPOINT_ENTRY_SIZE);
+		}
+		_uncheckpointedBytes = 0;
+	}
+	uint8_t crc[4];
+	putUInt32(crc, updateCRC(0, buf.data(), buf.size()));
+	buf.insert(buf.end(), crc, crc + 4);
+
+	/* Replace the previous checkpoint atomically */
+	const std::string pathname = this->canonicalName(
+	    LogStructuredRecordStore::CHECKPOINT_FILE_NAME);
+	const std::string tempPathname = pathname + ".tmp";
+	const int fd = open(tempPathname.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+	    0666);
+	if (fd == -1)
+		throw Error::StrategyError("Could not create " + tempPathname +
+		    " (" + Error::errorStr() + ")");
+	try {
+		writeFully(fd, buf.data(), buf.size(), 0);
+		syncFully(fd);
+	} catch (Error::Exception &e) {
+		close(fd);
+		unlink(tempPathname.c_str());
+		_uncheckpointedBytes += 1;
+		throw;
+	}
+	close(fd);
+	if (rename(tempPathname.c_str(), pathname.c_str()) != 0) {
+		_uncheckpointedBytes += 1;
+		throw Error::StrategyError("Could not rename " + tempPathname +
+		    " (" + Error::errorStr() + ")");
+	}
+}
+
+uint64_t
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::getSpaceUsed()
+    const
+{
+	uint64_t total = RecordStore::Impl::getSpaceUsed();
+	struct stat sb;
+
+	{
+		ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+		for (const auto &segment : _segments) {
+			if (fstat(segment.second.fd, &sb) != 0)
+				throw Error::StrategyError("Could not stat "
+				    "log segment (" + Error::errorStr() + ")");
+			total += sb.st_blocks * S_BLKSIZE;
+		}
+	}
+
+	if (stat(this->canonicalName(LogStructuredRecordStore::
+	    CHECKPOINT_FILE_NAME).c_str(), &sb) == 0)
+		total += sb.st_blocks * S_BLKSIZE;
+	return (total);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::i_sequence(
+    bool returnData,
+    int cursor)
+{
+	if ((cursor != BE_RECSTORE_SEQ_START) &&
+	    (cursor != BE_RECSTORE_SEQ_NEXT))
+	    	throw Error::StrategyError("Invalid cursor position as "
+		    "argument");
+
+	if ((getCursor() == BE_RECSTORE_SEQ_START) ||
+	    (cursor == BE_RECSTORE_SEQ_START))
+		_seqSerial = 0;
+
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	const auto it = _order.lower_bound(_seqSerial);
+	if (it == _order.end()) {
+		setCursor(BE_RECSTORE_SEQ_NEXT);
+		throw Error::ObjectDoesNotExist("No record at position");
+	}
+
+	RecordStore::Record record;
+	record.key = *it->second;
+	if (returnData)
+		record.data = this->readData(record.key,
+		    _index.at(record.key));
+
+	_seqSerial = it->first + 1;
+	setCursor(BE_RECSTORE_SEQ_NEXT);
+	return (record);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::sequence(
+    int cursor)
+{
+	return (i_sequence(true, cursor));
+}
+
+std::string
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::sequenceKey(
+    int cursor)
+{
+	RecordStore::Record record = i_sequence(false, cursor);
+	return (record.key);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::setCursorAtKey(
+    const std::string &key)
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	const auto it = _index.find(key);
+	if (it == _index.end())
+		throw Error::ObjectDoesNotExist(key);
+	_seqSerial = it->second.serial;
+	setCursor(BE_RECSTORE_SEQ_NEXT);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::move(
+    const std::string &pathname)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+
+	this->cancelCompaction();
+	this->sync();
+	this->closeSegments();
+	RecordStore::Impl::move(pathname);
+
+	std::vector<uint32_t> segments;
+	for (const auto &segment : _segments)
+		segments.push_back(segment.first);
+	this->openSegments(segments);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::compact(
+    double threshold)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if ((threshold < 0) || (threshold > 1))
+		throw Error::ParameterError("Threshold must be within [0, 1]");
+
+	std::lock_guard<std::mutex> compactionLock(_compactionMutex);
+
+	/*
+	 * Sealed segments never change, so their files can be read
+	 * without the lock.  Only compaction deletes segments.
+	 */
+	struct Victim
+	{
+		uint32_t segment;
+		int fd;
+		uint64_t size;
+	};
+	std::vector<Victim> victims;
+	{
+		ScopedRWLock lock(&_lock, false);
+		for (const auto &segment : _segments) {
+			const uint64_t dead = segment.second.size -
+			    segment.second.liveBytes;
+			if ((segment.first != _activeSegment) && (dead > 0) &&
+			    (dead >= (threshold * segment.second.size)))
+				victims.push_back({segment.first,
+				    segment.second.fd, segment.second.size});
+		}
+	}
+
+	std::vector<uint32_t> emptied;
+	Entry entry;
+	Memory::uint8Array data;
+	for (const auto &victim : victims) {
+		uint64_t offset = 0;
+		while ((offset < victim.size) && !_cancelCompaction) {
+			uint32_t expectedCRC, crc;
+			if (!readEntryHeader(victim.fd, offset, victim.size,
+			    entry, expectedCRC, crc))
+				throw Error::StrategyError("Log segment " +
+				    std::to_string(victim.segment) + " is "
+				    "damaged at offset " +
+				    std::to_string(offset));
+
+			if (entry.type == EntryType::Put) {
+				bool live;
+				{
+					ScopedRWLock lock(&_lock, false);
+					const auto it = _index.find(entry.key);
+					live = ((it != _index.end()) &&
+					    (it->second.segment ==
+					    victim.segment) &&
+					    (it->second.offset == offset));
+				}
+				if (live) {
+					data.resize(entry.size);
+					if (entry.size > 0)
+						readFully(victim.fd, data,
+						    entry.size, offset +
+						    ENTRY_HEADER_SIZE +
+						    entry.key.size());
+
+					/* Skip if changed since checked */
+					ScopedRWLock lock(&_lock, true);
+					const auto it = _index.find(entry.key);
+					if ((it != _index.end()) &&
+					    (it->second.segment ==
+					    victim.segment) &&
+					    (it->second.offset == offset)) {
+						this->sealIfFull(entrySize(
+						    entry.key, entry.size));
+						this->setLocation(entry.key,
+						    this->append(entry, data));
+					}
+				}
+			} else {
+				/*
+				 * A removal must outlive any older entry
+				 * for its key, unless the key was since
+				 * inserted again.
+				 */
+				ScopedRWLock lock(&_lock, true);
+				if ((_index.find(entry.key) == _index.end()) &&
+				    (_segments.begin()->first <
+				    victim.segment)) {
+					this->sealIfFull(entrySize(entry.key,
+					    0));
+					(void)this->append(entry, nullptr);
+				}
+			}
+			offset += entrySize(entry.key, entry.size);
+		}
+		if (offset < victim.size)
+			break;
+		emptied.push_back(victim.segment);
+	}
+	if (emptied.empty())
+		return;
+
+	/* Deleted segments must not be needed to recover the index */
+	this->checkpoint();
+	for (const auto segment : emptied) {
+		{
+			ScopedRWLock lock(&_lock, true);
+			const auto it = _segments.find(segment);
+			if ((it == _segments.end()) ||
+			    (it->second.liveBytes != 0))
+				continue;
+			close(it->second.fd);
+			_segments.erase(it);
+		}
+		unlink(this->segmentPathname(segment).c_str());
+	}
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::startCompaction(
+    double threshold)
+{
+	if (getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+
+	std::lock_guard<std::mutex> lock(_compactionThreadMutex);
+	if (_compacting)
+		throw Error::StrategyError("Compaction is already running");
+
+	if (_compactionThread.joinable())
+		_compactionThread.join();
+	_compactionError = nullptr;
+	_cancelCompaction = false;
+	_compacting = true;
+	_compactionThread = std::thread([this, threshold]() {
+		try {
+			this->compact(threshold);
+		} catch (...) {
+			_compactionError = std::current_exception();
+		}
+		_compacting = false;
+	});
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::waitForCompaction()
+{
+	std::lock_guard<std::mutex> lock(_compactionThreadMutex);
+	if (_compactionThread.joinable())
+		_compactionThread.join();
+	if (_compactionError) {
+		std::exception_ptr error = _compactionError;
+		_compactionError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::cancelCompaction()
+{
+	std::lock_guard<std::mutex> lock(_compactionThreadMutex);
+	_cancelCompaction = true;
+	if (_compactionThread.joinable())
+		_compactionThread.join();
+	_cancelCompaction = false;
+}
+
+bool
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::isCompacting()
+    const
+{
+	return (_compacting);
+}
+
+void
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::setAutoCompaction(
+    double threshold)
+{
+	if (getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if ((threshold < 0) || (threshold > 1))
+		throw Error::ParameterError("Threshold must be within [0, 1]");
+
+	_autoCompactThreshold = threshold;
+}
+
+uint64_t
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::getDeadSpace()
+    const
+{
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	uint64_t dead = 0;
+	for (const auto &segment : _segments)
+		if (segment.first != _activeSegment)
+			dead += segment.second.size - segment.second.liveBytes;
+	return (dead);
+}
+
+unsigned int
+BiometricEvaluation::IO::LogStructuredRecordStore::Impl::getSegmentCount()
+    const
+{
+	ScopedRWLock lock(&_lock, false, getMode() == Mode::ReadWrite);
+	return (static_cast<unsigned int>(_segments.size()));
+}
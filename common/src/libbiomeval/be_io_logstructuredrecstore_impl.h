@@ -0,0 +1,534 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IO_LOGSTRUCTUREDRECSTORE_IMPL_H__
+#define __BE_IO_LOGSTRUCTUREDRECSTORE_IMPL_H__
+
+#include <pthread.h>
+
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <be_io_logstructuredrecstore.h>
+#include "be_io_recordstore_impl.h"
+
+namespace BiometricEvaluation
+{
+	namespace IO
+	{
+		/**
+		 * @brief
+		 * Implementation of LogStructuredRecordStore.
+		 *
+		 * @details
+		 * Each log entry is a fixed-size header followed by the
+		 * key and the record data.  The header holds a magic
+		 * number, a CRC-32 of the rest of the entry, the entry
+		 * type, the key length, the record's insertion serial
+		 * number, and the data length, all little-endian.
+		 */
+		class LogStructuredRecordStore::Impl : public RecordStore::Impl
+		{
+		public:
+			Impl(
+			    const std::string &pathname,
+			    const std::string &description,
+			    uint64_t segmentSize,
+			    uint64_t checkpointInterval);
+
+			Impl(
+			    const std::string &pathname,
+			    IO::Mode mode = IO::Mode::ReadOnly);
+
+			~Impl();
+
+			uint64_t
+			getSpaceUsed() const;
+
+			void
+			sync() const;
+
+			unsigned int
+			getCount() const;
+
+			void
+			insert(
+			    const std::string &key,
+			    const void *const data,
+			    const uint64_t size);
+
+			void
+			replace(
+			    const std::string &key,
+			    const void *const data,
+			    const uint64_t size);
+
+			void
+			remove(
+			    const std::string &key);
+
+			Memory::uint8Array
+			read(
+			    const std::string &key) const;
+
+			uint64_t
+			length(
+			    const std::string &key) const;
+
+			void
+			flush(
+			    const std::string &key) const;
+
+			RecordStore::Record
+			sequence(
+			    int cursor = BE_RECSTORE_SEQ_NEXT);
+
+			std::string
+			sequenceKey(
+			    int cursor = BE_RECSTORE_SEQ_NEXT);
+
+			void
+			setCursorAtKey(
+			    const std::string &key);
+
+			void
+			move(
+			    const std::string &pathname);
+
+			void
+			checkpoint() const;
+
+			void
+			compact(
+			    double threshold);
+
+			void
+			startCompaction(
+			    double threshold);
+
+			void
+			waitForCompaction();
+
+			void
+			cancelCompaction();
+
+			bool
+			isCompacting() const;
+
+			void
+			setAutoCompaction(
+			    double threshold);
+
+			uint64_t
+			getDeadSpace() const;
+
+			unsigned int
+			getSegmentCount() const;
+
+			Impl(
+			    const LogStructuredRecordStore&) = delete;
+			Impl&
+			operator=(
+			    const LogStructuredRecordStore&) = delete;
+
+		private:
+			/** Types of log entries */
+			enum class EntryType : uint8_t
+			{
+				/** Record data for a key */
+				Put = 1,
+				/** Removal of a key */
+				Remove = 2
+			};
+
+			/** A log entry, as described by its header */
+			struct Entry
+			{
+				EntryType type;
+				std::string key;
+				/** Serial number of the record */
+				uint64_t serial;
+				/** Length of the record data */
+				uint64_t size;
+			};
+
+			/** Location of the newest entry for a live key */
+			struct Location
+			{
+				/** Segment holding the entry */
+				uint32_t segment;
+				/** Offset of the entry within the segment */
+				uint64_t offset;
+				/** Length of the record data */
+				uint64_t size;
+				/** Serial number, which orders sequencing */
+				uint64_t serial;
+			};
+
+			/** One file of the log */
+			struct Segment
+			{
+				/** Descriptor, read/write for the active one */
+				int fd;
+				/** Bytes of entries in the file */
+				uint64_t size;
+				/** Bytes of entries that are in the index */
+				uint64_t liveBytes;
+				/** Whether written since last forced to disk */
+				mutable bool dirty;
+			};
+
+			/** Size at which the active segment is sealed */
+			uint64_t _segmentSize;
+
+			/** Bytes logged between automatic checkpoints */
+			uint64_t _checkpointInterval;
+
+			/** Newest entry of each live key */
+			std::unordered_map<std::string, Location> _index;
+
+			/** Keys by serial number, for sequencing */
+			std::map<uint64_t, const std::string*> _order;
+
+			/** Segments of the log, by number */
+			std::map<uint32_t, Segment> _segments;
+
+			/** Number of the segment being appended to */
+			uint32_t _activeSegment;
+
+			/** Serial number of the next new key */
+			uint64_t _nextSerial;
+
+			/** Bytes logged since the last checkpoint */
+			mutable std::atomic<uint64_t> _uncheckpointedBytes;
+
+			/** Serializes checkpoints */
+			mutable std::mutex _checkpointMutex;
+
+			/** Lowest serial number the next sequence() returns */
+			uint64_t _seqSerial;
+
+			/**
+			 * Held shared by readers and exclusively by
+			 * modifiers of a read/write store.  Not used for
+			 * read-only stores, which cannot change.
+			 */
+			mutable pthread_rwlock_t _lock;
+
+			/** Serializes compactions */
+			std::mutex _compactionMutex;
+
+			/** Serializes starting and joining _compactionThread */
+			std::mutex _compactionThreadMutex;
+
+			/** Background compaction thread */
+			std::thread _compactionThread;
+
+			/** Whether _compactionThread is running */
+			std::atomic<bool> _compacting;
+
+			/** Request that a running compaction stop */
+			std::atomic<bool> _cancelCompaction;
+
+			/** Failure of the last background compaction */
+			std::exception_ptr _compactionError;
+
+			/** Dead fraction that triggers compaction, or 0 */
+			double _autoCompactThreshold;
+
+			/**
+			 * @brief
+			 * Common member initialization for constructors.
+			 */
+			void
+			init();
+
+			/**
+			 * @param[in] segment
+			 *	Segment number.
+			 *
+			 * @return
+			 *	Path to the segment's file.
+			 */
+			std::string
+			segmentPathname(
+			    uint32_t segment)
+			    const;
+
+			/**
+			 * @brief
+			 * Open the file of every segment, making the
+			 * newest one active.
+			 *
+			 * @param[in] segments
+			 *	Segment numbers, which are added to
+			 *	_segments if not already present.
+			 */
+			void
+			openSegments(
+			    const std::vector<uint32_t> &segments);
+
+			/**
+			 * @brief
+			 * Close the file of every segment.
+			 */
+			void
+			closeSegments();
+
+			/**
+			 * @brief
+			 * Seal the active segment and start a new one.
+			 */
+			void
+			startSegment();
+
+			/**
+			 * @brief
+			 * Start a new segment if an entry would overflow
+			 * the active one.
+			 * @note
+			 * Caller must hold _lock exclusively.
+			 *
+			 * @param[in] size
+			 *	Size of the entry to be appended.
+			 *
+			 * @return
+			 *	Whether a segment was sealed.
+			 */
+			bool
+			sealIfFull(
+			    uint64_t size);
+
+			/**
+			 * @brief
+			 * Build the index from the checkpoint and the log.
+			 */
+			void
+			recover();
+
+			/**
+			 * @brief
+			 * Load the index from the checkpoint file.
+			 *
+			 * @param[out] segment
+			 *	Segment at which to resume replay.
+			 * @param[out] offset
+			 *	Offset in segment at which to resume replay.
+			 *
+			 * @return
+			 *	Whether a valid checkpoint was loaded.
+			 */
+			bool
+			loadCheckpoint(
+			    uint32_t &segment,
+			    uint64_t &offset);
+
+			/**
+			 * @brief
+			 * Apply the entries of a segment to the index.
+			 *
+			 * @param[in] segment
+			 *	Segment to replay.
+			 * @param[in] offset
+			 *	Offset of the first entry to replay.
+			 * @param[in] last
+			 *	Whether segment is the newest segment,
+			 *	where a damaged entry marks the end of the
+			 *	log rather than an error.
+			 */
+			void
+			replay(
+			    uint32_t segment,
+			    uint64_t offset,
+			    bool last);
+
+			/**
+			 * @brief
+			 * Read the header and key of the entry at offset.
+			 *
+			 * @param[in] fd
+			 *	Descriptor of the segment.
+			 * @param[in] offset
+			 *	Offset of the entry.
+			 * @param[in] fileSize
+			 *	Size of the segment file.
+			 * @param[out] entry
+			 *	The entry's header and key.
+			 * @param[out] expectedCRC
+			 *	CRC-32 recorded for the entry.
+			 * @param[out] crc
+			 *	CRC-32 of the header and key, to be
+			 *	continued over the record data.
+			 *
+			 * @return
+			 *	false if the entry is incomplete or is not
+			 *	an entry.
+			 */
+			static bool
+			readEntryHeader(
+			    int fd,
+			    uint64_t offset,
+			    uint64_t fileSize,
+			    Entry &entry,
+			    uint32_t &expectedCRC,
+			    uint32_t &crc);
+
+			/**
+			 * @brief
+			 * Read and verify the entry at offset.
+			 *
+			 * @param[in] fd
+			 *	Descriptor of the segment.
+			 * @param[in] offset
+			 *	Offset of the entry.
+			 * @param[in] fileSize
+			 *	Size of the segment file.
+			 * @param[out] entry
+			 *	The entry's header and key.
+			 * @param[out] data
+			 *	The entry's record data.
+			 *
+			 * @return
+			 *	false if the entry is incomplete or fails
+			 *	its checksum.
+			 */
+			static bool
+			readEntry(
+			    int fd,
+			    uint64_t offset,
+			    uint64_t fileSize,
+			    Entry &entry,
+			    Memory::uint8Array &data);
+
+			/**
+			 * @brief
+			 * Append an entry to the active segment.
+			 * @note
+			 * Caller must hold _lock exclusively.
+			 *
+			 * @param[in] entry
+			 *	Entry to append.
+			 * @param[in] data
+			 *	Record data.
+			 *
+			 * @return
+			 *	Location of the appended entry.
+			 */
+			Location
+			append(
+			    const Entry &entry,
+			    const void *const data);
+
+			/**
+			 * @brief
+			 * Point a key at a new location in the index,
+			 * adjusting segment accounting.
+			 * @note
+			 * Caller must hold _lock exclusively.
+			 *
+			 * @param[in] key
+			 *	Key to update.
+			 * @param[in] location
+			 *	Newest entry for key.
+			 */
+			void
+			setLocation(
+			    const std::string &key,
+			    const Location &location);
+
+			/**
+			 * @brief
+			 * Drop a key from the index, adjusting segment
+			 * accounting.
+			 * @note
+			 * Caller must hold _lock exclusively.
+			 *
+			 * @param[in] key
+			 *	Key to drop.
+			 */
+			void
+			dropKey(
+			    const std::string &key);
+
+			/**
+			 * @brief
+			 * Read the data of a live record.
+			 * @note
+			 * Caller must hold _lock, if the store is
+			 * read/write.
+			 *
+			 * @param[in] key
+			 *	Key of the record.
+			 * @param[in] location
+			 *	Location of the record's newest entry.
+			 *
+			 * @return
+			 *	The record data.
+			 */
+			Memory::uint8Array
+			readData(
+			    const std::string &key,
+			    const Location &location)
+			    const;
+
+			/**
+			 * @brief
+			 * Write the index to the checkpoint file.
+			 * @note
+			 * Caller must hold _checkpointMutex.
+			 */
+			void
+			writeCheckpoint()
+			    const;
+
+			/**
+			 * @brief
+			 * Checkpoint and start automatic compaction, as
+			 * needed, after a modification.
+			 *
+			 * @param[in] sealed
+			 *	Whether the modification sealed a segment.
+			 */
+			void
+			afterModification(
+			    bool sealed);
+
+			/**
+			 * Internal implementation of sequencing through a
+			 * store, returning the key, and optionally, the
+			 * data.
+			 * @param[in] returnData
+			 * 	Whether to return the data with the key.
+			 * @param[in] cursor
+			 *	The location within the sequence of the
+			 *	key/data pair to return.
+			 * @return
+			 *	The record that is next in sequence.
+			 * @throw Error::ObjectDoesNotExist
+			 *	End of sequencing.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 */
+			RecordStore::Record
+			i_sequence(
+			    bool returnData,
+			    int cursor);
+		};
+	}
+}
+
+#endif /* __BE_IO_LOGSTRUCTUREDRECSTORE_IMPL_H__ */
@@ -10,8 +10,12 @@
 
 #include <sys/types.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <climits>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -29,7 +33,8 @@ BiometricEvaluation::IO::PropertiesFile::PropertiesFile(
     IO::Mode mode,
     const std::map<std::string, std::string> &defaults) :
     Properties(mode, defaults),
-    _pathname(pathname)
+    _pathname(pathname),
+    _dirty(!defaults.empty())
 {
 	this->initPropertiesFile(defaults);
 }
@@ -61,7 +66,13 @@ BiometricEvaluation::IO::PropertiesFile::sync()
 	if (this->getMode() == Mode::ReadOnly)
 		throw Error::StrategyError(RO_ERR_MSG);
 
-	std::ofstream ofs(_pathname.c_str());
+	/*
+	 * Replace the file rather than rewriting it in place, so that a
+	 * crash leaves either the old or the new properties, never a
+	 * truncated file.
+	 */
+	const std::string tempName = _pathname + ".tmp";
+	std::ofstream ofs(tempName.c_str());
 	if (!ofs)
 		throw Error::FileError("Could not write properties file");
 
@@ -70,6 +81,67 @@ BiometricEvaluation::IO::PropertiesFile::sync()
 		ofs << *k << " = " << this->getProperty(*k) << '\n';
 	}
 	ofs.close();
+	if (!ofs)
+		throw Error::FileError("Could not write properties file");
+
+	const int fd = open(tempName.c_str(), O_WRONLY);
+	if (fd == -1)
+		throw Error::FileError("Could not open properties file (" +
+		    Error::errorStr() + ")");
+	const int rv = fsync(fd);
+	close(fd);
+	if (rv != 0)
+		throw Error::FileError("Could not sync properties file (" +
+		    Error::errorStr() + ")");
+
+	if (std::rename(tempName.c_str(), _pathname.c_str()) != 0)
+		throw Error::FileError("Could not replace properties file (" +
+		    Error::errorStr() + ")");
+	this->_dirty = false;
+}
+
+void
+BiometricEvaluation::IO::PropertiesFile::setProperty(
+    const std::string &property,
+    const std::string &value)
+{
+	Properties::setProperty(property, value);
+	this->_dirty = true;
+}
+
+void
+BiometricEvaluation::IO::PropertiesFile::setPropertyFromInteger(
+    const std::string &property,
+    int64_t value)
+{
+	Properties::setPropertyFromInteger(property, value);
+	this->_dirty = true;
+}
+
+void
+BiometricEvaluation::IO::PropertiesFile::setPropertyFromDouble(
+    const std::string &property,
+    double value)
+{
+	Properties::setPropertyFromDouble(property, value);
+	this->_dirty = true;
+}
+
+void
+BiometricEvaluation::IO::PropertiesFile::setPropertyFromBoolean(
+    const std::string &property,
+    bool value)
+{
+	Properties::setPropertyFromBoolean(property, value);
+	this->_dirty = true;
+}
+
+void
+BiometricEvaluation::IO::PropertiesFile::removeProperty(
+    const std::string &property)
+{
+	Properties::removeProperty(property);
+	this->_dirty = true;
 }
 
 void
@@ -93,7 +165,7 @@ BiometricEvaluation::IO::PropertiesFile::changeName(
 BiometricEvaluation::IO::PropertiesFile::~PropertiesFile()
 {
 	try {
-		if (this->getMode() != Mode::ReadOnly)
+		if ((this->getMode() != Mode::ReadOnly) && this->_dirty)
 			this->sync();
 	} catch (Error::Exception) {}
 }
@@ -8,11 +8,93 @@
  * about its quality, reliability, or any other characteristic.
  ******************************************************************************/
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include "be_io_recordstore_impl.h"
 #include <be_io_recordstore.h>
 
 namespace BE = BiometricEvaluation;
 
+namespace
+{
+	/**
+	 * @brief
+	 * A range of a list of keys, read through a read-only instance
+	 * of the store opened by the partition.
+	 */
+	class KeyListPartition : public BE::IO::RecordStore::Partition
+	{
+	public:
+		/**
+		 * @param[in] pathname
+		 *	Path of the store.
+		 * @param[in] keys
+		 *	Keys of the store, in sequence order.
+		 * @param[in] first
+		 *	Index of the first key of the partition.
+		 * @param[in] last
+		 *	Index one past the last key of the partition.
+		 */
+		KeyListPartition(
+		    const std::string &pathname,
+		    const std::shared_ptr<const std::vector<std::string>> &keys,
+		    std::size_t first,
+		    std::size_t last) :
+		    _pathname(pathname),
+		    _keys(keys),
+		    _first(first),
+		    _last(last),
+		    _next(first)
+		{
+		}
+
+		BE::IO::RecordStore::Record
+		sequence(
+		    int cursor)
+		    override
+		{
+			const std::string key = this->sequenceKey(cursor);
+			if (!_rs)
+				_rs = BE::IO::RecordStore::openRecordStore(
+				    _pathname);
+			return (BE::IO::RecordStore::Record(key,
+			    _rs->read(key)));
+		}
+
+		std::string
+		sequenceKey(
+		    int cursor)
+		    override
+		{
+			if (cursor == BE::IO::RecordStore::BE_RECSTORE_SEQ_START)
+				_next = _first;
+			else if (cursor !=
+			    BE::IO::RecordStore::BE_RECSTORE_SEQ_NEXT)
+				throw BE::Error::StrategyError("Invalid cursor "
+				    "position as argument");
+			if (_next == _last)
+				throw BE::Error::ObjectDoesNotExist("No record "
+				    "at position");
+			return ((*_keys)[_next++]);
+		}
+
+	private:
+		const std::string _pathname;
+		const std::shared_ptr<const std::vector<std::string>> _keys;
+		const std::size_t _first;
+		const std::size_t _last;
+		/** Index of the next key to return */
+		std::size_t _next;
+		/** Store opened by the thread using this partition */
+		std::shared_ptr<BE::IO::RecordStore> _rs;
+	};
+}
+
 /*
  * Constructors for Record.
  */
@@ -27,6 +109,10 @@ BiometricEvaluation::IO::RecordStore::Record::Record(
 
 const std::string BiometricEvaluation::IO::RecordStore::INVALIDKEYCHARS(
     "/\\*&");
+const unsigned int
+    BiometricEvaluation::IO::RecordStore::DEFAULT_PREFETCH_RECORDS = 16;
+const uint64_t BiometricEvaluation::IO::RecordStore::DEFAULT_PREFETCH_BYTES =
+    64 * 1024 * 1024;
 
 /*
  * RecordStore::Kind
@@ -39,7 +125,11 @@ BE_IO_RecordStore_Kind_EnumToStringMap = {
 	{BiometricEvaluation::IO::RecordStore::Kind::File, "File"},
 	{BiometricEvaluation::IO::RecordStore::Kind::SQLite, "SQLite"},
 	{BiometricEvaluation::IO::RecordStore::Kind::Compressed, "Compressed"},
-	{BiometricEvaluation::IO::RecordStore::Kind::List, "List"}
+	{BiometricEvaluation::IO::RecordStore::Kind::List, "List"},
+	{BiometricEvaluation::IO::RecordStore::Kind::ShardedArchive,
+	    "ShardedArchive"},
+	{BiometricEvaluation::IO::RecordStore::Kind::LogStructured,
+	    "LogStructured"}
 };
 BE_FRAMEWORK_ENUMERATION_DEFINITIONS(
     BiometricEvaluation::IO::RecordStore::Kind,
@@ -127,6 +217,21 @@ BiometricEvaluation::IO::RecordStore::mergeRecordStores(
 	    mergePathname, description, kind, pathnames));
 }
 
+void
+BiometricEvaluation::IO::RecordStore::mergeRecordStores(
+    const std::string &mergePathname,
+    const std::string &description,
+    const RecordStore::Kind &kind,
+    const std::vector<std::string> &pathnames,
+    const MergeTransform &transform,
+    const MergeCallback &callback,
+    unsigned int numThreads)
+{
+	return (IO::RecordStore::Impl::mergeRecordStores(
+	    mergePathname, description, kind, pathnames, transform,
+	    callback, numThreads));
+}
+
 BiometricEvaluation::IO::RecordStore::iterator
 BiometricEvaluation::IO::RecordStore::begin()
     noexcept
@@ -142,6 +247,231 @@ BiometricEvaluation::IO::RecordStore::end()
 	    RecordStoreIterator(this, true));
 }
 
+BiometricEvaluation::IO::RecordStore::iterator
+BiometricEvaluation::IO::RecordStore::prefetchingBegin(
+    unsigned int prefetchRecords,
+    uint64_t prefetchBytes)
+{
+	return (RecordStoreIterator(this, prefetchRecords, prefetchBytes));
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::RecordStore::readPrefix(
+    const std::string &key,
+    uint64_t size)
+    const
+{
+	Memory::uint8Array data = this->read(key);
+	if (data.size() > size)
+		data.resize(size);
+	return (data);
+}
+
+void
+BiometricEvaluation::IO::RecordStore::adviseSequentialRead(
+    unsigned int records)
+{
+	/* Nothing to advise, by default */
+}
+
+BiometricEvaluation::IO::RecordStore::Partition::~Partition()
+{
+}
+
+std::vector<std::shared_ptr<BiometricEvaluation::IO::RecordStore::Partition>>
+BiometricEvaluation::IO::RecordStore::partition(
+    unsigned int count)
+{
+	if (count == 0)
+		throw Error::ParameterError("Partition count must be positive");
+
+	std::shared_ptr<std::vector<std::string>> keys(
+	    new std::vector<std::string>());
+	keys->reserve(this->getCount());
+	try {
+		keys->push_back(this->sequenceKey(BE_RECSTORE_SEQ_START));
+		for (;;)
+			keys->push_back(this->sequenceKey(BE_RECSTORE_SEQ_NEXT));
+	} catch (Error::ObjectDoesNotExist) {
+		/* End of sequence */
+	}
+
+	std::vector<std::shared_ptr<Partition>> partitions;
+	partitions.reserve(count);
+	for (unsigned int i = 0; i < count; i++)
+		partitions.emplace_back(new KeyListPartition(
+		    this->getPathname(), keys, keys->size() * i / count,
+		    keys->size() * (i + 1) / count));
+	return (partitions);
+}
+
+/******************************************************************************/
+/* RecordStoreIterator::Prefetcher                                            */
+/******************************************************************************/
+
+namespace BiometricEvaluation
+{
+	namespace IO
+	{
+		/**
+		 * @brief
+		 * Sequences a RecordStore on a background thread,
+		 * holding a bounded number of records until the
+		 * iterator reaches them.
+		 */
+		class RecordStoreIterator::Prefetcher
+		{
+		public:
+			Prefetcher(
+			    RecordStore *recordStore,
+			    unsigned int records,
+			    uint64_t bytes);
+
+			~Prefetcher();
+
+			/**
+			 * @brief
+			 * Wait for the next record.
+			 *
+			 * @param[out] record
+			 *	The next record in sequence.
+			 *
+			 * @return
+			 *	false if there are no more records.
+			 *
+			 * @throw Error::Exception
+			 *	Reading the record failed.
+			 */
+			bool
+			next(
+			    RecordStore::Record &record);
+
+		private:
+			/** Store being sequenced */
+			RecordStore *_recordStore;
+			/** Most records to hold */
+			unsigned int _records;
+			/** Most bytes of record data to hold */
+			uint64_t _bytes;
+
+			/** Protects the members below */
+			std::mutex _mutex;
+			/** Signals changes to the members below */
+			std::condition_variable _cv;
+			/** Records read ahead, in sequence order */
+			std::deque<RecordStore::Record> _buffer;
+			/** Bytes of record data in _buffer */
+			uint64_t _bufferedBytes;
+			/** Whether the last record has been read */
+			bool _done;
+			/** Whether the thread should exit */
+			bool _stop;
+			/** Failure reading the record after _buffer */
+			std::exception_ptr _error;
+
+			/** Reads records into _buffer */
+			std::thread _thread;
+
+			/** Body of _thread */
+			void
+			run();
+		};
+	}
+}
+
+BiometricEvaluation::IO::RecordStoreIterator::Prefetcher::Prefetcher(
+    RecordStore *recordStore,
+    unsigned int records,
+    uint64_t bytes) :
+    _recordStore(recordStore),
+    _records(std::max(records, 1u)),
+    _bytes(bytes),
+    _bufferedBytes(0),
+    _done(false),
+    _stop(false)
+{
+	_recordStore->adviseSequentialRead(_records);
+	_thread = std::thread(&Prefetcher::run, this);
+}
+
+BiometricEvaluation::IO::RecordStoreIterator::Prefetcher::~Prefetcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cv.notify_all();
+	_thread.join();
+
+	try {
+		_recordStore->adviseSequentialRead(0);
+	} catch (Error::Exception) {
+		/* Advice only */
+	}
+}
+
+void
+BiometricEvaluation::IO::RecordStoreIterator::Prefetcher::run()
+{
+	int cursor = RecordStore::BE_RECSTORE_SEQ_START;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [&]() {
+				return (_stop || _buffer.empty() ||
+				    ((_buffer.size() < _records) &&
+				    (_bufferedBytes < _bytes)));
+			});
+			if (_stop)
+				return;
+		}
+
+		/* The store is only used by this thread until done */
+		RecordStore::Record record;
+		try {
+			record = _recordStore->sequence(cursor);
+			cursor = RecordStore::BE_RECSTORE_SEQ_NEXT;
+		} catch (Error::ObjectDoesNotExist) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_done = true;
+			_cv.notify_all();
+			return;
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_error = std::current_exception();
+			_done = true;
+			_cv.notify_all();
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_bufferedBytes += record.data.size();
+		_buffer.push_back(std::move(record));
+		_cv.notify_all();
+	}
+}
+
+bool
+BiometricEvaluation::IO::RecordStoreIterator::Prefetcher::next(
+    RecordStore::Record &record)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cv.wait(lock, [&]() {
+		return (!_buffer.empty() || _done);
+	});
+	if (_buffer.empty()) {
+		if (_error)
+			std::rethrow_exception(_error);
+		return (false);
+	}
+
+	record = std::move(_buffer.front());
+	_buffer.pop_front();
+	_bufferedBytes -= record.data.size();
+	_cv.notify_all();
+	return (true);
+}
+
 /******************************************************************************/
 /* RecordStoreIterator                                                        */
 /******************************************************************************/
@@ -158,6 +488,18 @@ BiometricEvaluation::IO::RecordStoreIterator::RecordStoreIterator(
 		this->setBegin();
 }
 
+BiometricEvaluation::IO::RecordStoreIterator::RecordStoreIterator(
+    BiometricEvaluation::IO::RecordStore *recordStore,
+    unsigned int prefetchRecords,
+    uint64_t prefetchBytes) :
+    _recordStore{recordStore},
+    _atEnd{false},
+    _prefetcher{new Prefetcher(recordStore, prefetchRecords,
+        prefetchBytes)}
+{
+	this->step(1);
+}
+
 BiometricEvaluation::IO::RecordStoreIterator::reference
 BiometricEvaluation::IO::RecordStoreIterator::operator*()
 {
@@ -233,6 +575,16 @@ BiometricEvaluation::IO::RecordStoreIterator::step(
 	if (numSteps <= 0)
 		return;
 
+	if (this->_prefetcher) {
+		for (difference_type i = 0; i < numSteps; i++) {
+			if (!this->_prefetcher->next(this->_currentRecord)) {
+				this->setEnd();
+				return;
+			}
+		}
+		return;
+	}
+
 	/* Forward one step */
 	if (numSteps == 1) {
 		try {
@@ -264,6 +616,9 @@ BiometricEvaluation::IO::RecordStoreIterator::setEnd()
 {
 	this->_atEnd = true;
 	this->_currentRecord = RecordStore::Record();
+
+	/* The last copy to reach the end stops reading ahead */
+	this->_prefetcher.reset();
 }
 
 
@@ -13,10 +13,19 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include <be_error.h>
 #include <be_error_exception.h>
@@ -28,7 +37,9 @@
 #include <be_io_dbrecstore.h>
 #include <be_io_filerecstore.h>
 #include <be_io_listrecstore.h>
+#include <be_io_logstructuredrecstore.h>
 #include <be_io_propertiesfile.h>
+#include <be_io_shardedarchiverecstore.h>
 #include <be_io_sqliterecstore.h>
 #include <be_io_utility.h>
 #include <be_memory_autoarray.h>
@@ -42,9 +53,54 @@ using namespace BE::Framework::Enumeration;
  * The common properties for all RecordStore types.
  */
 const std::string BE::IO::RecordStore::Impl::CONTROLFILENAME(".rscontrol.prop");
+const std::string BE::IO::RecordStore::Impl::CONTROLJOURNALFILENAME(
+    ".rscontrol.journal");
+const uint64_t BE::IO::RecordStore::Impl::CONTROLJOURNAL_CHECKPOINT_RECORDS =
+    4096;
 static const std::string DESCRIPTIONPROPERTY("Description");
 static const std::string COUNTPROPERTY("Count");
 static const std::string TYPEPROPERTY("Type");
+static const std::string GENERATIONPROPERTY("Control Generation");
+
+/*
+ * Each control journal record is a little-endian magic number, a CRC-32
+ * of the rest of the record, the control file generation the record
+ * follows, and the record count.
+ */
+static const uint32_t JOURNAL_MAGIC = 0x4A524542;
+static const std::size_t JOURNAL_RECORD_SIZE = 24;
+
+namespace
+{
+	void
+	putJournalField(
+	    uint8_t *buf,
+	    uint64_t value,
+	    unsigned int bytes)
+	{
+		for (unsigned int i = 0; i < bytes; i++)
+			buf[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+
+	uint64_t
+	getJournalField(
+	    const uint8_t *buf,
+	    unsigned int bytes)
+	{
+		uint64_t value = 0;
+		for (unsigned int i = 0; i < bytes; i++)
+			value |= static_cast<uint64_t>(buf[i]) << (8 * i);
+		return (value);
+	}
+
+	uint32_t
+	journalCRC(
+	    const uint8_t *record)
+	{
+		return (static_cast<uint32_t>(crc32(0, record + 8,
+		    JOURNAL_RECORD_SIZE - 8)));
+	}
+}
 
 /** Error message when trying to change a core property */
 static const std::string COREPROPERTYERROR("Cannot change core properties");
@@ -61,7 +117,13 @@ BiometricEvaluation::IO::RecordStore::Impl::Impl(
     const BE::IO::RecordStore::Kind &kind) :
     _pathname(pathname),
     _cursor(RecordStore::BE_RECSTORE_SEQ_START),
-    _mode(IO::Mode::ReadWrite)
+    _mode(IO::Mode::ReadWrite),
+    _count(0),
+    _journalfd(-1),
+    _generation(0),
+    _journalCount(0),
+    _journalRecords(0),
+    _controlDirty(false)
 {
 	if (IO::Utility::fileExists(pathname))
 		throw Error::ObjectExists(pathname + " already exists");
@@ -83,6 +145,8 @@ BiometricEvaluation::IO::RecordStore::Impl::Impl(
 	_props->setPropertyFromInteger(COUNTPROPERTY, 0);
 	_props->setProperty(DESCRIPTIONPROPERTY, description);
 	_props->setProperty(TYPEPROPERTY, to_string(kind));
+	this->checkpointControl();
+	this->openControlJournal();
 }
 
 BiometricEvaluation::IO::RecordStore::Impl::Impl(
@@ -90,7 +154,13 @@ BiometricEvaluation::IO::RecordStore::Impl::Impl(
     IO::Mode mode) :
     _pathname(pathname),
     _cursor(RecordStore::BE_RECSTORE_SEQ_START),
-    _mode(mode)
+    _mode(mode),
+    _count(0),
+    _journalfd(-1),
+    _generation(0),
+    _journalCount(0),
+    _journalRecords(0),
+    _controlDirty(false)
 {
 	if (!IO::Utility::fileExists(pathname))
 		throw Error::ObjectDoesNotExist("Could not find " + pathname);
@@ -107,9 +177,21 @@ BiometricEvaluation::IO::RecordStore::Impl::Impl(
 }
 
 /*
- * Destructor for the abstract class; required empty implementaton.
+ * Destructor for the abstract class.  Subclass destructors have closed
+ * their data by now, so the final count can be checkpointed.  A store
+ * that was not changed is left as it was found.
  */
-BiometricEvaluation::IO::RecordStore::Impl::~Impl() { }
+BiometricEvaluation::IO::RecordStore::Impl::~Impl()
+{
+	if ((_mode == Mode::ReadWrite) && _props && _controlDirty) {
+		try {
+			this->checkpointControl();
+		} catch (Error::Exception &e) {
+			/* The journal still holds the last synced count */
+		}
+	}
+	this->closeControlJournal();
+}
 
 /******************************************************************************/
 /* Common public methods implementations.                                     */
@@ -128,14 +210,26 @@ BiometricEvaluation::IO::RecordStore::Impl::insert(
     const void *const data,
     const uint64_t size)
 {
-	_props->setPropertyFromInteger(COUNTPROPERTY, this->getCount() + 1);
+	_count++;
+	_controlDirty = true;
 }
 
 void
 BiometricEvaluation::IO::RecordStore::Impl::remove(
     const std::string &key)
 {
-	_props->setPropertyFromInteger(COUNTPROPERTY, this->getCount() - 1);
+	_count--;
+	_controlDirty = true;
+}
+
+void
+BiometricEvaluation::IO::RecordStore::Impl::setCount(
+    uint64_t count)
+{
+	if (count != _count) {
+		_count = count;
+		_controlDirty = true;
+	}
 }
 
 int
@@ -157,7 +251,10 @@ BiometricEvaluation::IO::RecordStore::Impl::getSpaceUsed() const
 
 	if (stat(_controlFile.c_str(), &sb) != 0)
 		throw Error::StrategyError("Could not find control file");
-	return (sb.st_blocks * S_BLKSIZE);
+	uint64_t total = sb.st_blocks * S_BLKSIZE;
+	if (stat(canonicalName(CONTROLJOURNALFILENAME).c_str(), &sb) == 0)
+		total += sb.st_blocks * S_BLKSIZE;
+	return (total);
 }
 
 void
@@ -166,17 +263,18 @@ BiometricEvaluation::IO::RecordStore::Impl::sync() const
 	if (_mode == Mode::ReadOnly)
 		return;
 
-	try {
-		_props->sync();
-	} catch (Error::Exception& e) {
-		throw Error::StrategyError(e.whatString());
-	}
+	if (_count == _journalCount)
+		return;
+	if (_journalRecords >= CONTROLJOURNAL_CHECKPOINT_RECORDS)
+		this->checkpointControl();
+	else
+		this->appendControlJournal();
 }
 
 unsigned int
 BiometricEvaluation::IO::RecordStore::Impl::getCount() const
 {
-	return (_props->getPropertyAsInteger(COUNTPROPERTY));
+	return (_count);
 }
 
 std::string
@@ -201,7 +299,9 @@ BiometricEvaluation::IO::RecordStore::Impl::move(const std::string &pathname)
 		throw Error::ObjectExists(pathname);
 
 	/* Sync the old data first */
-	_props->sync();
+	if (_controlDirty)
+		this->checkpointControl();
+	this->closeControlJournal();
 	_props.reset();
 
 	/* Rename the directory */
@@ -212,6 +312,7 @@ BiometricEvaluation::IO::RecordStore::Impl::move(const std::string &pathname)
 	_controlFile = canonicalName(CONTROLFILENAME);
 	
 	this->openControlFile();
+	this->openControlJournal();
 }
 
 void
@@ -222,13 +323,12 @@ BiometricEvaluation::IO::RecordStore::Impl::changeDescription(
 		throw Error::StrategyError(RSREADONLYERROR);
 
 	_props->setProperty(DESCRIPTIONPROPERTY, description);
-	_props->sync();
+	this->checkpointControl();
 }
 
-std::shared_ptr<BiometricEvaluation::IO::RecordStore>
-BiometricEvaluation::IO::RecordStore::Impl::openRecordStore(
-    const std::string &pathname,
-    IO::Mode mode)
+std::string
+BiometricEvaluation::IO::RecordStore::Impl::readTypeProperty(
+    const std::string &pathname)
 {
 	if (!IO::Utility::fileExists(pathname))
 		throw Error::ObjectDoesNotExist("Could not find " + pathname);
@@ -248,12 +348,19 @@ BiometricEvaluation::IO::RecordStore::Impl::openRecordStore(
 	}
 	std::unique_ptr<PropertiesFile> aprops(props);
 
-	std::string type;
 	try {
-		type = aprops->getProperty(TYPEPROPERTY);
+		return (aprops->getProperty(TYPEPROPERTY));
 	} catch (Error::ObjectDoesNotExist& e) {
 		throw Error::StrategyError("Type property is missing");
 	}
+}
+
+std::shared_ptr<BiometricEvaluation::IO::RecordStore>
+BiometricEvaluation::IO::RecordStore::Impl::openRecordStore(
+    const std::string &pathname,
+    IO::Mode mode)
+{
+	const std::string type = readTypeProperty(pathname);
 
 	RecordStore *rs;
 	/* Exceptions thrown by constructors are allowed to float out */
@@ -267,6 +374,10 @@ BiometricEvaluation::IO::RecordStore::Impl::openRecordStore(
 		rs = new ArchiveRecordStore(pathname, mode);
 	else if (type == to_string(RecordStore::Kind::Compressed))
 		rs = new CompressedRecordStore(pathname, mode);
+	else if (type == to_string(RecordStore::Kind::ShardedArchive))
+		rs = new ShardedArchiveRecordStore(pathname, mode);
+	else if (type == to_string(RecordStore::Kind::LogStructured))
+		rs = new LogStructuredRecordStore(pathname, mode);
 	else if (type == to_string(RecordStore::Kind::List)) {
 		if (mode == IO::Mode::ReadWrite)
 			throw Error::StrategyError("ListRecordStores cannot "
@@ -303,6 +414,12 @@ BiometricEvaluation::IO::RecordStore::Impl::createRecordStore(
 		rs = new CompressedRecordStore(pathname, description,
 		    RecordStore::Kind::Default, IO::Compressor::Kind::GZIP);
 		break;
+	case BE::IO::RecordStore::Kind::ShardedArchive:
+		rs = new ShardedArchiveRecordStore(pathname, description);
+		break;
+	case BE::IO::RecordStore::Kind::LogStructured:
+		rs = new LogStructuredRecordStore(pathname, description);
+		break;
 	case BE::IO::RecordStore::Kind::List:
 		throw Error::StrategyError("ListRecordStores cannot be "
 		    "created with this function");
@@ -315,14 +432,29 @@ BiometricEvaluation::IO::RecordStore::Impl::removeRecordStore(
     const std::string &pathname)
 {
 	/* Confirm that pathname is a RecordStore */
+	std::shared_ptr<RecordStore> rs;
 	try {   
-		openRecordStore(pathname);
+		rs = openRecordStore(pathname);
 	} catch (Error::Exception &e) {
 		throw;
 	}
 
+	/* Shards placed outside of the store must be removed separately */
+	std::vector<std::string> externalShards;
+	auto shardedRS = std::dynamic_pointer_cast<ShardedArchiveRecordStore>(
+	    rs);
+	if (shardedRS) {
+		for (const auto &shard : shardedRS->getShardPathnames())
+			if (shard.find(pathname + '/') != 0)
+				externalShards.push_back(shard);
+	}
+	shardedRS.reset();
+	rs.reset();
+
 	try {
 		IO::Utility::removeDirectory(pathname);
+		for (const auto &shard : externalShards)
+			IO::Utility::removeDirectory(shard);
 	} catch (Error::ObjectDoesNotExist &e) {
 		throw;
 	} catch (Error::StrategyError &e) {
@@ -330,6 +462,305 @@ BiometricEvaluation::IO::RecordStore::Impl::removeRecordStore(
 	}
 }
 
+namespace
+{
+	/** Most records read from a source at once while merging */
+	const std::size_t MERGE_BATCH_RECORDS = 1024;
+
+	/** Most bytes read from a source at once while merging */
+	const uint64_t MERGE_BATCH_BYTES = 16 * 1024 * 1024;
+
+	/** Most bytes read ahead of the writer while merging */
+	const uint64_t MERGE_BUDGET_BYTES = 256 * 1024 * 1024;
+
+	/** Consecutive records read from one source store */
+	struct MergeBatch
+	{
+		/** Records, transformed once they reach the writer */
+		std::vector<BE::IO::RecordStore::Record> records;
+		/** Source keys of records, if they may be transformed */
+		std::vector<std::string> sourceKeys;
+		/** Total size of the data in records */
+		uint64_t bytes{0};
+		/** Whether this is the last batch from its source */
+		bool last{false};
+	};
+
+	/** Source index and batch number within the source */
+	using MergeBatchID = std::pair<std::size_t, uint64_t>;
+
+	/**
+	 * @brief
+	 * Reads, transforms, and writes records for mergeRecordStores().
+	 *
+	 * @details
+	 * Reader threads each claim the next unread source and read it in
+	 * batches.  If there is a transform, worker threads apply it to
+	 * whole batches.  The calling thread writes batches in source
+	 * order as they become ready.  Readers wait when too much data
+	 * is waiting to be written, except for the reader of the source
+	 * being written, so that the writer can always make progress.
+	 */
+	class MergePipeline
+	{
+	public:
+		MergePipeline(
+		    const std::vector<std::string> &pathnames,
+		    const BE::IO::RecordStore::MergeTransform &transform,
+		    const BE::IO::RecordStore::MergeCallback &callback) :
+		    _pathnames(pathnames),
+		    _transform(transform),
+		    _callback(callback)
+		{
+		}
+
+		/**
+		 * @brief
+		 * Merge all sources into mergedRS.
+		 *
+		 * @param[in] mergedRS
+		 *	Store to which records are added.
+		 * @param[in] numThreads
+		 *	Number of reader threads, and of worker threads
+		 *	if there is a transform.
+		 */
+		void
+		run(
+		    BE::IO::RecordStore &mergedRS,
+		    unsigned int numThreads)
+		{
+			const unsigned int numReaders = std::max(1U,
+			    static_cast<unsigned int>(std::min<std::size_t>(
+			    numThreads, _pathnames.size())));
+			_activeReaders = numReaders;
+
+			std::vector<std::thread> threads;
+			for (unsigned int i = 0; i < numReaders; i++)
+				threads.emplace_back(&MergePipeline::guard,
+				    this, &MergePipeline::read);
+			if (_transform)
+				for (unsigned int i = 0; i < numThreads; i++)
+					threads.emplace_back(
+					    &MergePipeline::guard, this,
+					    &MergePipeline::transform);
+
+			try {
+				this->write(mergedRS);
+			} catch (...) {
+				this->fail(std::current_exception());
+			}
+			for (auto &thread : threads)
+				thread.join();
+
+			if (_error)
+				std::rethrow_exception(_error);
+		}
+
+	private:
+		const std::vector<std::string> &_pathnames;
+		const BE::IO::RecordStore::MergeTransform &_transform;
+		const BE::IO::RecordStore::MergeCallback &_callback;
+
+		/** Protects all members below */
+		std::mutex _mutex;
+		/** Signaled whenever any member below changes */
+		std::condition_variable _changed;
+
+		/** Next source to be claimed by a reader */
+		std::size_t _nextSource{0};
+		/** Readers that have not yet finished */
+		unsigned int _activeReaders{0};
+		/** Source being written */
+		std::size_t _writerSource{0};
+		/** Bytes read but not yet written */
+		uint64_t _pendingBytes{0};
+		/** Batches waiting for the transform */
+		std::deque<std::pair<MergeBatchID, MergeBatch>> _untransformed;
+		/** Batches waiting for the writer */
+		std::map<MergeBatchID, MergeBatch> _ready;
+		/** First failure of any thread */
+		std::exception_ptr _error;
+
+		/** Stop the merge because of error */
+		void
+		fail(
+		    std::exception_ptr error)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (!_error)
+				_error = error;
+			_changed.notify_all();
+		}
+
+		/** Run a thread body, stopping the merge if it throws */
+		void
+		guard(
+		    void (MergePipeline::*body)())
+		{
+			try {
+				(this->*body)();
+			} catch (...) {
+				this->fail(std::current_exception());
+			}
+		}
+
+		/** Reader thread body */
+		void
+		read()
+		{
+			try {
+				for (;;) {
+					std::size_t source;
+					{
+						std::lock_guard<std::mutex>
+						    lock(_mutex);
+						if (_error || (_nextSource ==
+						    _pathnames.size()))
+							break;
+						source = _nextSource++;
+					}
+					this->readSource(source);
+				}
+			} catch (...) {
+				this->fail(std::current_exception());
+			}
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_activeReaders--;
+			_changed.notify_all();
+		}
+
+		/** Read every record of one source */
+		void
+		readSource(
+		    std::size_t source)
+		{
+			std::shared_ptr<BE::IO::RecordStore> rs;
+			try {
+				rs = BE::IO::RecordStore::openRecordStore(
+				    _pathnames[source], BE::IO::Mode::ReadOnly);
+			} catch (BE::Error::Exception &e) {
+				throw BE::Error::StrategyError(e.whatString());
+			}
+
+			bool exhausted = false;
+			for (uint64_t sequence = 0; !exhausted; sequence++) {
+				MergeBatch batch;
+				while ((batch.records.size() <
+				    MERGE_BATCH_RECORDS) &&
+				    (batch.bytes < MERGE_BATCH_BYTES)) {
+					try {
+						batch.records.push_back(
+						    rs->sequence());
+					} catch (BE::Error::ObjectDoesNotExist) {
+						exhausted = true;
+						break;
+					}
+					batch.bytes +=
+					    batch.records.back().data.size();
+				}
+				batch.last = exhausted;
+
+				std::unique_lock<std::mutex> lock(_mutex);
+				_changed.wait(lock, [&]() {
+					return (_error ||
+					    (source == _writerSource) ||
+					    (_pendingBytes < MERGE_BUDGET_BYTES));
+				});
+				if (_error)
+					return;
+				_pendingBytes += batch.bytes;
+				if (_transform)
+					_untransformed.emplace_back(MergeBatchID(
+					    source, sequence), std::move(batch));
+				else
+					_ready.emplace(MergeBatchID(source,
+					    sequence), std::move(batch));
+				_changed.notify_all();
+			}
+		}
+
+		/** Worker thread body */
+		void
+		transform()
+		{
+			for (;;) {
+				std::pair<MergeBatchID, MergeBatch> item;
+				{
+					std::unique_lock<std::mutex> lock(
+					    _mutex);
+					_changed.wait(lock, [&]() {
+						return (_error ||
+						    !_untransformed.empty() ||
+						    (_activeReaders == 0));
+					});
+					if (_error || _untransformed.empty())
+						return;
+					item = std::move(
+					    _untransformed.front());
+					_untransformed.pop_front();
+				}
+
+				MergeBatch &batch = item.second;
+				if (_callback)
+					for (const auto &record : batch.records)
+						batch.sourceKeys.push_back(
+						    record.key);
+				for (auto &record : batch.records)
+					_transform(record);
+
+				std::lock_guard<std::mutex> lock(_mutex);
+				_ready.emplace(item.first, std::move(batch));
+				_changed.notify_all();
+			}
+		}
+
+		/** Writer body, run on the calling thread */
+		void
+		write(
+		    BE::IO::RecordStore &mergedRS)
+		{
+			MergeBatchID next(0, 0);
+			while (next.first < _pathnames.size()) {
+				MergeBatch batch;
+				{
+					std::unique_lock<std::mutex> lock(
+					    _mutex);
+					_changed.wait(lock, [&]() {
+						return (_error ||
+						    (_ready.count(next) != 0));
+					});
+					if (_error)
+						return;
+					auto it = _ready.find(next);
+					batch = std::move(it->second);
+					_ready.erase(it);
+				}
+
+				for (std::size_t i = 0;
+				    i < batch.records.size(); i++) {
+					mergedRS.insert(batch.records[i].key,
+					    batch.records[i].data);
+					if (_callback)
+						_callback(batch.records[i].key,
+						    batch.sourceKeys.empty() ?
+						    batch.records[i].key :
+						    batch.sourceKeys[i]);
+				}
+
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pendingBytes -= batch.bytes;
+				if (batch.last) {
+					next = MergeBatchID(next.first + 1, 0);
+					_writerSource = next.first;
+				} else
+					next.second++;
+				_changed.notify_all();
+			}
+		}
+	};
+}
+
 void
 BiometricEvaluation::IO::RecordStore::Impl::mergeRecordStores(
     const std::string &mergePathname,
@@ -337,7 +768,20 @@ BiometricEvaluation::IO::RecordStore::Impl::mergeRecordStores(
     const RecordStore::Kind &kind,
     const std::vector<std::string> &pathnames)
 {
-	std::shared_ptr<RecordStore> merged_rs;
+	mergeRecordStores(mergePathname, description, kind, pathnames,
+	    nullptr, nullptr, 0);
+}
+
+void
+BiometricEvaluation::IO::RecordStore::Impl::mergeRecordStores(
+    const std::string &mergePathname,
+    const std::string &description,
+    const RecordStore::Kind &kind,
+    const std::vector<std::string> &pathnames,
+    const MergeTransform &transform,
+    const MergeCallback &callback,
+    unsigned int numThreads)
+{
 	switch (kind) {
 		case BiometricEvaluation::IO::RecordStore::Kind::BerkeleyDB:
 			/* FALLTHROUGH */
@@ -346,8 +790,10 @@ BiometricEvaluation::IO::RecordStore::Impl::mergeRecordStores(
 		case BiometricEvaluation::IO::RecordStore::Kind::File:
 			/* FALLTHROUGH */
 		case BiometricEvaluation::IO::RecordStore::Kind::SQLite:
-			merged_rs = RecordStore::createRecordStore(
-			   mergePathname, description, kind);
+			/* FALLTHROUGH */
+		case BiometricEvaluation::IO::RecordStore::Kind::ShardedArchive:
+			/* FALLTHROUGH */
+		case BiometricEvaluation::IO::RecordStore::Kind::LogStructured:
 			break;
 		case BiometricEvaluation::IO::RecordStore::Kind::List:
 			/* FALLTHROUGH */
@@ -355,26 +801,37 @@ BiometricEvaluation::IO::RecordStore::Impl::mergeRecordStores(
 			throw Error::StrategyError("Invalid RecordStore type");
 	}
 
-	bool exhausted;
-	std::shared_ptr<RecordStore> rs;
-	RecordStore::Record record;
-	for (uint32_t i = 0; i < pathnames.size(); i++) {
-		try {
-			rs = openRecordStore(pathnames[i], Mode::ReadOnly);
-		} catch (Error::Exception &e) {
-			throw Error::StrategyError(e.whatString());
-		}
-	
-		exhausted = false;
-		while (!exhausted) {
+	/*
+	 * Archives can be merged without reading individual records, but
+	 * then no record passes through transform or callback.
+	 */
+	if (!transform && !callback && (kind == RecordStore::Kind::Archive)) {
+		bool allArchives = true;
+		for (const auto &pathname : pathnames) {
 			try {
-				record = rs->sequence();
-				merged_rs->insert(record.key, record.data);
-			} catch (Error::ObjectDoesNotExist) {
-				exhausted = true;
+				if (readTypeProperty(pathname) != to_string(
+				    RecordStore::Kind::Archive)) {
+					allArchives = false;
+					break;
+				}
+			} catch (Error::Exception &e) {
+				throw Error::StrategyError(e.whatString());
 			}
 		}
+		if (allArchives) {
+			ArchiveRecordStore::mergeArchives(mergePathname,
+			    description, pathnames);
+			return;
+		}
 	}
+
+	std::shared_ptr<RecordStore> merged_rs = RecordStore::createRecordStore(
+	    mergePathname, description, kind);
+
+	if (numThreads == 0)
+		numThreads = std::max(1U, std::thread::hardware_concurrency());
+	MergePipeline(pathnames, transform, callback).run(*merged_rs,
+	    numThreads);
 }
 /******************************************************************************/
 /* Common protected method implementations.                                   */
@@ -418,6 +875,38 @@ BiometricEvaluation::IO::RecordStore::Impl::genKeySegName(
 	return (keyseg.str());
 }
 
+BiometricEvaluation::IO::RecordStore::Impl::ScopedRWLock::ScopedRWLock(
+    pthread_rwlock_t *lock,
+    bool exclusive,
+    bool enabled) :
+    _lock(enabled ? lock : nullptr)
+{
+	if (_lock == nullptr)
+		return;
+	const int rv = (exclusive ? pthread_rwlock_wrlock(_lock) :
+	    pthread_rwlock_rdlock(_lock));
+	if (rv != 0)
+		throw Error::StrategyError("Could not lock RecordStore");
+}
+
+BiometricEvaluation::IO::RecordStore::Impl::ScopedRWLock::~ScopedRWLock()
+{
+	if (_lock != nullptr)
+		pthread_rwlock_unlock(_lock);
+}
+
+uint64_t
+BiometricEvaluation::IO::RecordStore::Impl::hashKey(
+    const std::string &key)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char c : key) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ULL;
+	}
+	return (hash);
+}
+
 std::shared_ptr<BiometricEvaluation::IO::Properties>
 BiometricEvaluation::IO::RecordStore::Impl::getProperties() const
 {
@@ -467,13 +956,9 @@ BiometricEvaluation::IO::RecordStore::Impl::setProperties(
 			}
 		}
 	}
-	_props->sync();
+	this->checkpointControl();
 }
 
-/*
- * Private methods.
- */
-
 bool
 BiometricEvaluation::IO::RecordStore::Impl::isKeyCoreProperty(
     const std::string &key) const
@@ -481,9 +966,39 @@ BiometricEvaluation::IO::RecordStore::Impl::isKeyCoreProperty(
 	return (
 	    (key == DESCRIPTIONPROPERTY) ||
 	    (key == COUNTPROPERTY) ||
-	    (key == TYPEPROPERTY));
+	    (key == TYPEPROPERTY) ||
+	    (key == GENERATIONPROPERTY));
+}
+
+void
+BiometricEvaluation::IO::RecordStore::Impl::setCoreProperty(
+    const std::string &key,
+    const std::string &value)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!isKeyCoreProperty(key))
+		throw Error::StrategyError(key + " is not a core property");
+
+	_props->setProperty(key, value);
+	this->checkpointControl();
+}
+
+std::string
+BiometricEvaluation::IO::RecordStore::Impl::getCoreProperty(
+    const std::string &key)
+    const
+{
+	if (!isKeyCoreProperty(key))
+		throw Error::StrategyError(key + " is not a core property");
+
+	return (_props->getProperty(key));
 }
 
+/*
+ * Private methods.
+ */
+
 void
 BiometricEvaluation::IO::RecordStore::Impl::validateControlFile()
 {
@@ -509,10 +1024,13 @@ BiometricEvaluation::IO::RecordStore::Impl::validateControlFile()
                 throw Error::StrategyError("Type property is missing");
         }
 	try {
-		_props->getPropertyAsInteger(COUNTPROPERTY);
+		_count = _props->getPropertyAsInteger(COUNTPROPERTY);
         } catch (Error::ObjectDoesNotExist& e) {
                 throw Error::StrategyError("Count property is missing");
         }
+
+	/* Counts synced since the control file was written */
+	this->openControlJournal();
 }
 
 void
@@ -526,3 +1044,126 @@ BiometricEvaluation::IO::RecordStore::Impl::openControlFile()
 	}
 }
 
+void
+BiometricEvaluation::IO::RecordStore::Impl::openControlJournal()
+{
+	this->closeControlJournal();
+
+	_generation = 0;
+	try {
+		_generation = _props->getPropertyAsInteger(GENERATIONPROPERTY);
+	} catch (Error::ObjectDoesNotExist &e) {
+		/* Written before the control journal existed */
+	}
+
+	const std::string journal = canonicalName(CONTROLJOURNALFILENAME);
+	if (_mode == Mode::ReadOnly)
+		_journalfd = open(journal.c_str(), O_RDONLY);
+	else
+		_journalfd = open(journal.c_str(), O_RDWR | O_CREAT,
+		    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (_journalfd == -1) {
+		if ((_mode == Mode::ReadOnly) && (errno == ENOENT))
+			return;
+		throw Error::StrategyError("Could not open control journal "
+		    "(" + Error::errorStr() + ")");
+	}
+
+	struct stat sb;
+	if (fstat(_journalfd, &sb) != 0)
+		throw Error::StrategyError("Could not stat control journal "
+		    "(" + Error::errorStr() + ")");
+
+	/*
+	 * Records are only ever appended, so the newest intact record is
+	 * the last one that passes its checksum.
+	 */
+	uint8_t record[JOURNAL_RECORD_SIZE];
+	uint64_t records = sb.st_size / JOURNAL_RECORD_SIZE;
+	for (; records > 0; records--) {
+		if (pread(_journalfd, record, JOURNAL_RECORD_SIZE,
+		    (records - 1) * JOURNAL_RECORD_SIZE) !=
+		    static_cast<ssize_t>(JOURNAL_RECORD_SIZE))
+			throw Error::StrategyError("Could not read control "
+			    "journal (" + Error::errorStr() + ")");
+		if ((getJournalField(record, 4) == JOURNAL_MAGIC) &&
+		    (getJournalField(record + 4, 4) == journalCRC(record)))
+			break;
+	}
+
+	/* Records of an older generation precede the control file */
+	if ((records > 0) && (getJournalField(record + 8, 8) == _generation))
+		_count = getJournalField(record + 16, 8);
+	else
+		records = 0;
+
+	if ((_mode == Mode::ReadWrite) &&
+	    (static_cast<uint64_t>(sb.st_size) !=
+	    records * JOURNAL_RECORD_SIZE)) {
+		if (ftruncate(_journalfd, records * JOURNAL_RECORD_SIZE) != 0)
+			throw Error::StrategyError("Could not truncate "
+			    "control journal (" + Error::errorStr() + ")");
+	}
+	_journalRecords = records;
+	_journalCount = _count;
+}
+
+void
+BiometricEvaluation::IO::RecordStore::Impl::closeControlJournal()
+{
+	if (_journalfd != -1) {
+		close(_journalfd);
+		_journalfd = -1;
+	}
+}
+
+void
+BiometricEvaluation::IO::RecordStore::Impl::appendControlJournal()
+    const
+{
+	uint8_t record[JOURNAL_RECORD_SIZE];
+	putJournalField(record, JOURNAL_MAGIC, 4);
+	putJournalField(record + 8, _generation, 8);
+	putJournalField(record + 16, _count, 8);
+	putJournalField(record + 4, journalCRC(record), 4);
+
+	if (pwrite(_journalfd, record, JOURNAL_RECORD_SIZE,
+	    _journalRecords * JOURNAL_RECORD_SIZE) !=
+	    static_cast<ssize_t>(JOURNAL_RECORD_SIZE))
+		throw Error::StrategyError("Could not write control journal "
+		    "(" + Error::errorStr() + ")");
+	if (fdatasync(_journalfd) != 0)
+		throw Error::StrategyError("Could not sync control journal "
+		    "(" + Error::errorStr() + ")");
+	_journalRecords++;
+	_journalCount = _count;
+}
+
+void
+BiometricEvaluation::IO::RecordStore::Impl::checkpointControl()
+    const
+{
+	/*
+	 * The new generation makes any journal records left by a crash
+	 * before the journal is emptied obsolete.
+	 */
+	try {
+		_props->setPropertyFromInteger(COUNTPROPERTY, _count);
+		_props->setPropertyFromInteger(GENERATIONPROPERTY,
+		    _generation + 1);
+		_props->sync();
+	} catch (Error::Exception &e) {
+		throw Error::StrategyError(e.whatString());
+	}
+	_generation++;
+
+	if ((_journalfd != -1) && (_journalRecords != 0)) {
+		if (ftruncate(_journalfd, 0) != 0)
+			throw Error::StrategyError("Could not truncate "
+			    "control journal (" + Error::errorStr() + ")");
+	}
+	_journalRecords = 0;
+	_journalCount = _count;
+	_controlDirty = false;
+}
+
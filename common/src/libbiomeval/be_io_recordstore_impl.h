@@ -10,6 +10,8 @@
 #ifndef __BE_IO_RECORDSTORE_IMPL_H__
 #define __BE_IO_RECORDSTORE_IMPL_H__
 
+#include <pthread.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,6 +30,10 @@ namespace BiometricEvaluation {
 		public:
 			/** The name of the control file, a properties list */
                         static const std::string CONTROLFILENAME;
+			/** The name of the journal of Count changes */
+			static const std::string CONTROLJOURNALFILENAME;
+			/** Journal records appended before a checkpoint */
+			static const uint64_t CONTROLJOURNAL_CHECKPOINT_RECORDS;
 
 			~Impl();
 			
@@ -101,6 +107,13 @@ namespace BiometricEvaluation {
 			 * Synchronize the entire record store to persistent
 			 * storage.
 			 *
+			 * @details
+			 * A changed record count is appended to the control
+			 * journal rather than rewriting the control file,
+			 * which is only rewritten (checkpointed) once the
+			 * journal holds CONTROLJOURNAL_CHECKPOINT_RECORDS
+			 * records, and when the store is closed.
+			 *
 			 * @throw Error::StrategyError
 			 *	An error occurred when using the underlying
 			 *	storage system.
@@ -145,6 +158,24 @@ namespace BiometricEvaluation {
 			void remove(
 			    const std::string &key);
 
+			/**
+			 * @brief
+			 * Obtain the type of an existing RecordStore from
+			 * its control file.
+			 *
+			 * @param[in] pathname
+			 *	The path name of the store.
+			 * @return
+			 *	The store's Type property.
+			 * @throw Error::ObjectDoesNotExist
+			 *	The RecordStore does not exist.
+			 * @throw Error::StrategyError
+			 *	pathname is not a RecordStore, or its
+			 *	control file could not be read.
+			 */
+			static std::string readTypeProperty(
+			    const std::string &pathname);
+
 			/**
 			 * @brief
 			 * Open an existing RecordStore and return a managed
@@ -248,6 +279,44 @@ namespace BiometricEvaluation {
 			    const IO::RecordStore::Kind &kind,
 			    const std::vector<std::string> &pathnames);
 
+			/**
+			 * @brief
+			 * Create a new RecordStore that contains the
+			 * transformed contents of several other RecordStores.
+			 *
+			 * @param[in] mergePathname
+			 *	The path name of the new RecordStore.
+			 * @param[in] description
+			 *	The text used to describe the new RecordStore.
+			 * @param[in] kind
+			 *	The kind of the new, merged RecordStore.
+			 * @param[in] pathnames
+			 *	Path names of the RecordStores to merge.
+			 * @param[in] transform
+			 *	Function to apply to each record, or nullptr.
+			 * @param[in] callback
+			 *	Function to call after each record is
+			 *	added, or nullptr.
+			 * @param[in] numThreads
+			 *	Maximum number of threads used to read and
+			 *	transform records, or 0 for one per core.
+			 *
+			 * @throw Error::ObjectExists
+			 *	A RecordStore at mergePathname already exists,
+			 *	or a key appears in more than one source.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 */
+			static void mergeRecordStores(
+			    const std::string &mergePathname,
+			    const std::string &description,
+			    const IO::RecordStore::Kind &kind,
+			    const std::vector<std::string> &pathnames,
+			    const MergeTransform &transform,
+			    const MergeCallback &callback,
+			    unsigned int numThreads);
+
 			/**
 			 * Constructor to create a new RecordStore.
 			 *
@@ -297,8 +366,56 @@ namespace BiometricEvaluation {
 			/** Message for ReadOnly RecordStore modification */
 			static const std::string RSREADONLYERROR;
 
+			/**
+			 * @brief
+			 * Holds a pthread read/write lock for the life of
+			 * the object.
+			 */
+			class ScopedRWLock
+			{
+			public:
+				/**
+				 * @param[in] lock
+				 *	Lock to acquire.
+				 * @param[in] exclusive
+				 *	true to acquire for writing, false for
+				 *	reading.
+				 * @param[in] enabled
+				 *	Whether to acquire lock at all.
+				 *
+				 * @throw Error::StrategyError
+				 *	Could not acquire lock.
+				 */
+				ScopedRWLock(
+				    pthread_rwlock_t *lock,
+				    bool exclusive,
+				    bool enabled = true);
+
+				~ScopedRWLock();
+
+				ScopedRWLock(const ScopedRWLock&) = delete;
+				ScopedRWLock& operator=(
+				    const ScopedRWLock&) = delete;
+
+			private:
+				/** Lock held, or nullptr if not enabled */
+				pthread_rwlock_t *_lock;
+			};
+
 			IO::Mode getMode() const;
 
+			/**
+			 * @brief
+			 * Set the Count property, for stores that track
+			 * their records by other means.
+			 *
+			 * @param[in] count
+			 *	Number of records in the store.
+			 */
+			void
+			setCount(
+			    uint64_t count);
+
 			/*
 			 * Return the full path of a file stored as part
 			 * of the RecordStore, typically _pathname + name.
@@ -327,6 +444,24 @@ namespace BiometricEvaluation {
 			genKeySegName(
 			    const std::string &key,
 			    const uint64_t segnum);
+
+			/**
+			 * @brief
+			 * Hash a key.
+			 * @details
+			 * 64-bit FNV-1a, whose values are the same on every
+			 * platform and release, so they may decide where
+			 * records are stored.
+			 *
+			 * @param key
+			 *	Key to hash.
+			 *
+			 * @return
+			 *	Hash of key.
+			 */
+			static uint64_t
+			hashKey(
+			    const std::string &key);
 			
 			/**
 			 * @brief
@@ -359,6 +494,68 @@ namespace BiometricEvaluation {
 			std::shared_ptr<IO::Properties>
 			getProperties()
 			    const;
+
+			/**
+			 * @brief
+			 * Detemine if a property key is a core RecordStore
+			 * property.
+			 * @details
+			 * Implementations may add properties of their own
+			 * that must not be changed by setProperties().
+			 * 
+			 * @param[in] key
+			 *	Key to check.
+			 *
+			 * @return
+			 *	true if key is a core RecordStore property,
+			 *	false otherwise.
+			 */
+			virtual bool
+			isKeyCoreProperty(
+			    const std::string &key)
+			    const;
+
+			/**
+			 * @brief
+			 * Set a core property in the RecordStore control
+			 * file.
+			 *
+			 * @param[in] key
+			 *	Key of the property, for which
+			 *	isKeyCoreProperty() is true.
+			 * @param[in] value
+			 *	Value of the property.
+			 *
+			 * @throw Error::StrategyError
+			 *	RecordStore was opened ReadOnly, key is not
+			 *	a core property, or error with underlying
+			 *	file system.
+			 */
+			void
+			setCoreProperty(
+			    const std::string &key,
+			    const std::string &value);
+
+			/**
+			 * @brief
+			 * Obtain the value of a core property.
+			 *
+			 * @param[in] key
+			 *	Key of the property, for which
+			 *	isKeyCoreProperty() is true.
+			 *
+			 * @return
+			 *	Value of the property.
+			 *
+			 * @throw Error::ObjectDoesNotExist
+			 *	The property is not set.
+			 * @throw Error::StrategyError
+			 *	key is not a core property.
+			 */
+			std::string
+			getCoreProperty(
+			    const std::string &key)
+			    const;
 			
 		private:
 			/** Properties of the RecordStore */
@@ -383,6 +580,71 @@ namespace BiometricEvaluation {
 			 * Mode in which the RecordStore was opened.
 			 */
 			BiometricEvaluation::IO::Mode _mode;
+
+			/** Number of records, the Count property */
+			uint64_t _count;
+
+			/** Descriptor of the control journal, or -1 */
+			mutable int _journalfd;
+
+			/** Checkpoint generation of the control file */
+			mutable uint64_t _generation;
+
+			/** Count as of the last durable journal record */
+			mutable uint64_t _journalCount;
+
+			/** Records in the control journal */
+			mutable uint64_t _journalRecords;
+
+			/** Whether the control file predates a mutation */
+			mutable bool _controlDirty;
+
+			/**
+			 * @brief
+			 * Open the control journal and apply its newest
+			 * record for the control file's generation.
+			 *
+			 * @details
+			 * Only the tail of the journal is read.  A record
+			 * torn by a crash fails its checksum and is
+			 * ignored, and is truncated when read/write.
+			 *
+			 * @throw Error::StrategyError
+			 *	Error with underlying file system.
+			 */
+			void
+			openControlJournal();
+
+			/**
+			 * @brief
+			 * Close the control journal.
+			 */
+			void
+			closeControlJournal();
+
+			/**
+			 * @brief
+			 * Durably append the current Count to the control
+			 * journal.
+			 *
+			 * @throw Error::StrategyError
+			 *	Error with underlying file system.
+			 */
+			void
+			appendControlJournal()
+			    const;
+
+			/**
+			 * @brief
+			 * Write the control file under a new generation and
+			 * empty the control journal.
+			 *
+			 * @throw Error::StrategyError
+			 *	Error with underlying file system.
+			 */
+			void
+			checkpointControl()
+			    const;
 			
 			/**
 			 * @brief
@@ -406,23 +668,6 @@ namespace BiometricEvaluation {
 			void
 			openControlFile();
 
-			/**
-			 * @brief
-			 * Detemine if a property key is a core RecordStore
-			 * property.
-			 * 
-			 * @param[in] key
-			 *	Key to check.
-			 *
-			 * @return
-			 *	true if key is a core RecordStore property,
-			 *	false otherwise.
-			 */
-			bool
-			isKeyCoreProperty(
-			    const std::string &key)
-			    const;
-
 		};
 	}
 }
@@ -0,0 +1,201 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include "be_io_shardedarchiverecstore_impl.h"
+
+const unsigned int BiometricEvaluation::IO::ShardedArchiveRecordStore::
+    DEFAULT_SHARD_COUNT{8};
+
+BiometricEvaluation::IO::ShardedArchiveRecordStore::ShardedArchiveRecordStore(
+    const std::string &pathname,
+    const std::string &description,
+    const unsigned int shardCount,
+    const std::vector<std::string> &shardDirectories)
+{
+	/*
+	 * Exceptions float out.
+	 */
+	this->pimpl.reset(new IO::ShardedArchiveRecordStore::Impl(
+	    pathname, description, shardCount, shardDirectories));
+}
+
+BiometricEvaluation::IO::ShardedArchiveRecordStore::ShardedArchiveRecordStore(
+    const std::string &pathname,
+    IO::Mode mode)
+{
+	this->pimpl.reset(new IO::ShardedArchiveRecordStore::Impl(
+	    pathname, mode));
+}
+
+BiometricEvaluation::IO::ShardedArchiveRecordStore::~ShardedArchiveRecordStore()
+{
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::move(
+    const std::string &pathname)
+{
+	this->pimpl->move(pathname);
+}
+
+uint64_t
+BiometricEvaluation::IO::ShardedArchiveRecordStore::getSpaceUsed()
+    const
+{
+	return (this->pimpl->getSpaceUsed());
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::sync()
+    const
+{
+	this->pimpl->sync();
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::insert(
+    const std::string &key,
+    const void *const data,
+    const uint64_t size)
+{
+	this->pimpl->insert(key, data, size);
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::remove(
+    const std::string &key)
+{
+	this->pimpl->remove(key);
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ShardedArchiveRecordStore::read(
+    const std::string &key)
+    const
+{
+	return (this->pimpl->read(key));
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ShardedArchiveRecordStore::readPrefix(
+    const std::string &key,
+    uint64_t size)
+    const
+{
+	return (this->pimpl->readPrefix(key, size));
+}
+
+uint64_t
+BiometricEvaluation::IO::ShardedArchiveRecordStore::length(
+    const std::string &key)
+    const
+{
+	return (this->pimpl->length(key));
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::flush(
+    const std::string &key)
+    const
+{
+	this->pimpl->flush(key);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::ShardedArchiveRecordStore::sequence(
+    int cursor)
+{
+	return (this->pimpl->sequence(cursor));
+}
+
+std::string
+BiometricEvaluation::IO::ShardedArchiveRecordStore::sequenceKey(
+    int cursor)
+{
+	return (this->pimpl->sequenceKey(cursor));
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::setCursorAtKey(
+    const std::string &key)
+{
+	this->pimpl->setCursorAtKey(key);
+}
+
+unsigned int
+BiometricEvaluation::IO::ShardedArchiveRecordStore::getCount()
+    const
+{
+	return (this->pimpl->getCount());
+}
+
+std::string
+BiometricEvaluation::IO::ShardedArchiveRecordStore::getPathname()
+    const
+{
+	return (this->pimpl->getPathname());
+}
+
+std::string
+BiometricEvaluation::IO::ShardedArchiveRecordStore::getDescription()
+    const
+{
+	return (this->pimpl->getDescription());
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::changeDescription(
+    const std::string &description)
+{
+	this->pimpl->changeDescription(description);
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::adviseSequentialRead(
+    unsigned int records)
+{
+	this->pimpl->adviseSequentialRead(records);
+}
+
+unsigned int
+BiometricEvaluation::IO::ShardedArchiveRecordStore::getShardCount()
+    const
+{
+	return (this->pimpl->getShardCount());
+}
+
+unsigned int
+BiometricEvaluation::IO::ShardedArchiveRecordStore::getShardForKey(
+    const std::string &key)
+    const
+{
+	return (this->pimpl->getShardForKey(key));
+}
+
+std::vector<std::string>
+BiometricEvaluation::IO::ShardedArchiveRecordStore::getShardPathnames()
+    const
+{
+	return (this->pimpl->getShardPathnames());
+}
+
+bool
+BiometricEvaluation::IO::ShardedArchiveRecordStore::needsVacuum()
+{
+	return (this->pimpl->needsVacuum());
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::vacuum(
+    const std::string &pathname)
+{
+	BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::vacuum(
+	    pathname);
+}
@@ -0,0 +1,439 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <climits>
+#include <cstdlib>
+
+#include "be_io_shardedarchiverecstore_impl.h"
+#include <be_error.h>
+#include <be_io_properties.h>
+#include <be_io_utility.h>
+#include <be_text.h>
+
+namespace BE = BiometricEvaluation;
+
+static const std::string SHARD_COUNT_PROPERTY{"Shard Count"};
+static const std::string SHARD_LOCATION_PROPERTY{"Shard Location "};
+static const std::string SHARD_NAME_PREFIX{"shard"};
+
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::Impl(
+    const std::string &pathname,
+    const std::string &description,
+    const unsigned int shardCount,
+    const std::vector<std::string> &shardDirectories) :
+    RecordStore::Impl(pathname, description,
+    RecordStore::Kind::ShardedArchive),
+    _seqShard(0),
+    _seqShardFromStart(false)
+{
+	if (shardCount == 0)
+		throw Error::ParameterError("Shard count must be positive");
+
+	/* Store external shard locations as absolute paths */
+	std::vector<std::string> directories;
+	for (const auto &dir : shardDirectories) {
+		char resolved[PATH_MAX];
+		if ((realpath(dir.c_str(), resolved) == nullptr) ||
+		    !IO::Utility::pathIsDirectory(resolved))
+			throw Error::ParameterError("Invalid shard directory: " +
+			    dir);
+		directories.push_back(resolved);
+	}
+
+	std::shared_ptr<IO::Properties> props = this->getProperties();
+	props->setPropertyFromInteger(SHARD_COUNT_PROPERTY, shardCount);
+	const std::string storeName = Text::basename(pathname);
+	for (unsigned int i = 0; i < shardCount; i++) {
+		std::string location;
+		if (directories.empty())
+			location = SHARD_NAME_PREFIX + std::to_string(i);
+		else
+			location = directories[i % directories.size()] + '/' +
+			    storeName + '.' + SHARD_NAME_PREFIX +
+			    std::to_string(i);
+
+		Shard shard;
+		shard.location = location;
+		shard.rs.reset(new ArchiveRecordStore(
+		    this->shardPathname(location), description));
+		shard.mutex.reset(new std::mutex());
+		_shards.push_back(std::move(shard));
+
+		props->setProperty(SHARD_LOCATION_PROPERTY + std::to_string(i),
+		    location);
+	}
+	this->setProperties(props);
+	RecordStore::Impl::sync();
+}
+
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::Impl(
+    const std::string &pathname,
+    IO::Mode mode) :
+    RecordStore::Impl(pathname, mode),
+    _seqShard(0),
+    _seqShardFromStart(false)
+{
+	this->openShards(mode);
+}
+
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::~Impl()
+{
+
+}
+
+std::string
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::shardPathname(
+    const std::string &location)
+    const
+{
+	if (!location.empty() && (location[0] == '/'))
+		return (location);
+	return (this->canonicalName(location));
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::openShards(
+    IO::Mode mode)
+{
+	std::shared_ptr<IO::Properties> props = this->getProperties();
+	unsigned int shardCount;
+	try {
+		shardCount = props->getPropertyAsInteger(SHARD_COUNT_PROPERTY);
+	} catch (Error::Exception &e) {
+		throw Error::StrategyError("Could not read " +
+		    SHARD_COUNT_PROPERTY + " (" + e.whatString() + ")");
+	}
+	if (shardCount == 0)
+		throw Error::StrategyError("Invalid " + SHARD_COUNT_PROPERTY);
+
+	_shards.clear();
+	for (unsigned int i = 0; i < shardCount; i++) {
+		Shard shard;
+		try {
+			shard.location = props->getProperty(
+			    SHARD_LOCATION_PROPERTY + std::to_string(i));
+		} catch (Error::ObjectDoesNotExist) {
+			throw Error::StrategyError("Missing location of "
+			    "shard " + std::to_string(i));
+		}
+		shard.rs.reset(new ArchiveRecordStore(
+		    this->shardPathname(shard.location), mode));
+		shard.mutex.reset(new std::mutex());
+		_shards.push_back(std::move(shard));
+	}
+}
+
+unsigned int
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::getShardCount()
+    const
+{
+	return (static_cast<unsigned int>(_shards.size()));
+}
+
+unsigned int
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::getShardForKey(
+    const std::string &key)
+    const
+{
+	return (static_cast<unsigned int>(hashKey(key) % _shards.size()));
+}
+
+std::vector<std::string>
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::getShardPathnames()
+    const
+{
+	std::vector<std::string> pathnames;
+	for (const auto &shard : _shards)
+		pathnames.push_back(this->shardPathname(shard.location));
+	return (pathnames);
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::insert(
+    const std::string &key,
+    const void *const data,
+    const uint64_t size)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	Shard &shard = _shards[this->getShardForKey(key)];
+	{
+		std::lock_guard<std::mutex> lock(*shard.mutex);
+		shard.rs->insert(key, data, size);
+	}
+
+	std::lock_guard<std::mutex> lock(_countMutex);
+	RecordStore::Impl::insert(key, data, size);
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::remove(
+    const std::string &key)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	Shard &shard = _shards[this->getShardForKey(key)];
+	{
+		std::lock_guard<std::mutex> lock(*shard.mutex);
+		shard.rs->remove(key);
+	}
+
+	std::lock_guard<std::mutex> lock(_countMutex);
+	RecordStore::Impl::remove(key);
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::read(
+    const std::string &key)
+    const
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	/* ArchiveRecordStores support concurrent readers when read-only */
+	const Shard &shard = _shards[this->getShardForKey(key)];
+	if (this->getMode() == Mode::ReadOnly)
+		return (shard.rs->read(key));
+	std::lock_guard<std::mutex> lock(*shard.mutex);
+	return (shard.rs->read(key));
+}
+
+BiometricEvaluation::Memory::uint8Array
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::readPrefix(
+    const std::string &key,
+    uint64_t size)
+    const
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	/* ArchiveRecordStores support concurrent readers when read-only */
+	const Shard &shard = _shards[this->getShardForKey(key)];
+	if (this->getMode() == Mode::ReadOnly)
+		return (shard.rs->readPrefix(key, size));
+	std::lock_guard<std::mutex> lock(*shard.mutex);
+	return (shard.rs->readPrefix(key, size));
+}
+
+uint64_t
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::length(
+    const std::string &key)
+    const
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	/* ArchiveRecordStores support concurrent readers when read-only */
+	const Shard &shard = _shards[this->getShardForKey(key)];
+	if (this->getMode() == Mode::ReadOnly)
+		return (shard.rs->length(key));
+	std::lock_guard<std::mutex> lock(*shard.mutex);
+	return (shard.rs->length(key));
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::flush(
+    const std::string &key)
+    const
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	const Shard &shard = _shards[this->getShardForKey(key)];
+	std::lock_guard<std::mutex> lock(*shard.mutex);
+	shard.rs->flush(key);
+}
+
+unsigned int
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::getCount()
+    const
+{
+	std::lock_guard<std::mutex> lock(_countMutex);
+	return (RecordStore::Impl::getCount());
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::sync()
+    const
+{
+	if (this->getMode() == Mode::ReadOnly)
+		return;
+
+	for (const auto &shard : _shards) {
+		std::lock_guard<std::mutex> lock(*shard.mutex);
+		shard.rs->sync();
+	}
+
+	std::lock_guard<std::mutex> lock(_countMutex);
+	RecordStore::Impl::sync();
+}
+
+uint64_t
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::getSpaceUsed()
+    const
+{
+	uint64_t spaceUsed = RecordStore::Impl::getSpaceUsed();
+	for (const auto &shard : _shards) {
+		std::lock_guard<std::mutex> lock(*shard.mutex);
+		spaceUsed += shard.rs->getSpaceUsed();
+	}
+	return (spaceUsed);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::i_sequence(
+    bool returnData,
+    int cursor)
+{
+	if ((cursor != BE_RECSTORE_SEQ_START) &&
+	    (cursor != BE_RECSTORE_SEQ_NEXT))
+	    	throw Error::StrategyError("Invalid cursor position as "
+		    "argument");
+
+	/*
+	 * Shards are sequenced in order, each from its first record,
+	 * moving to the next shard when one is exhausted.
+	 */
+	int shardCursor = BE_RECSTORE_SEQ_NEXT;
+	if ((getCursor() == BE_RECSTORE_SEQ_START) ||
+	    (cursor == BE_RECSTORE_SEQ_START)) {
+		_seqShard = 0;
+		shardCursor = BE_RECSTORE_SEQ_START;
+	} else if (_seqShardFromStart) {
+		shardCursor = BE_RECSTORE_SEQ_START;
+	}
+	_seqShardFromStart = false;
+
+	RecordStore::Record record;
+	while (true) {
+		Shard &shard = _shards[_seqShard];
+		try {
+			std::lock_guard<std::mutex> lock(*shard.mutex);
+			if (returnData)
+				record = shard.rs->sequence(shardCursor);
+			else
+				record.key = shard.rs->sequenceKey(shardCursor);
+			break;
+		} catch (Error::ObjectDoesNotExist) {
+			if ((_seqShard + 1) >= _shards.size()) {
+				setCursor(BE_RECSTORE_SEQ_NEXT);
+				throw Error::ObjectDoesNotExist("No record at "
+				    "position");
+			}
+			_seqShard++;
+			shardCursor = BE_RECSTORE_SEQ_START;
+		}
+	}
+
+	setCursor(BE_RECSTORE_SEQ_NEXT);
+	return (record);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::sequence(
+    int cursor)
+{
+	return (i_sequence(true, cursor));
+}
+
+std::string
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::sequenceKey(
+    int cursor)
+{
+	RecordStore::Record record = i_sequence(false, cursor);
+	return (record.key);
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::setCursorAtKey(
+    const std::string &key)
+{
+	if (!validateKeyString(key))
+		throw Error::StrategyError("Invalid key format");
+
+	const unsigned int shardNum = this->getShardForKey(key);
+	Shard &shard = _shards[shardNum];
+	std::lock_guard<std::mutex> lock(*shard.mutex);
+
+	/* Throws if key does not exist, leaving the cursor unchanged */
+	(void)shard.rs->length(key);
+
+	/*
+	 * Position the shard's cursor so that its next record is key.
+	 * The shard's first record is handled by restarting that shard.
+	 */
+	if (shard.rs->sequenceKey(BE_RECSTORE_SEQ_START) == key) {
+		_seqShardFromStart = true;
+	} else {
+		shard.rs->setCursorAtKey(key);
+		_seqShardFromStart = false;
+	}
+	_seqShard = shardNum;
+	setCursor(BE_RECSTORE_SEQ_NEXT);
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::adviseSequentialRead(
+    unsigned int records)
+{
+	for (Shard &shard : _shards) {
+		std::lock_guard<std::mutex> lock(*shard.mutex);
+		shard.rs->adviseSequentialRead(records);
+	}
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::move(
+    const std::string &pathname)
+{
+	if (this->getMode() == Mode::ReadOnly)
+		throw Error::StrategyError(RSREADONLYERROR);
+
+	/* Shards within the store move with it; reopen all of them */
+	this->sync();
+	_shards.clear();
+	RecordStore::Impl::move(pathname);
+	this->openShards(Mode::ReadWrite);
+	setCursor(BE_RECSTORE_SEQ_START);
+}
+
+bool
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::needsVacuum()
+{
+	for (auto &shard : _shards) {
+		std::lock_guard<std::mutex> lock(*shard.mutex);
+		if (shard.rs->needsVacuum())
+			return (true);
+	}
+	return (false);
+}
+
+void
+BiometricEvaluation::IO::ShardedArchiveRecordStore::Impl::vacuum(
+    const std::string &pathname)
+{
+	std::vector<std::string> shardPathnames;
+	{
+		ShardedArchiveRecordStore::Impl rs(pathname, Mode::ReadOnly);
+		shardPathnames = rs.getShardPathnames();
+	}
+
+	for (const auto &shardPathname : shardPathnames)
+		if (ArchiveRecordStore::needsVacuum(shardPathname))
+			ArchiveRecordStore::vacuum(shardPathname);
+}
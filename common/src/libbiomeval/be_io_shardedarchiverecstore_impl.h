@@ -0,0 +1,204 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef __BE_IO_SHARDEDARCHIVERECSTORE_IMPL_H__
+#define __BE_IO_SHARDEDARCHIVERECSTORE_IMPL_H__
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <be_io_archiverecstore.h>
+#include <be_io_shardedarchiverecstore.h>
+#include "be_io_recordstore_impl.h"
+
+namespace BiometricEvaluation
+{
+	namespace IO
+	{
+		/**
+		 * @brief
+		 * Implementation of ShardedArchiveRecordStore.
+		 */
+		class ShardedArchiveRecordStore::Impl : public RecordStore::Impl
+		{
+		public:
+			Impl(
+			    const std::string &pathname,
+			    const std::string &description,
+			    const unsigned int shardCount,
+			    const std::vector<std::string> &shardDirectories);
+
+			Impl(
+			    const std::string &pathname,
+			    IO::Mode mode = IO::Mode::ReadOnly);
+
+			~Impl();
+
+			uint64_t
+			getSpaceUsed() const;
+
+			void
+			sync() const;
+
+			unsigned int
+			getCount() const;
+
+			void
+			insert(
+			    const std::string &key,
+			    const void *const data,
+			    const uint64_t size);
+
+			void
+			remove(
+			    const std::string &key);
+
+			Memory::uint8Array
+			read(
+			    const std::string &key) const;
+
+			Memory::uint8Array
+			readPrefix(
+			    const std::string &key,
+			    uint64_t size) const;
+
+			uint64_t
+			length(
+			    const std::string &key) const;
+
+			void
+			flush(
+			    const std::string &key) const;
+
+			RecordStore::Record
+			sequence(
+			    int cursor = BE_RECSTORE_SEQ_NEXT);
+
+			std::string
+			sequenceKey(
+			    int cursor = BE_RECSTORE_SEQ_NEXT);
+
+			void
+			setCursorAtKey(
+			    const std::string &key);
+
+			void
+			move(
+			    const std::string &pathname);
+
+			void
+			adviseSequentialRead(
+			    unsigned int records);
+
+			unsigned int
+			getShardCount() const;
+
+			unsigned int
+			getShardForKey(
+			    const std::string &key)
+			    const;
+
+			std::vector<std::string>
+			getShardPathnames() const;
+
+			bool
+			needsVacuum();
+
+			static void
+			vacuum(
+			    const std::string &pathname);
+
+			Impl(
+			    const ShardedArchiveRecordStore&) = delete;
+			Impl&
+			operator=(
+			    const ShardedArchiveRecordStore&) = delete;
+
+		private:
+			/** One shard of the store */
+			struct Shard
+			{
+				/** Location, as recorded in the control file */
+				std::string location;
+				/** Open ArchiveRecordStore for the shard */
+				std::unique_ptr<IO::ArchiveRecordStore> rs;
+				/** Serializes access to rs */
+				std::unique_ptr<std::mutex> mutex;
+			};
+
+			/** Shards, indexed by getShardForKey() */
+			std::vector<Shard> _shards;
+
+			/** Serializes updates to the Count property */
+			mutable std::mutex _countMutex;
+
+			/** Shard currently being sequenced */
+			unsigned int _seqShard;
+
+			/**
+			 * Whether the next BE_RECSTORE_SEQ_NEXT should restart
+			 * sequencing _seqShard from its first record.
+			 */
+			bool _seqShardFromStart;
+
+			/**
+			 * @brief
+			 * Resolve a shard location to a path.
+			 *
+			 * @param[in] location
+			 *	Location as recorded in the control file;
+			 *	relative locations are within the store.
+			 *
+			 * @return
+			 *	Path to the shard.
+			 */
+			std::string
+			shardPathname(
+			    const std::string &location)
+			    const;
+
+			/**
+			 * @brief
+			 * Open every shard listed in the control file.
+			 *
+			 * @param[in] mode
+			 *	Mode in which to open the shards.
+			 */
+			void
+			openShards(
+			    IO::Mode mode);
+
+			/**
+			 * Internal implementation of sequencing through a
+			 * store, returning the key, and optionally, the
+			 * data.
+			 * @param[in] returnData
+			 * 	Whether to return the data with the key.
+			 * @param[in] cursor
+			 *	The location within the sequence of the
+			 *	key/data pair to return.
+			 * @return
+			 *	The record that is next in sequence.
+			 * @throw Error::ObjectDoesNotExist
+			 *	End of sequencing.
+			 * @throw Error::StrategyError
+			 *	An error occurred when using the underlying
+			 *	storage system.
+			 */
+			RecordStore::Record
+			i_sequence(
+			    bool returnData,
+			    int cursor);
+		};
+	}
+}
+
+#endif /* __BE_IO_SHARDEDARCHIVERECSTORE_IMPL_H__ */
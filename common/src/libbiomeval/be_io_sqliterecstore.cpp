@@ -146,3 +146,10 @@ BiometricEvaluation::IO::SQLiteRecordStore::changeDescription(
 	return (this->pimpl->changeDescription(description));
 }
 
+std::vector<std::shared_ptr<BiometricEvaluation::IO::RecordStore::Partition>>
+BiometricEvaluation::IO::SQLiteRecordStore::partition(
+    unsigned int count)
+{
+	return (this->pimpl->partition(count));
+}
+
@@ -643,6 +643,190 @@ BiometricEvaluation::IO::SQLiteRecordStore::Impl::setCursorAtKey(
 	_sequenceEnd = false;
 }
 
+std::vector<std::shared_ptr<BiometricEvaluation::IO::RecordStore::Partition>>
+BiometricEvaluation::IO::SQLiteRecordStore::Impl::partition(
+    unsigned int count)
+{
+	if (count == 0)
+		throw Error::ParameterError("Partition count must be positive");
+
+	sqlite3_stmt *statement;
+	std::string sqlCommand = "SELECT MIN(ROWID),MAX(ROWID) FROM " +
+	    PRIMARY_KV_TABLE;
+#ifdef	SQLITE_V2_SUPPORT
+	int32_t rv = sqlite3_prepare_v2(_db, sqlCommand.c_str(),
+	    sqlCommand.length(), &statement, nullptr);
+#else
+	int32_t rv = sqlite3_prepare(_db, sqlCommand.c_str(),
+	    sqlCommand.length(), &statement, nullptr);
+#endif
+	if ((rv != SQLITE_OK) || (statement == nullptr))
+		sqliteError(rv);
+
+	/* MIN() and MAX() are NULL when the table is empty */
+	int64_t minRow = 1, maxRow = 0;
+	rv = sqlite3_step(statement);
+	if ((rv == SQLITE_ROW) &&
+	    (sqlite3_column_type(statement, 0) != SQLITE_NULL)) {
+		minRow = sqlite3_column_int64(statement, 0);
+		maxRow = sqlite3_column_int64(statement, 1);
+	}
+	if ((rv != SQLITE_ROW) && (rv != SQLITE_DONE)) {
+		sqlite3_finalize(statement);
+		sqliteError(rv);
+	}
+	rv = sqlite3_finalize(statement);
+	if (rv != SQLITE_OK)
+		sqliteError(rv);
+
+	/* Split [minRow, maxRow] into count nearly equal ranges */
+	const uint64_t span = (maxRow >= minRow) ?
+	    static_cast<uint64_t>(maxRow - minRow) + 1 : 0;
+	std::vector<std::shared_ptr<RecordStore::Partition>> partitions;
+	partitions.reserve(count);
+	int64_t first = minRow;
+	for (unsigned int i = 0; i < count; i++) {
+		const uint64_t rows = (span / count) +
+		    ((i < (span % count)) ? 1 : 0);
+		partitions.emplace_back(new RowRangePartition(this, first,
+		    first + static_cast<int64_t>(rows) - 1));
+		first += rows;
+	}
+	return (partitions);
+}
+
+BiometricEvaluation::IO::SQLiteRecordStore::Impl::RowRangePartition::
+RowRangePartition(
+    const SQLiteRecordStore::Impl *store,
+    int64_t first,
+    int64_t last) :
+    _store(store),
+    _first(first),
+    _last(last),
+    _db(nullptr),
+    _sequencer(nullptr),
+    _sequenceEnd(false)
+{
+
+}
+
+BiometricEvaluation::IO::SQLiteRecordStore::Impl::RowRangePartition::
+~RowRangePartition()
+{
+	sqlite3_finalize(_sequencer);
+	sqlite3_close(_db);
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::SQLiteRecordStore::Impl::RowRangePartition::
+sequence(
+    int cursor)
+{
+	return (this->i_sequence(true, cursor));
+}
+
+std::string
+BiometricEvaluation::IO::SQLiteRecordStore::Impl::RowRangePartition::
+sequenceKey(
+    int cursor)
+{
+	return (this->i_sequence(false, cursor).key);
+}
+
+void
+BiometricEvaluation::IO::SQLiteRecordStore::Impl::RowRangePartition::
+sqliteError(
+    int32_t errorNumber)
+    const
+{
+	std::stringstream msg;
+	msg << "sqlite3: " << sqlite3_errmsg(_db) << " (" << errorNumber << ')';
+	throw Error::StrategyError(msg.str());
+}
+
+BiometricEvaluation::IO::RecordStore::Record
+BiometricEvaluation::IO::SQLiteRecordStore::Impl::RowRangePartition::
+i_sequence(
+    bool returnData,
+    int cursor)
+{
+	if ((cursor != BE_RECSTORE_SEQ_START) &&
+	    (cursor != BE_RECSTORE_SEQ_NEXT))
+		throw Error::StrategyError("Invalid cursor position as "
+		    "argument");
+	if (_first > _last)
+		throw Error::ObjectDoesNotExist("No record at position");
+
+	int32_t rv;
+	if (_db == nullptr) {
+		/* Opened by the thread sequencing this partition */
+#ifdef	SQLITE_V2_SUPPORT
+		rv = sqlite3_open_v2(_store->_dbname.c_str(), &_db,
+		    SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+#else
+		rv = sqlite3_open(_store->_dbname.c_str(), &_db);
+#endif
+		if ((rv != SQLITE_OK) || (_db == nullptr))
+			sqliteError(rv);
+	}
+
+	if ((cursor == BE_RECSTORE_SEQ_START) || (_sequencer == nullptr)) {
+		std::stringstream sqlCommand;
+		sqlCommand << "SELECT " << KEY_COL << "," << VALUE_COL <<
+		    " FROM " << PRIMARY_KV_TABLE << " WHERE ROWID BETWEEN " <<
+		    _first << " AND " << _last << " ORDER BY ROWID";
+
+		rv = sqlite3_finalize(_sequencer);
+		_sequencer = nullptr;
+		if (rv != SQLITE_OK)
+			sqliteError(rv);
+#ifdef	SQLITE_V2_SUPPORT
+		rv = sqlite3_prepare_v2(_db, sqlCommand.str().c_str(),
+		    sqlCommand.str().length(), &_sequencer, nullptr);
+#else
+		rv = sqlite3_prepare(_db, sqlCommand.str().c_str(),
+		    sqlCommand.str().length(), &_sequencer, nullptr);
+#endif
+		if ((rv != SQLITE_OK) || (_sequencer == nullptr))
+			sqliteError(rv);
+		_sequenceEnd = false;
+	}
+
+	if (_sequenceEnd)
+		throw Error::ObjectDoesNotExist("No record at position");
+
+	rv = sqlite3_step(_sequencer);
+	switch (rv) {
+	case SQLITE_ROW:
+		break;
+	case SQLITE_DONE:
+		_sequenceEnd = true;
+		throw Error::ObjectDoesNotExist("No record at position");
+	default:
+		sqliteError(rv);
+	}
+
+	RecordStore::Record record;
+	record.key.assign(
+	    (const char *)sqlite3_column_text(_sequencer, 0));
+	if (returnData) {
+		const uint64_t bytes = sqlite3_column_bytes(_sequencer, 1);
+		if (bytes == MAX_REC_SIZE) {
+			/*
+			 * Later segments are in the subordinate table; read
+			 * them through the store's serialized connection.
+			 */
+			record.data = _store->read(record.key);
+		} else {
+			record.data.resize(bytes);
+			record.data.copy(
+			    (uint8_t *)sqlite3_column_blob(_sequencer, 1),
+			    bytes);
+		}
+	}
+	return (record);
+}
+
 void
 BiometricEvaluation::IO::SQLiteRecordStore::Impl::cleanup()
 {
@@ -69,6 +69,9 @@ namespace BiometricEvaluation
 			void
 			setCursorAtKey(const std::string &key);
 
+			std::vector<std::shared_ptr<RecordStore::Partition>>
+			partition(unsigned int count);
+
 			~Impl();
 
 			Impl(const SQLiteRecordStore&) = delete;
@@ -196,6 +199,64 @@ namespace BiometricEvaluation
 			/** Row for key in setCursorForKey() */
 			uint64_t _cursorRow;
 			
+			/**
+			 * @brief
+			 * A range of ROWIDs of the primary table, read
+			 * through a connection of its own.
+			 */
+			class RowRangePartition : public RecordStore::Partition
+			{
+			public:
+				/**
+				 * @param[in] store
+				 *	Store being partitioned.
+				 * @param[in] first
+				 *	First ROWID of the range.
+				 * @param[in] last
+				 *	Last ROWID of the range, which is
+				 *	empty if less than first.
+				 */
+				RowRangePartition(
+				    const SQLiteRecordStore::Impl *store,
+				    int64_t first,
+				    int64_t last);
+
+				~RowRangePartition();
+
+				RecordStore::Record
+				sequence(
+				    int cursor)
+				    override;
+
+				std::string
+				sequenceKey(
+				    int cursor)
+				    override;
+
+			private:
+				const SQLiteRecordStore::Impl *_store;
+				const int64_t _first;
+				const int64_t _last;
+				/** Read-only connection, opened when needed */
+				sqlite3 *_db;
+				/** Statement selecting the range */
+				sqlite3_stmt *_sequencer;
+				/** If _sequencer has reached the end */
+				bool _sequenceEnd;
+
+				/** Throw the last error of _db */
+				void
+				sqliteError(
+				    int32_t errorNumber)
+				    const;
+
+				/** Sequence, optionally reading data */
+				RecordStore::Record
+				i_sequence(
+				    bool returnData,
+				    int cursor);
+			};
+
 			/** Name given to the primate SQLite table */
 			static const std::string PRIMARY_KV_TABLE;
 			/** Name given to the subordinate SQLite table */
@@ -20,7 +20,8 @@
 namespace BE = BiometricEvaluation;
 using namespace BE::Framework::Enumeration;
 
-BE::Iris::INCITSView::INCITSView()
+BE::Iris::INCITSView::INCITSView() :
+    _iir(std::make_shared<Memory::uint8Array>())
 {
 }
 
@@ -31,7 +32,8 @@ BE::Iris::INCITSView::INCITSView()
  */
 BE::Iris::INCITSView::INCITSView(
     const std::string &filename,
-    const uint32_t viewNumber)
+    const uint32_t viewNumber) :
+    _iir(std::make_shared<Memory::uint8Array>())
 {
 	FILE *fp;
 	if (!BE::IO::Utility::fileExists(filename)) {
@@ -42,8 +44,8 @@ BE::Iris::INCITSView::INCITSView(
 		throw (BE::Error::FileError("Could not open file."));
 	}
 	uint64_t size = IO::Utility::getFileSize(filename);
-	this->_iir.resize(size);
-	if (fread(this->_iir, 1, size, fp) != size){
+	this->_iir->resize(size);
+	if (fread(*this->_iir, 1, size, fp) != size){
 		fclose(fp);
 		throw (BE::Error::FileError("Could not read file"));
 	}
@@ -52,9 +54,16 @@ BE::Iris::INCITSView::INCITSView(
 
 BE::Iris::INCITSView::INCITSView(
     const Memory::uint8Array &buffer,
-    const uint32_t viewNumber)
+    const uint32_t viewNumber) :
+    _iir(std::make_shared<Memory::uint8Array>(buffer))
+{
+}
+
+BE::Iris::INCITSView::INCITSView(
+    Memory::uint8Array &&buffer,
+    const uint32_t viewNumber) :
+    _iir(std::make_shared<Memory::uint8Array>(std::move(buffer)))
 {
-	this->_iir = buffer;
 }
 
 /******************************************************************************/
@@ -161,7 +170,7 @@ BiometricEvaluation::Iris::INCITSView::getIrisCenterInfo(
 BiometricEvaluation::Memory::uint8Array const&
 BiometricEvaluation::Iris::INCITSView::getIIRData() const
 {
-	return (this->_iir);
+	return (*this->_iir);
 }
 
 void
@@ -281,9 +290,17 @@ BiometricEvaluation::Iris::INCITSView::readIrisView(
 	this->_irisDiameterLargest = buf.scanBeU16Val();
 
 	uval32 = buf.scanBeU32Val();	/* image length */
-	BE::Memory::uint8Array imageData(uval32);
-	buf.scan(&imageData[0], uval32);
-	this->setImageData(imageData);
+	const uint8_t *imageData = buf.get() + buf.getIndex();
+	buf.scan(nullptr, uval32);
+	if (buf.get() == static_cast<const uint8_t *>(*this->_iir)) {
+		/* Point into the record instead of copying the image */
+		this->setImageData(std::shared_ptr<const uint8_t>(this->_iir,
+		    imageData), uval32);
+	} else {
+		BE::Memory::uint8Array copy;
+		copy.copy(imageData, uval32);
+		this->setImageData(std::move(copy));
+	}
 }
 
 /******************************************************************************/
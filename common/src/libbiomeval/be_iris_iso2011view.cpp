@@ -21,8 +21,7 @@ BiometricEvaluation::Iris::ISO2011View::ISO2011View(
     const uint32_t viewNumber) :
     BiometricEvaluation::Iris::INCITSView::INCITSView(filename, viewNumber)
 {
-	BE::Memory::uint8Array recordData = Iris::INCITSView::getIIRData();
-	BE::Memory::IndexedBuffer iBuf(recordData, recordData.size());
+	BE::Memory::IndexedBuffer iBuf(Iris::INCITSView::getIIRData());
 	this->readISOHeader(iBuf);
 
 	//XXX Really should use a skipIrisView() function here
@@ -35,8 +34,21 @@ BiometricEvaluation::Iris::ISO2011View::ISO2011View(
     const uint32_t viewNumber) :
     BiometricEvaluation::Iris::INCITSView::INCITSView(buffer, viewNumber)
 {
-	BE::Memory::IndexedBuffer iBuf(
-	    const_cast<BE::Memory::uint8Array &>(buffer), buffer.size());
+	BE::Memory::IndexedBuffer iBuf(Iris::INCITSView::getIIRData());
+	this->readISOHeader(iBuf);
+
+	//XXX Really should use a skipIrisView() function here
+	for (uint32_t i = 1; i <= viewNumber; i++)
+		this->readIrisView(iBuf);
+}
+
+BiometricEvaluation::Iris::ISO2011View::ISO2011View(
+    BiometricEvaluation::Memory::uint8Array &&buffer,
+    const uint32_t viewNumber) :
+    BiometricEvaluation::Iris::INCITSView::INCITSView(
+    std::move(buffer), viewNumber)
+{
+	BE::Memory::IndexedBuffer iBuf(Iris::INCITSView::getIIRData());
 	this->readISOHeader(iBuf);
 
 	//XXX Really should use a skipIrisView() function here
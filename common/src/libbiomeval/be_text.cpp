@@ -176,12 +176,15 @@ BiometricEvaluation::Text::digest(
 #else
 	/* Use OpenSSL everywhere else */
 	
-	/* This need only be called once per executable */
-	static bool digests_loaded = false;
-	if (!digests_loaded) {
+	/*
+	 * This need only be called once per executable. Initializing a
+	 * static local is thread-safe, so concurrent first calls are too.
+	 */
+	static const bool digests_loaded = []() {
 		OpenSSL_add_all_digests();
-		digests_loaded = true;
-	}
+		return (true);
+	}();
+	(void)digests_loaded;
 
 	/* Supports any digest type supported by OpenSSL (MD5, SHA1, ...) */
 	const EVP_MD *md;
@@ -350,7 +350,7 @@ BiometricEvaluation::View::AN2KView::readImageCommon(
 	BE::Memory::uint8Array imageData;
 	imageData.copy(field->subfields[0]->items[0]->value,
 	    field->subfields[0]->items[0]->num_bytes);
-	this->setImageData(imageData);
+	this->setImageData(std::move(imageData));
 }
 
 void
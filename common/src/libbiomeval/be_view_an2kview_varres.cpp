@@ -382,11 +382,10 @@ BiometricEvaluation::View::AN2KViewVariableResolution::readImageRecord(
 	/* Read the image data */
 	if (lookup_ANSI_NIST_field(&field, &idx, DAT2_ID, record) != TRUE)
 		throw Error::DataError("Field DAT2 not found");
-	Memory::AutoArray<uint8_t>imageData = Memory::AutoArray<uint8_t>(
+	Memory::uint8Array imageData;
+	imageData.copy(field->subfields[0]->items[0]->value,
 	    field->subfields[0]->items[0]->num_bytes);
-	for (unsigned int i = 0; i < imageData.size(); i++)
-		imageData[i] = field->subfields[0]->items[0]->value[i];
-	AN2KView::setImageData(imageData);
+	AN2KView::setImageData(std::move(imageData));
 
 	/*********************************************************************/
 	/* Optional Fields.                                                  */
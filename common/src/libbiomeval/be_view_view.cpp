@@ -29,11 +29,11 @@ BiometricEvaluation::View::View::getImage() const
 	switch (_compressionAlgorithm) {
 	case BE::Image::CompressionAlgorithm::None: {
 		uint8_t bitDepth{0};
-		if (this->_imageData.size() ==
+		if (this->_imageDataSize ==
 		    (this->_imageSize.xSize * this->_imageSize.ySize *
 		    (this->_imageColorDepth / 8)))
 			bitDepth = 8;
-		else if (this->_imageData.size() ==
+		else if (this->_imageDataSize ==
 		    (this->_imageSize.xSize * this->_imageSize.ySize *
 		    (this->_imageColorDepth / 16)))
 			bitDepth = 16;
@@ -41,12 +41,13 @@ BiometricEvaluation::View::View::getImage() const
 			throw BE::Error::NotImplemented("> 16-bit depth");
 
 		return (std::make_shared<BE::Image::Raw>(this->_imageData,
-		    this->_imageData.size(), this->_imageSize,
+		    this->_imageDataSize, this->_imageSize,
 		    this->_imageColorDepth, bitDepth, this->_imageResolution,
 		    false));
 	}
 	default:
-		return (BE::Image::Image::openImage(this->_imageData));
+		return (BE::Image::Image::openImage(this->_imageData,
+		    this->_imageDataSize));
 	}
 }
 
@@ -101,8 +102,26 @@ BiometricEvaluation::View::View::setImageSize(
 void
 BiometricEvaluation::View::View::setImageData(
     const BiometricEvaluation::Memory::uint8Array &imageData)
+{
+	this->setImageData(BE::Memory::uint8Array(imageData));
+}
+
+void
+BiometricEvaluation::View::View::setImageData(
+    BiometricEvaluation::Memory::uint8Array &&imageData)
+{
+	const uint64_t size = imageData.size();
+	this->setImageData(BE::Image::Image::shareData(std::move(imageData)),
+	    size);
+}
+
+void
+BiometricEvaluation::View::View::setImageData(
+    const std::shared_ptr<const uint8_t> &imageData,
+    uint64_t size)
 {
 	this->_imageData = imageData;
+	this->_imageDataSize = size;
 }
 
 void
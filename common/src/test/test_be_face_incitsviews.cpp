@@ -13,6 +13,7 @@
 #include <fstream>
 #include <iostream>
 #include <be_face_iso2005view.h>
+#include <be_io_utility.h>
 #include <be_feature_mpegfacepoint.h>
 
 using namespace std;
@@ -118,6 +119,22 @@ testISO2005()
 	cout << "Success." << endl;
 
 	printViewInfo(facev);
+
+	cout << "Attempt to construct with moved buffer: ";
+	try {
+		Memory::uint8Array record = IO::Utility::readFile(
+		    "test_data/face01.iso2005");
+		Face::ISO2005View movedv(std::move(record), 1);
+		if (!(movedv.getImage()->getData() ==
+		    facev.getImage()->getData())) {
+			cout << "FAILED (image data differs)." << endl;
+			return (false);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what()  << endl;
+		return (false);
+	}
+	cout << "Success." << endl;
 	return (true);
 }
 
@@ -0,0 +1,242 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Decode a batch of encoded images one at a time on this thread and then
+ * with BatchDecoder at increasing thread counts, verifying that every
+ * batch delivers the same pixels in the same order and writing one line
+ * of comma-separated throughput results per trial.
+ */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_image_batchdecoder.h>
+#include <be_io_recordstore.h>
+#include <be_io_utility.h>
+#include <be_time_timer.h>
+
+#include "test_be_image_files.h"
+
+namespace BE = BiometricEvaluation;
+
+static const std::string USAGE =
+    "[-c copies] [-t threads] [-o file] [-r recordstore] [file ...]\n"
+    "\t-c\tTimes each image appears in the batch (default: 20)\n"
+    "\t-t\tMaximum number of decoding threads (default: all cores)\n"
+    "\t-o\tCSV results file (default: stdout)\n"
+    "\t-r\tRecordStore of images to decode instead of files\n"
+    "\tfile\tImage or ANSI/NIST file (default: " +
+    DefaultImageFilesUsage + ")";
+
+/**
+ * @brief
+ * Decode every image on this thread, as callers did before
+ * BatchDecoder.
+ *
+ * @return
+ *	Decoded pixels of each image, empty if it could not be decoded.
+ */
+static std::vector<BE::Memory::uint8Array>
+decodeSerially(
+    const std::vector<BE::Memory::uint8Array> &images,
+    BE::Time::Timer &timer)
+{
+	std::vector<BE::Memory::uint8Array> pixels(images.size());
+	timer.start();
+	for (uint64_t i = 0; i < images.size(); i++) {
+		try {
+			const auto image = BE::Image::Image::openImage(
+			    images[i]);
+			const uint64_t stride = image->getDecodedRowSize(
+			    BE::Image::PixelFormat::Gray8);
+			pixels[i].resize(stride * image->getDimensions().ySize);
+			image->decodeInto(pixels[i], stride,
+			    BE::Image::PixelFormat::Gray8);
+		} catch (BE::Error::Exception &e) {
+			pixels[i].resize(0);
+		}
+	}
+	timer.stop();
+
+	return (pixels);
+}
+
+static void
+printResult(
+    std::ostream &out,
+    const std::string &path,
+    uint32_t threads,
+    uint64_t images,
+    uint64_t pixels,
+    uint64_t elapsed)
+{
+	const double seconds = elapsed / 1000000.0;
+	out << path << ',' << threads << ',' << images << ',' << elapsed <<
+	    ',' << (seconds > 0 ? images / seconds : 0) << ',' <<
+	    (seconds > 0 ? (pixels / 1000000.0) / seconds : 0) << std::endl;
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	uint64_t copies{20};
+	uint32_t maxThreads{std::max(1U, std::thread::hardware_concurrency())};
+	std::string output{};
+	std::string recordStore{};
+
+	int c;
+	while ((c = getopt(argc, argv, "c:t:o:r:")) != EOF) {
+		try {
+			switch (c) {
+			case 'c':
+				copies = std::stoull(optarg);
+				break;
+			case 't':
+				maxThreads = std::stoul(optarg);
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			case 'r':
+				recordStore = optarg;
+				break;
+			default:
+				std::cerr << "Usage: " << argv[0] << " " <<
+				    USAGE << std::endl;
+				return (EXIT_FAILURE);
+			}
+		} catch (std::exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	if ((copies == 0) || (maxThreads == 0)) {
+		std::cerr << "Copies and threads must be positive" <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	/* Encoded images, and RecordStore keys when decoding a store */
+	std::vector<BE::Memory::uint8Array> unique;
+	std::vector<std::string> uniqueKeys;
+	std::shared_ptr<BE::IO::RecordStore> rs;
+	try {
+		if (!recordStore.empty()) {
+			rs = BE::IO::RecordStore::openRecordStore(recordStore,
+			    BE::IO::Mode::ReadOnly);
+			for (const auto &record : *rs) {
+				unique.push_back(record.data);
+				uniqueKeys.push_back(record.key);
+			}
+		} else {
+			std::vector<std::string> files(argv + optind,
+			    argv + argc);
+			if (files.empty())
+				files = DefaultImageFiles;
+			for (const auto &f : files)
+				for (const auto &fileImage :
+				    readFileImages(f))
+					unique.push_back(
+					    fileImage.image->getData());
+		}
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Could not load images: " << e.what() <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	}
+	if (unique.empty()) {
+		std::cerr << "No images to decode" << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	std::vector<BE::Memory::uint8Array> images;
+	std::vector<std::string> keys;
+	for (uint64_t i = 0; i < copies; i++) {
+		images.insert(images.end(), unique.begin(), unique.end());
+		keys.insert(keys.end(), uniqueKeys.begin(), uniqueKeys.end());
+	}
+
+	std::ofstream file;
+	if (!output.empty()) {
+		file.open(output);
+		if (!file) {
+			std::cerr << "Could not open " << output << std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	std::ostream &out = output.empty() ? std::cout : file;
+	out << "path,threads,images,elapsed_us,images_per_sec," <<
+	    "mpix_per_sec" << std::endl;
+
+	BE::Time::Timer timer;
+	const std::vector<BE::Memory::uint8Array> expected = decodeSerially(
+	    images, timer);
+	uint64_t pixels = 0;
+	for (const auto &p : expected)
+		pixels += p.size();
+	printResult(out, "serial", 1, images.size(), pixels,
+	    timer.elapsed());
+
+	int status = EXIT_SUCCESS;
+	for (uint32_t threads = 1; ; threads = std::min(threads * 2,
+	    maxThreads)) {
+		uint64_t next = 0, mismatches = 0;
+		const auto verify = [&](BE::Image::DecodedImage &decoded) {
+			if ((decoded.index != next) ||
+			    (decoded.pixels != expected[next]) ||
+			    (!keys.empty() && (decoded.key != keys[next])))
+				mismatches++;
+			next++;
+		};
+
+		try {
+			const BE::Image::BatchDecoder decoder(threads);
+			timer.start();
+			if (rs)
+				decoder.decode(rs, keys, verify);
+			else
+				decoder.decode(images, verify);
+			timer.stop();
+		} catch (BE::Error::Exception &e) {
+			std::cerr << "BatchDecoder (" << threads <<
+			    " threads): " << e.what() << std::endl;
+			return (EXIT_FAILURE);
+		}
+
+		if ((mismatches != 0) || (next != images.size())) {
+			std::cerr << "BatchDecoder (" << threads <<
+			    " threads): " << mismatches << " images differ "
+			    "from serial decoding, " << next << " of " <<
+			    images.size() << " delivered" << std::endl;
+			status = EXIT_FAILURE;
+		}
+		printResult(out, "batch", threads, images.size(), pixels,
+		    timer.elapsed());
+
+		if (threads == maxThreads)
+			break;
+	}
+
+	return (status);
+}
@@ -0,0 +1,342 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Check that BatchDecoder delivers the same pixels as decoding each image
+ * serially, in order, with errors for undecodable images, and that
+ * delivered images remain usable after the encoded buffers are gone.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_finger_an2kview_fixedres.h>
+#include <be_image_batchdecoder.h>
+#include <be_io_recordstore.h>
+#include <be_io_utility.h>
+
+namespace BE = BiometricEvaluation;
+
+static const std::string STORENAME = "test_be_image_batchdecoder.rs";
+
+/**
+ * @return
+ *	Encoded images followed by buffers that are not images.
+ */
+static std::vector<BE::Memory::uint8Array>
+readImages()
+{
+	std::vector<BE::Memory::uint8Array> images;
+	images.push_back(BE::IO::Utility::readFile("test_data/img.wsq"));
+	const std::string an2k = "test_data/type4-slaps.an2k";
+	for (uint32_t record = 1; record <= 4; record++) {
+		const BE::Finger::AN2KViewFixedResolution view(an2k,
+		    BE::View::AN2KView::RecordType::Type_4, record);
+		images.push_back(view.getImage()->getData());
+	}
+
+	BE::Memory::uint8Array garbage(64);
+	std::memset(garbage, 0x5A, garbage.size());
+	images.push_back(garbage);
+	images.push_back(BE::Memory::uint8Array());
+
+	return (images);
+}
+
+/**
+ * @return
+ *	Pixels of each image decoded on this thread, empty if it could
+ *	not be decoded.
+ */
+static std::vector<BE::Memory::uint8Array>
+decodeSerially(
+    const std::vector<BE::Memory::uint8Array> &images,
+    BE::Image::PixelFormat format)
+{
+	std::vector<BE::Memory::uint8Array> pixels(images.size());
+	for (uint64_t i = 0; i < images.size(); i++) {
+		try {
+			const auto image = BE::Image::Image::openImage(
+			    images[i]);
+			const uint64_t stride = image->getDecodedRowSize(
+			    format);
+			pixels[i].resize(stride * image->getDimensions().ySize);
+			image->decodeInto(pixels[i], stride, format);
+		} catch (BE::Error::Exception &e) {
+			pixels[i].resize(0);
+		}
+	}
+
+	return (pixels);
+}
+
+/**
+ * @brief
+ * Check one delivered image against its serial decode.
+ *
+ * @return
+ *	true if result matches, false otherwise.
+ */
+static bool
+checkResult(
+    const BE::Image::DecodedImage &result,
+    uint64_t expectedIndex,
+    const std::string &expectedKey,
+    const BE::Memory::uint8Array &expected)
+{
+	if (result.index != expectedIndex) {
+		std::cout << "\t*** Image " << expectedIndex << " delivered "
+		    "as " << result.index << std::endl;
+		return (false);
+	}
+	if (result.key != expectedKey) {
+		std::cout << "\t*** Image " << expectedIndex << " has key \"" <<
+		    result.key << "\"" << std::endl;
+		return (false);
+	}
+	if (expected.size() == 0) {
+		if (result.error.empty() || result.image ||
+		    (result.pixels.size() != 0)) {
+			std::cout << "\t*** Image " << expectedIndex <<
+			    " should not have decoded" << std::endl;
+			return (false);
+		}
+		return (true);
+	}
+	if (!result.error.empty() || !result.image) {
+		std::cout << "\t*** Image " << expectedIndex << " failed: " <<
+		    result.error << std::endl;
+		return (false);
+	}
+	if (result.pixels != expected) {
+		std::cout << "\t*** Image " << expectedIndex << " decoded "
+		    "incorrectly" << std::endl;
+		return (false);
+	}
+	return (true);
+}
+
+/**
+ * @brief
+ * Decode a batch of buffers at several thread counts and pixel formats.
+ */
+static bool
+checkBuffers(
+    const std::vector<BE::Memory::uint8Array> &images)
+{
+	bool success = true;
+	for (const auto format : {BE::Image::PixelFormat::Gray8,
+	    BE::Image::PixelFormat::RGB24}) {
+		const auto expected = decodeSerially(images, format);
+		for (const uint32_t threads : {1, 2, 5}) {
+			uint64_t next = 0;
+			BE::Image::BatchDecoder(threads, format).decode(images,
+			    [&](BE::Image::DecodedImage &result) {
+				if (!checkResult(result, next, "",
+				    expected[next]))
+					success = false;
+				next++;
+			});
+			if (next != images.size()) {
+				std::cout << "\t*** " << next << " of " <<
+				    images.size() << " images delivered" <<
+				    std::endl;
+				success = false;
+			}
+		}
+	}
+
+	return (success);
+}
+
+/**
+ * @brief
+ * Keep delivered images, then overwrite and destroy the encoded
+ * buffers before using them.
+ */
+static bool
+checkLifetime(
+    const std::vector<BE::Memory::uint8Array> &images)
+{
+	std::map<uint64_t, std::shared_ptr<BE::Image::Image>> kept;
+	{
+		std::vector<BE::Memory::uint8Array> copies(images);
+		BE::Image::BatchDecoder(2).decode(copies,
+		    [&](BE::Image::DecodedImage &result) {
+			if (result.image)
+				kept[result.index] = result.image;
+		});
+		for (auto &copy : copies)
+			if (copy.size() != 0)
+				std::memset(copy, 0, copy.size());
+	}
+
+	if (kept.empty()) {
+		std::cout << "\t*** No images decoded" << std::endl;
+		return (false);
+	}
+
+	bool success = true;
+	for (const auto &image : kept) {
+		try {
+			if (image.second->getRawData() !=
+			    BE::Image::Image::openImage(images[image.first])->
+			    getRawData()) {
+				std::cout << "\t*** Kept image " <<
+				    image.first << " changed" << std::endl;
+				success = false;
+			}
+		} catch (BE::Error::Exception &e) {
+			std::cout << "\t*** Kept image " << image.first <<
+			    ": " << e.whatString() << std::endl;
+			success = false;
+		}
+	}
+
+	return (success);
+}
+
+/**
+ * @brief
+ * Decode images stored in a RecordStore, including a missing key.
+ */
+static bool
+checkRecordStore(
+    const std::vector<BE::Memory::uint8Array> &images)
+{
+	std::shared_ptr<BE::IO::RecordStore> rs;
+	try {
+		rs = BE::IO::RecordStore::createRecordStore(STORENAME,
+		    "BatchDecoder test", BE::IO::RecordStore::Kind::Default);
+	} catch (BE::Error::Exception &e) {
+		std::cout << "\t*** Could not create RecordStore: " <<
+		    e.whatString() << std::endl;
+		return (false);
+	}
+
+	std::vector<std::string> keys;
+	std::vector<BE::Memory::uint8Array> stored;
+	for (uint64_t i = 0; i < images.size(); i++) {
+		if (images[i].size() == 0)
+			continue;
+		keys.push_back("image" + std::to_string(i));
+		rs->insert(keys.back(), images[i]);
+		stored.push_back(images[i]);
+	}
+	keys.push_back("missing");
+	const auto expected = decodeSerially(stored,
+	    BE::Image::PixelFormat::Gray8);
+
+	bool success = true;
+	uint64_t next = 0;
+	BE::Image::BatchDecoder(3).decode(rs, keys,
+	    [&](BE::Image::DecodedImage &result) {
+		if (!checkResult(result, next, keys[next],
+		    next < expected.size() ? expected[next] :
+		    BE::Memory::uint8Array()))
+			success = false;
+		next++;
+	});
+	if (next != keys.size()) {
+		std::cout << "\t*** " << next << " of " << keys.size() <<
+		    " records delivered" << std::endl;
+		success = false;
+	}
+
+	rs.reset();
+	BE::IO::RecordStore::removeRecordStore(STORENAME);
+	return (success);
+}
+
+/**
+ * @brief
+ * Throw from the callback and expect decode() to rethrow it.
+ */
+static bool
+checkCallbackException(
+    const std::vector<BE::Memory::uint8Array> &images)
+{
+	uint64_t delivered = 0;
+	try {
+		BE::Image::BatchDecoder(2).decode(images,
+		    [&](BE::Image::DecodedImage &result) {
+			if (++delivered == 2)
+				throw BE::Error::StrategyError("Stop");
+		});
+	} catch (BE::Error::StrategyError &e) {
+		if (delivered == 2)
+			return (true);
+	}
+
+	std::cout << "\t*** Exception from callback not rethrown after "
+	    "image 2 (" << delivered << " delivered)" << std::endl;
+	return (false);
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	std::vector<BE::Memory::uint8Array> images;
+	try {
+		images = readImages();
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Could not read test images: " <<
+		    e.whatString() << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	try {
+		BE::Image::BatchDecoder(1, BE::Image::PixelFormat::MonoWhite);
+		std::cout << "Constructing with MonoWhite did not throw." <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	} catch (BE::Error::ParameterError &e) {}
+
+	bool success = true;
+	try {
+		std::cout << "Decoding buffers: " << std::flush;
+		if (checkBuffers(images))
+			std::cout << "Matches" << std::endl;
+		else
+			success = false;
+
+		std::cout << "Using images after buffers are gone: " <<
+		    std::flush;
+		if (checkLifetime(images))
+			std::cout << "Matches" << std::endl;
+		else
+			success = false;
+
+		std::cout << "Decoding RecordStore records: " << std::flush;
+		if (checkRecordStore(images))
+			std::cout << "Matches" << std::endl;
+		else
+			success = false;
+
+		std::cout << "Throwing from the callback: " << std::flush;
+		if (checkCallbackException(images))
+			std::cout << "Rethrown" << std::endl;
+		else
+			success = false;
+	} catch (BE::Error::Exception &e) {
+		std::cout << "Caught " << e.whatString() << std::endl;
+		success = false;
+	}
+
+	return (success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,327 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Benchmark in-process image encoding against transcoding with the
+ * external NBIS and OpenJPEG tools (cwsq and opj_compress), writing one
+ * line of comma-separated results per (image, workload, path) triple.
+ */
+
+#include <getopt.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_image_jpeg2000.h>
+#include <be_image_png.h>
+#include <be_image_wsq.h>
+#include <be_io_utility.h>
+#include <be_time_timer.h>
+
+#include "test_be_image_files.h"
+
+namespace BE = BiometricEvaluation;
+
+static const std::string USAGE =
+    "[-n iterations] [-t threads] [-d dir] [-o file] [file ...]\n"
+    "\t-n\tNumber of times to encode each image (default: 10)\n"
+    "\t-t\tThreads encoding in-process concurrently (default: 1)\n"
+    "\t-d\tDirectory for external tool files (default: .)\n"
+    "\t-o\tCSV results file (default: stdout)\n"
+    "\tfile\tImage or ANSI/NIST file (default: " +
+    DefaultImageFilesUsage + ")";
+
+/** 8-bit grayscale pixels to encode */
+struct BenchmarkImage
+{
+	std::string name;
+	BE::Image::Size dimensions;
+	BE::Image::Resolution resolution;
+	BE::Memory::uint8Array rawData;
+};
+
+/** An encoding to time, in-process and with an external tool */
+struct Workload
+{
+	std::string name;
+	/** Encode in-process, returning the encoded size */
+	std::function<uint64_t(const BenchmarkImage&)> encode;
+	/** External tool command, with the input file appended */
+	std::string command;
+	/** Extension of the file written by command */
+	std::string extension;
+	/** Whether command reads PGM instead of raw pixels */
+	bool pgm;
+};
+
+static const std::vector<Workload> WORKLOADS{
+    {"wsq_0.75", [](const BenchmarkImage &i) -> uint64_t {
+	return (BE::Image::WSQ::encode(i.rawData, i.dimensions,
+	    i.resolution, 0.75).size());
+    }, "cwsq 0.75 wsq", "wsq", false},
+    {"jp2_lossless", [](const BenchmarkImage &i) -> uint64_t {
+	return (BE::Image::JPEG2000::encode(i.rawData, i.dimensions, 8, 8,
+	    i.resolution).size());
+    }, "opj_compress -o %o -i", "jp2", true},
+    {"jp2_10to1", [](const BenchmarkImage &i) -> uint64_t {
+	return (BE::Image::JPEG2000::encode(i.rawData, i.dimensions, 8, 8,
+	    i.resolution, 10).size());
+    }, "opj_compress -r 10 -o %o -i", "jp2", true},
+    {"png", [](const BenchmarkImage &i) -> uint64_t {
+	return (BE::Image::PNG::encode(i.rawData, i.dimensions, 8, 8,
+	    i.resolution).size());
+    }, "", "", false}};
+
+static void
+addImage(
+    const std::string &name,
+    const std::shared_ptr<BE::Image::Image> &image,
+    std::vector<BenchmarkImage> &images)
+{
+	images.push_back({name, image->getDimensions(),
+	    image->getResolution(), image->getRawGrayscaleData(8)});
+}
+
+/** @return Whether program can be found in PATH */
+static bool
+haveTool(
+    const std::string &command)
+{
+	const std::string program = command.substr(0, command.find(' '));
+	return (std::system(("command -v " + program +
+	    " > /dev/null 2>&1").c_str()) == 0);
+}
+
+/**
+ * @brief
+ * Transcode an image the way scripts do: write the pixels to a file,
+ * run the external tool, and read back the result.
+ *
+ * @return
+ *	Size of the encoded image.
+ */
+static uint64_t
+encodeExternally(
+    const BenchmarkImage &image,
+    const Workload &workload,
+    const std::string &directory)
+{
+	const std::string base = directory + "/encbench";
+	const std::string input = base + (workload.pgm ? ".pgm" : ".raw");
+	const std::string output = base + "." + workload.extension;
+
+	std::ofstream file(input, std::ios::binary);
+	if (workload.pgm)
+		file << "P5\n" << image.dimensions.xSize << " " <<
+		    image.dimensions.ySize << "\n255\n";
+	file.write(reinterpret_cast<const char *>(&image.rawData[0]),
+	    image.rawData.size());
+	file.close();
+	if (!file)
+		throw BE::Error::FileError("Could not write " + input);
+
+	std::string command = workload.command;
+	const auto outputPos = command.find("%o");
+	if (outputPos != std::string::npos)
+		command.replace(outputPos, 2, output);
+	command += " " + input;
+	if (!workload.pgm)
+		command += " -raw_in " +
+		    std::to_string(image.dimensions.xSize) + "," +
+		    std::to_string(image.dimensions.ySize) + ",8," +
+		    std::to_string(static_cast<int>(image.resolution.
+		    toUnits(BE::Image::Resolution::Units::PPI).xRes));
+	if (std::system((command + " > /dev/null 2>&1").c_str()) != 0)
+		throw BE::Error::StrategyError("Could not run " + command);
+
+	const uint64_t size = BE::IO::Utility::readFile(output).size();
+	std::remove(input.c_str());
+	std::remove(output.c_str());
+
+	return (size);
+}
+
+static void
+printHeader(
+    std::ostream &out)
+{
+	out << "image,width,height,workload,path,threads,encodes,"
+	    "encoded_bytes,elapsed_us,ms_per_encode,encodes_per_sec,"
+	    "mpix_per_sec" << std::endl;
+}
+
+static void
+printResult(
+    std::ostream &out,
+    const BenchmarkImage &image,
+    const std::string &workload,
+    const std::string &path,
+    uint32_t threads,
+    uint64_t encodes,
+    uint64_t encodedSize,
+    uint64_t elapsed)
+{
+	const double seconds = elapsed / 1000000.0;
+	const double megapixels = (static_cast<double>(
+	    image.dimensions.xSize) * image.dimensions.ySize * encodes) /
+	    1000000.0;
+	out << image.name << ',' << image.dimensions.xSize << ',' <<
+	    image.dimensions.ySize << ',' << workload << ',' << path << ',' <<
+	    threads << ',' << encodes << ',' << encodedSize << ',' <<
+	    elapsed << ',' << ((seconds * 1000.0) / encodes) << ',' <<
+	    (seconds > 0 ? encodes / seconds : 0) << ',' <<
+	    (seconds > 0 ? megapixels / seconds : 0) << std::endl;
+}
+
+/**
+ * @brief
+ * Time every workload against one image.
+ */
+static void
+benchmarkImage(
+    const BenchmarkImage &image,
+    uint64_t iterations,
+    uint32_t threads,
+    const std::string &directory,
+    std::ostream &out)
+{
+	for (const auto &workload : WORKLOADS) {
+		/* Each thread encodes the image iterations times */
+		uint64_t encodedSize = 0;
+		BE::Time::Timer timer;
+		try {
+			/* Exceptions are only expected on the first encode */
+			encodedSize = workload.encode(image);
+			timer.start();
+			std::vector<std::thread> pool;
+			for (uint32_t t = 0; t < threads; t++)
+				pool.emplace_back([&]() {
+					try {
+						for (uint64_t i = 0;
+						    i < iterations; i++)
+							workload.encode(image);
+					} catch (BE::Error::Exception &e) {
+						std::cerr << image.name <<
+						    ": " << e.what() <<
+						    std::endl;
+					}
+				});
+			for (auto &thread : pool)
+				thread.join();
+			timer.stop();
+			printResult(out, image, workload.name, "inprocess",
+			    threads, iterations * threads, encodedSize,
+			    timer.elapsed());
+		} catch (BE::Error::Exception &e) {
+			std::cerr << image.name << ": " << workload.name <<
+			    ": " << e.what() << std::endl;
+		}
+
+		if (workload.command.empty() || !haveTool(workload.command))
+			continue;
+		try {
+			timer.start();
+			for (uint64_t i = 0; i < iterations; i++)
+				encodedSize = encodeExternally(image, workload,
+				    directory);
+			timer.stop();
+			printResult(out, image, workload.name, "external", 1,
+			    iterations, encodedSize, timer.elapsed());
+		} catch (BE::Error::Exception &e) {
+			std::cerr << image.name << ": " << workload.command <<
+			    ": " << e.what() << std::endl;
+		}
+	}
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	uint64_t iterations{10};
+	uint32_t threads{1};
+	std::string directory{"."};
+	std::string output{};
+
+	int c;
+	while ((c = getopt(argc, argv, "n:t:d:o:")) != EOF) {
+		try {
+			switch (c) {
+			case 'n':
+				iterations = std::stoull(optarg);
+				break;
+			case 't':
+				threads = std::stoul(optarg);
+				break;
+			case 'd':
+				directory = optarg;
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			default:
+				std::cerr << "Usage: " << argv[0] << " " <<
+				    USAGE << std::endl;
+				return (EXIT_FAILURE);
+			}
+		} catch (std::exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	if ((iterations == 0) || (threads == 0)) {
+		std::cerr << "Iterations and threads must be positive" <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	std::vector<std::string> files(argv + optind, argv + argc);
+	if (files.empty())
+		files = DefaultImageFiles;
+
+	std::vector<BenchmarkImage> images;
+	try {
+		for (const auto &f : files)
+			for (const auto &fileImage : readFileImages(f))
+				addImage(fileImage.name, fileImage.image,
+				    images);
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Could not load images: " << e.what() <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	std::ofstream file;
+	if (!output.empty()) {
+		file.open(output);
+		if (!file) {
+			std::cerr << "Could not open " << output << std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	std::ostream &out = output.empty() ? std::cout : file;
+
+	printHeader(out);
+	for (const auto &image : images)
+		benchmarkImage(image, iterations, threads, directory, out);
+
+	return (EXIT_SUCCESS);
+}
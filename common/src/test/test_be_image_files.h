@@ -0,0 +1,92 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+#ifndef TEST_BE_IMAGE_FILES_H_
+#define TEST_BE_IMAGE_FILES_H_
+
+/*
+ * Loading of test images shared by the image test programs, so that
+ * each program works on the same images from the same files.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <be_data_interchange_an2k.h>
+#include <be_error_exception.h>
+#include <be_finger_an2kview_fixedres.h>
+#include <be_image_image.h>
+#include <be_io_utility.h>
+
+/** Files read by a program given none */
+static const std::vector<std::string> DefaultImageFiles{
+    "test_data/type4-slaps.an2k", "test_data/img.wsq"};
+/** DefaultImageFiles, for usage messages */
+static const std::string DefaultImageFilesUsage{
+    "test_data/type4-slaps.an2k and test_data/img.wsq"};
+
+/** An image read from a file */
+struct FileImage
+{
+	/** Path of the file, and "#n" for the nth image of a record */
+	std::string name;
+	/** The image */
+	std::shared_ptr<BiometricEvaluation::Image::Image> image;
+};
+
+/**
+ * @brief
+ * Read the images in a file, which may be an image or ANSI/NIST record.
+ *
+ * @param pathname
+ *	Path of the file.
+ *
+ * @return
+ *	The image, or every variable-resolution (Type-14) finger
+ *	capture and fixed-resolution (Type-4) image in the record.
+ *
+ * @throw Error::Exception
+ *	pathname could not be read or parsed.
+ */
+static std::vector<FileImage>
+readFileImages(
+    const std::string &pathname)
+{
+	namespace BE = BiometricEvaluation;
+
+	std::vector<FileImage> images;
+	BE::Memory::uint8Array data = BE::IO::Utility::readFile(pathname);
+	if (BE::Image::Image::getCompressionAlgorithm(data) !=
+	    BE::Image::CompressionAlgorithm::None) {
+		images.push_back({pathname,
+		    BE::Image::Image::openImage(std::move(data))});
+		return (images);
+	}
+
+	const BE::DataInterchange::AN2KRecord an2k(data);
+	uint32_t i = 0;
+	for (const auto &capture : an2k.getFingerCaptures())
+		images.push_back({pathname + "#" + std::to_string(i++),
+		    capture.getImage()});
+	for (uint32_t record = 1; ; record++) {
+		try {
+			const BE::Finger::AN2KViewFixedResolution view(data,
+			    BE::View::AN2KView::RecordType::Type_4, record);
+			images.push_back({pathname + "#" + std::to_string(i++),
+			    view.getImage()});
+		} catch (BE::Error::DataError &e) {
+			break;
+		}
+	}
+
+	return (images);
+}
+
+#endif /* TEST_BE_IMAGE_FILES_H_ */
@@ -0,0 +1,253 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Benchmark full, reduced-resolution, and region-of-interest decoding
+ * of a set of images (typically 1000 ppi slap captures), writing one
+ * line of comma-separated results per (image, workload) pair.
+ */
+
+#include <getopt.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_image_image.h>
+#include <be_io_recordstore.h>
+#include <be_io_utility.h>
+#include <be_time_timer.h>
+
+#include "test_be_image_files.h"
+
+namespace BE = BiometricEvaluation;
+using namespace BE::Framework::Enumeration;
+
+static const std::string USAGE =
+    "[-n iterations] [-m minimum_ppi] [-o file] [-r recordstore] "
+    "[file ...]\n"
+    "\t-n\tNumber of times to decode each image (default: 10)\n"
+    "\t-m\tSkip images below this resolution (default: 0)\n"
+    "\t-o\tCSV results file (default: stdout)\n"
+    "\t-r\tRecordStore of images to decode\n"
+    "\tfile\tImage or ANSI/NIST file (default: " +
+    DefaultImageFilesUsage + ")";
+
+/** A decoded image under test */
+struct BenchmarkImage
+{
+	std::string name;
+	std::shared_ptr<BE::Image::Image> image;
+};
+
+/** A decode request to time, as a fraction of the image */
+struct Workload
+{
+	std::string name;
+	uint8_t scaleDenominator;
+	/** Fraction of each dimension covered by a central ROI */
+	double roiFraction;
+};
+
+/*
+ * Segmentation and quality stages typically need a preview of the entire
+ * slap or a crop of the fingers from its center.
+ */
+static const std::vector<Workload> WORKLOADS{
+    {"full", 1, 1.0},
+    {"scale2", 2, 1.0},
+    {"scale4", 4, 1.0},
+    {"scale8", 8, 1.0},
+    {"roi", 1, 0.5},
+    {"roi_scale2", 2, 0.5},
+    {"roi_scale4", 4, 0.5}};
+
+/**
+ * @brief
+ * Add every image in a RecordStore.
+ */
+static void
+addRecordStore(
+    const std::string &pathname,
+    std::vector<BenchmarkImage> &images)
+{
+	const auto rs = BE::IO::RecordStore::openRecordStore(pathname,
+	    BE::IO::Mode::ReadOnly);
+	for (const auto &record : *rs) {
+		try {
+			images.push_back({pathname + "/" + record.key,
+			    BE::Image::Image::openImage(record.data)});
+		} catch (BE::Error::Exception &e) {
+			std::cerr << record.key << ": " << e.what() <<
+			    std::endl;
+		}
+	}
+}
+
+static void
+printHeader(
+    std::ostream &out)
+{
+	out << "image,codec,width,height,ppi,workload,decoded_width,"
+	    "decoded_height,iterations,elapsed_us,ms_per_decode,"
+	    "mpix_per_sec" << std::endl;
+}
+
+/**
+ * @brief
+ * Time every workload against one image.
+ */
+static void
+benchmarkImage(
+    const BenchmarkImage &benchmarkImage,
+    uint64_t iterations,
+    std::ostream &out)
+{
+	const auto &image = benchmarkImage.image;
+	const BE::Image::Size dimensions = image->getDimensions();
+	const BE::Image::Resolution resolution = image->getResolution().
+	    toUnits(BE::Image::Resolution::Units::PPI);
+
+	for (const auto &workload : WORKLOADS) {
+		BE::Image::ROI roi;
+		if (workload.roiFraction < 1.0) {
+			roi.size = BE::Image::Size(
+			    dimensions.xSize * workload.roiFraction,
+			    dimensions.ySize * workload.roiFraction);
+			roi.horzOffset = (dimensions.xSize -
+			    roi.size.xSize) / 2;
+			roi.vertOffset = (dimensions.ySize -
+			    roi.size.ySize) / 2;
+		}
+		const BE::Image::DecodeRequest request(roi,
+		    workload.scaleDenominator);
+		const BE::Image::Size decoded =
+		    image->getDecodedDimensions(request);
+		BE::Memory::uint8Array buffer(
+		    static_cast<uint64_t>(decoded.xSize) * decoded.ySize);
+
+		BE::Time::Timer timer;
+		timer.start();
+		for (uint64_t i = 0; i < iterations; i++)
+			image->decodeRegionInto(buffer, decoded.xSize,
+			    BE::Image::PixelFormat::Gray8, request);
+		timer.stop();
+
+		/* Throughput is relative to the full-resolution region */
+		const double seconds = timer.elapsed() / 1000000.0;
+		const double megapixels = (static_cast<double>(
+		    workload.roiFraction * dimensions.xSize) *
+		    (workload.roiFraction * dimensions.ySize) * iterations) /
+		    1000000.0;
+		out << benchmarkImage.name << ',' <<
+		    to_string(image->getCompressionAlgorithm()) << ',' <<
+		    dimensions.xSize << ',' << dimensions.ySize << ',' <<
+		    resolution.xRes << ',' << workload.name << ',' <<
+		    decoded.xSize << ',' << decoded.ySize << ',' <<
+		    iterations << ',' << timer.elapsed() << ',' <<
+		    ((seconds * 1000.0) / iterations) << ',' <<
+		    (seconds > 0 ? megapixels / seconds : 0) << std::endl;
+	}
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	uint64_t iterations{10};
+	double minimumResolution{0};
+	std::string output{};
+	std::vector<std::string> recordStores{};
+
+	int c;
+	while ((c = getopt(argc, argv, "n:m:o:r:")) != EOF) {
+		try {
+			switch (c) {
+			case 'n':
+				iterations = std::stoull(optarg);
+				break;
+			case 'm':
+				minimumResolution = std::stod(optarg);
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			case 'r':
+				recordStores.push_back(optarg);
+				break;
+			default:
+				std::cerr << "Usage: " << argv[0] << " " <<
+				    USAGE << std::endl;
+				return (EXIT_FAILURE);
+			}
+		} catch (std::exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	if (iterations == 0) {
+		std::cerr << "Iterations must be positive" << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	std::vector<std::string> files(argv + optind, argv + argc);
+	if (files.empty() && recordStores.empty())
+		files = DefaultImageFiles;
+
+	std::vector<BenchmarkImage> images;
+	try {
+		for (const auto &f : files)
+			for (const auto &fileImage : readFileImages(f))
+				images.push_back({fileImage.name,
+				    fileImage.image});
+		for (const auto &rs : recordStores)
+			addRecordStore(rs, images);
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Could not load images: " << e.what() <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	std::ofstream file;
+	if (!output.empty()) {
+		file.open(output);
+		if (!file) {
+			std::cerr << "Could not open " << output << std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	std::ostream &out = output.empty() ? std::cout : file;
+
+	printHeader(out);
+	int status = EXIT_SUCCESS;
+	for (const auto &image : images) {
+		if (image.image->getResolution().toUnits(
+		    BE::Image::Resolution::Units::PPI).xRes <
+		    minimumResolution)
+			continue;
+
+		try {
+			benchmarkImage(image, iterations, out);
+		} catch (BE::Error::Exception &e) {
+			std::cerr << image.name << ": " << e.what() <<
+			    std::endl;
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return (status);
+}
@@ -8,6 +8,7 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <map>
@@ -28,6 +29,8 @@ using namespace BiometricEvaluation::Framework::Enumeration;
 #include <be_image_raw.h>
 static const std::string imageType = "Raw";
 #elif defined BMPTEST
+#include <cstdio>
+
 #include <be_image_bmp.h>
 static const std::string imageType = "BMP";
 #elif defined JPEG2000TEST
@@ -49,8 +52,23 @@ static const std::string imageType = "NetPBM";
 #include <be_image_png.h>
 static const std::string imageType = "PNG";
 #elif defined WSQTEST
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <be_data_interchange_an2k.h>
+#include <be_finger_an2kview_fixedres.h>
 #include <be_image_wsq.h>
 static const std::string imageType = "WSQ";
+
+/* Reference decoder, from NBIS */
+extern "C" {
+	int wsq_decode_mem(unsigned char **, int *, int *, int *, int *,
+	    int *, unsigned char *, const int);
+}
 #elif defined TIFFTEST
 #include <be_image_tiff.h>
 static const std::string imageType = "TIFF";
@@ -281,11 +299,630 @@ compareProperties(
 		cout << "\t>> All Properties Validated" << endl;
 }
 
+/**
+ * @brief
+ * Compare decodeInto() output with getRawData()/getRawGrayscaleData().
+ *
+ * @param image
+ *	The Image to decode.
+ * @param decoded
+ *	Buffer reused between images, grown as needed.
+ *
+ * @return
+ *	true if decodeInto() produced equivalent pixels, false otherwise.
+ *
+ * @notes
+ * Writes errors to stderr.
+ */
+static bool
+checkDecodeInto(
+    shared_ptr<Image::Image> image,
+    Memory::uint8Array &decoded)
+{
+	const uint32_t width = image->getDimensions().xSize;
+	const uint32_t height = image->getDimensions().ySize;
+
+	/* Pad rows to exercise the stride */
+	static const uint64_t padding = 13;
+	const uint64_t grayStride = image->getDecodedRowSize(
+	    Image::PixelFormat::Gray8) + padding;
+	const uint64_t rgbStride = image->getDecodedRowSize(
+	    Image::PixelFormat::RGB24) + padding;
+	if (decoded.size() < (rgbStride * height))
+		decoded.resize(rgbStride * height);
+
+	/* Libraries may round the color conversion differently */
+	const Memory::uint8Array rawGray{image->getRawGrayscaleData(8)};
+	image->decodeInto(decoded, grayStride, Image::PixelFormat::Gray8);
+	for (uint32_t row = 0; row < height; row++) {
+		for (uint32_t col = 0; col < width; col++) {
+			if (abs(decoded[(row * grayStride) + col] -
+			    rawGray[(row * width) + col]) > 1) {
+				cerr << "\t*** Gray8 decodeInto differs at (" <<
+				    col << ", " << row << ")" << endl;
+				return (false);
+			}
+		}
+	}
+
+	if ((image->getBitDepth() != 8) || ((image->getColorDepth() != 8) &&
+	    (image->getColorDepth() != 24)))
+		return (true);
+	const uint8_t components = image->getColorDepth() / 8;
+	const Memory::uint8Array raw{image->getRawData()};
+	image->decodeInto(decoded, rgbStride, Image::PixelFormat::RGB24);
+	for (uint32_t row = 0; row < height; row++) {
+		for (uint64_t i = 0; i < (width * 3); i++) {
+			if (decoded[(row * rgbStride) + i] != raw[(((row *
+			    width) + (i / 3)) * components) +
+			    ((components == 3) ? (i % 3) : 0)]) {
+				cerr << "\t*** RGB24 decodeInto differs at (" <<
+				    (i / 3) << ", " << row << ")" << endl;
+				return (false);
+			}
+		}
+	}
+
+	return (true);
+}
+
+#if defined PNGTEST || defined JPEG2000LTEST || defined WSQTEST
+#if defined PNGTEST
+static const Image::CompressionAlgorithm encodedAlgorithm =
+    Image::CompressionAlgorithm::PNG;
+#elif defined JPEG2000LTEST
+static const Image::CompressionAlgorithm encodedAlgorithm =
+    Image::CompressionAlgorithm::JP2;
+#else
+static const Image::CompressionAlgorithm encodedAlgorithm =
+    Image::CompressionAlgorithm::WSQ20;
+#endif
+
+/**
+ * @brief
+ * Check that decoding an encoded image yields the encoded image's
+ * dimensions, depths, and resolution.
+ *
+ * @param key
+ *	Name of the image, for messages.
+ * @param encoded
+ *	Encoded image.
+ * @param dimensions
+ *	Dimensions that were encoded.
+ * @param colorDepth
+ *	Bits per pixel that were encoded.
+ * @param bitDepth
+ *	Bits per component that were encoded.
+ * @param resolution
+ *	Resolution that was encoded.
+ *
+ * @return
+ *	The decoded image, or nullptr if it differs from what was encoded.
+ *
+ * @notes
+ * Writes errors to stderr.
+ */
+static shared_ptr<Image::Image>
+checkEncodedImage(
+    const std::string &key,
+    const Memory::uint8Array &encoded,
+    const Image::Size &dimensions,
+    uint32_t colorDepth,
+    uint16_t bitDepth,
+    const Image::Resolution &resolution)
+{
+	const shared_ptr<Image::Image> image = Image::Image::openImage(
+	    encoded);
+	if (image->getCompressionAlgorithm() != encodedAlgorithm) {
+		cerr << "\t*** " << key << " opened as " <<
+		    to_string(image->getCompressionAlgorithm()) << endl;
+		return (nullptr);
+	}
+	if ((image->getDimensions() != dimensions) ||
+	    (image->getColorDepth() != colorDepth) ||
+	    (image->getBitDepth() != bitDepth)) {
+		cerr << "\t*** " << key << " decoded as " <<
+		    image->getDimensions() << ", " <<
+		    image->getColorDepth() << "/" << image->getBitDepth() <<
+		    " bits" << endl;
+		return (nullptr);
+	}
+
+	/* Some formats store resolution in other units */
+	const Image::Resolution decoded = image->getResolution().toUnits(
+	    resolution.units);
+	if ((abs(decoded.xRes - resolution.xRes) > 0.01) ||
+	    (abs(decoded.yRes - resolution.yRes) > 0.01)) {
+		cerr << "\t*** " << key << " decoded with resolution " <<
+		    image->getResolution() << endl;
+		return (nullptr);
+	}
+
+	return (image);
+}
+
+/**
+ * @brief
+ * Encode synthetic pixels, and check the image that decoding them yields.
+ *
+ * @return
+ *	true if every encoded image decoded as expected, false otherwise.
+ *
+ * @notes
+ * Writes success to stdout and errors to stderr.
+ */
+static bool
+checkEncode()
+{
+	/* Odd dimensions exercise rows that are not a multiple of 8 */
+	const Image::Size dimensions(167, 131);
+	const Image::Resolution resolution(500, 500,
+	    Image::Resolution::Units::PPI);
+	bool success = true;
+
+#if defined WSQTEST
+	Memory::uint8Array raw(dimensions.xSize * dimensions.ySize);
+	for (uint32_t row = 0; row < dimensions.ySize; row++)
+		for (uint32_t col = 0; col < dimensions.xSize; col++)
+			raw[(row * dimensions.xSize) + col] =
+			    static_cast<uint8_t>(128 + ((col % 32) * 2) -
+			    ((row % 16) * 3));
+
+	const std::string key = "Encoded 8-bit grayscale";
+	try {
+		if (checkEncodedImage(key, Image::WSQ::encode(raw, dimensions,
+		    resolution), dimensions, 8, 8, resolution) != nullptr)
+			cout << key << ": Matches" << endl;
+		else
+			success = false;
+	} catch (Error::Exception &e) {
+		cerr << "Error encoding " << key << endl;
+		cerr << e.whatString() << endl;
+		success = false;
+	}
+#else
+	/* Gray, gray with alpha, RGB, and RGBA, with 8- and 16-bit samples */
+	for (uint16_t bitDepth : {8, 16}) {
+		for (uint32_t components = 1; components <= 4; components++) {
+			const uint32_t colorDepth = components * bitDepth;
+			Memory::uint8Array raw(dimensions.xSize *
+			    dimensions.ySize * (colorDepth / 8));
+			for (uint64_t i = 0; i < raw.size(); i++)
+				raw[i] = static_cast<uint8_t>((i * 7) +
+				    (i / dimensions.xSize));
+
+			const std::string key = "Encoded " +
+			    std::to_string(colorDepth) + "-bit (" +
+			    std::to_string(bitDepth) + " bits/component)";
+			try {
+#if defined PNGTEST
+				const Memory::uint8Array encoded =
+				    Image::PNG::encode(raw, dimensions,
+				    colorDepth, bitDepth, resolution);
+#else
+				const Memory::uint8Array encoded =
+				    Image::JPEG2000::encode(raw, dimensions,
+				    colorDepth, bitDepth, resolution);
+#endif
+				const shared_ptr<Image::Image> image =
+				    checkEncodedImage(key, encoded, dimensions,
+				    colorDepth, bitDepth, resolution);
+				if (image == nullptr) {
+					success = false;
+					continue;
+				}
+
+				/* Lossless encoding must keep every sample */
+				if (image->getRawData() == raw)
+					cout << key << ": Matches" << endl;
+				else {
+					cerr << "\t*** " << key << " pixels "
+					    "differ" << endl;
+					success = false;
+				}
+			} catch (Error::Exception &e) {
+				cerr << "Error encoding " << key << endl;
+				cerr << e.whatString() << endl;
+				success = false;
+			}
+		}
+	}
+#endif
+
+	return (success);
+}
+#endif
+
+#if defined JPEG2000LTEST
+/**
+ * @brief
+ * Check that a lossless JPEG2000 image of synthetic pixels decodes to
+ * the pixels that were encoded.
+ *
+ * @param dimensions
+ *	Dimensions of the image.
+ * @param components
+ *	Number of components per pixel.
+ * @param bitDepth
+ *	Bits per component.
+ *
+ * @return
+ *	true if the image decoded to what was encoded, false otherwise.
+ *
+ * @notes
+ * Writes errors to stderr.
+ */
+static bool
+checkPackedImage(
+    const Image::Size &dimensions,
+    uint32_t components,
+    uint16_t bitDepth)
+{
+	const uint32_t colorDepth = components * bitDepth;
+	const std::string key = std::to_string(dimensions.xSize) + "x" +
+	    std::to_string(dimensions.ySize) + " " +
+	    std::to_string(colorDepth) + "-bit (" +
+	    std::to_string(bitDepth) + " bits/component)";
+
+	/* Samples cover the whole range of the bit depth */
+	Memory::uint8Array raw(dimensions.xSize * dimensions.ySize *
+	    (colorDepth / 8));
+	for (uint64_t i = 0; i < raw.size(); i++)
+		raw[i] = static_cast<uint8_t>((i * 2654435761U) >> 13);
+
+	try {
+		const Memory::uint8Array encoded = Image::JPEG2000::encode(raw,
+		    dimensions, colorDepth, bitDepth, Image::Resolution(0, 0,
+		    Image::Resolution::Units::NA));
+		if (Image::Image::openImage(encoded)->getRawData() != raw) {
+			cerr << "\t*** " << key << " unpacked incorrectly" <<
+			    endl;
+			return (false);
+		}
+	} catch (Error::Exception &e) {
+		cerr << "Error encoding " << key << endl;
+		cerr << e.whatString() << endl;
+		return (false);
+	}
+
+	return (true);
+}
+
+/**
+ * @brief
+ * Check that decoding interleaves component samples correctly for every
+ * number of samples left over after the vectorized part of unpacking.
+ *
+ * @details
+ * Decoded samples are unpacked up to 16 at a time, so small images of
+ * every width up to 40 cover each vectorized kernel and its scalar tail.
+ *
+ * @return
+ *	true if every image decoded to what was encoded, false otherwise.
+ *
+ * @notes
+ * Writes success to stdout and errors to stderr.
+ */
+static bool
+checkPackedComponents()
+{
+	bool success = true;
+	for (uint16_t bitDepth : {8, 16})
+		for (uint32_t components = 1; components <= 4; components++)
+			for (uint32_t width = 1; width <= 40; width++)
+				for (uint32_t height = 1; height <= 2; height++)
+					if (!checkPackedImage(Image::Size(width,
+					    height), components, bitDepth))
+						success = false;
+
+	if (success)
+		cout << "Unpacking components of every width: Matches" << endl;
+	return (success);
+}
+#endif
+
+#if defined WSQTEST
+/**
+ * @brief
+ * Check that a WSQ image decodes to the same pixels as it does with the
+ * NBIS decoder, with one and with several threads.
+ *
+ * @param key
+ *	Name of the image, for messages.
+ * @param image
+ *	WSQ image to check.
+ *
+ * @return
+ *	true if the pixels are identical, false otherwise.
+ *
+ * @notes
+ * Writes success to stdout and errors to stderr.
+ */
+static bool
+checkLibwsqDecode(
+    const std::string &key,
+    const shared_ptr<Image::Image> &image)
+{
+	unsigned char *reference = nullptr;
+	int width, height, depth, ppi, lossy;
+	Memory::uint8Array data{image->getData()};
+	if (wsq_decode_mem(&reference, &width, &height, &depth, &ppi, &lossy,
+	    data, data.size()) != 0) {
+		cerr << "\t*** libwsq could not decode " << key << endl;
+		return (false);
+	}
+	const uint64_t size = static_cast<uint64_t>(width) * height;
+
+	bool identical = true;
+	for (uint32_t threads : {1, 4}) {
+		image->setDecodeThreadCount(threads);
+		const Memory::uint8Array raw{image->getRawData()};
+		if ((raw.size() != size) ||
+		    (memcmp(raw, reference, size) != 0)) {
+			cerr << "\t*** " << key << " differs from libwsq "
+			    "with " << threads << " thread(s)" << endl;
+			identical = false;
+		}
+	}
+	image->setDecodeThreadCount(0);
+	free(reference);
+
+	if (identical)
+		cout << key << ": Matches libwsq" << endl;
+	return (identical);
+}
+
+/**
+ * @brief
+ * Check every WSQ image in the test data, alone or within an ANSI/NIST
+ * record, against the NBIS decoder.
+ *
+ * @return
+ *	true if every image matches, false otherwise.
+ */
+static bool
+checkLibwsqDecodes()
+{
+	DIR *dir = opendir(RSParentDir.c_str());
+	if (dir == nullptr) {
+		cerr << "Could not open " << RSParentDir << endl;
+		return (false);
+	}
+	vector<std::string> names;
+	for (struct dirent *entry = readdir(dir); entry != nullptr;
+	    entry = readdir(dir))
+		names.push_back(entry->d_name);
+	closedir(dir);
+	sort(names.begin(), names.end());
+
+	bool success = true;
+	unsigned int checked = 0;
+	for (const auto &name : names) {
+		const std::string path = RSParentDir + '/' + name;
+		struct stat sb;
+		if ((stat(path.c_str(), &sb) != 0) || !S_ISREG(sb.st_mode))
+			continue;
+
+		/* Images that stand alone, or that an AN2K record holds */
+		vector<pair<std::string, shared_ptr<Image::Image>>> images;
+		try {
+			Memory::uint8Array data = IO::Utility::readFile(
+			    path);
+			if (Image::WSQ::isWSQ(data, data.size())) {
+				images.emplace_back(path, make_shared<
+				    Image::WSQ>(data));
+			} else if ((name.size() > 5) && (name.compare(
+			    name.size() - 5, 5, ".an2k") == 0)) {
+				const DataInterchange::AN2KRecord an2k(data);
+				for (const auto &capture :
+				    an2k.getFingerCaptures())
+					images.emplace_back(path,
+					    capture.getImage());
+				for (const auto &latent :
+				    an2k.getFingerLatents())
+					images.emplace_back(path,
+					    latent.getImage());
+				for (uint32_t record = 1; ; record++) {
+					try {
+						images.emplace_back(path,
+						    Finger::
+						    AN2KViewFixedResolution(
+						    data, View::AN2KView::
+						    RecordType::Type_4,
+						    record).getImage());
+					} catch (Error::DataError &e) {
+						break;
+					}
+				}
+			}
+		} catch (Error::Exception &e) {
+			/* Not an image */
+			continue;
+		}
+
+		for (size_t i = 0; i < images.size(); i++) {
+			if ((images[i].second == nullptr) ||
+			    (images[i].second->getCompressionAlgorithm() !=
+			    Image::CompressionAlgorithm::WSQ20))
+				continue;
+			checked++;
+			try {
+				if (!checkLibwsqDecode(images[i].first +
+				    (images.size() > 1 ? "#" + std::to_string(
+				    i) : ""), images[i].second))
+					success = false;
+			} catch (Error::Exception &e) {
+				cerr << "Error decoding " << images[i].first <<
+				    endl;
+				cerr << e.whatString() << endl;
+				success = false;
+			}
+		}
+	}
+
+	if (checked == 0) {
+		cerr << "No WSQ images found in " << RSParentDir << endl;
+		return (false);
+	}
+	return (success);
+}
+#endif
+
+#if defined BMPTEST
+/**
+ * @brief
+ * Create an 8-bit paletted BMP.
+ *
+ * @param dimensions
+ *	Dimensions of the image.
+ * @param gray
+ *	Whether every palette entry is a shade of gray.
+ *
+ * @return
+ *	BMP-encoded image, whose header and palette occupy 1078 bytes.
+ */
+static Memory::uint8Array
+makePalettedBMP(
+    const Image::Size &dimensions,
+    bool gray)
+{
+	static const uint32_t HeaderSize = 14 + 40 + (256 * 4);
+	const uint32_t stride = ((dimensions.xSize + 3) / 4) * 4;
+	const uint32_t size = HeaderSize + (stride * dimensions.ySize);
+
+	Memory::uint8Array bmp(size);
+	std::fill(bmp.begin(), bmp.end(), 0);
+	const auto put = [&](uint32_t offset, uint32_t value, uint8_t bytes) {
+		for (uint8_t i = 0; i < bytes; i++)
+			bmp[offset + i] = (value >> (8 * i)) & 0xFF;
+	};
+
+	/* BMP header */
+	bmp[0] = 'B';
+	bmp[1] = 'M';
+	put(2, size, 4);
+	put(10, HeaderSize, 4);
+
+	/* BITMAPINFOHEADER, uncompressed, 500 PPI */
+	put(14, 40, 4);
+	put(18, dimensions.xSize, 4);
+	put(22, dimensions.ySize, 4);
+	put(26, 1, 2);
+	put(28, 8, 2);
+	put(34, stride * dimensions.ySize, 4);
+	put(38, 19685, 4);
+	put(42, 19685, 4);
+
+	/* Palette (BGR and reserved), colored only at the end if at all */
+	for (uint32_t entry = 0; entry < 256; entry++) {
+		bmp[54 + (entry * 4)] = entry;
+		bmp[54 + (entry * 4) + 1] = entry;
+		bmp[54 + (entry * 4) + 2] = ((entry == 255) && !gray) ?
+		    0 : entry;
+	}
+
+	for (uint32_t i = HeaderSize; i < size; i++)
+		bmp[i] = i * 7;
+
+	return (bmp);
+}
+
+/**
+ * @brief
+ * Check that probing paletted BMPs from prefixes that end within the
+ * palette reports the same properties as opening the complete image.
+ *
+ * @return
+ *	true if every probe matches, false otherwise.
+ *
+ * @notes
+ * Writes success to stdout and errors to stderr.
+ */
+static bool
+checkProbePalette()
+{
+	bool success = true;
+	for (const bool gray : {true, false}) {
+		const Memory::uint8Array bmp = makePalettedBMP(
+		    Image::Size(37, 11), gray);
+		const Image::BMP image(bmp);
+		const std::string key = std::string(gray ? "Gray" : "Color") +
+		    " paletted BMP";
+		if (image.getColorDepth() != (gray ? 8U : 24U)) {
+			cerr << "\t*** " << key << " has color depth " <<
+			    image.getColorDepth() << endl;
+			success = false;
+			continue;
+		}
+
+		std::string path;
+		try {
+			path = IO::Utility::createTemporaryFile("probe", ".");
+			IO::Utility::writeFile(bmp, path, ios_base::trunc);
+		} catch (Error::Exception &e) {
+			cerr << "\t*** Could not write " << key << ": " <<
+			    e.whatString() << endl;
+			return (false);
+		}
+
+		for (const uint64_t prefixSize : {uint64_t(54), uint64_t(55),
+		    uint64_t(256), uint64_t(1077), uint64_t(1078),
+		    Image::DefaultProbeSize}) {
+			try {
+				const Image::Metadata metadata =
+				    Image::Image::probe(path, prefixSize);
+				if ((metadata.compressionAlgorithm !=
+				    Image::CompressionAlgorithm::BMP) ||
+				    (metadata.size != bmp.size()) ||
+				    (metadata.dimensions !=
+				    image.getDimensions()) ||
+				    (metadata.colorDepth !=
+				    image.getColorDepth()) ||
+				    (metadata.bitDepth != image.getBitDepth())) {
+					cerr << "\t*** " << key << " probed "
+					    "from " << prefixSize << " bytes "
+					    "differs" << endl;
+					success = false;
+				}
+			} catch (Error::Exception &e) {
+				cerr << "\t*** Could not probe " << key <<
+				    " from " << prefixSize << " bytes: " <<
+				    e.whatString() << endl;
+				success = false;
+			}
+		}
+		std::remove(path.c_str());
+	}
+
+	if (success)
+		cout << "Probing paletted BMP prefixes: Matches" << endl;
+	return (success);
+}
+#endif
+
 int
 main(
     int argc,
     char *argv[])
 {
+#if defined PNGTEST || defined JPEG2000LTEST || defined WSQTEST
+	/* Report every failed check before failing */
+	bool checked = checkEncode();
+#if defined WSQTEST
+	if (!checkLibwsqDecodes())
+		checked = false;
+#elif defined JPEG2000LTEST
+	if (!checkPackedComponents())
+		checked = false;
+#endif
+	if (!checked)
+		return (EXIT_FAILURE);
+#endif
+#if defined BMPTEST
+	if (!checkProbePalette())
+		return (EXIT_FAILURE);
+#endif
+
 	/* Define file extensions and which class should deal with each */
 	map<std::string, std::string> extensions;
 	extensions["bmp"] = "BMP";
@@ -329,6 +966,7 @@ main(
 
 	bool doPropertyCompare;
 	std::string rawKey, extension;
+	Memory::uint8Array decoded;
 	Memory::uint8Array propertyData;
 	shared_ptr<IO::Properties> properties;
 	IO::RecordStore::Record record;
@@ -460,14 +1098,56 @@ main(
 		    stringToResUnits(properties->getProperty("resUnits"))),
 		    properties->getPropertyAsBoolean("hasAlphaChannel")));
 #elif defined FACTORYTEST
-		image = Image::Image::openImage(record.data);
+		/* Hand the record to the Image instead of copying it */
+		image = Image::Image::openImage(std::move(record.data));
 #endif
 
 		/* Print all the metadata for the Image */
 		cout << record.key << ':' << endl;
 #if defined FACTORYTEST
 		cout << "\tCompression Algorithm: " <<
-		    to_string(Image::Image::getCompressionAlgorithm(record.data)) << endl;
+		    to_string(image->getCompressionAlgorithm()) << endl;
+
+		/* A known compression algorithm need not be detected */
+		try {
+			const auto hinted = Image::Image::openImage(
+			    image->getData(), image->getCompressionAlgorithm());
+			if ((hinted->getCompressionAlgorithm() ==
+			    image->getCompressionAlgorithm()) &&
+			    (hinted->getDimensions() == image->getDimensions()))
+				cout << "\tOpen with known compression: "
+				    "Matches" << endl;
+			else
+				cerr << "\t*** Open with known compression "
+				    "differs" << endl;
+		} catch (Error::Exception &e) {
+			cerr << "Error opening with known compression for " <<
+			    record.key << endl;
+			cerr << e.whatString() << endl;
+		}
+
+		/* Metadata is available without keeping the image data */
+		try {
+			const Image::Metadata metadata = Image::Image::probe(
+			    *imageRS, record.key, 256);
+			if ((metadata.compressionAlgorithm ==
+			    image->getCompressionAlgorithm()) &&
+			    (metadata.dimensions == image->getDimensions()) &&
+			    (metadata.resolution.xRes ==
+			    image->getResolution().xRes) &&
+			    (metadata.resolution.yRes ==
+			    image->getResolution().yRes) &&
+			    (metadata.colorDepth == image->getColorDepth()) &&
+			    (metadata.bitDepth == image->getBitDepth()) &&
+			    (metadata.hasAlphaChannel ==
+			    image->hasAlphaChannel()))
+				cout << "\tProbe: Matches" << endl;
+			else
+				cerr << "\t*** Probe differs" << endl;
+		} catch (Error::Exception &e) {
+			cerr << "Error probing " << record.key << endl;
+			cerr << e.whatString() << endl;
+		}
 #endif
 		Memory::uint8Array buf{image->getData()};
 		cout << "\tDimensions: " << image->getDimensions() << endl;
@@ -501,6 +1181,33 @@ main(
 			   "for " << record.key << endl;
 			cerr << e.whatString() << endl;
 		}
+
+		/* Decode into a buffer reused for every image */
+		try {
+			if (checkDecodeInto(image, decoded))
+				cout << "\tdecodeInto: Matches raw data" << endl;
+		} catch (Error::Exception &e) {
+			cerr << "Error decodeInto for " << record.key << endl;
+			cerr << e.whatString() << endl;
+		}
+
+		/* Decoding with more threads must not change pixels */
+		try {
+			image->setDecodeThreadCount(1);
+			const Memory::uint8Array single{image->getRawData()};
+			image->setDecodeThreadCount(4);
+			if (image->getRawData() == single)
+				cout << "\tMultithreaded decode: Matches" <<
+				    endl;
+			else
+				cerr << "\t*** Multithreaded decode "
+				    "differs" << endl;
+			image->setDecodeThreadCount(0);
+		} catch (Error::Exception &e) {
+			cerr << "Error multithreaded decode for " <<
+			    record.key << endl;
+			cerr << e.whatString() << endl;
+		}
 		
 		/* 
 		 * Compare all properties of the Image as parsed to those 
@@ -0,0 +1,405 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Check the quality of images resampled by each filter against known
+ * results, then time resampling images to 500 PPI at increasing thread
+ * counts, writing one line of comma-separated throughput results per
+ * (image, filter, threads) trial.
+ */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_image_resampler.h>
+#include <be_io_utility.h>
+#include <be_time_timer.h>
+
+#include "test_be_image_files.h"
+
+namespace BE = BiometricEvaluation;
+using namespace BE::Framework::Enumeration;
+
+static const std::string USAGE =
+    "[-n iterations] [-t threads] [-o file] [file ...]\n"
+    "\t-n\tNumber of times to resample each image (default: 10)\n"
+    "\t-t\tMaximum number of threads (default: all cores)\n"
+    "\t-o\tCSV results file (default: stdout)\n"
+    "\tfile\tImage or ANSI/NIST file (default: " +
+    DefaultImageFilesUsage + ")";
+
+static const BE::Image::ResampleFilter FILTERS[] = {
+    BE::Image::ResampleFilter::Box,
+    BE::Image::ResampleFilter::Bilinear,
+    BE::Image::ResampleFilter::Lanczos3
+};
+
+/** An image with packed rows */
+struct Pixels
+{
+	BE::Image::Size dimensions;
+	uint32_t channels;
+	std::vector<uint8_t> samples;
+};
+
+/**
+ * @brief
+ * Create an image whose samples are computed by a function.
+ */
+static Pixels
+makePixels(
+    uint32_t width,
+    uint32_t height,
+    uint32_t channels,
+    const std::function<double(uint32_t x, uint32_t y, uint32_t c)> &value)
+{
+	Pixels pixels{BE::Image::Size(width, height), channels, {}};
+	pixels.samples.resize(static_cast<uint64_t>(width) * height * channels);
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			for (uint32_t c = 0; c < channels; c++)
+				pixels.samples[((static_cast<uint64_t>(y) *
+				    width + x) * channels) + c] =
+				    static_cast<uint8_t>(std::lround(
+				    std::min(255.0, std::max(0.0,
+				    value(x, y, c)))));
+	return (pixels);
+}
+
+static Pixels
+resample(
+    const Pixels &input,
+    uint32_t width,
+    uint32_t height,
+    BE::Image::ResampleFilter filter,
+    uint32_t threads = 1)
+{
+	Pixels output{BE::Image::Size(width, height), input.channels, {}};
+	output.samples.resize(static_cast<uint64_t>(width) * height *
+	    input.channels);
+	BE::Image::Resampler(filter, threads).resample(input.samples.data(),
+	    input.dimensions, static_cast<uint64_t>(input.dimensions.xSize) *
+	    input.channels, output.samples.data(), output.dimensions,
+	    static_cast<uint64_t>(width) * input.channels,
+	    input.channels == 3 ? BE::Image::PixelFormat::RGB24 :
+	    BE::Image::PixelFormat::Gray8);
+	return (output);
+}
+
+/**
+ * @return
+ *	Largest difference between samples of a and b, ignoring margin
+ *	pixels at each edge.
+ */
+static int
+maxDifference(
+    const Pixels &a,
+    const Pixels &b,
+    uint32_t margin = 0)
+{
+	int difference = 0;
+	for (uint32_t y = margin; y + margin < a.dimensions.ySize; y++) {
+		for (uint32_t x = margin; x + margin < a.dimensions.xSize;
+		    x++) {
+			for (uint32_t c = 0; c < a.channels; c++) {
+				const uint64_t s = ((static_cast<uint64_t>(y) *
+				    a.dimensions.xSize + x) * a.channels) + c;
+				difference = std::max(difference, std::abs(
+				    a.samples[s] - b.samples[s]));
+			}
+		}
+	}
+	return (difference);
+}
+
+static bool
+report(
+    const std::string &test,
+    bool passed)
+{
+	std::cout << "Testing " << test << "... " << (passed ? "passed" :
+	    "FAILED") << std::endl;
+	return (passed);
+}
+
+/**
+ * @brief
+ * Compare resampled synthetic images with known results.
+ *
+ * @return
+ *	true if every check passed.
+ */
+static bool
+testQuality()
+{
+	bool passed = true;
+
+	/* Uniform images stay uniform, however they are scaled */
+	const Pixels gray = makePixels(101, 67, 1, [](uint32_t, uint32_t,
+	    uint32_t) { return (137); });
+	for (const auto filter : FILTERS) {
+		bool uniform = true;
+		for (const auto &size : {BE::Image::Size(50, 33),
+		    BE::Image::Size(13, 200), BE::Image::Size(1, 1),
+		    BE::Image::Size(303, 67)}) {
+			const Pixels output = resample(gray, size.xSize,
+			    size.ySize, filter);
+			for (const auto sample : output.samples)
+				if (sample != 137)
+					uniform = false;
+		}
+		passed &= report(to_string(filter) + " preserves uniform "
+		    "images", uniform);
+	}
+
+	/* Box reduction by 2 averages each 2x2 block */
+	const Pixels noise = makePixels(64, 48, 1, [](uint32_t x, uint32_t y,
+	    uint32_t) { return (((x * 7919) ^ (y * 104729)) % 256); });
+	const Pixels expected = makePixels(32, 24, 1, [&](uint32_t x,
+	    uint32_t y, uint32_t) {
+		const auto at = [&](uint32_t x, uint32_t y) {
+			return (noise.samples[(y * 64) + x]);
+		};
+		return ((at(2 * x, 2 * y) + at((2 * x) + 1, 2 * y) +
+		    at(2 * x, (2 * y) + 1) + at((2 * x) + 1, (2 * y) + 1)) /
+		    4.0);
+	});
+	passed &= report("Box reduction by 2", maxDifference(resample(noise,
+	    32, 24, BE::Image::ResampleFilter::Box), expected) <= 1);
+
+	/* Enlarging a ramp interpolates it, away from the edges */
+	const Pixels ramp = makePixels(40, 30, 1, [](uint32_t x, uint32_t y,
+	    uint32_t) { return ((x * 4) + (y * 2)); });
+	const Pixels largeRamp = makePixels(100, 75, 1, [](uint32_t x,
+	    uint32_t y, uint32_t) {
+		return ((((x + 0.5) / 2.5 - 0.5) * 4) +
+		    (((y + 0.5) / 2.5 - 0.5) * 2));
+	});
+	passed &= report("Bilinear enlargement of a ramp", maxDifference(
+	    resample(ramp, 100, 75, BE::Image::ResampleFilter::Bilinear),
+	    largeRamp, 3) <= 1);
+
+	/* Reducing and restoring a smooth image loses little */
+	const Pixels smooth = makePixels(256, 192, 1, [](uint32_t x,
+	    uint32_t y, uint32_t) {
+		return (128 + (60 * std::sin(x / 9.0)) +
+		    (60 * std::cos(y / 13.0)));
+	});
+	for (const auto filter : FILTERS) {
+		const Pixels restored = resample(resample(smooth, 128, 96,
+		    filter), 256, 192, filter);
+		double error = 0;
+		for (uint64_t s = 0; s < smooth.samples.size(); s++)
+			error += std::abs(smooth.samples[s] -
+			    restored.samples[s]);
+		error /= smooth.samples.size();
+		passed &= report(to_string(filter) + " reduction and "
+		    "enlargement by 2 (mean error " + std::to_string(error) +
+		    ")", error < 3);
+	}
+
+	/* RGB24 resamples each channel as Gray8 does */
+	const Pixels color = makePixels(90, 70, 3, [](uint32_t x, uint32_t y,
+	    uint32_t c) { return ((x * (c + 1) * 3) + (y * (3 - c))); });
+	for (const auto filter : FILTERS) {
+		const Pixels resampled = resample(color, 37, 101, filter);
+		bool same = true;
+		for (uint32_t c = 0; c < 3; c++) {
+			const Pixels channel = makePixels(90, 70, 1, [&](
+			    uint32_t x, uint32_t y, uint32_t) {
+				return (color.samples[(((y * 90) + x) * 3) +
+				    c]);
+			});
+			const Pixels expected = resample(channel, 37, 101,
+			    filter);
+			for (uint64_t s = 0; s < expected.samples.size(); s++)
+				if (expected.samples[s] !=
+				    resampled.samples[(s * 3) + c])
+					same = false;
+		}
+		passed &= report(to_string(filter) + " RGB24 matches Gray8",
+		    same);
+	}
+
+	/* Threads do not change the result */
+	const Pixels large = makePixels(1200, 1100, 1, [](uint32_t x,
+	    uint32_t y, uint32_t) { return ((x * 31 + y * 17) % 256); });
+	for (const auto filter : FILTERS) {
+		const Pixels single = resample(large, 731, 977, filter, 1);
+		bool same = true;
+		for (const uint32_t threads : {2U, 3U, 8U})
+			if (resample(large, 731, 977, filter,
+			    threads).samples != single.samples)
+				same = false;
+		passed &= report(to_string(filter) + " is independent of "
+		    "thread count", same);
+	}
+
+	/* Invalid arguments */
+	bool thrown = false;
+	try {
+		uint8_t pixel{0};
+		BE::Image::Resampler().resample(&pixel, {1, 1}, 1, &pixel,
+		    {1, 1}, 1, BE::Image::PixelFormat::MonoWhite);
+	} catch (BE::Error::ParameterError &e) {
+		thrown = true;
+	}
+	passed &= report("unsupported pixel format", thrown);
+
+	thrown = false;
+	try {
+		const BE::Memory::uint8Array data(100);
+		const BE::Image::Raw raw(data, {10, 10}, 8, 8, {500, 500,
+		    BE::Image::Resolution::Units::NA}, false);
+		BE::Image::Resampler().resample(raw, BE::Image::Resolution(
+		    500, 500, BE::Image::Resolution::Units::PPI));
+	} catch (BE::Error::StrategyError &e) {
+		thrown = true;
+	}
+	passed &= report("image of unknown resolution", thrown);
+
+	return (passed);
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	uint32_t iterations{10};
+	uint32_t maxThreads{std::max(1U, std::thread::hardware_concurrency())};
+	std::string output{};
+
+	int c;
+	while ((c = getopt(argc, argv, "n:t:o:")) != EOF) {
+		try {
+			switch (c) {
+			case 'n':
+				iterations = std::stoul(optarg);
+				break;
+			case 't':
+				maxThreads = std::stoul(optarg);
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			default:
+				std::cerr << "Usage: " << argv[0] << " " <<
+				    USAGE << std::endl;
+				return (EXIT_FAILURE);
+			}
+		} catch (std::exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	if ((iterations == 0) || (maxThreads == 0)) {
+		std::cerr << "Iterations and threads must be positive" <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	int status = testQuality() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	std::vector<std::shared_ptr<BE::Image::Image>> images;
+	try {
+		std::vector<std::string> files(argv + optind, argv + argc);
+		if (files.empty())
+			files = DefaultImageFiles;
+		for (const auto &f : files)
+			for (const auto &fileImage : readFileImages(f))
+				images.push_back(fileImage.image);
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Could not load images: " << e.what() << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	std::ofstream file;
+	if (!output.empty()) {
+		file.open(output);
+		if (!file) {
+			std::cerr << "Could not open " << output << std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	std::ostream &out = output.empty() ? std::cout : file;
+	out << "image,width,height,ppi,filter,threads,elapsed_us," <<
+	    "mpix_per_sec" << std::endl;
+
+	BE::Time::Timer timer;
+	for (uint64_t i = 0; i < images.size(); i++) {
+		/* Time resampling alone, not decoding */
+		const BE::Image::Size dimensions = images[i]->getDimensions();
+		BE::Image::Size outputDimensions;
+		double ppi;
+		BE::Memory::uint8Array pixels;
+		try {
+			ppi = images[i]->getResolution().toUnits(
+			    BE::Image::Resolution::Units::PPI).xRes;
+			outputDimensions = BE::Image::Resampler().resample(
+			    *images[i], BE::Image::Resolution(500, 500,
+			    BE::Image::Resolution::Units::PPI))->
+			    getDimensions();
+			pixels = images[i]->getRawGrayscaleData(8);
+		} catch (BE::Error::Exception &e) {
+			std::cerr << "Image " << i << ": " << e.what() <<
+			    std::endl;
+			status = EXIT_FAILURE;
+			continue;
+		}
+		BE::Memory::uint8Array resampled(
+		    static_cast<uint64_t>(outputDimensions.xSize) *
+		    outputDimensions.ySize);
+
+		for (const auto filter : FILTERS) {
+			for (uint32_t threads = 1; ; threads = std::min(
+			    threads * 2, maxThreads)) {
+				const BE::Image::Resampler resampler(filter,
+				    threads);
+				timer.start();
+				for (uint32_t n = 0; n < iterations; n++)
+					resampler.resample(pixels, dimensions,
+					    dimensions.xSize, resampled,
+					    outputDimensions,
+					    outputDimensions.xSize,
+					    BE::Image::PixelFormat::Gray8);
+				timer.stop();
+
+				const double seconds = timer.elapsed() /
+				    1000000.0 / iterations;
+				out << i << ',' << dimensions.xSize << ',' <<
+				    dimensions.ySize << ',' << ppi << ',' <<
+				    to_string(filter) << ',' << threads <<
+				    ',' << (timer.elapsed() / iterations) <<
+				    ',' << (seconds > 0 ? (dimensions.xSize *
+				    dimensions.ySize / 1000000.0) / seconds :
+				    0) << std::endl;
+
+				if (threads == maxThreads)
+					break;
+			}
+		}
+	}
+
+	return (status);
+}
@@ -1,7 +1,10 @@
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 
 #include <be_io_listrecstore.h>
+#include <be_io_utility.h>
 
 using namespace BiometricEvaluation;
 using namespace std;
@@ -119,6 +122,122 @@ int main(
 		return (8);
 	}
 
+	/*
+	 * Set cursor at an ordinal position.
+	 */
+	cout << "Set cursor at position 3, then sequence (B004.AN2)... ";
+	shared_ptr<IO::ListRecordStore> lrs =
+	    dynamic_pointer_cast<IO::ListRecordStore>(rs);
+	try {
+		lrs->setCursorAtPosition(3);
+		key = lrs->sequenceKey();
+	} catch (Error::Exception &e) {
+		cout << "FAIL: " << e.what() << endl;
+		return (10);
+	}
+	if (key == "B004.AN2")
+		cout << "SUCCESS" << endl;
+	else {
+		cout << "FAIL (" << key << ")" << endl;
+		return (11);
+	}
+
+	cout << "Set cursor past the last position... ";
+	try {
+		lrs->setCursorAtPosition(numRecords);
+		cout << "FAIL" << endl;
+		return (12);
+	} catch (Error::ObjectDoesNotExist &e) {
+		cout << "SUCCESS: " << e.what() << endl;
+	}
+
+	/*
+	 * Records read ahead match those read directly, including after
+	 * moving the cursor.
+	 */
+	cout << "Sequencing with read-ahead... ";
+	for (unsigned int depth : {IO::ListRecordStore::DEFAULT_PREFETCH_DEPTH,
+	    2U, 0U}) {
+		lrs->setPrefetchDepth(depth);
+		counter = 0;
+		try {
+			IO::RecordStore::Record rec = lrs->sequence(
+			    IO::RecordStore::BE_RECSTORE_SEQ_START);
+			for (;;) {
+				Memory::uint8Array direct = lrs->read(rec.key);
+				if ((direct.size() != rec.data.size()) ||
+				    !equal(direct.cbegin(), direct.cend(),
+				    rec.data.cbegin())) {
+					cout << "FAIL (" << rec.key << " differs)" <<
+					    endl;
+					return (13);
+				}
+				counter++;
+				if (counter == 2)
+					lrs->setCursorAtKey("B001.AN2");
+				rec = lrs->sequence();
+			}
+		} catch (Error::ObjectDoesNotExist) {
+			/* End of sequence */
+		} catch (Error::Exception &e) {
+			cout << "FAIL: " << e.what() << endl;
+			return (14);
+		}
+		if (counter != numRecords + 2) {
+			cout << "FAIL (" << counter << " records)" << endl;
+			return (15);
+		}
+	}
+	cout << "SUCCESS" << endl;
+
+	/*
+	 * The key list index is only cached on request, and is not used
+	 * once the key list changes.
+	 */
+	cout << "Opening did not cache the key list index... ";
+	if (IO::Utility::fileExists("test_data/listRecordStore/KeyList.index")) {
+		cout << "FAIL" << endl;
+		return (16);
+	}
+	cout << "SUCCESS" << endl;
+
+	cout << "Cached key list index is rebuilt after the list changes... ";
+	const string indexedRS = "listRecordStore_indexed";
+	try {
+		if (IO::Utility::fileExists(indexedRS))
+			IO::Utility::removeDirectory(indexedRS);
+		IO::Utility::makePath(indexedRS, S_IRWXU);
+		ofstream control(indexedRS + "/.rscontrol.prop");
+		control << "Type = List\nName = " << indexedRS << "\n"
+		    "Description = Key list index test\n"
+		    "Source Record Store = test_data/AN2KRecordStore\n"
+		    "Count = 5\n";
+		control.close();
+
+		/* Rewrite the list in place, without changing its size */
+		for (const char *first : {"B001.AN2", "B005.AN2"}) {
+			ofstream keyList(indexedRS + "/KeyList.txt");
+			keyList << first << "\nB002.AN2\nB003.AN2\n"
+			    "B004.AN2\n" << (first == string("B001.AN2") ?
+			    "B005.AN2" : "B001.AN2") << "\n";
+			keyList.close();
+
+			IO::ListRecordStore indexed(indexedRS);
+			indexed.setCursorAtPosition(0);
+			key = indexed.sequenceKey();
+			if (key != first) {
+				cout << "FAIL (" << key << ")" << endl;
+				return (17);
+			}
+			IO::ListRecordStore::indexKeyList(indexedRS);
+		}
+		IO::Utility::removeDirectory(indexedRS);
+	} catch (Error::Exception &e) {
+		cout << "FAIL: " << e.what() << endl;
+		return (18);
+	}
+	cout << "SUCCESS" << endl;
+
 	/*
 	 * Try the imvalid methods of a ListRecordStore
 	 */
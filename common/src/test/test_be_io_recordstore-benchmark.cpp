@@ -0,0 +1,528 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Benchmark the RecordStore implementations with a common set of
+ * workloads, writing one line of comma-separated results per
+ * (RecordStore kind, workload) pair so that results can be compared
+ * between releases.
+ */
+
+#include <sys/stat.h>
+#include <getopt.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_io_archiverecstore.h>
+#include <be_io_propertiesfile.h>
+#include <be_io_recordstore.h>
+#include <be_io_shardedarchiverecstore.h>
+#include <be_io_utility.h>
+#include <be_text.h>
+#include <be_time_timer.h>
+
+namespace BE = BiometricEvaluation;
+using namespace BE::Framework::Enumeration;
+
+static const std::string USAGE =
+    "[-k kind[,kind...]] [-n count] [-s size] [-d dir] [-o file] [-r seed]\n"
+    "\t-k\tRecordStore kinds (default: all)\n"
+    "\t-n\tNumber of records (default: 10000)\n"
+    "\t-s\tRecord size distribution (default: fixed:1024)\n"
+    "\t\t  fixed:<bytes>\n"
+    "\t\t  uniform:<min>:<max>\n"
+    "\t\t  normal:<mean>:<stddev>\n"
+    "\t-d\tDirectory in which to create RecordStores (default: .)\n"
+    "\t-o\tCSV results file (default: stdout)\n"
+    "\t-r\tRandom seed (default: 1)";
+
+/* ListRecordStore files, as created by rstool */
+static const std::string CONTROLFILENAME{".rscontrol.prop"};
+static const std::string KEYLISTFILENAME{"KeyList.txt"};
+static const std::string SOURCERECORDSTOREPROPERTY{"Source Record Store"};
+
+/** Options that apply to every kind of RecordStore benchmarked */
+struct BenchmarkOptions
+{
+	std::vector<BE::IO::RecordStore::Kind> kinds{
+	    BE::IO::RecordStore::Kind::Archive,
+	    BE::IO::RecordStore::Kind::BerkeleyDB,
+	    BE::IO::RecordStore::Kind::File,
+	    BE::IO::RecordStore::Kind::SQLite,
+	    BE::IO::RecordStore::Kind::Compressed,
+	    BE::IO::RecordStore::Kind::List,
+	    BE::IO::RecordStore::Kind::ShardedArchive};
+	uint64_t count{10000};
+	std::string distribution{"fixed:1024"};
+	std::string directory{"."};
+	std::string output{};
+	uint64_t seed{1};
+};
+
+/** Timings collected for a single workload */
+struct WorkloadResult
+{
+	std::string workload;
+	/** Latency of each operation, in nanoseconds */
+	std::vector<uint64_t> latencies;
+	/** Total payload bytes moved by the workload */
+	uint64_t bytes{0};
+	/** Wall-clock time for the entire workload, in microseconds */
+	uint64_t elapsed{0};
+};
+
+/**
+ * @brief
+ * Produce record sizes according to a textual distribution description.
+ */
+class SizeGenerator
+{
+public:
+	SizeGenerator(
+	    const std::string &description,
+	    std::mt19937_64 &engine) :
+	    _engine(engine)
+	{
+		const auto pieces = BE::Text::split(description, ':');
+		try {
+			if (pieces.size() == 2 && pieces[0] == "fixed") {
+				_kind = Kind::Fixed;
+				_a = std::stod(pieces[1]);
+			} else if (pieces.size() == 3 &&
+			    pieces[0] == "uniform") {
+				_kind = Kind::Uniform;
+				_a = std::stod(pieces[1]);
+				_b = std::stod(pieces[2]);
+			} else if (pieces.size() == 3 &&
+			    pieces[0] == "normal") {
+				_kind = Kind::Normal;
+				_a = std::stod(pieces[1]);
+				_b = std::stod(pieces[2]);
+			} else
+				throw BE::Error::ParameterError(description);
+		} catch (std::logic_error &) {
+			throw BE::Error::ParameterError(description);
+		}
+		if (_a < 0 || _b < 0 || (_kind == Kind::Uniform && _b < _a))
+			throw BE::Error::ParameterError(description);
+	}
+
+	uint64_t
+	next()
+	{
+		switch (_kind) {
+		case Kind::Fixed:
+			return (static_cast<uint64_t>(_a));
+		case Kind::Uniform:
+			return (std::uniform_int_distribution<uint64_t>(
+			    _a, _b)(_engine));
+		case Kind::Normal:
+			return (static_cast<uint64_t>(std::max(0.0,
+			    std::normal_distribution<double>(
+			    _a, _b)(_engine))));
+		}
+		return (0);
+	}
+
+	/** @return Largest size this generator is likely to produce */
+	uint64_t
+	maximum()
+	    const
+	{
+		switch (_kind) {
+		case Kind::Fixed:
+			return (static_cast<uint64_t>(_a));
+		case Kind::Uniform:
+			return (static_cast<uint64_t>(_b));
+		case Kind::Normal:
+			return (static_cast<uint64_t>(_a + (6 * _b)));
+		}
+		return (0);
+	}
+
+private:
+	enum class Kind { Fixed, Uniform, Normal };
+	Kind _kind{Kind::Fixed};
+	double _a{0};
+	double _b{0};
+	std::mt19937_64 &_engine;
+};
+
+static std::string
+keyName(
+    uint64_t i)
+{
+	return ("key" + std::to_string(i));
+}
+
+/**
+ * @brief
+ * Run one operation per key, recording the latency of each.
+ *
+ * @param name
+ *	Name of the workload.
+ * @param keys
+ *	Keys of the records to operate on, in operation order.
+ * @param op
+ *	Operation to perform, returning the number of payload bytes moved.
+ */
+static WorkloadResult
+timeWorkload(
+    const std::string &name,
+    const std::vector<uint64_t> &keys,
+    const std::function<uint64_t(uint64_t)> &op)
+{
+	WorkloadResult result;
+	result.workload = name;
+	result.latencies.reserve(keys.size());
+
+	BE::Time::Timer total, single;
+	total.start();
+	for (const auto &k : keys) {
+		single.start();
+		result.bytes += op(k);
+		single.stop();
+		result.latencies.push_back(single.elapsed(true));
+	}
+	total.stop();
+	result.elapsed = total.elapsed();
+
+	return (result);
+}
+
+/**
+ * @brief
+ * Time a sequential scan of the entire RecordStore via sequence().
+ */
+static WorkloadResult
+timeScan(
+    const std::shared_ptr<BE::IO::RecordStore> &rs)
+{
+	WorkloadResult result;
+	result.workload = "scan";
+	result.latencies.reserve(rs->getCount());
+
+	BE::Time::Timer total, single;
+	int cursor = BE::IO::RecordStore::BE_RECSTORE_SEQ_START;
+	total.start();
+	for (;;) {
+		single.start();
+		try {
+			result.bytes += rs->sequence(cursor).data.size();
+		} catch (BE::Error::ObjectDoesNotExist) {
+			single.stop();
+			break;
+		}
+		single.stop();
+		result.latencies.push_back(single.elapsed(true));
+		cursor = BE::IO::RecordStore::BE_RECSTORE_SEQ_NEXT;
+	}
+	total.stop();
+	result.elapsed = total.elapsed();
+
+	return (result);
+}
+
+/** @return The p-th percentile of sorted. */
+static uint64_t
+percentile(
+    const std::vector<uint64_t> &sorted,
+    double p)
+{
+	if (sorted.empty())
+		return (0);
+	const auto rank = static_cast<std::size_t>(
+	    (p / 100.0) * (sorted.size() - 1) + 0.5);
+	return (sorted[std::min(rank, sorted.size() - 1)]);
+}
+
+static void
+printHeader(
+    std::ostream &out)
+{
+	out << "kind,workload,records,operations,bytes,elapsed_us,ops_per_sec,"
+	    "mb_per_sec,lat_min_ns,lat_p50_ns,lat_p90_ns,lat_p99_ns,"
+	    "lat_p999_ns,lat_max_ns" << std::endl;
+}
+
+static void
+printResult(
+    std::ostream &out,
+    const std::string &kind,
+    uint64_t records,
+    WorkloadResult &result)
+{
+	std::sort(result.latencies.begin(), result.latencies.end());
+	const double seconds = result.elapsed / 1000000.0;
+	const auto ops = result.latencies.size();
+
+	out << kind << ',' << result.workload << ',' << records << ',' <<
+	    ops << ',' << result.bytes << ',' << result.elapsed << ',' <<
+	    (seconds > 0 ? ops / seconds : 0) << ',' <<
+	    (seconds > 0 ? (result.bytes / (1024.0 * 1024.0)) / seconds : 0) <<
+	    ',' << percentile(result.latencies, 0) << ',' <<
+	    percentile(result.latencies, 50) << ',' <<
+	    percentile(result.latencies, 90) << ',' <<
+	    percentile(result.latencies, 99) << ',' <<
+	    percentile(result.latencies, 99.9) << ',' <<
+	    percentile(result.latencies, 100) << std::endl;
+}
+
+/**
+ * @brief
+ * Create a ListRecordStore referencing every key in a source store.
+ * @details
+ * ListRecordStores cannot be created through the RecordStore factory,
+ * so the control and key list files are written directly, as rstool does.
+ */
+static std::shared_ptr<BE::IO::RecordStore>
+createListRecordStore(
+    const std::string &pathname,
+    const std::string &sourcePathname,
+    const std::vector<uint64_t> &keys)
+{
+	if (mkdir(pathname.c_str(), S_IRWXU | S_IRWXG | S_IRWXO) != 0)
+		throw BE::Error::StrategyError("Could not create " + pathname);
+
+	BE::IO::PropertiesFile props(pathname + '/' + CONTROLFILENAME,
+	    BE::IO::Mode::ReadWrite);
+	props.setPropertyFromInteger("Count", keys.size());
+	props.setProperty("Description", "RecordStore Benchmark");
+	props.setProperty("Type", to_string(BE::IO::RecordStore::Kind::List));
+	props.setProperty(SOURCERECORDSTOREPROPERTY, sourcePathname);
+	props.sync();
+
+	std::ofstream keyList(pathname + '/' + KEYLISTFILENAME);
+	for (const auto &k : keys)
+		keyList << keyName(k) << '\n';
+	keyList.close();
+	if (!keyList)
+		throw BE::Error::StrategyError("Could not write key list");
+
+	return (BE::IO::RecordStore::openRecordStore(pathname));
+}
+
+/**
+ * @brief
+ * Run all workloads against one kind of RecordStore.
+ */
+static void
+benchmarkKind(
+    const BenchmarkOptions &options,
+    BE::IO::RecordStore::Kind kind,
+    std::ostream &out)
+{
+	const std::string kindName = to_string(kind);
+	const std::string pathname = options.directory + "/rsbench_" +
+	    kindName;
+	const std::string sourcePathname = pathname + "_source";
+	for (const auto &p : {pathname, sourcePathname})
+		if (BE::IO::Utility::fileExists(p))
+			BE::IO::Utility::removeDirectory(p);
+
+	std::mt19937_64 engine(options.seed);
+	SizeGenerator sizes(options.distribution, engine);
+
+	/* Random payload, sliced to produce records of varying size */
+	BE::Memory::uint8Array payload(std::max<uint64_t>(sizes.maximum(), 1));
+	std::uniform_int_distribution<uint16_t> byte(0, 255);
+	for (uint64_t i = 0; i < payload.size(); i++)
+		payload[i] = static_cast<uint8_t>(byte(engine));
+	auto nextSize = [&]() -> uint64_t {
+		return (std::min<uint64_t>(sizes.next(), payload.size()));
+	};
+
+	std::vector<uint64_t> sequential(options.count);
+	for (uint64_t i = 0; i < options.count; i++)
+		sequential[i] = i;
+	std::vector<uint64_t> shuffled(sequential);
+	std::shuffle(shuffled.begin(), shuffled.end(), engine);
+
+	/*
+	 * ListRecordStores are read-only views of another RecordStore, so
+	 * populate an Archive source and only benchmark read workloads.
+	 */
+	const bool isList = (kind == BE::IO::RecordStore::Kind::List);
+	std::shared_ptr<BE::IO::RecordStore> rs;
+	if (isList) {
+		auto source = BE::IO::RecordStore::createRecordStore(
+		    sourcePathname, "RecordStore Benchmark",
+		    BE::IO::RecordStore::Kind::Archive);
+		for (const auto &k : sequential)
+			source->insert(keyName(k), payload, nextSize());
+		source->sync();
+		source.reset();
+		rs = createListRecordStore(pathname, sourcePathname,
+		    sequential);
+	} else {
+		rs = BE::IO::RecordStore::createRecordStore(pathname,
+		    "RecordStore Benchmark", kind);
+
+		WorkloadResult insert = timeWorkload("insert", sequential,
+		    [&](uint64_t k) -> uint64_t {
+			const uint64_t size = nextSize();
+			rs->insert(keyName(k), payload, size);
+			return (size);
+		});
+		rs->sync();
+		printResult(out, kindName, options.count, insert);
+	}
+
+	WorkloadResult read = timeWorkload("read", shuffled,
+	    [&](uint64_t k) -> uint64_t {
+		return (rs->read(keyName(k)).size());
+	});
+	printResult(out, kindName, options.count, read);
+
+	WorkloadResult scan = timeScan(rs);
+	printResult(out, kindName, options.count, scan);
+
+	if (!isList) {
+		WorkloadResult replace = timeWorkload("replace", shuffled,
+		    [&](uint64_t k) -> uint64_t {
+			const uint64_t size = nextSize();
+			rs->replace(keyName(k), payload, size);
+			return (size);
+		});
+		rs->sync();
+		printResult(out, kindName, options.count, replace);
+
+		/* Remove half of the records so vacuum() has work to do */
+		const std::vector<uint64_t> removals(shuffled.begin(),
+		    shuffled.begin() + (shuffled.size() / 2));
+		WorkloadResult remove = timeWorkload("remove", removals,
+		    [&](uint64_t k) -> uint64_t {
+			rs->remove(keyName(k));
+			return (0);
+		});
+		rs->sync();
+		printResult(out, kindName, options.count, remove);
+	}
+
+	/* Only archive-based RecordStores currently need to be vacuumed */
+	if ((kind == BE::IO::RecordStore::Kind::Archive) ||
+	    (kind == BE::IO::RecordStore::Kind::ShardedArchive)) {
+		rs.reset();
+		/* Size the store outside the timer so only vacuum() is timed */
+		const uint64_t before = BE::IO::Utility::sumDirectoryUsage(
+		    pathname);
+		WorkloadResult vacuum = timeWorkload("vacuum", {0},
+		    [&](uint64_t) -> uint64_t {
+			if (kind == BE::IO::RecordStore::Kind::Archive)
+				BE::IO::ArchiveRecordStore::vacuum(pathname);
+			else
+				BE::IO::ShardedArchiveRecordStore::vacuum(
+				    pathname);
+			return (before);
+		});
+		printResult(out, kindName, options.count, vacuum);
+	}
+
+	rs.reset();
+	for (const auto &p : {pathname, sourcePathname})
+		if (BE::IO::Utility::fileExists(p))
+			BE::IO::Utility::removeDirectory(p);
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	BenchmarkOptions options;
+
+	int c;
+	while ((c = getopt(argc, argv, "k:n:s:d:o:r:")) != EOF) {
+		try {
+			switch (c) {
+			case 'k':
+				options.kinds.clear();
+				for (const auto &k : BE::Text::split(
+				    optarg, ','))
+					options.kinds.push_back(to_enum<
+					    BE::IO::RecordStore::Kind>(k));
+				break;
+			case 'n':
+				options.count = std::stoull(optarg);
+				break;
+			case 's':
+				options.distribution = optarg;
+				break;
+			case 'd':
+				options.directory = optarg;
+				break;
+			case 'o':
+				options.output = optarg;
+				break;
+			case 'r':
+				options.seed = std::stoull(optarg);
+				break;
+			default:
+				std::cerr << "Usage: " << argv[0] << " " <<
+				    USAGE << std::endl;
+				return (EXIT_FAILURE);
+			}
+		} catch (BE::Error::Exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		} catch (std::exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+
+	/* Validate the size distribution before creating anything */
+	try {
+		std::mt19937_64 engine;
+		SizeGenerator(options.distribution, engine);
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Invalid size distribution: " << e.what() <<
+		    std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	std::ofstream file;
+	if (!options.output.empty()) {
+		file.open(options.output);
+		if (!file) {
+			std::cerr << "Could not open " << options.output <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+	std::ostream &out = options.output.empty() ? std::cout : file;
+
+	printHeader(out);
+	int status = EXIT_SUCCESS;
+	for (const auto &kind : options.kinds) {
+		try {
+			benchmarkKind(options, kind, out);
+		} catch (BE::Error::Exception &e) {
+			std::cerr << to_string(kind) << ": " << e.what() <<
+			    std::endl;
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return (status);
+}
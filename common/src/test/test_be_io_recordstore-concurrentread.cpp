@@ -0,0 +1,359 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+/*
+ * Stress concurrent readers of a single read-only RecordStore object,
+ * verifying every record read and reporting how read throughput scales
+ * with the number of reading threads.  Stores that lock for concurrent
+ * access are also read by many threads while another thread writes.
+ */
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <be_error_exception.h>
+#include <be_io_recordstore.h>
+#include <be_io_utility.h>
+#include <be_text.h>
+#include <be_time_timer.h>
+
+namespace BE = BiometricEvaluation;
+using namespace BE::Framework::Enumeration;
+
+static const std::string USAGE =
+    "[-k kind[,kind...]] [-n count] [-s size] [-t threads] [-p passes] "
+    "[-d dir]\n"
+    "\t-k\tRecordStore kinds (default: Archive,BerkeleyDB,ShardedArchive)\n"
+    "\t-n\tNumber of records (default: 20000)\n"
+    "\t-s\tRecord size in bytes (default: 4096)\n"
+    "\t-t\tMaximum number of reading threads (default: all cores)\n"
+    "\t-p\tReads of each record per trial (default: 4)\n"
+    "\t-d\tDirectory in which to create RecordStores (default: .)";
+
+static std::string
+keyName(
+    uint64_t index)
+{
+	return ("key" + std::to_string(index));
+}
+
+/*
+ * Fill a record with bytes derived from its index, so that a reader can
+ * verify it received the correct record in its entirety.
+ */
+static void
+fillRecord(
+    BE::Memory::uint8Array &data,
+    uint64_t index)
+{
+	for (uint64_t i = 0; i < data.size(); i++)
+		data[i] = static_cast<uint8_t>((index * 31) + i);
+}
+
+static bool
+verifyRecord(
+    const BE::Memory::uint8Array &data,
+    uint64_t index,
+    uint64_t size)
+{
+	if (data.size() != size)
+		return (false);
+	for (uint64_t i = 0; i < data.size(); i++)
+		if (data[i] != static_cast<uint8_t>((index * 31) + i))
+			return (false);
+	return (true);
+}
+
+/*
+ * Read and verify records of a ReadWrite rs from numThreads threads
+ * while another thread inserts records into it.
+ *
+ * @return
+ *	Number of incorrect reads.
+ */
+static uint64_t
+readWhileWriting(
+    const std::shared_ptr<BE::IO::RecordStore> &rs,
+    uint64_t first,
+    uint64_t count,
+    uint64_t size,
+    unsigned int numThreads)
+{
+	std::atomic<uint64_t> failures{0};
+	std::atomic<uint64_t> inserted{first};
+	std::atomic<bool> writing{true};
+
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < numThreads; t++) {
+		threads.emplace_back([&, t]() {
+			std::mt19937_64 engine(t);
+			while (writing) {
+				const uint64_t index = engine() % inserted;
+				const std::string key = keyName(index);
+				try {
+					/* Alternate whole and partial reads */
+					if ((index % 2) == 0) {
+						if (!verifyRecord(rs->read(
+						    key), index, size))
+							failures++;
+					} else {
+						if (!verifyRecord(
+						    rs->readPrefix(key,
+						    size / 2), index,
+						    size / 2))
+							failures++;
+					}
+					if (rs->length(key) != size)
+						failures++;
+				} catch (BE::Error::Exception &e) {
+					failures++;
+				}
+			}
+		});
+	}
+
+	/* Readers only choose records that were inserted before they look */
+	BE::Memory::uint8Array data(size);
+	try {
+		for (uint64_t i = first; i < count; i++) {
+			fillRecord(data, i);
+			rs->insert(keyName(i), data);
+			inserted = i + 1;
+		}
+	} catch (BE::Error::Exception &e) {
+		failures++;
+	}
+	writing = false;
+	for (auto &thread : threads)
+		thread.join();
+
+	return (failures);
+}
+
+/*
+ * Read every record passes times, in a shuffled order, split evenly
+ * between numThreads threads sharing rs.
+ *
+ * @return
+ *	Elapsed time in microseconds.
+ */
+static uint64_t
+timeReaders(
+    const std::shared_ptr<BE::IO::RecordStore> &rs,
+    const std::vector<uint64_t> &order,
+    unsigned int numThreads,
+    unsigned int passes,
+    uint64_t size,
+    std::atomic<uint64_t> &failures)
+{
+	std::vector<std::thread> threads;
+	BE::Time::Timer timer;
+
+	timer.start();
+	for (unsigned int t = 0; t < numThreads; t++) {
+		threads.emplace_back([&, t]() {
+			for (unsigned int p = 0; p < passes; p++) {
+				for (uint64_t i = t; i < order.size();
+				    i += numThreads) {
+					try {
+						if (!verifyRecord(rs->read(
+						    keyName(order[i])),
+						    order[i], size))
+							failures++;
+					} catch (BE::Error::Exception &e) {
+						failures++;
+					}
+				}
+			}
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+	timer.stop();
+
+	return (timer.elapsed());
+}
+
+static bool
+stressKind(
+    BE::IO::RecordStore::Kind kind,
+    uint64_t count,
+    uint64_t size,
+    unsigned int maxThreads,
+    unsigned int passes,
+    const std::string &directory)
+{
+	const std::string kindName = to_string(kind);
+	const std::string pathname = directory + "/concurrentread_" +
+	    kindName;
+	if (BE::IO::Utility::fileExists(pathname))
+		BE::IO::Utility::removeDirectory(pathname);
+
+	std::cout << kindName << ": inserting " << count << " records of " <<
+	    size << " bytes... " << std::flush;
+	{
+		auto rs = BE::IO::RecordStore::createRecordStore(pathname,
+		    "Concurrent read stress test", kind);
+		BE::Memory::uint8Array data(size);
+		for (uint64_t i = 0; i < count; i++) {
+			fillRecord(data, i);
+			rs->insert(keyName(i), data);
+		}
+		rs->sync();
+	}
+	std::cout << "done." << std::endl;
+
+	/* One store object is shared by all readers */
+	auto rs = BE::IO::RecordStore::openRecordStore(pathname,
+	    BE::IO::Mode::ReadOnly);
+
+	std::vector<uint64_t> order(count);
+	for (uint64_t i = 0; i < count; i++)
+		order[i] = i;
+	std::mt19937_64 engine(1);
+	std::shuffle(order.begin(), order.end(), engine);
+
+	/* Warm the page cache so that trials measure the store, not I/O */
+	std::atomic<uint64_t> failures{0};
+	(void)timeReaders(rs, order, 1, 1, size, failures);
+
+	std::cout << std::setw(8) << "threads" << std::setw(14) <<
+	    "reads/sec" << std::setw(10) << "speedup" << std::setw(12) <<
+	    "efficiency" << std::endl;
+	double baseline = 0;
+	for (unsigned int t = 1; t <= maxThreads; t *= 2) {
+		const uint64_t elapsed = timeReaders(rs, order, t, passes,
+		    size, failures);
+		const double rate = (static_cast<double>(count) * passes) /
+		    (std::max<uint64_t>(elapsed, 1) / 1000000.0);
+		if (t == 1)
+			baseline = rate;
+		std::cout << std::setw(8) << t << std::setw(14) <<
+		    static_cast<uint64_t>(rate) << std::setw(9) <<
+		    std::fixed << std::setprecision(2) << (rate / baseline) <<
+		    'x' << std::setw(11) << std::setprecision(0) <<
+		    (100 * rate / baseline / t) << '%' << std::endl;
+		if ((t < maxThreads) && ((t * 2) > maxThreads))
+			t = maxThreads / 2;
+	}
+
+	rs.reset();
+
+	/* Reopen for writing, and read what is written as it is written */
+	if ((kind == BE::IO::RecordStore::Kind::Archive) ||
+	    (kind == BE::IO::RecordStore::Kind::ShardedArchive)) {
+		rs = BE::IO::RecordStore::openRecordStore(pathname,
+		    BE::IO::Mode::ReadWrite);
+		const uint64_t rwFailures = readWhileWriting(rs, count,
+		    count + (count / 4), size, std::max(2U, maxThreads));
+		std::cout << kindName << ": " << (count / 4) << " inserts "
+		    "while reading, " << rwFailures << " incorrect reads." <<
+		    std::endl;
+		failures += rwFailures;
+		rs.reset();
+	}
+	BE::IO::Utility::removeDirectory(pathname);
+
+	if (failures != 0) {
+		std::cout << kindName << ": FAILED (" << failures <<
+		    " incorrect reads)." << std::endl;
+		return (false);
+	}
+	std::cout << kindName << ": all reads verified; success." <<
+	    std::endl << std::endl;
+	return (true);
+}
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	std::vector<BE::IO::RecordStore::Kind> kinds{
+	    BE::IO::RecordStore::Kind::Archive,
+	    BE::IO::RecordStore::Kind::BerkeleyDB,
+	    BE::IO::RecordStore::Kind::ShardedArchive};
+	uint64_t count = 20000;
+	uint64_t size = 4096;
+	unsigned int maxThreads = std::max(1U,
+	    std::thread::hardware_concurrency());
+	unsigned int passes = 4;
+	std::string directory = ".";
+
+	int c;
+	while ((c = getopt(argc, argv, "k:n:s:t:p:d:")) != EOF) {
+		try {
+			switch (c) {
+			case 'k':
+				kinds.clear();
+				for (const auto &k : BE::Text::split(
+				    optarg, ','))
+					kinds.push_back(to_enum<
+					    BE::IO::RecordStore::Kind>(k));
+				break;
+			case 'n':
+				count = std::stoull(optarg);
+				break;
+			case 's':
+				size = std::stoull(optarg);
+				break;
+			case 't':
+				maxThreads = std::max(1UL,
+				    std::stoul(optarg));
+				break;
+			case 'p':
+				passes = std::max(1UL, std::stoul(optarg));
+				break;
+			case 'd':
+				directory = optarg;
+				break;
+			default:
+				std::cerr << "Usage: " << argv[0] << " " <<
+				    USAGE << std::endl;
+				return (EXIT_FAILURE);
+			}
+		} catch (BE::Error::Exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		} catch (std::exception &e) {
+			std::cerr << "Invalid argument to -" <<
+			    static_cast<char>(c) << ": " << optarg <<
+			    std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+
+	int status = EXIT_SUCCESS;
+	for (const auto &kind : kinds) {
+		try {
+			if (!stressKind(kind, count, size, maxThreads, passes,
+			    directory))
+				status = EXIT_FAILURE;
+		} catch (BE::Error::Exception &e) {
+			std::cerr << to_string(kind) << ": " << e.what() <<
+			    std::endl;
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return (status);
+}
@@ -8,6 +8,7 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -15,12 +16,18 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include <be_io_utility.h>
 #include <be_memory_autoarrayutility.h>
 
 #ifdef FILERECORDSTORETEST
+#include <algorithm>
+#include <vector>
 #include <be_io_filerecstore.h>
 #define TESTDEFINED
 #define MERGETESTDEFINED
@@ -33,6 +40,7 @@
 #endif
 
 #ifdef ARCHIVERECORDSTORETEST
+#include <atomic>
 #include <be_io_archiverecstore.h>
 #define TESTDEFINED
 #define MERGETESTDEFINED
@@ -44,6 +52,23 @@
 #define MERGETESTDEFINED
 #endif
 
+#ifdef SHARDEDARCHIVERECORDSTORETEST
+#include <thread>
+#include <vector>
+#include <be_io_shardedarchiverecstore.h>
+#define TESTDEFINED
+#define MERGETESTDEFINED
+#endif
+
+#ifdef LOGSTRUCTUREDRECORDSTORETEST
+#include <dirent.h>
+#include <map>
+#include <vector>
+#include <be_io_logstructuredrecstore.h>
+#define TESTDEFINED
+#define MERGETESTDEFINED
+#endif
+
 #ifdef COMPRESSEDRECORDSTORETEST
 #include <be_io_compressedrecstore.h>
 #include <be_io_dbrecstore.h>
@@ -136,6 +161,271 @@ testIterator(
 	cout << "Record 3: " << it->key << endl;
 }
 
+/*
+ * Test that the record count survives a process that syncs a store and
+ * then stops without closing it.
+ */
+static int
+testCrashRecovery()
+{
+	unsigned int count;
+	try {
+		count = IO::RecordStore::openRecordStore(rsPath)->getCount();
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	const pid_t pid = fork();
+	if (pid == -1) {
+		cout << "FAILED (could not fork)." << endl;
+		return (-1);
+	}
+	if (pid == 0) {
+		/* Exit without running destructors, as a crash would */
+		try {
+			std::shared_ptr<IO::RecordStore> rs =
+			    IO::RecordStore::openRecordStore(rsPath,
+			    IO::Mode::ReadWrite);
+			for (int i = 0; i < 3; i++)
+				rs->insert("crash" + to_string(i), "crash", 6);
+			rs->sync();
+			_exit(EXIT_SUCCESS);
+		} catch (Error::Exception &e) {
+			_exit(EXIT_FAILURE);
+		}
+	}
+	int status;
+	if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) ||
+	    (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+		cout << "FAILED (child process failed)." << endl;
+		return (-1);
+	}
+
+	try {
+		std::shared_ptr<IO::RecordStore> rs =
+		    IO::RecordStore::openRecordStore(rsPath,
+		    IO::Mode::ReadWrite);
+		unsigned int sequenced = 0;
+		for (auto it = rs->begin(); it != rs->end(); it++)
+			sequenced++;
+		if ((rs->getCount() != count + 3) || (sequenced != count + 3)) {
+			cout << "FAILED (count is " << rs->getCount() << ", " <<
+			    sequenced << " records, expected " << count + 3 <<
+			    ")." << endl;
+			return (-1);
+		}
+		for (int i = 0; i < 3; i++)
+			rs->remove("crash" + to_string(i));
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	cout << "success." << endl;
+	return (0);
+}
+
+/*
+ * Test that an iterator reading ahead on another thread returns the same
+ * records as sequence(), and may be abandoned before the end.
+ */
+static int
+testPrefetchingIterator()
+{
+	try {
+		std::shared_ptr<IO::RecordStore> rs =
+		    IO::RecordStore::openRecordStore(rsPath);
+		vector<IO::RecordStore::Record> expected;
+		for (auto it = rs->begin(); it != rs->end(); it++)
+			expected.push_back(*it);
+
+		/* Small limits, so the reader thread must wait */
+		unsigned int i = 0;
+		for (auto it = rs->prefetchingBegin(2, 16); it != rs->end();
+		    it++, i++) {
+			if ((i >= expected.size()) ||
+			    (it->key != expected[i].key) ||
+			    (it->data.size() != expected[i].data.size()) ||
+			    !std::equal(it->data.cbegin(), it->data.cend(),
+			    expected[i].data.cbegin())) {
+				cout << "FAILED (record " << i << " differs)." <<
+				    endl;
+				return (-1);
+			}
+		}
+		if (i != expected.size()) {
+			cout << "FAILED (" << i << " records, expected " <<
+			    expected.size() << ")." << endl;
+			return (-1);
+		}
+
+		/* Stop early, then use the store normally */
+		if (expected.size() > 1) {
+			auto it = rs->prefetchingBegin();
+			it++;
+			if (it->key != expected[1].key) {
+				cout << "FAILED (wrong second record)." << endl;
+				return (-1);
+			}
+		}
+		if ((expected.size() > 0) &&
+		    (rs->sequence(IO::RecordStore::BE_RECSTORE_SEQ_START).key !=
+		    expected[0].key)) {
+			cout << "FAILED (sequence after abandoning)." << endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	cout << "success." << endl;
+	return (0);
+}
+
+/*
+ * Test that partitions sequenced on separate threads together hold every
+ * record of the store once, in sequence order.
+ */
+static int
+testPartitions()
+{
+	try {
+		std::shared_ptr<IO::RecordStore> rs =
+		    IO::RecordStore::openRecordStore(rsPath);
+		vector<IO::RecordStore::Record> expected;
+		for (auto it = rs->begin(); it != rs->end(); it++)
+			expected.push_back(*it);
+
+		bool caught = false;
+		try {
+			rs->partition(0);
+		} catch (Error::ParameterError) {
+			caught = true;
+		}
+		if (!caught) {
+			cout << "FAILED (0 partitions allowed)." << endl;
+			return (-1);
+		}
+
+		for (unsigned int count : {1u, 3u,
+		    static_cast<unsigned int>(expected.size() + 2)}) {
+			auto partitions = rs->partition(count);
+			if (partitions.size() != count) {
+				cout << "FAILED (" << partitions.size() <<
+				    " partitions, expected " << count << ")." <<
+				    endl;
+				return (-1);
+			}
+
+			vector<vector<IO::RecordStore::Record>> found(count);
+			vector<string> errors(count);
+			vector<std::thread> threads;
+			for (unsigned int i = 0; i < count; i++) {
+				threads.emplace_back([&, i]() {
+					try {
+						for (;;)
+							found[i].push_back(
+							    partitions[i]->
+							    sequence());
+					} catch (Error::ObjectDoesNotExist) {
+						/* End of partition */
+					} catch (Error::Exception &e) {
+						errors[i] = e.whatString();
+					}
+				});
+			}
+			for (auto &thread : threads)
+				thread.join();
+
+			vector<IO::RecordStore::Record> all;
+			for (unsigned int i = 0; i < count; i++) {
+				if (!errors[i].empty()) {
+					cout << "Caught " << errors[i] << endl;
+					return (-1);
+				}
+				all.insert(all.end(), found[i].begin(),
+				    found[i].end());
+			}
+			if (all.size() != expected.size()) {
+				cout << "FAILED (" << all.size() << " records "
+				    "in " << count << " partitions, expected " <<
+				    expected.size() << ")." << endl;
+				return (-1);
+			}
+			for (size_t i = 0; i < all.size(); i++) {
+				if ((all[i].key != expected[i].key) ||
+				    (all[i].data.size() !=
+				    expected[i].data.size()) ||
+				    !std::equal(all[i].data.cbegin(),
+				    all[i].data.cend(),
+				    expected[i].data.cbegin())) {
+					cout << "FAILED (record " << i << " of " <<
+					    count << " partitions differs)." <<
+					    endl;
+					return (-1);
+				}
+			}
+
+			/* Restarting a partition returns its first key */
+			if (!found[0].empty() && (partitions[0]->sequenceKey(
+			    IO::RecordStore::BE_RECSTORE_SEQ_START) !=
+			    found[0][0].key)) {
+				cout << "FAILED (could not restart)." << endl;
+				return (-1);
+			}
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	cout << "success." << endl;
+	return (0);
+}
+
+/*
+ * Test that opening and closing a store read/write without changing it
+ * does not rewrite its control file.
+ */
+static int
+testUnchangedClose()
+{
+	const string controlFile = rsPath + "/.rscontrol.prop";
+	struct stat before, after;
+	if (stat(controlFile.c_str(), &before) != 0) {
+		cout << "FAILED (could not stat control file)." << endl;
+		return (-1);
+	}
+
+	try {
+		std::shared_ptr<IO::RecordStore> rs =
+		    IO::RecordStore::openRecordStore(rsPath,
+		    IO::Mode::ReadWrite);
+		for (auto it = rs->begin(); it != rs->end(); it++)
+			(void)rs->length(it->key);
+		rs->sync();
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	if (stat(controlFile.c_str(), &after) != 0) {
+		cout << "FAILED (could not stat control file)." << endl;
+		return (-1);
+	}
+	/* The control file is replaced, not overwritten, when written */
+	if ((before.st_ino != after.st_ino) ||
+	    (before.st_mtime != after.st_mtime)) {
+		cout << "FAILED (control file was rewritten)." << endl;
+		return (-1);
+	}
+
+	cout << "success." << endl;
+	return (0);
+}
+
 #ifdef MERGETESTDEFINED
 /*
  * Test the ability to merge RecordStores of different types
@@ -186,6 +476,24 @@ testMerge()
 		    "RS for merge");
 		merge_rs[2] = new IO::SQLiteRecordStore(merge_rs_fn[2],
 		    "RS for merge");
+#endif
+#ifdef SHARDEDARCHIVERECORDSTORETEST
+		merged_type = IO::RecordStore::Kind::ShardedArchive;
+		merge_rs[0] = new IO::ShardedArchiveRecordStore(merge_rs_fn[0],
+		    "RS for merge");
+		merge_rs[1] = new IO::ShardedArchiveRecordStore(merge_rs_fn[1],
+		    "RS for merge");
+		merge_rs[2] = new IO::ShardedArchiveRecordStore(merge_rs_fn[2],
+		    "RS for merge");
+#endif
+#ifdef LOGSTRUCTUREDRECORDSTORETEST
+		merged_type = IO::RecordStore::Kind::LogStructured;
+		merge_rs[0] = new IO::LogStructuredRecordStore(merge_rs_fn[0],
+		    "RS for merge");
+		merge_rs[1] = new IO::LogStructuredRecordStore(merge_rs_fn[1],
+		    "RS for merge");
+		merge_rs[2] = new IO::LogStructuredRecordStore(merge_rs_fn[2],
+		    "RS for merge");
 #endif
 		Memory::uint8Array data(2);
 		data.copy((uint8_t *)"0", 2);
@@ -233,6 +541,14 @@ testMerge()
 #ifdef SQLITERECORDSTORETEST
 		merged_rs = new IO::SQLiteRecordStore(merged_rs_fn,
 		    IO::Mode::ReadWrite);
+#endif
+#ifdef SHARDEDARCHIVERECORDSTORETEST
+		merged_rs = new IO::ShardedArchiveRecordStore(merged_rs_fn,
+		    IO::Mode::ReadWrite);
+#endif
+#ifdef LOGSTRUCTUREDRECORDSTORETEST
+		merged_rs = new IO::LogStructuredRecordStore(merged_rs_fn,
+		    IO::Mode::ReadWrite);
 #endif
 		if (merged_rs->getCount() == (num_rs * 3))
 			cout << "success." << endl;
@@ -243,6 +559,45 @@ testMerge()
 			delete merged_rs; 
 			IO::RecordStore::removeRecordStore(merged_rs_fn);
 		}
+
+		cout << "Merging with a callback: ";
+		unsigned int callbacks = 0;
+		IO::RecordStore::mergeRecordStores(merged_rs_fn,
+		    "A merge of 3 RS", merged_type, path, nullptr,
+		    [&callbacks](const string &mergedKey,
+		    const string &sourceKey) {
+			if (mergedKey == sourceKey)
+				callbacks++;
+		    });
+		IO::RecordStore::removeRecordStore(merged_rs_fn);
+		if (callbacks == (num_rs * 3))
+			cout << "success." << endl;
+		else
+			cout << "FAILED (" << callbacks << " calls)." << endl;
+
+		cout << "Merging duplicate keys: ";
+		try {
+			IO::RecordStore::mergeRecordStores(merged_rs_fn,
+			    "A merge of duplicates", merged_type,
+			    {merge_rs_fn[0], merge_rs_fn[0]});
+			cout << "FAILED (no exception)." << endl;
+			IO::RecordStore::removeRecordStore(merged_rs_fn);
+		} catch (Error::ObjectExists &e) {
+#ifdef ARCHIVERECORDSTORETEST
+			/* Duplicates are found before anything is written */
+			if (IO::Utility::fileExists(merged_rs_fn)) {
+				cout << "FAILED (partial merge left)." << endl;
+				IO::RecordStore::removeRecordStore(
+				    merged_rs_fn);
+			} else
+				cout << "success." << endl;
+#else
+			cout << "success." << endl;
+			if (IO::Utility::fileExists(merged_rs_fn))
+				IO::RecordStore::removeRecordStore(
+				    merged_rs_fn);
+#endif
+		}
 		if (merge_rs[0] != nullptr) {
 			delete merge_rs[0];
 			IO::RecordStore::removeRecordStore(merge_rs_fn[0]);
@@ -261,6 +616,602 @@ testMerge()
 }
 #endif
 
+#ifdef ARCHIVERECORDSTORETEST
+/*
+ * Obtain the key stored at the start of a compaction test record, which
+ * may be followed by '.' and padding.
+ */
+static string
+compactedRecordKey(
+    const Memory::uint8Array &data)
+{
+	string value((char *)&data[0]);
+	return (value.substr(0, value.find('.')));
+}
+
+/*
+ * Check that every record of an ArchiveRecordStore holds its own key, and
+ * that the number of records is as expected.
+ */
+static bool
+verifyCompactedRecords(
+    IO::ArchiveRecordStore &rs,
+    unsigned int expected)
+{
+	unsigned int sequenced = 0;
+	try {
+		for (;;) {
+			IO::RecordStore::Record record = rs.sequence();
+			if (record.key != compactedRecordKey(record.data))
+				return (false);
+			sequenced++;
+		}
+	} catch (Error::ObjectDoesNotExist) {
+		/* End of sequence */
+	}
+	return ((sequenced == expected) && (rs.getCount() == expected));
+}
+
+/*
+ * Test reclaiming dead space from an open ArchiveRecordStore
+ */
+static int
+testCompaction()
+{
+	const string compactRSPath = "ars_compact_test";
+	const unsigned int numRecs = 1000;
+	unsigned int live = numRecs;
+
+	try {
+		IO::ArchiveRecordStore compactRS(compactRSPath,
+		    "Compaction test");
+		for (unsigned int i = 0; i < numRecs; i++) {
+			string key = "key" + to_string(i);
+			string value = key + "." + string(i % 97, 'x');
+			compactRS.insert(key, value.c_str(), value.size() + 1);
+		}
+
+		/* Remove or replace most records, leaving holes throughout */
+		for (unsigned int i = 0; i < numRecs; i++) {
+			string key = "key" + to_string(i);
+			if ((i % 3) == 0) {
+				compactRS.remove(key);
+				live--;
+			} else if ((i % 3) == 1) {
+				compactRS.replace(key, key.c_str(),
+				    key.size() + 1);
+			}
+		}
+		if (!compactRS.needsVacuum() ||
+		    (compactRS.getDeadSpace() == 0)) {
+			cout << "FAILED (no dead space)." << endl;
+			return (-1);
+		}
+
+		/* Read every record while compacting in small segments */
+		uint64_t callbacks = 0, reclaimed = 0;
+		compactRS.startCompaction(512,
+		    [&callbacks, &reclaimed](
+		    const IO::ArchiveRecordStore::CompactionProgress &p) {
+			callbacks++;
+			if (p.finished)
+				reclaimed = p.bytesReclaimed;
+		});
+		bool readFailed = false;
+		while (compactRS.isCompacting()) {
+			for (unsigned int i = 0; i < numRecs; i += 7) {
+				if ((i % 3) == 0)
+					continue;
+				string key = "key" + to_string(i);
+				Memory::uint8Array data = compactRS.read(key);
+				if (key != compactedRecordKey(data))
+					readFailed = true;
+			}
+		}
+		compactRS.waitForCompaction();
+		if (readFailed) {
+			cout << "FAILED (bad read during compaction)." << endl;
+			return (-1);
+		}
+		if ((callbacks < 2) || (reclaimed == 0) ||
+		    compactRS.needsVacuum() ||
+		    (compactRS.getDeadSpace() != 0)) {
+			cout << "FAILED (" << compactRS.getDeadSpace() <<
+			    " bytes still dead)." << endl;
+			return (-1);
+		}
+		if (!verifyCompactedRecords(compactRS, live)) {
+			cout << "FAILED (records differ after compaction)." <<
+			    endl;
+			return (-1);
+		}
+
+		/* The store must remain writable */
+		compactRS.insert("after", "after", 6);
+		live++;
+
+		/* Removing enough records triggers compaction */
+		std::atomic<unsigned int> autoCompactions{0};
+		compactRS.setAutoCompaction(0.25,
+		    IO::ArchiveRecordStore::DEFAULT_COMPACTION_SEGMENT_SIZE,
+		    [&autoCompactions](
+		    const IO::ArchiveRecordStore::CompactionProgress &p) {
+			if (p.finished)
+				autoCompactions++;
+		});
+		for (unsigned int i = 2; i < numRecs; i += 3) {
+			compactRS.remove("key" + to_string(i));
+			live--;
+		}
+		compactRS.waitForCompaction();
+		if (autoCompactions == 0) {
+			cout << "FAILED (automatic compaction did not run)." <<
+			    endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	try {
+		IO::ArchiveRecordStore reopenedRS(compactRSPath);
+		if (!verifyCompactedRecords(reopenedRS, live)) {
+			cout << "FAILED (records differ after reopen)." << endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	IO::RecordStore::removeRecordStore(compactRSPath);
+	cout << "success." << endl;
+	return (0);
+}
+
+/*
+ * Test opening an ArchiveRecordStore whose manifest ends with entries
+ * left by a process that stopped while writing.  Every entry in tail is
+ * to be discarded.
+ */
+static int
+testManifestRecovery(
+    const string &tail)
+{
+	const string recoveryRSPath = "ars_recovery_test";
+	const unsigned int numRecs = 10;
+
+	try {
+		IO::ArchiveRecordStore recoveryRS(recoveryRSPath,
+		    "Recovery test");
+		for (unsigned int i = 0; i < numRecs; i++) {
+			string key = "key" + to_string(i);
+			recoveryRS.insert(key, key.c_str(), key.size() + 1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	try {
+		IO::Utility::writeFile((const uint8_t *)tail.c_str(),
+		    tail.size(), recoveryRSPath + "/" +
+		    IO::ArchiveRecordStore::MANIFEST_FILE_NAME,
+		    std::ios_base::binary | std::ios_base::app);
+
+		IO::ArchiveRecordStore recoveryRS(recoveryRSPath,
+		    IO::Mode::ReadWrite);
+		if (!verifyCompactedRecords(recoveryRS, numRecs)) {
+			cout << "FAILED (records differ after recovery)." <<
+			    endl;
+			return (-1);
+		}
+		string key = "key" + to_string(numRecs);
+		recoveryRS.insert(key, key.c_str(), key.size() + 1);
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	try {
+		IO::ArchiveRecordStore recoveryRS(recoveryRSPath);
+		if (!verifyCompactedRecords(recoveryRS, numRecs + 1)) {
+			cout << "FAILED (records differ after reopening)." <<
+			    endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	IO::RecordStore::removeRecordStore(recoveryRSPath);
+	cout << "success." << endl;
+	return (0);
+}
+#endif
+
+#ifdef SHARDEDARCHIVERECORDSTORETEST
+/*
+ * Test inserting into a ShardedArchiveRecordStore from multiple threads
+ */
+static int
+testParallelInsert()
+{
+	const string parRSPath = "sars_par_test";
+	const unsigned int numThreads = 4;
+	const unsigned int numRecsPerThread = 250;
+
+	try {
+		IO::ShardedArchiveRecordStore parRS(parRSPath,
+		    "Parallel insert test", numThreads);
+
+		vector<std::thread> threads;
+		for (unsigned int t = 0; t < numThreads; t++) {
+			threads.emplace_back([&parRS, t, numRecsPerThread]() {
+				for (unsigned int i = 0; i < numRecsPerThread;
+				    i++) {
+					string key = "t" + to_string(t) + "_" +
+					    to_string(i);
+					parRS.insert(key, key.c_str(),
+					    key.size() + 1);
+				}
+			});
+		}
+		for (auto &thread : threads)
+			thread.join();
+
+		if (parRS.getCount() != (numThreads * numRecsPerThread)) {
+			cout << "FAILED (count is " << parRS.getCount() <<
+			    ")." << endl;
+			return (-1);
+		}
+
+		unsigned int sequenced = 0;
+		try {
+			for (;;) {
+				IO::RecordStore::Record record =
+				    parRS.sequence();
+				if (record.key != string((char *)&record.data[0])) {
+					cout << "FAILED (" << record.key <<
+					    " data mismatch)." << endl;
+					return (-1);
+				}
+				sequenced++;
+			}
+		} catch (Error::ObjectDoesNotExist) {
+			/* End of sequence */
+		}
+		if (sequenced != (numThreads * numRecsPerThread)) {
+			cout << "FAILED (sequenced " << sequenced << ")." <<
+			    endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	IO::RecordStore::removeRecordStore(parRSPath);
+	cout << "success." << endl;
+	return (0);
+}
+#endif
+
+#ifdef LOGSTRUCTUREDRECORDSTORETEST
+/*
+ * Check that a LogStructuredRecordStore holds exactly the expected records,
+ * sequenced in the order their keys were first inserted.
+ */
+static bool
+verifyLogRecords(
+    IO::LogStructuredRecordStore &rs,
+    const vector<string> &keys,
+    const std::map<string, string> &values)
+{
+	auto key = keys.cbegin();
+	int cursor = IO::RecordStore::BE_RECSTORE_SEQ_START;
+	try {
+		for (;;) {
+			IO::RecordStore::Record record = rs.sequence(cursor);
+			cursor = IO::RecordStore::BE_RECSTORE_SEQ_NEXT;
+			while ((key != keys.cend()) && (values.count(*key) == 0))
+				key++;
+			if ((key == keys.cend()) || (record.key != *key) ||
+			    (string((char *)&record.data[0]) !=
+			    values.at(*key)))
+				return (false);
+			key++;
+		}
+	} catch (Error::ObjectDoesNotExist) {
+		/* End of sequence */
+	}
+	while ((key != keys.cend()) && (values.count(*key) == 0))
+		key++;
+	return ((key == keys.cend()) && (rs.getCount() == values.size()));
+}
+
+/*
+ * Obtain the path of the newest segment of a LogStructuredRecordStore.
+ */
+static string
+newestLogSegment(
+    const string &pathname)
+{
+	string newest;
+	DIR *dir = opendir(pathname.c_str());
+	if (dir == nullptr)
+		return (newest);
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != nullptr) {
+		const string name(entry->d_name);
+		if ((name.find(IO::LogStructuredRecordStore::
+		    SEGMENT_FILE_PREFIX) == 0) && (name > newest))
+			newest = name;
+	}
+	closedir(dir);
+	return (pathname + "/" + newest);
+}
+
+/*
+ * Test updating, compacting, and recovering a LogStructuredRecordStore
+ */
+static int
+testLogStructured()
+{
+	const string logRSPath = "lsrs_log_test";
+	const string checkpointPath = logRSPath + "/" +
+	    IO::LogStructuredRecordStore::CHECKPOINT_FILE_NAME;
+	const unsigned int numRecs = 600;
+	vector<string> keys;
+	std::map<string, string> values;
+	Memory::uint8Array oldCheckpoint;
+
+	try {
+		/* Small segments, checkpointed only by sync() */
+		IO::LogStructuredRecordStore logRS(logRSPath, "Log test",
+		    4096, 0);
+		logRS.setAutoCompaction(0);
+		for (unsigned int i = 0; i < numRecs; i++) {
+			string key = "key" + to_string(i);
+			string value = key + "." + string(i % 61, 'x');
+			logRS.insert(key, value.c_str(), value.size() + 1);
+			keys.push_back(key);
+			values[key] = value;
+		}
+		for (unsigned int i = 0; i < numRecs; i++) {
+			string key = "key" + to_string(i);
+			if ((i % 5) == 0) {
+				logRS.remove(key);
+				values.erase(key);
+			} else if ((i % 2) == 0) {
+				string value = key + ".replaced";
+				logRS.replace(key, value.c_str(),
+				    value.size() + 1);
+				values[key] = value;
+			}
+		}
+		if ((logRS.getSegmentCount() < 2) ||
+		    (logRS.getDeadSpace() == 0)) {
+			cout << "FAILED (no sealed dead space)." << endl;
+			return (-1);
+		}
+		if (!verifyLogRecords(logRS, keys, values)) {
+			cout << "FAILED (records differ after updates)." <<
+			    endl;
+			return (-1);
+		}
+
+		/* Read every record while compacting */
+		const uint64_t deadBefore = logRS.getDeadSpace();
+		logRS.startCompaction(0.25);
+		bool readFailed = false;
+		do {
+			for (const auto &value : values)
+				if (string((char *)&logRS.read(
+				    value.first)[0]) != value.second)
+					readFailed = true;
+		} while (logRS.isCompacting());
+		logRS.waitForCompaction();
+		if (readFailed) {
+			cout << "FAILED (bad read during compaction)." << endl;
+			return (-1);
+		}
+		if (logRS.getDeadSpace() >= deadBefore) {
+			cout << "FAILED (" << logRS.getDeadSpace() <<
+			    " bytes still dead)." << endl;
+			return (-1);
+		}
+		if (!verifyLogRecords(logRS, keys, values)) {
+			cout << "FAILED (records differ after compaction)." <<
+			    endl;
+			return (-1);
+		}
+
+		/* Changes after this checkpoint must be found by replay */
+		logRS.sync();
+		oldCheckpoint = IO::Utility::readFile(checkpointPath);
+		for (unsigned int i = 1; i < numRecs; i += 10) {
+			string key = "key" + to_string(i);
+			string value = key + ".after";
+			logRS.replace(key, value.c_str(), value.size() + 1);
+			values[key] = value;
+		}
+		logRS.remove("key3");
+		values.erase("key3");
+		logRS.insert("late", "late", 5);
+		keys.push_back("late");
+		values["late"] = "late";
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	try {
+		/* Simulate a crash: stale checkpoint, partial last entry */
+		IO::Utility::writeFile(oldCheckpoint, checkpointPath);
+		const uint8_t partial[] = {'B', 'E', 'L', 'R', 0, 1, 2};
+		IO::Utility::writeFile(partial, sizeof(partial),
+		    newestLogSegment(logRSPath),
+		    std::ios_base::binary | std::ios_base::app);
+
+		IO::LogStructuredRecordStore reopenedRS(logRSPath,
+		    IO::Mode::ReadWrite);
+		if (!verifyLogRecords(reopenedRS, keys, values)) {
+			cout << "FAILED (records differ after replay)." << endl;
+			return (-1);
+		}
+		reopenedRS.insert("recovered", "recovered", 10);
+		keys.push_back("recovered");
+		values["recovered"] = "recovered";
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	try {
+		/* Without a checkpoint, the whole log is replayed */
+		if (unlink(checkpointPath.c_str()) != 0) {
+			cout << "FAILED (could not remove checkpoint)." << endl;
+			return (-1);
+		}
+		IO::LogStructuredRecordStore reopenedRS(logRSPath);
+		if (!verifyLogRecords(reopenedRS, keys, values)) {
+			cout << "FAILED (records differ after full replay)." <<
+			    endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	IO::RecordStore::removeRecordStore(logRSPath);
+	cout << "success." << endl;
+	return (0);
+}
+#endif
+
+#ifdef FILERECORDSTORETEST
+/*
+ * Sequence a FileRecordStore, checking that every record holds its own key
+ * and returning the keys in sequence order.
+ */
+static vector<string>
+sequenceFileRecords(
+    IO::FileRecordStore &rs)
+{
+	vector<string> keys;
+	try {
+		for (;;) {
+			IO::RecordStore::Record record = rs.sequence();
+			if (record.key != string((char *)&record.data[0]))
+				return {};
+			keys.push_back(record.key);
+		}
+	} catch (Error::ObjectDoesNotExist) {
+		/* End of sequence */
+	}
+	return (keys);
+}
+
+/*
+ * Test the key index and hashed subdirectories of a FileRecordStore
+ */
+static int
+testFanOut()
+{
+	const string fanOutRSPath = "frs_fanout_test";
+	const string indexPath = fanOutRSPath + "/theFiles.index";
+	const unsigned int numRecs = 600;
+	vector<string> expected;
+
+	try {
+		IO::FileRecordStore fanOutRS(fanOutRSPath, "Fan-out test", 2);
+		for (unsigned int i = 0; i < numRecs; i++) {
+			string key = "key" + to_string(i);
+			fanOutRS.insert(key, key.c_str(), key.size() + 1);
+		}
+		for (unsigned int i = 0; i < numRecs; i++) {
+			string key = "key" + to_string(i);
+			if ((i % 4) == 0)
+				fanOutRS.remove(key);
+			else
+				expected.push_back(key);
+		}
+		if (IO::Utility::fileExists(fanOutRSPath + "/theFiles/key1")) {
+			cout << "FAILED (record not in a subdirectory)." << endl;
+			return (-1);
+		}
+		if (sequenceFileRecords(fanOutRS) != expected) {
+			cout << "FAILED (sequence differs)." << endl;
+			return (-1);
+		}
+		fanOutRS.setCursorAtKey("key301");
+		if (fanOutRS.sequenceKey() != "key301") {
+			cout << "FAILED (cursor not at key)." << endl;
+			return (-1);
+		}
+		if (fanOutRS.getSpaceUsed() == 0) {
+			cout << "FAILED (no space used)." << endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	try {
+		/* Saved index retains the insertion order */
+		{
+			IO::FileRecordStore reopenedRS(fanOutRSPath);
+			if ((reopenedRS.getFanOutDepth() != 2) ||
+			    (sequenceFileRecords(reopenedRS) != expected)) {
+				cout << "FAILED (records differ after reopen)." <<
+				    endl;
+				return (-1);
+			}
+		}
+
+		/* Modifying the store discards the saved index until sync */
+		{
+			IO::FileRecordStore modifiedRS(fanOutRSPath,
+			    IO::Mode::ReadWrite);
+			modifiedRS.insert("extra", "extra", 6);
+			expected.push_back("extra");
+			if (IO::Utility::fileExists(indexPath)) {
+				cout << "FAILED (stale index remains)." << endl;
+				return (-1);
+			}
+			modifiedRS.sync();
+			if (!IO::Utility::fileExists(indexPath)) {
+				cout << "FAILED (index not saved)." << endl;
+				return (-1);
+			}
+		}
+
+		/* A missing index is rebuilt from the record files */
+		std::remove(indexPath.c_str());
+		IO::FileRecordStore rebuiltRS(fanOutRSPath);
+		vector<string> rebuilt = sequenceFileRecords(rebuiltRS);
+		std::sort(rebuilt.begin(), rebuilt.end());
+		std::sort(expected.begin(), expected.end());
+		if (rebuilt != expected) {
+			cout << "FAILED (records differ after rebuild)." << endl;
+			return (-1);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what() << endl;
+		return (-1);
+	}
+
+	IO::RecordStore::removeRecordStore(fanOutRSPath);
+	cout << "success." << endl;
+	return (0);
+}
+#endif
+
 /*
  * Test the read and write operations of a RecordStore. This function will
  * test any implementation of the abstract RecordStore by using the abstract
@@ -676,6 +1627,46 @@ main(int argc, char* argv[]) {
 	}
 #endif
 
+#ifdef SHARDEDARCHIVERECORDSTORETEST
+	/*
+	 * Call the constructor that will create a new
+	 * ShardedArchiveRecordStore.
+	 */
+	rsPath = "sars_test";
+	IO::ShardedArchiveRecordStore *rs;
+	try {
+		rs = new IO::ShardedArchiveRecordStore(rsPath,
+		    "ShardedArchiveRecordStore Test");
+	} catch (Error::ObjectExists &e) {
+		cout << "The Sharded Archive Record Store exists; exiting." <<
+		    endl;
+		return (EXIT_FAILURE);
+	} catch (Error::StrategyError& e) {
+		cout << "A strategy error occurred: " << e.what() << endl;
+		return (EXIT_FAILURE);
+	}
+#endif
+
+#ifdef LOGSTRUCTUREDRECORDSTORETEST
+	/*
+	 * Call the constructor that will create a new
+	 * LogStructuredRecordStore.
+	 */
+	rsPath = "lsrs_test";
+	IO::LogStructuredRecordStore *rs;
+	try {
+		rs = new IO::LogStructuredRecordStore(rsPath,
+		    "LogStructuredRecordStore Test");
+	} catch (Error::ObjectExists &e) {
+		cout << "The Log Structured Record Store exists; exiting." <<
+		    endl;
+		return (EXIT_FAILURE);
+	} catch (Error::StrategyError& e) {
+		cout << "A strategy error occurred: " << e.what() << endl;
+		return (EXIT_FAILURE);
+	}
+#endif
+
 #ifdef COMPRESSEDRECORDSTORETEST
 	/* Call the constructor that will create a new CompressedRecordStore. */
 	rsPath = "comprs_test";
@@ -759,6 +1750,44 @@ main(int argc, char* argv[]) {
 	}
 #endif
 
+#ifdef SHARDEDARCHIVERECORDSTORETEST
+	/*
+	 * Call the constructor that will open an existing
+	 * ShardedArchiveRecordStore.
+	 */
+	rsPath = "sars_test";
+	try {
+		rs = new IO::ShardedArchiveRecordStore(rsPath,
+		    IO::Mode::ReadWrite);
+	} catch (Error::ObjectDoesNotExist &e) {
+		cout << "The Sharded Archive Record Store does not exist; "
+		    "exiting." << endl;
+		return (EXIT_FAILURE);
+	} catch (Error::StrategyError& e) {
+		cout << "A strategy error occurred: " << e.what() << endl;
+		return (EXIT_FAILURE);
+	}
+#endif
+
+#ifdef LOGSTRUCTUREDRECORDSTORETEST
+	/*
+	 * Call the constructor that will open an existing
+	 * LogStructuredRecordStore.
+	 */
+	rsPath = "lsrs_test";
+	try {
+		rs = new IO::LogStructuredRecordStore(rsPath,
+		    IO::Mode::ReadWrite);
+	} catch (Error::ObjectDoesNotExist &e) {
+		cout << "The Log Structured Record Store does not exist; "
+		    "exiting." << endl;
+		return (EXIT_FAILURE);
+	} catch (Error::StrategyError& e) {
+		cout << "A strategy error occurred: " << e.what() << endl;
+		return (EXIT_FAILURE);
+	}
+#endif
+
 #ifdef COMPRESSEDRECORDSTORETEST
 	/* Call the constructor that will open an existing CompressedRecordStore.*/
 	rsPath = "comprs_test";
@@ -800,6 +1829,46 @@ main(int argc, char* argv[]) {
 	} catch (Error::StrategyError& e) {
 		cout << "failed:" << e.what() << "." << endl;
 	}
+
+	cout << "Compacting an open ArchiveRecordStore: ";
+	if (testCompaction() != 0)
+		return (EXIT_FAILURE);
+
+	/* An entry for data that never reached the archive, a torn entry */
+	cout << "Recovering an ArchiveRecordStore manifest: ";
+	if (testManifestRecovery("ghost 16 1048576\ntorn 5") != 0)
+		return (EXIT_FAILURE);
+	/* Manifest pages written after data that never reached the disk */
+	cout << "Recovering a manifest with removals after lost data: ";
+	if (testManifestRecovery("ghost 16 1048576\nkey3 5 -1\n") != 0)
+		return (EXIT_FAILURE);
+#endif
+#ifdef SHARDEDARCHIVERECORDSTORETEST
+	/*
+	 * Test vacuuming a ShardedArchiveRecordStore
+	 */
+	cout << "Vacuuming ShardedArchiveRecordStore... " << endl;
+	try {
+		IO::ShardedArchiveRecordStore::vacuum(rsPath);
+	} catch (Error::ObjectDoesNotExist &e) {
+		cout << "Caught: " << e.what() << endl;
+	} catch (Error::StrategyError &e) {
+		cout << "Caught: " << e.what() << endl;
+	}
+
+	cout << "Inserting into shards from multiple threads: ";
+	if (testParallelInsert() != 0)
+		return (EXIT_FAILURE);
+#endif
+#ifdef LOGSTRUCTUREDRECORDSTORETEST
+	cout << "Updating, compacting, and recovering a log: ";
+	if (testLogStructured() != 0)
+		return (EXIT_FAILURE);
+#endif
+#ifdef FILERECORDSTORETEST
+	cout << "Indexing a FileRecordStore in hashed subdirectories: ";
+	if (testFanOut() != 0)
+		return (EXIT_FAILURE);
 #endif
 	delete rs;
 
@@ -836,6 +1905,22 @@ main(int argc, char* argv[]) {
 		return (EXIT_FAILURE);
 	srs.reset();		// Close the RecordStore
 
+	cout << "Recovering the count after a crash: ";
+	if (testCrashRecovery() != 0)
+		return (EXIT_FAILURE);
+
+	cout << "Closing an unchanged store: ";
+	if (testUnchangedClose() != 0)
+		return (EXIT_FAILURE);
+
+	cout << "Reading records ahead while iterating: ";
+	if (testPrefetchingIterator() != 0)
+		return (EXIT_FAILURE);
+
+	cout << "Sequencing partitions in parallel: ";
+	if (testPartitions() != 0)
+		return (EXIT_FAILURE);
+
 #ifdef MERGETESTDEFINED
 	/*
 	 * Test merging many RecordStores
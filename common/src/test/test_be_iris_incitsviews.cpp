@@ -13,6 +13,7 @@
 #include <fstream>
 #include <iostream>
 #include <be_iris_iso2011view.h>
+#include <be_io_utility.h>
 
 using namespace std;
 using namespace BiometricEvaluation;
@@ -130,6 +131,22 @@ testISO2011()
 	cout << "Success." << endl;
 
 	printViewInfo(irisv);
+
+	cout << "Attempt to construct with moved buffer: ";
+	try {
+		Memory::uint8Array record = IO::Utility::readFile(
+		    "test_data/iris01.iso2011");
+		Iris::ISO2011View movedv(std::move(record), 1);
+		if (!(movedv.getImage()->getData() ==
+		    irisv.getImage()->getData())) {
+			cout << "FAILED (image data differs)." << endl;
+			return (false);
+		}
+	} catch (Error::Exception &e) {
+		cout << "Caught " << e.what()  << endl;
+		return (false);
+	}
+	cout << "Success." << endl;
 	return (true);
 }
 
@@ -9,6 +9,7 @@
  */
 
 #include <be_error.h>
+#include <be_io_listrecstore.h>
 #include <be_io_propertiesfile.h>
 #include <be_io_utility.h>
 #include <be_io_recordstore.h>
@@ -201,6 +202,11 @@ writeListRecordStoreKeys(
                     BE::Error::errorStr());
 
 	updateListRecordStoreCount(rsPath, keys->size());
+
+	/* The cached index only speeds opening, so it need not be written */
+	try {
+		BE::IO::ListRecordStore::indexKeyList(rsPath);
+	} catch (BE::Error::Exception &e) {}
 }
 
 void
@@ -11,17 +11,31 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <getopt.h>
+#include <unistd.h>
 
 #include <be_error.h>
 #include <be_error_exception.h>
@@ -32,6 +46,7 @@
 #include <be_io_compressor.h>
 #include <be_io_filerecstore.h>
 #include <be_io_recordstore.h>
+#include <be_io_shardedarchiverecstore.h>
 #include <be_io_sqliterecstore.h>
 #include <be_io_utility.h>
 #include <be_text.h>
@@ -182,7 +197,10 @@ void usage(char *exe)
 	    "translation RecordStore" << std::endl;
 	std::cerr << "\t-k <key>\tKey to dump" << std::endl;
 	std::cerr << "\t-r <#-#>\tRange of keys" << std::endl;
-	std::cerr << "\t-o <dir>\tOutput directory" << std::endl;
+	std::cerr << "\t-o <dir>\tOutput directory, or - for a tar archive "
+	    "on stdout" << std::endl;
+	std::cerr << "\t-j <threads>\tNumber of threads dumping records "
+	    "(default: all cores)" << std::endl;
 	std::cerr << "\t-f\t\tVisualize image/AN2K record (display only)" <<
 	    std::endl;
 
@@ -201,7 +219,7 @@ void usage(char *exe)
 	    std::endl;
 	std::cerr << "\t-t <type>\tType of RecordStore to make" << std::endl;
 	std::cerr << "\t\t\tWhere <type> is Archive, BerkeleyDB, File, List, "
-	    "SQLite" << std::endl;
+	    "SQLite,\n\t\t\tShardedArchive, LogStructured" << std::endl;
 	std::cerr << "\t-r <...>\tDescription of the RecordStore" << std::endl;
 	std::cerr << "\t-s <sourceRS>\tSource RecordStore, if -t is List" <<
 	    std::endl;
@@ -209,6 +227,9 @@ void usage(char *exe)
 	    "\t\t\t(same as -Z GZIP)" << std::endl;
 	std::cerr << "\t-Z <type>\tCompress records with <type> compression" <<
 	    "\n\t\t\tWhere type is GZIP" << std::endl;
+	std::cerr << "\t-j <threads>\tNumber of threads reading files "
+	    "(default: all cores)" << std::endl;
+	std::cerr << "\t-v\t\tReport progress and throughput" << std::endl;
 	std::cerr << "\t<file> ...\tFiles/dirs to add as a record" << std::endl;
 	std::cerr << "\t-q\t\tSkip the confirmation step" << std::endl;
 
@@ -222,8 +243,8 @@ void usage(char *exe)
 	std::cerr << "\t-r <...>\t\tDescription of the merged RecordStore" <<
 	    std::endl;
 	std::cerr << "\t-t <type>\tType of RecordStore to make" << std::endl;
-	std::cerr << "\t\t\tWhere <type> is Archive, BerkeleyDB, File" <<
-	    std::endl;
+	std::cerr << "\t\t\tWhere <type> is Archive, BerkeleyDB, File, "
+	    "SQLite,\n\t\t\tShardedArchive, LogStructured" << std::endl;
 	std::cerr << "\t<RS> ...\tRecordStore(s) to be merged " << std::endl;
 
 	std::cerr << std::endl;
@@ -285,10 +306,34 @@ validate_rs_type(
 	else if (BE::Text::caseInsensitiveCompare(type,
 	    to_string(BE::IO::RecordStore::Kind::List)))
 		return (BE::IO::RecordStore::Kind::List);
+	else if (BE::Text::caseInsensitiveCompare(type,
+	    to_string(BE::IO::RecordStore::Kind::ShardedArchive)))
+		return (BE::IO::RecordStore::Kind::ShardedArchive);
+	else if (BE::Text::caseInsensitiveCompare(type,
+	    to_string(BE::IO::RecordStore::Kind::LogStructured)))
+		return (BE::IO::RecordStore::Kind::LogStructured);
 
 	throw BE::Error::StrategyError("Invalid RecordStore Type: " + type);
 }
 
+unsigned int
+validate_num_threads(
+    const std::string &count)
+{
+	unsigned long numThreads;
+	try {
+		numThreads = std::stoul(count);
+	} catch (std::exception) {
+		numThreads = 0;
+	}
+	if ((numThreads == 0) ||
+	    (numThreads > std::numeric_limits<unsigned int>::max()))
+		throw BE::Error::StrategyError("Invalid number of threads: " +
+		    count);
+
+	return (static_cast<unsigned int>(numThreads));
+}
+
 Action procargs(int argc, char *argv[])
 {
 	if (argc == 1) {
@@ -362,14 +407,26 @@ procargs_extract(
     std::string &key,
     std::string &range,
     std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
-    std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs)
+    std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    unsigned int &numThreads)
 {	
+	numThreads = std::max(1U, std::thread::hardware_concurrency());
+
 	char c;
         while ((c = getopt(argc, argv, optstr)) != EOF) {
 		switch (c) {
 		case 'f':	/* Visualize */
 			visualize = true;
 			break;
+		case 'j':	/* Reading and writing threads */
+			try {
+				numThreads = validate_num_threads(optarg);
+			} catch (BE::Error::StrategyError) {
+				std::cerr << "Invalid number of threads (-j): " <<
+				    optarg << std::endl;
+				return (EXIT_FAILURE);
+			}
+			break;
 		case 'h':	/* Existing hash translation RecordStore */
 			try {
 				hash_rs = BE::IO::RecordStore::openRecordStore(
@@ -393,7 +450,9 @@ procargs_extract(
 			break;
 		case 'o':	/* Output directory */
 			oflagval = std::string(optarg);
-			if (BE::IO::Utility::fileExists(oflagval)) {
+			if (oflagval == TAR_STDOUT) {
+				/* Stream a tar archive instead */
+			} else if (BE::IO::Utility::fileExists(oflagval)) {
 				if (!BE::IO::Utility::pathIsDirectory(
 				    oflagval)) {
 					std::cerr << optarg << " is not a "
@@ -504,11 +563,178 @@ visualizeRecord(
 	return (EXIT_FAILURE);
 }
 
+int
+dump_write_file(
+    const std::string &pathname,
+    const BiometricEvaluation::Memory::uint8Array &value)
+{
+	int fd = open(pathname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd == -1) {
+		std::cerr << "Could not create file (" << pathname << ") - " <<
+		    BE::Error::errorStr() << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	/* Write the whole record at once instead of through stdio */
+	uint64_t written = 0;
+	while (written < value.size()) {
+		ssize_t rv = write(fd, value + written, value.size() - written);
+		if (rv == -1) {
+			if (errno == EINTR)
+				continue;
+			std::cerr << "Could not write entry (" << pathname <<
+			    ") - " << BE::Error::errorStr() << std::endl;
+			close(fd);
+			return (EXIT_FAILURE);
+		}
+		written += rv;
+	}
+
+	if (close(fd) != 0) {
+		std::cerr << "Could not write entry (" << pathname << ") - " <<
+		    BE::Error::errorStr() << std::endl;
+		return (EXIT_FAILURE);
+	}
+	return (EXIT_SUCCESS);
+}
+
+/* Size of a tar header, and the unit in which tar data is padded */
+static const size_t TAR_BLOCK_SIZE = 512;
+
+/*
+ * Store value in a numeric tar header field: octal when it fits,
+ * otherwise the base-256 form understood by GNU and POSIX pax readers.
+ */
+static void
+tar_set_number(
+    char *field,
+    size_t length,
+    uint64_t value)
+{
+	if (value < (1ULL << (3 * (length - 1)))) {
+		snprintf(field, length, "%0*llo", static_cast<int>(length - 1),
+		    static_cast<unsigned long long>(value));
+		return;
+	}
+
+	std::memset(field, 0, length);
+	field[0] = static_cast<char>(0x80);
+	for (size_t i = length - 1; (i > 0) && (value != 0); i--) {
+		field[i] = static_cast<char>(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+static void
+tar_write_header(
+    FILE *fp,
+    const std::string &name,
+    const std::string &prefix,
+    uint64_t size,
+    char type)
+{
+	char header[TAR_BLOCK_SIZE] = {};
+
+	std::memcpy(header, name.data(), std::min<size_t>(name.size(), 100));
+	tar_set_number(header + 100, 8, 0644);		/* mode */
+	tar_set_number(header + 108, 8, 0);		/* uid */
+	tar_set_number(header + 116, 8, 0);		/* gid */
+	tar_set_number(header + 124, 12, size);		/* size */
+	tar_set_number(header + 136, 12, time(nullptr));	/* mtime */
+	header[156] = type;
+	std::memcpy(header + 257, "ustar", 6);		/* magic */
+	std::memcpy(header + 263, "00", 2);		/* version */
+	std::memcpy(header + 345, prefix.data(),
+	    std::min<size_t>(prefix.size(), 155));
+
+	/* Checksum is computed with its own field set to spaces */
+	std::memset(header + 148, ' ', 8);
+	unsigned int checksum = 0;
+	for (size_t i = 0; i < TAR_BLOCK_SIZE; i++)
+		checksum += static_cast<unsigned char>(header[i]);
+	snprintf(header + 148, 8, "%06o", checksum);
+
+	if (std::fwrite(header, 1, TAR_BLOCK_SIZE, fp) != TAR_BLOCK_SIZE)
+		throw BE::Error::StrategyError("Could not write tar header (" +
+		    BE::Error::errorStr() + ")");
+}
+
+static void
+tar_write_data(
+    FILE *fp,
+    const void *data,
+    uint64_t size)
+{
+	static const char padding[TAR_BLOCK_SIZE] = {};
+	const size_t padLength = (TAR_BLOCK_SIZE - (size % TAR_BLOCK_SIZE)) %
+	    TAR_BLOCK_SIZE;
+
+	if ((std::fwrite(data, 1, size, fp) != size) ||
+	    (std::fwrite(padding, 1, padLength, fp) != padLength))
+		throw BE::Error::StrategyError("Could not write tar data (" +
+		    BE::Error::errorStr() + ")");
+}
+
+int
+dump_tar(
+    FILE *fp,
+    const std::string &key,
+    const BiometricEvaluation::Memory::uint8Array &value)
+{
+	try {
+		std::string name = key, prefix;
+		if (key.size() > 100) {
+			/* Split long names between the prefix and name fields */
+			const std::string::size_type slash = key.find('/',
+			    key.size() - 101);
+			if ((slash != std::string::npos) && (slash <= 155) &&
+			    (slash != 0) && (slash != (key.size() - 1))) {
+				prefix = key.substr(0, slash);
+				name = key.substr(slash + 1);
+			} else {
+				/* GNU tar long name extension */
+				tar_write_header(fp, "././@LongLink", "",
+				    key.size() + 1, 'L');
+				tar_write_data(fp, key.c_str(),
+				    key.size() + 1);
+			}
+		}
+
+		tar_write_header(fp, name, prefix, value.size(), '0');
+		tar_write_data(fp, value, value.size());
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Could not write entry (" << key << ") - " <<
+		    e.what() << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+int
+dump_tar_finish(
+    FILE *fp)
+{
+	static const char trailer[TAR_BLOCK_SIZE * 2] = {};
+
+	if ((std::fwrite(trailer, 1, sizeof(trailer), fp) !=
+	    sizeof(trailer)) || (std::fflush(fp) != 0)) {
+		std::cerr << "Could not finish tar archive - " <<
+		    BE::Error::errorStr() << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
 int
 dump(
     const std::string &key,
     BiometricEvaluation::Memory::AutoArray<uint8_t> &value)
 {
+	if (oflagval == TAR_STDOUT)
+		return (dump_tar(stdout, key, value));
+
 	/* Possible that keys could have slashes */
 	if (key.find('/') != std::string::npos) {
 		if (BE::IO::Utility::makePath(oflagval + "/" +
@@ -520,20 +746,225 @@ dump(
 		}
 	}
 
-	FILE *fp = std::fopen((oflagval + "/" + key).c_str(), "wb");
-	if (fp == NULL) {
-		std::cerr << "Could not create file." << std::endl;
-		return (EXIT_FAILURE);
+	return (dump_write_file(oflagval + "/" + key, value));
+}
+
+int
+dump_range(
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    const std::vector<std::string> &keys,
+    unsigned int numThreads)
+{
+	/* Number of consecutive keys claimed by a thread at a time */
+	static const size_t BATCH_SIZE = 64;
+
+	numThreads = std::max(1U, std::min<unsigned int>(numThreads,
+	    (keys.size() + BATCH_SIZE - 1) / BATCH_SIZE));
+	const bool toTar = (oflagval == TAR_STDOUT);
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::string error;
+	std::atomic<bool> stop{false};
+
+	/*
+	 * Run fn(thread rs, thread hash_rs, index) over every key, with each
+	 * thread claiming batches of consecutive keys.  The first thread
+	 * uses the stores already opened; others open their own so that no
+	 * store object is shared between threads.
+	 */
+	const auto partition = [&](const std::function<void(
+	    const std::shared_ptr<BE::IO::RecordStore>&,
+	    const std::shared_ptr<BE::IO::RecordStore>&, size_t)> &fn) {
+		size_t nextBatch = 0;
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < numThreads; t++) {
+			threads.emplace_back([&, t]() {
+				try {
+					std::shared_ptr<BE::IO::RecordStore>
+					    t_rs = rs, t_hash_rs = hash_rs;
+					if (t != 0) {
+						t_rs = BE::IO::RecordStore::
+						    openRecordStore(sflagval,
+						    BE::IO::Mode::ReadOnly);
+						if (hash_rs.get() != nullptr)
+							t_hash_rs = BE::IO::
+							    RecordStore::
+							    openRecordStore(
+							    hash_rs->
+							    getPathname(),
+							    BE::IO::Mode::
+							    ReadOnly);
+					}
+
+					for (;;) {
+						size_t first;
+						{
+							std::lock_guard<
+							    std::mutex> lock(
+							    mutex);
+							if (stop || (nextBatch >=
+							    keys.size()))
+								return;
+							first = nextBatch;
+							nextBatch += BATCH_SIZE;
+						}
+						const size_t last = std::min(
+						    first + BATCH_SIZE,
+						    keys.size());
+						for (size_t i = first; (i < last) &&
+						    !stop; i++)
+							fn(t_rs, t_hash_rs, i);
+					}
+				} catch (BE::Error::Exception &e) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (error.empty())
+						error = e.what();
+					stop = true;
+					cv.notify_all();
+				}
+			});
+		}
+		for (auto &thread : threads)
+			thread.join();
+	};
+
+	/* Names of the files or tar entries, unhashed if requested */
+	std::vector<std::string> names;
+	if (hash_rs.get() == nullptr) {
+		names = keys;
+	} else {
+		names.resize(keys.size());
+		partition([&](const std::shared_ptr<BE::IO::RecordStore>&,
+		    const std::shared_ptr<BE::IO::RecordStore> &t_hash_rs,
+		    size_t i) {
+			BE::Memory::uint8Array hash_buf;
+			try {
+				hash_buf = t_hash_rs->read(keys[i]);
+			} catch (BE::Error::Exception &e) {
+				throw BE::Error::StrategyError("Could not "
+				    "unhash " + keys[i] + " - " + e.what());
+			}
+			names[i] = BE::Memory::AutoArrayUtility::getString(
+			    hash_buf, hash_buf.size());
+		});
+		if (!error.empty()) {
+			std::cerr << error << std::endl;
+			return (EXIT_FAILURE);
+		}
 	}
-	if (fwrite(value, 1, value.size(), fp) != value.size()) {
-		std::cerr << "Could not write entry." << std::endl;
-		if (fp != NULL)
-			std::fclose(fp);
-		return (EXIT_FAILURE);
+
+	if (!toTar) {
+		/* Create each output directory once, before any writes */
+		std::set<std::string> directories;
+		for (const auto &name : names)
+			if (name.find('/') != std::string::npos)
+				directories.insert(BE::Text::dirname(name));
+		for (const auto &directory : directories) {
+			if (BE::IO::Utility::makePath(oflagval + "/" +
+			    directory, S_IRWXU)) {
+				std::cerr << "Could not create path to store "
+				    "file (" << oflagval + "/" + directory <<
+				    ")." << std::endl;
+				return (EXIT_FAILURE);
+			}
+		}
+
+		partition([&](const std::shared_ptr<BE::IO::RecordStore> &t_rs,
+		    const std::shared_ptr<BE::IO::RecordStore>&, size_t i) {
+			BE::Memory::uint8Array data;
+			try {
+				data = t_rs->read(keys[i]);
+			} catch (BE::Error::Exception &e) {
+				throw BE::Error::StrategyError("Could not read "
+				    "key " + keys[i] + " - " + e.what());
+			}
+			if (dump_write_file(oflagval + "/" + names[i], data) !=
+			    EXIT_SUCCESS)
+				throw BE::Error::StrategyError("Could not dump "
+				    "key " + keys[i]);
+		});
+		if (!error.empty()) {
+			std::cerr << error << std::endl;
+			return (EXIT_FAILURE);
+		}
+		return (EXIT_SUCCESS);
 	}
-	std::fclose(fp);
 
-	return (EXIT_SUCCESS);
+	/*
+	 * Tar entries are written by this thread in key order.  Readers may
+	 * each hold one record beyond the in-flight byte budget while waiting
+	 * for the writer to catch up.
+	 */
+	std::map<size_t, BE::Memory::uint8Array> ready;
+	size_t nextToWrite = 0;
+	uint64_t inFlightBytes = 0;
+	std::thread readers([&]() {
+		partition([&](const std::shared_ptr<BE::IO::RecordStore> &t_rs,
+		    const std::shared_ptr<BE::IO::RecordStore>&, size_t i) {
+			BE::Memory::uint8Array data;
+			try {
+				data = t_rs->read(keys[i]);
+			} catch (BE::Error::Exception &e) {
+				throw BE::Error::StrategyError("Could not read "
+				    "key " + keys[i] + " - " + e.what());
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&]() { return (stop ||
+			    (i == nextToWrite) || ((inFlightBytes +
+			    data.size()) <= MAX_INFLIGHT_BYTES)); });
+			if (stop)
+				return;
+			inFlightBytes += data.size();
+			ready.emplace(i, std::move(data));
+			cv.notify_all();
+		});
+	});
+
+	if (setvbuf(stdout, nullptr, _IOFBF, 1024 * 1024) != 0)
+		std::cerr << "Could not set output buffer size" << std::endl;
+	int status = EXIT_SUCCESS;
+	while (nextToWrite < keys.size()) {
+		BE::Memory::uint8Array data;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&]() { return (stop ||
+			    (ready.count(nextToWrite) != 0)); });
+			if (stop) {
+				status = EXIT_FAILURE;
+				break;
+			}
+			const auto it = ready.find(nextToWrite);
+			data = std::move(it->second);
+			ready.erase(it);
+		}
+
+		if (dump_tar(stdout, names[nextToWrite], data) !=
+		    EXIT_SUCCESS) {
+			status = EXIT_FAILURE;
+			break;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		inFlightBytes -= data.size();
+		nextToWrite++;
+		cv.notify_all();
+	}
+
+	if (status != EXIT_SUCCESS) {
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+		cv.notify_all();
+	}
+	readers.join();
+	if (!error.empty())
+		std::cerr << error << std::endl;
+	if (status != EXIT_SUCCESS)
+		return (status);
+
+	return (dump_tar_finish(stdout));
 }
 
 
@@ -542,8 +973,9 @@ int extract(int argc, char *argv[], Action action)
 	bool visualize = false;
 	std::string key = "", range = "";
 	std::shared_ptr<BE::IO::RecordStore> rs, hash_rs;
-	if (procargs_extract(argc, argv, visualize, key, range, rs, hash_rs) !=
-	    EXIT_SUCCESS)
+	unsigned int numThreads;
+	if (procargs_extract(argc, argv, visualize, key, range, rs, hash_rs,
+	    numThreads) != EXIT_SUCCESS)
 		return (EXIT_FAILURE);
 
 	BE::Memory::AutoArray<uint8_t> hash_buf;
@@ -584,6 +1016,8 @@ int extract(int argc, char *argv[], Action action)
 		case Action::DUMP:
 			if (dump(key, buf) != EXIT_SUCCESS)
 				return (EXIT_FAILURE);
+			if (oflagval == TAR_STDOUT)
+				return (dump_tar_finish(stdout));
 			break;
 		case Action::DISPLAY:
 			if (visualize) {
@@ -633,6 +1067,23 @@ int extract(int argc, char *argv[], Action action)
 				return (EXIT_FAILURE);
 			}
 		}
+
+		if (action == Action::DUMP) {
+			std::vector<std::string> keys;
+			for (int i = atoi(ranges[0].c_str());
+			    i <= atoi(ranges[1].c_str()); i++) {
+				try {
+					keys.push_back(rs->sequenceKey());
+				} catch (BE::Error::Exception &e) {
+					std::cerr << "Could not read key " <<
+					    i << " - " << e.what() << "." <<
+					    std::endl;
+					return (EXIT_FAILURE);
+				}
+			}
+			return (dump_range(rs, hash_rs, keys, numThreads));
+		}
+
 		BE::IO::RecordStore::Record record;
 		for (int i = atoi(ranges[0].c_str());
 		    i <= atoi(ranges[1].c_str()); i++) {
@@ -730,7 +1181,9 @@ procargs_make(
     std::vector<std::string> &elements,
     bool &compress,
     BiometricEvaluation::IO::Compressor::Kind &compressorKind,
-    bool &stopOnDuplicate)
+    bool &stopOnDuplicate,
+    unsigned int &numThreads,
+    bool &showProgress)
 {
 	what_to_hash = HashablePart::NOTHING;
 	hashed_key_format = KeyFormat::DEFAULT;
@@ -738,6 +1191,8 @@ procargs_make(
 	compressorKind = BE::IO::Compressor::Kind::GZIP;
 	stopOnDuplicate = true;
 	kind = BE::IO::RecordStore::Kind::Default;
+	numThreads = std::max(1U, std::thread::hardware_concurrency());
+	showProgress = false;
 
 	char c;
 	bool textProvided = false, dirProvided = false, otherProvided = false;
@@ -806,6 +1261,15 @@ procargs_make(
 		case 'h':	/* Hash translation RecordStore */
 			hash_pathname.assign(optarg);
 			break;
+		case 'j':	/* Reading threads */
+			try {
+				numThreads = validate_num_threads(optarg);
+			} catch (BE::Error::StrategyError) {
+				std::cerr << "Invalid number of threads (-j): " <<
+				    optarg << std::endl;
+				return (EXIT_FAILURE);
+			}
+			break;
 		case 'k':	/* Hash key display type */
 			switch (optarg[0]) {
 			case 'f':	/* Display as file's name */
@@ -844,6 +1308,9 @@ procargs_make(
 				return (EXIT_FAILURE);
 			}
 			break;
+		case 'v':	/* Report progress */
+			showProgress = true;
+			break;
 		case 'z':	/* Compress */
 			compress = true;
 			compressorKind = BE::IO::Compressor::Kind::GZIP;
@@ -1027,39 +1494,80 @@ makeHumanConfirmation(
 	return (EXIT_SUCCESS);
 }
 
-int make_insert_contents(const std::string &filename,
-    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
-    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+void
+make_read_contents(
+    const std::string &filename,
+    const bool hashing,
     const HashablePart what_to_hash,
     const KeyFormat hashed_key_format,
-    bool stopOnDuplicate)
+    BiometricEvaluation::Memory::uint8Array &buffer,
+    std::string &key,
+    std::string &hash_value)
 {
-	static BE::Memory::uint8Array buffer;
-	static uint64_t buffer_size = 0;
-	static std::ifstream buffer_file;
-
+	uint64_t buffer_size;
 	try {
 		buffer_size = BE::IO::Utility::getFileSize(filename);
 		buffer.resize(buffer_size);
 	} catch (BE::Error::Exception &e) {
-		std::cerr << "Could not get file size for " << filename <<
-		    std::endl;
-		return (EXIT_FAILURE);
+		throw BE::Error::StrategyError("Could not get file size for " +
+		    filename);
 	}
 
 	/* Extract file into buffer */
-	buffer_file.open(filename.c_str(), std::ifstream::binary);
+	std::ifstream buffer_file(filename.c_str(), std::ifstream::binary);
 	buffer_file.read((char *)&(*buffer), buffer_size);
-	if (buffer_file.bad()) {
-		std::cerr << "Error reading file (" << filename << ')' <<
-		    std::endl;
-		return (EXIT_FAILURE);
-	}
+	if (buffer_file.bad())
+		throw BE::Error::StrategyError("Error reading file (" +
+		    filename + ')');
 	buffer_file.close();
-	
-	static std::string key = "", hash_value = "";
+
+	key = BE::Text::basename(filename);
+	hash_value = "";
+	if (!hashing)
+		return;
+
+	switch (what_to_hash) {
+	case HashablePart::FILECONTENTS:
+		hash_value = BE::Text::digest(buffer, buffer_size);
+		break;
+	case HashablePart::FILENAME:
+		hash_value = BE::Text::digest(key);
+		break;
+	case HashablePart::FILEPATH:
+		hash_value = BE::Text::digest(filename);
+		break;
+	case HashablePart::NOTHING:
+		/* FALLTHROUGH */
+	default:
+		/* Don't hash */
+		break;
+	}
+
+	switch (hashed_key_format) {
+	case KeyFormat::FILENAME:
+		/* Already done */
+		break;
+	case KeyFormat::FILEPATH:
+		key = filename;
+		break;
+	default:
+		throw BE::Error::StrategyError("Invalid key format received (" +
+		    std::to_string(static_cast<std::underlying_type<
+		    KeyFormat>::type>(hashed_key_format)) + ')');
+	}
+}
+
+int
+make_insert_record(
+    const std::string &filename,
+    const BiometricEvaluation::Memory::uint8Array &buffer,
+    const std::string &key,
+    const std::string &hash_value,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    bool stopOnDuplicate)
+{
 	try {
-		key = BE::Text::basename(filename);
 		if (hash_rs.get() == NULL) {
 			try {
 				rs->insert(key, buffer);
@@ -1074,39 +1582,6 @@ int make_insert_contents(const std::string &filename,
 				rs->replace(key, buffer);
 			}
 		} else {
-			switch (what_to_hash) {
-			case HashablePart::FILECONTENTS:
-				hash_value = BE::Text::digest(buffer,
-				    buffer_size);
-				break;
-			case HashablePart::FILENAME:
-				hash_value = BE::Text::digest(key);
-				break;
-			case HashablePart::FILEPATH:
-				hash_value = BE::Text::digest(filename);
-				break;
-			case HashablePart::NOTHING:
-				/* FALLTHROUGH */
-			default:
-				/* Don't hash */
-				break;
-			}
-
-			switch (hashed_key_format) {
-			case KeyFormat::FILENAME:
-				/* Already done */
-				break;
-			case KeyFormat::FILEPATH:
-				key = filename;
-				break;
-			default:
-				std::cerr << "Invalid key format received (" <<
-				    static_cast<std::underlying_type<
-				    KeyFormat>::type>(hashed_key_format) <<
-				    ')' << std::endl;
-				return (EXIT_FAILURE);
-			}
-
 			try {
 				rs->insert(hash_value, buffer);
 			} catch (BE::Error::ObjectExists &e) {
@@ -1144,6 +1619,28 @@ int make_insert_contents(const std::string &filename,
 	return (EXIT_SUCCESS);
 }
 
+int make_insert_contents(const std::string &filename,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    const HashablePart what_to_hash,
+    const KeyFormat hashed_key_format,
+    bool stopOnDuplicate)
+{
+	static BE::Memory::uint8Array buffer;
+	static std::string key = "", hash_value = "";
+
+	try {
+		make_read_contents(filename, hash_rs.get() != NULL,
+		    what_to_hash, hashed_key_format, buffer, key, hash_value);
+	} catch (BE::Error::Exception &e) {
+		std::cerr << e.what() << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	return (make_insert_record(filename, buffer, key, hash_value, rs,
+	    hash_rs, stopOnDuplicate));
+}
+
 int
 make_insert_directory_contents(
     const std::string &directory,
@@ -1197,6 +1694,264 @@ make_insert_directory_contents(
 	return (EXIT_SUCCESS);
 }
 
+bool
+make_walk_directory(
+    const std::string &dirpath,
+    const std::function<bool(const std::string&)> &visit)
+{
+	struct dirent *entry;
+	DIR *dir = NULL;
+	std::string filename;
+	bool isDirectory, keepWalking = true;
+
+	if (!BE::IO::Utility::fileExists(dirpath))
+		throw BE::Error::ObjectDoesNotExist(dirpath + " does not exist");
+	dir = opendir(dirpath.c_str());
+	if (dir == NULL)
+		throw BE::Error::StrategyError(dirpath + " could not be opened");
+
+	try {
+		while (keepWalking && ((entry = readdir(dir)) != NULL)) {
+			if (entry->d_ino == 0)
+				continue;
+			if ((strcmp(entry->d_name, ".") == 0) ||
+			    (strcmp(entry->d_name, "..") == 0))
+				continue;
+
+			filename = dirpath + "/" + entry->d_name;
+
+			/* Avoid a stat() when the entry type is known */
+			switch (entry->d_type) {
+			case DT_DIR:
+				isDirectory = true;
+				break;
+			case DT_REG:
+				isDirectory = false;
+				break;
+			default:
+				isDirectory = BE::IO::Utility::pathIsDirectory(
+				    filename);
+				break;
+			}
+
+			if (isDirectory)
+				keepWalking = make_walk_directory(filename,
+				    visit);
+			else
+				keepWalking = visit(filename);
+		}
+	} catch (BE::Error::Exception) {
+		closedir(dir);
+		throw;
+	}
+
+	if (closedir(dir))
+		throw BE::Error::StrategyError("Could not close " + dirpath +
+		    " (" + BE::Error::errorStr() + ")");
+
+	return (keepWalking);
+}
+
+int
+make_insert_parallel(
+    const std::vector<std::string> &elements,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    const HashablePart what_to_hash,
+    const KeyFormat hashed_key_format,
+    bool stopOnDuplicate,
+    unsigned int numThreads,
+    bool showProgress)
+{
+	/* Paths found but not yet claimed, per reading thread */
+	static const size_t MAX_PENDING_PATHS = 4096;
+
+	/* A file read (and hashed) by a reader, awaiting insertion */
+	struct Item
+	{
+		std::string filename;
+		BE::Memory::uint8Array buffer;
+		std::string key;
+		std::string hash_value;
+		std::string error;
+	};
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::pair<uint64_t, std::string>> pending;
+	std::map<uint64_t, Item> ready;
+	uint64_t enumerated = 0, nextToWrite = 0, inFlightBytes = 0;
+	bool walkDone = false, stop = false;
+	std::string walkError;
+
+	/* Enumerate files in the same order as a serial traversal */
+	std::thread walker([&]() {
+		const std::function<bool(const std::string&)> visit =
+		    [&](const std::string &filename) -> bool {
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&]() { return (stop ||
+			    (pending.size() < (MAX_PENDING_PATHS *
+			    numThreads))); });
+			if (stop)
+				return (false);
+			pending.emplace_back(enumerated++, filename);
+			cv.notify_all();
+			return (true);
+		};
+
+		for (const auto &element : elements) {
+			try {
+				if (BE::IO::Utility::pathIsDirectory(element)) {
+					if (!make_walk_directory(
+					    BE::Text::dirname(element) + "/" +
+					    BE::Text::basename(element), visit))
+						break;
+				} else if (!visit(element))
+					break;
+			} catch (BE::Error::Exception &e) {
+				std::lock_guard<std::mutex> lock(mutex);
+				walkError = "Could not add contents of dir " +
+				    element + " - " + e.what();
+				break;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		walkDone = true;
+		cv.notify_all();
+	});
+
+	/* Read and hash files, within the in-flight byte budget */
+	std::vector<std::thread> readers;
+	for (unsigned int i = 0; i < numThreads; i++) {
+		readers.emplace_back([&]() {
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;) {
+				cv.wait(lock, [&]() { return (stop ||
+				    !pending.empty() || walkDone); });
+				if (stop || pending.empty())
+					return;
+				const uint64_t index = pending.front().first;
+				Item item;
+				item.filename = std::move(
+				    pending.front().second);
+				pending.pop_front();
+				cv.notify_all();
+				lock.unlock();
+
+				uint64_t size = 0;
+				try {
+					size = BE::IO::Utility::getFileSize(
+					    item.filename);
+				} catch (BE::Error::Exception) {
+					/* Reported by make_read_contents() */
+				}
+
+				/* Never hold back the next record to insert */
+				lock.lock();
+				cv.wait(lock, [&]() { return (stop ||
+				    (index == nextToWrite) ||
+				    ((inFlightBytes + size) <=
+				    MAX_INFLIGHT_BYTES)); });
+				if (stop)
+					return;
+				inFlightBytes += size;
+				lock.unlock();
+
+				try {
+					make_read_contents(item.filename,
+					    hash_rs.get() != nullptr,
+					    what_to_hash, hashed_key_format,
+					    item.buffer, item.key,
+					    item.hash_value);
+				} catch (BE::Error::Exception &e) {
+					item.error = e.what();
+				}
+
+				lock.lock();
+				inFlightBytes = inFlightBytes - size +
+				    item.buffer.size();
+				ready.emplace(index, std::move(item));
+				cv.notify_all();
+			}
+		});
+	}
+
+	/* Insert records in enumeration order from this thread only */
+	int status = EXIT_SUCCESS;
+	uint64_t insertedBytes = 0;
+	const auto start = std::chrono::steady_clock::now();
+	auto lastReport = start;
+	const auto report = [&](bool final) {
+		const auto now = std::chrono::steady_clock::now();
+		if (!final && ((now - lastReport) < std::chrono::seconds(1)))
+			return;
+		lastReport = now;
+
+		const double elapsed = std::max(0.001,
+		    std::chrono::duration<double>(now - start).count());
+		const double mib = insertedBytes / (1024.0 * 1024.0);
+		std::cerr << "Added " << nextToWrite << " files, " <<
+		    std::fixed << std::setprecision(1) << mib << " MiB in " <<
+		    elapsed << " s (" << (nextToWrite / elapsed) <<
+		    " files/s, " << (mib / elapsed) << " MiB/s)" << std::endl;
+	};
+	for (;;) {
+		Item item;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&]() { return (
+			    (ready.count(nextToWrite) != 0) ||
+			    (walkDone && (nextToWrite == enumerated))); });
+			const auto it = ready.find(nextToWrite);
+			if (it == ready.end()) {
+				if (!walkError.empty()) {
+					std::cerr << walkError << std::endl;
+					status = EXIT_FAILURE;
+				}
+				break;
+			}
+			item = std::move(it->second);
+			ready.erase(it);
+		}
+
+		if (!item.error.empty()) {
+			std::cerr << item.error << std::endl;
+			status = EXIT_FAILURE;
+			break;
+		}
+		if (make_insert_record(item.filename, item.buffer, item.key,
+		    item.hash_value, rs, hash_rs, stopOnDuplicate) !=
+		    EXIT_SUCCESS) {
+			status = EXIT_FAILURE;
+			break;
+		}
+		insertedBytes += item.buffer.size();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			inFlightBytes -= item.buffer.size();
+			nextToWrite++;
+			cv.notify_all();
+		}
+		if (showProgress)
+			report(false);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+		cv.notify_all();
+	}
+	walker.join();
+	for (auto &reader : readers)
+		reader.join();
+
+	if (showProgress)
+		report(true);
+	return (status);
+}
+
 int
 makeListRecordStore(
     int argc,
@@ -1298,10 +2053,12 @@ int make(int argc, char *argv[])
 	bool compress = false;
 	BE::IO::Compressor::Kind compressorKind;
 	bool stopOnDuplicate = true;
+	unsigned int numThreads;
+	bool showProgress;
 
 	if (procargs_make(argc, argv, description, hash_pathname, what_to_hash,
 	    hashed_key_format, type, elements, compress, compressorKind,
-	    stopOnDuplicate) != EXIT_SUCCESS)
+	    stopOnDuplicate, numThreads, showProgress) != EXIT_SUCCESS)
 		return (EXIT_FAILURE);
 		
 	if (type == BE::IO::RecordStore::Kind::List) {
@@ -1332,32 +2089,8 @@ int make(int argc, char *argv[])
 		return (EXIT_FAILURE);
 	}
 
-	for (unsigned int i = 0; i < elements.size(); i++) {
-		if (BE::IO::Utility::pathIsDirectory(elements[i])) {
-			try {
-				/* Recursively insert contents of directory */
-				if (make_insert_directory_contents(
-				    BE::Text::basename(elements[i]),
-				    BE::Text::dirname(elements[i]),
-				    rs, hash_rs, what_to_hash,
-				    hashed_key_format,
-				    stopOnDuplicate) != EXIT_SUCCESS)
-			    		return (EXIT_FAILURE);
-			} catch (BE::Error::Exception &e) {
-				std::cerr << "Could not add contents of dir " <<
-				    elements[i] << " - " << e.what() <<
-				    std::endl;
-				return (EXIT_FAILURE);
-			}
-		} else {
-			if (make_insert_contents(elements[i], rs, hash_rs,
-			    what_to_hash, hashed_key_format,
-			    stopOnDuplicate) != EXIT_SUCCESS)
-				return (EXIT_FAILURE);
-		}
-	}
-
-	return (EXIT_SUCCESS);
+	return (make_insert_parallel(elements, rs, hash_rs, what_to_hash,
+	    hashed_key_format, stopOnDuplicate, numThreads, showProgress));
 }
 
 int
@@ -1474,93 +2207,69 @@ void mergeAndHashRecordStores(
     const HashablePart what_to_hash,
     const KeyFormat hashed_key_format)
 {
-	std::unique_ptr<BE::IO::RecordStore> merged_rs, hash_rs;
-	std::string hash_description = "Hash translation of " + mergedName;
-	if (kind == BE::IO::RecordStore::Kind::BerkeleyDB) {
-		merged_rs.reset(new BE::IO::DBRecordStore(mergedName,
-		    mergedDescription));
-		hash_rs.reset(new BE::IO::DBRecordStore(hashName,
-		    hash_description));
-	} else if (kind == BE::IO::RecordStore::Kind::Archive) {
-		merged_rs.reset(new BE::IO::ArchiveRecordStore(mergedName, 
-		    mergedDescription));
-		hash_rs.reset(new BE::IO::ArchiveRecordStore(hashName,
-		    hash_description));
-	} else if (kind == BE::IO::RecordStore::Kind::File) {
-		merged_rs.reset(new BE::IO::FileRecordStore(mergedName,
-		    mergedDescription));
-		hash_rs.reset(new BE::IO::FileRecordStore(hashName,
-		    hash_description));
-	} else if (kind == BE::IO::RecordStore::Kind::SQLite) {
-		merged_rs.reset(new BE::IO::SQLiteRecordStore(mergedName,
-		    mergedDescription));
-    		hash_rs.reset(new BE::IO::SQLiteRecordStore(hashName,
-		    hash_description));
-	} else if (kind == BE::IO::RecordStore::Kind::Compressed)
+	if ((kind == BE::IO::RecordStore::Kind::Compressed) ||
+	    (kind == BE::IO::RecordStore::Kind::List))
 		throw BE::Error::StrategyError("Invalid RecordStore type");
-	else
-		throw BE::Error::StrategyError("Unknown RecordStore type");
+	if (BE::IO::Utility::fileExists(mergedName))
+		throw BE::Error::ObjectExists(mergedName);
 
-	bool exhausted;
-	std::string hash;
-	std::shared_ptr<BE::IO::RecordStore> rs;
-	BE::IO::RecordStore::Record record;
-	for (size_t i = 0; i < recordStores.size(); i++) {
-		try {
-			rs = BE::IO::RecordStore::openRecordStore(
-			    recordStores[i], BE::IO::Mode::ReadOnly);
-		} catch (BE::Error::Exception &e) {
-			throw BE::Error::StrategyError(e.what());
+	std::string hash_description = "Hash translation of " + mergedName;
+	std::shared_ptr<BE::IO::RecordStore> hash_rs =
+	    BE::IO::RecordStore::createRecordStore(hashName, hash_description,
+	    kind);
+
+	/* Hashes are computed in parallel by the merge's worker threads */
+	const BE::IO::RecordStore::MergeTransform hashRecord =
+	    [what_to_hash, hashed_key_format](
+	    BE::IO::RecordStore::Record &record) {
+		std::string hash;
+		switch (what_to_hash) {
+		case HashablePart::FILECONTENTS:
+			hash = BE::Text::digest(record.data,
+			    record.data.size());
+			break;
+		case HashablePart::FILEPATH:
+			/*
+			 * We don't have a file's path
+			 * here since we're going from
+			 * RecordStore to RecordStore.
+			 */
+			/* FALLTHROUGH */
+		case HashablePart::FILENAME:
+			hash = BE::Text::digest(record.key);
+			break;
+		case HashablePart::NOTHING:
+			/* FALLTHROUGH */
+		default:
+			/* Don't hash */
+			break;
 		}
-		
-		exhausted = false;
-		while (!exhausted) {
-			try {
-				record = rs->sequence();
-				switch (what_to_hash) {
-				case HashablePart::FILECONTENTS:
-					hash = BE::Text::digest(
-					    record.data, record.data.size());
-					break;
-				case HashablePart::FILEPATH:
-					/*
-					 * We don't have a file's path
-					 * here since we're going from
-					 * RecordStore to RecordStore.
-					 */
-					/* FALLTHROUGH */
-				case HashablePart::FILENAME:
-					hash = BE::Text::digest(record.key);
-					break;
-				case HashablePart::NOTHING:
-					/* FALLTHROUGH */
-				default:
-					/* Don't hash */
-					break;
-				}
-				
-				switch (hashed_key_format) {
-				case KeyFormat::FILENAME:
-					/* FALLTHROUGH */
-				case KeyFormat::FILEPATH:
-					/* FALLTHROUGH */
-				default:
-					/*
-					 * We don't have a file's path
-					 * here since we're going from
-					 * RecordStore to RecordStore,
-					 * so not much we can do.
-					 */
-					break;
-				}
-				merged_rs->insert(hash, record.data);
-				hash_rs->insert(hash, record.key.c_str(),
-				    record.key.size() + 1);
-			} catch (BE::Error::ObjectDoesNotExist) {
-				exhausted = true;
-			}
+
+		switch (hashed_key_format) {
+		case KeyFormat::FILENAME:
+			/* FALLTHROUGH */
+		case KeyFormat::FILEPATH:
+			/* FALLTHROUGH */
+		default:
+			/*
+			 * We don't have a file's path
+			 * here since we're going from
+			 * RecordStore to RecordStore,
+			 * so not much we can do.
+			 */
+			break;
 		}
-	}
+		record.key = hash;
+	};
+
+	/* The hash translation is recorded by the merge's single writer */
+	const BE::IO::RecordStore::MergeCallback recordHash =
+	    [&hash_rs](const std::string &hash, const std::string &key) {
+		hash_rs->insert(hash, key.c_str(), key.size() + 1);
+	};
+
+	BE::IO::RecordStore::mergeRecordStores(mergedName, mergedDescription,
+	    kind, recordStores, hashRecord, recordHash);
 }
 
 int merge(int argc, char *argv[])
@@ -22,6 +22,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -48,7 +49,11 @@
 
 static std::string oflagval = ".";		/* Output directory */
 static std::string sflagval = "";		/* Path to main RecordStore */
-static const char optstr[] = "a:cfh:k:m:o:pqr:s:t:zZ:";
+/* Value of -o that writes a tar archive to stdout when dumping */
+static const std::string TAR_STDOUT = "-";
+/* Bytes read ahead of a single, ordered writer */
+static const uint64_t MAX_INFLIGHT_BYTES = 256 * 1024 * 1024;
+static const char optstr[] = "a:cfh:j:k:m:o:pqr:s:t:vzZ:";
 
 /* Possible actions performed by this utility */
 static const std::string ADD_ARG = "add";
@@ -210,6 +215,23 @@ BiometricEvaluation::IO::RecordStore::Kind
 validate_rs_type(
     const std::string &type);
 
+/**
+ * @brief
+ * Validate a thread count string.
+ *
+ * @param[in] count
+ *	String (likely entered by user) to check for validity.
+ *
+ * @return
+ *	Number of threads, at least 1.
+ *
+ * @throw BiometricEvaluation::Error::StrategyError
+ *	count is not a positive number that fits in an unsigned int.
+ */
+unsigned int
+validate_num_threads(
+    const std::string &count);
+
 /**
  * @brief
  * Process command-line arguments for the tool.
@@ -252,6 +274,8 @@ procargs(
  *	to hold a hash translation RecordStore.  Instantiating this RecordStore
  *	lets the driver know that the user would like the unhashed key to be
  *	used when the extraction takes place.
+ * @param[in/out] numThreads
+ *	Number of threads used to dump a range of records.
  *
  * @return
  *	An exit status, either EXIT_SUCCESS or EXIT_FAILURE.
@@ -264,7 +288,8 @@ procargs_extract(
     std::string &key,
     std::string &range,
     std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
-    std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs);
+    std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    unsigned int &numThreads);
 
 /**
  * @brief
@@ -322,6 +347,95 @@ int
 dump(
     const std::string &key,
     BiometricEvaluation::Memory::AutoArray<uint8_t> &value);
+
+/**
+ * @brief
+ * Write a record to a file with as few system calls as possible.
+ *
+ * @param[in] pathname
+ *	The path of the file to write.  Its directory must exist.
+ * @param[in] value
+ *	The contents of the file to write.
+ *
+ * @return
+ *	An exit status, either EXIT_SUCCESS or EXIT_FAILURE, that can be
+ *	returned from main().
+ */
+int
+dump_write_file(
+    const std::string &pathname,
+    const BiometricEvaluation::Memory::uint8Array &value);
+
+/**
+ * @brief
+ * Write a record as an entry of a tar archive.
+ *
+ * @param[in] fp
+ *	The stream to which the archive is written.
+ * @param[in] key
+ *	The name of the entry.
+ * @param[in] value
+ *	The contents of the entry.
+ *
+ * @return
+ *	An exit status, either EXIT_SUCCESS or EXIT_FAILURE, that can be
+ *	returned from main().
+ *
+ * @note
+ * Entries are ustar, using the GNU long name extension for names that
+ * do not fit in a ustar header.
+ */
+int
+dump_tar(
+    FILE *fp,
+    const std::string &key,
+    const BiometricEvaluation::Memory::uint8Array &value);
+
+/**
+ * @brief
+ * Write the end of a tar archive written with dump_tar().
+ *
+ * @param[in] fp
+ *	The stream to which the archive is written.
+ *
+ * @return
+ *	An exit status, either EXIT_SUCCESS or EXIT_FAILURE, that can be
+ *	returned from main().
+ */
+int
+dump_tar_finish(
+    FILE *fp);
+
+/**
+ * @brief
+ * Write a range of records to disk, or as a tar archive to stdout,
+ * using multiple threads.
+ *
+ * @param[in] rs
+ *	The RecordStore containing keys.
+ * @param[in] hash_rs
+ *	Hash translation RecordStore used to unhash keys, or nullptr.
+ * @param[in] keys
+ *	The keys to write.
+ * @param[in] numThreads
+ *	Maximum number of threads reading and writing records.
+ *
+ * @return
+ *	An exit status, either EXIT_SUCCESS or EXIT_FAILURE, that can be
+ *	returned from main().
+ *
+ * @note
+ * Threads claim batches of consecutive keys, and each thread reads from
+ * its own instance of the RecordStores.  Output directories are created
+ * before any records are written.  Tar entries are written in the order
+ * of keys.
+ */
+int
+dump_range(
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    const std::vector<std::string> &keys,
+    unsigned int numThreads);
 /**
  * @brief
  * Facilitates the extraction of a single key or a range of records from a 
@@ -395,6 +509,10 @@ listRecordStore(
  * @param[in] stopOnDuplicate
  *	Whether or not to stop when attempting to add a duplicate key into
  *	the data RecordStore.
+ * @param[in/out] numThreads
+ *	Number of threads that read files to be added.
+ * @param[in/out] showProgress
+ *	Whether or not to periodically report progress.
  *
  * @return
  *	An exit status, either EXIT_SUCCESS or EXIT_FAILURE, that can be
@@ -412,7 +530,80 @@ procargs_make(
     std::vector<std::string> &elements,
     bool &compress,
     BiometricEvaluation::IO::Compressor::Kind &compressorKind,
-    bool &stopOnDuplicate);
+    bool &stopOnDuplicate,
+    unsigned int &numThreads,
+    bool &showProgress);
+
+/**
+ * @brief
+ * Read the contents of a file and derive the key under which it
+ * should be inserted.
+ *
+ * @param[in] filename
+ *	The name of the file to read.
+ * @param[in] hashing
+ *	Whether or not the key should be a hash.
+ * @param[in] what_to_hash
+ *	What should be hashed when creating a hash for an entry.
+ * @param[in] hashed_key_format
+ *	How the key should be displayed in a hash translation RecordStore.
+ * @param[out] buffer
+ *	The contents of filename.
+ * @param[out] key
+ *	The key for the contents of filename.
+ * @param[out] hash_value
+ *	The value to store under key in a hash translation RecordStore, when
+ *	hashing.
+ *
+ * @throws BiometricEvaluation::Error::StrategyError
+ *	filename could not be read, or hashed_key_format is invalid.
+ *
+ * @note
+ * This function may be called from multiple threads at once.
+ */
+void
+make_read_contents(
+    const std::string &filename,
+    const bool hashing,
+    const HashablePart what_to_hash,
+    const KeyFormat hashed_key_format,
+    BiometricEvaluation::Memory::uint8Array &buffer,
+    std::string &key,
+    std::string &hash_value);
+
+/**
+ * @brief
+ * Insert a record previously read by make_read_contents().
+ *
+ * @param[in] filename
+ *	The name of the file that was read.
+ * @param[in] buffer
+ *	The contents of filename.
+ * @param[in] key
+ *	The key for buffer.
+ * @param[in] hash_value
+ *	The value to store under key in hash_rs.
+ * @param[in] rs
+ *	The RecordStore into which buffer should be inserted
+ * @param[in] hash_rs
+ *	The RecordStore into which hash translations should be stored
+ * @param[in] stopOnDuplicate
+ *	Whether or not to stop when attempting to add a duplicate key into
+ *	the data RecordStore.
+ *
+ * @return
+ *	An exit status, either EXIT_FAILURE or EXIT_SUCCESS, depending on if
+ *	buffer could be inserted.
+ */
+int
+make_insert_record(
+    const std::string &filename,
+    const BiometricEvaluation::Memory::uint8Array &buffer,
+    const std::string &key,
+    const std::string &hash_value,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    bool stopOnDuplicate);
 
 /**
  * @brief
@@ -482,6 +673,72 @@ make_insert_directory_contents(
     const KeyFormat hashed_key_format,
     bool stopOnDuplicate);
 
+/**
+ * @brief
+ * Call a function for each file within a directory tree.
+ *
+ * @param[in] dirpath
+ *	Path of the directory to traverse.
+ * @param[in] visit
+ *	Function called with the path of each file, in the order
+ *	make_insert_directory_contents() would insert them.  Traversal
+ *	ends when visit returns false.
+ *
+ * @throws BiometricEvaluation::Error::ObjectDoesNotExist
+ *	If the contents of the directory changes during the run
+ * @throws BiometricEvaluation::Error::StrategyError
+ *	Underlying problem in storage system
+ *
+ * @return
+ *	false if visit ended the traversal, true otherwise.
+ */
+bool
+make_walk_directory(
+    const std::string &dirpath,
+    const std::function<bool(const std::string&)> &visit);
+
+/**
+ * @brief
+ * Insert files and the contents of directories into a RecordStore,
+ * reading and hashing with multiple threads.
+ *
+ * @param[in] elements
+ *	Paths to files and directories to be inserted.
+ * @param[in] rs
+ *	The RecordStore into which files should be inserted
+ * @param[in] hash_rs
+ *	The RecordStore into which hash translations should be stored
+ * @param[in] what_to_hash
+ *	What should be hashed when creating a hash for an entry.
+ * @param[in] hashed_key_format
+ *	How the key should be displayed in the hash translation RecordStore.
+ * @param[in] stopOnDuplicate
+ *	Whether or not to stop if a duplicate key is detected.
+ * @param[in] numThreads
+ *	Number of threads reading and hashing files.
+ * @param[in] showProgress
+ *	Whether or not to report progress and throughput on stderr.
+ *
+ * @return
+ *	An exit status, either EXIT_SUCCESS or EXIT_FAILURE, that can be
+ *	returned from main().
+ *
+ * @note
+ * Records are inserted from the calling thread in the same order as
+ * make_insert_directory_contents(), regardless of numThreads.  The
+ * amount of data read but not yet inserted is bounded.
+ */
+int
+make_insert_parallel(
+    const std::vector<std::string> &elements,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &rs,
+    const std::shared_ptr<BiometricEvaluation::IO::RecordStore> &hash_rs,
+    const HashablePart what_to_hash,
+    const KeyFormat hashed_key_format,
+    bool stopOnDuplicate,
+    unsigned int numThreads,
+    bool showProgress);
+
 /**
  * @brief
  * Facilitates the creation of a ListRecordStore.